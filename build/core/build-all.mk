@@ -139,6 +139,18 @@ ifeq ($(HOST_OS),cygwin)
 clean: clean-dependency-converter
 endif
 	
-# include dependency information
 ALL_DEPENDENCY_DIRS := $(patsubst %/,%,$(sort $(ALL_DEPENDENCY_DIRS)))
+
+# Save everything read so far for the next runs, see build-local.mk. The
+# Cygwin dependency converter above is generated while reading, so it is
+# not saved there. Besides the makefiles, the files read by the $(shell)
+# calls of add-application.mk must not change.
+ifdef _ndk_db_file
+ifneq ($(HOST_OS),cygwin)
+$(ndk-database-save $(_ndk_db_file),$(_ndk_db_key),\
+    $(_local_props) $(APP_MANIFEST) $(wildcard $(BUILD_AWK)/*.awk))
+endif
+endif
+
+# include dependency information
 -include $(wildcard $(ALL_DEPENDENCY_DIRS:%=%/*.d))
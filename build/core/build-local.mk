@@ -37,6 +37,48 @@ ifneq ($(words $(NDK_ROOT)),1)
     $(error Aborting.)
 endif
 
+# When ndk-build runs with the GNU Make bundled with the NDK, everything the
+# makefiles below define is saved under the output directory once they have
+# been read, see build-all.mk, and the next runs include it instead of
+# reading them again. That stops as soon as one of the makefiles, the
+# directories they looked into, the environment variables they used, the
+# command line or the goals change. Define NDK_NO_DATABASE_CACHE to always
+# read the makefiles.
+#
+_ndk_db_file :=
+ifneq (,$(filter ndk-database,$(.FEATURES)))
+ifeq (,$(NDK_NO_DATABASE_CACHE)$(NDK_UNIT_TESTS)$(filter DUMP_%,$(MAKECMDGOALS)))
+    _ndk_db_dir := $(strip $(NDK_OUT))
+    ifndef _ndk_db_dir
+        ifneq (,$(filter-out null,$(strip $(NDK_PROJECT_PATH))))
+            _ndk_db_dir := $(strip $(NDK_PROJECT_PATH))/obj
+        else
+            ifeq (,$(strip $(NDK_PROJECT_PATH)))
+                _ndk_db_dir := $(if $(wildcard AndroidManifest.xml jni/Android.mk),obj)
+            endif
+        endif
+    endif
+    ifdef _ndk_db_dir
+        _ndk_db_file := $(_ndk_db_dir)/ndk-build-cache/database.mk
+        _ndk_db_key  := $(MAKECMDGOALS)
+    endif
+endif
+endif
+
+_ndk_db_loaded :=
+ifdef _ndk_db_file
+    ifeq (true,$(ndk-database-check $(_ndk_db_file),$(_ndk_db_key)))
+        include $(_ndk_db_file)
+        _ndk_db_loaded := true
+        $(call ndk_log,Using the makefiles data base $(_ndk_db_file))
+    endif
+endif
+
+ifeq (true,$(_ndk_db_loaded))
+# include dependency information, as build-all.mk does after saving
+-include $(wildcard $(ALL_DEPENDENCY_DIRS:%=%/*.d))
+else
+
 include $(NDK_ROOT)/build/core/init.mk
 
 # ====================================================================
@@ -190,3 +232,5 @@ else
     # Build it
     include $(BUILD_SYSTEM)/build-all.mk
 endif
+
+endif # _ndk_db_loaded
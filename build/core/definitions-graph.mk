@@ -42,6 +42,11 @@ else
 -ndk-topo-debug = $(empty)
 endif
 
+# The GNU Make bundled with the NDK implements the closure and topological
+# sort below natively, with the same results. They replace the macros when
+# available, unless NDK_NO_NATIVE_GRAPH is defined.
+_ndk_mod_native := $(if $(NDK_NO_NATIVE_GRAPH),,$(if $(filter ndk-graph,$(.FEATURES)),true))
+
 #######################################################################
 # Filter a list of module with a predicate function
 # $1: list of module names.
@@ -230,6 +235,10 @@ endif
     )\
     $(if $(_ndk_mod_wq),$(call -ndk-mod-closure-recursive))
 
+ifeq (true,$(_ndk_mod_native))
+-ndk-mod-get-closure = $(ndk-closure $1,$2)
+endif
+
 -test-ndk-mod-get-closure.empty = \
     $(eval -local-deps = $$($$1_depends))\
     $(call test-expect,,$(call -ndk-mod-get-closure,,-local-deps))
@@ -358,6 +367,10 @@ endif
         $(call -ndk-mod-topo-sort)\
     )
 
+ifeq (true,$(_ndk_mod_native))
+-ndk-mod-get-topo-list = $(ndk-toposort $1,$2)
+endif
+
 
 -test-ndk-mod-get-topo-list.empty = \
     $(eval -local-deps = $$($$1_depends))\
@@ -456,6 +469,10 @@ endif
     )\
     $(if $(_ndk_mod_wq),$(call -ndk-mod-bfs-recursive))
 
+ifeq (true,$(_ndk_mod_native))
+-ndk-mod-get-bfs-list = $(ndk-closure $(call strip-lib-prefix,$1),$2)
+endif
+
 -test-ndk-mod-get-bfs-list.empty = \
     $(eval -local-deps = $$($$1_depends))\
     $(call test-expect,,$(call -ndk-mod-get-bfs-list,,-local-deps))
@@ -408,6 +408,9 @@ ifeq ($(HOST_OS),cygwin)
             $(call __ndk_error,Aborting)
         endif
         $(call ndk_log, Forced usage of 'cygpath -m' through NDK_USE_CYGPATH=1)
+        # The same paths are converted for each source file: let a GNU Make
+        # that supports it run 'cygpath -m' once per path.
+        .SHELL_MEMO += $(CYGPATH)
         cygwin-to-host-path = $(strip $(shell $(CYGPATH) -m $1))
     else
         # Call an awk script to generate a Makefile fragment used to define a function
@@ -31,6 +31,8 @@
 #define _CRYSTAX_JUTILS_HPP_e6ec1ce9928d459eae2faf1df240509a
 
 #include <jni.h>
+#include <stddef.h>
+#include <stdlib.h>
 
 namespace crystax
 {
@@ -155,10 +157,111 @@ T jcast(U const &v)
     return details::jcast_helper<T, U>::cast(v);
 }
 
+// Copy modified UTF-8 representation of 'str' into 'buf', always
+// NUL-terminating it (if 'size' != 0). Return number of bytes needed
+// for the whole string (not counting terminating NUL), so result >= size
+// means output was truncated. Return (size_t)-1 on error.
+size_t jstring_to_utf(JNIEnv *env, jstring str, char *buf, size_t size);
+
+inline
+size_t jstring_to_utf(jstring str, char *buf, size_t size)
+{
+    return jstring_to_utf(jnienv(), str, buf, size);
+}
+
+// Scoped UTF-8 copy of java string. Short strings are converted into
+// inline storage, so no heap allocation happens for them.
+template <size_t N = 256>
+class jstring_chars
+{
+public:
+    jstring_chars(JNIEnv *env, jstring str)
+        :heap(0), len(0)
+    {
+        init(env, str);
+    }
+
+    explicit jstring_chars(jstring str)
+        :heap(0), len(0)
+    {
+        init(jnienv(), str);
+    }
+
+    template <typename T>
+    explicit jstring_chars(jholder<T> const &str)
+        :heap(0), len(0)
+    {
+        init(jnienv(), (jstring)str.get());
+    }
+
+    ~jstring_chars() {::free(heap);}
+
+    const char *c_str() const {return heap ? heap : (len == (size_t)-1 ? 0 : inl);}
+    size_t length() const {return len;}
+
+private:
+    jstring_chars(jstring_chars const &);
+    jstring_chars &operator=(jstring_chars const &);
+
+    void init(JNIEnv *env, jstring str)
+    {
+        len = str ? jstring_to_utf(env, str, inl, N) : (size_t)-1;
+        if (len == (size_t)-1 || len < N)
+            return;
+        heap = (char *)::malloc(len + 1);
+        if (!heap || jstring_to_utf(env, str, heap, len + 1) != len)
+        {
+            ::free(heap);
+            heap = 0;
+            len = (size_t)-1;
+        }
+    }
+
+private:
+    char inl[N];
+    char *heap;
+    size_t len;
+};
+
+// Interned lookups. Classes are kept as global references, method and field
+// IDs are remembered per (class name, name, signature) until the JVM unloads
+// the library, so only the first call for a given key goes through
+// FindClass/Get*ID. Lookups of already cached keys don't lock anything.
+jclass cached_class(JNIEnv *env, const char *clsname);
+inline jclass cached_class(const char *clsname) {return cached_class(jnienv(), clsname);}
+
+jmethodID cached_method_id(JNIEnv *env, const char *clsname, const char *name, const char *signature);
+inline jmethodID cached_method_id(const char *clsname, const char *name, const char *signature)
+{
+    return cached_method_id(jnienv(), clsname, name, signature);
+}
+
+jmethodID cached_static_method_id(JNIEnv *env, const char *clsname, const char *name, const char *signature);
+inline jmethodID cached_static_method_id(const char *clsname, const char *name, const char *signature)
+{
+    return cached_static_method_id(jnienv(), clsname, name, signature);
+}
+
+jfieldID cached_field_id(JNIEnv *env, const char *clsname, const char *name, const char *signature);
+inline jfieldID cached_field_id(const char *clsname, const char *name, const char *signature)
+{
+    return cached_field_id(jnienv(), clsname, name, signature);
+}
+
+jfieldID cached_static_field_id(JNIEnv *env, const char *clsname, const char *name, const char *signature);
+inline jfieldID cached_static_field_id(const char *clsname, const char *name, const char *signature)
+{
+    return cached_static_field_id(jnienv(), clsname, name, signature);
+}
+
+// Drop all cached entries (releasing global references)
+void clear_cache(JNIEnv *env);
+
 inline
 jhclass find_class(JNIEnv *env, const char *clsname)
 {
-    return jhclass((jclass)env->FindClass(clsname));
+    jclass cls = cached_class(env, clsname);
+    return jhclass(cls ? (jclass)env->NewLocalRef(cls) : 0);
 }
 
 inline
@@ -281,7 +384,7 @@ inline void jthrow(jhthrowable const &ex) {jthrow(jnienv(), ex);}
 inline void jthrow(JNIEnv *env, jhclass const &cls, char const *what) {env->ThrowNew(cls.get(), what);}
 inline void jthrow(jhclass const &cls, char const *what) {jthrow(jnienv(), cls, what);}
 
-inline void jthrow(JNIEnv *env, char const *clsname, char const *what) {jthrow(find_class(env, clsname), what);}
+inline void jthrow(JNIEnv *env, char const *clsname, char const *what) {env->ThrowNew(cached_class(env, clsname), what);}
 inline void jthrow(char const *clsname, char const *what) {jthrow(jnienv(), clsname, what);}
 
 bool jexcheck(JNIEnv *env);
@@ -417,7 +520,7 @@ Ret get_field(jholder<T> const &obj, const char *name, const char *signature)
 template <typename Ret>
 Ret get_field(JNIEnv *env, const char *clsname, const char *name, const char *signature)
 {
-    return get_field<Ret>(env, find_class(clsname), name, signature);
+    return get_field<Ret>(env, find_class(env, clsname), cached_static_field_id(env, clsname, name, signature));
 }
 
 template <typename Ret>
@@ -467,7 +570,7 @@ Ret get_static_field(jholder<T> const &obj, const char *name, const char *signat
 template <typename Ret>
 Ret get_static_field(JNIEnv *env, const char *clsname, const char *name, const char *signature)
 {
-    return get_static_field<Ret>(env, find_class(env, clsname), name, signature);
+    return get_field<Ret>(env, find_class(env, clsname), cached_static_field_id(env, clsname, name, signature));
 }
 
 template <typename Ret>
@@ -541,7 +644,7 @@ void set_field(jholder<T> const &obj, const char *name, const char *signature, A
 template <typename Arg>
 void set_field(JNIEnv *env, const char *clsname, const char *name, const char *signature, Arg const &arg)
 {
-    set_field(env, find_class(clsname), name, signature, arg);
+    set_field(env, find_class(env, clsname), cached_static_field_id(env, clsname, name, signature), arg);
 }
 
 template <typename Arg>
@@ -591,7 +694,7 @@ void set_static_field(jholder<T> const &obj, const char *name, const char *signa
 template <typename Arg>
 void set_static_field(JNIEnv *env, const char *clsname, const char *name, const char *signature, Arg const &arg)
 {
-    set_static_field(env, find_class(env, clsname), name, signature, arg);
+    set_field(env, find_class(env, clsname), cached_static_field_id(env, clsname, name, signature), arg);
 }
 
 template <typename Arg>
@@ -729,7 +832,8 @@ Ret call_method(T const &obj, const char *name, const char *signature, Args&&...
 template <typename Ret, typename... Args>
 Ret call_method(JNIEnv *env, const char *clsname, const char *name, const char *signature, Args&&... args)
 {
-    return call_method<Ret>(env, find_class(clsname), name, signature, details::forward<Args>(args)...);
+    return call_method<Ret>(env, find_class(env, clsname), cached_static_method_id(env, clsname, name, signature),
+        details::forward<Args>(args)...);
 }
 
 template <typename Ret, typename... Args>
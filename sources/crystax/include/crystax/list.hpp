@@ -71,6 +71,7 @@ public:
         if (after) after->prev = node;
         node->prev = before;
         node->next = after;
+        if (before == ptail) ptail = node;
         ++sz;
         return true;
     }
@@ -95,13 +96,19 @@ public:
 
     bool push_front(T *node)
     {
+        if (!node) return false;
         if (!phead)
         {
             phead = ptail = node;
             sz = 1;
             return true;
         }
-        return push(phead, node);
+        node->prev = 0;
+        node->next = phead;
+        phead->prev = node;
+        phead = node;
+        ++sz;
+        return true;
     }
 
     bool push_back(T *node)
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#ifndef _CRYSTAX_LOCALE_H_112beec1f0724f95a064a7f2f935b4ff
+#define _CRYSTAX_LOCALE_H_112beec1f0724f95a064a7f2f935b4ff
+
+#include <stddef.h>
+#include <wchar.h>
+#include <locale.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Locale data by name, apart from setlocale(). Each category of a named
+ * locale is loaded on first request and then kept read-only for the life
+ * of the process, so the returned pointers may be held on to and used from
+ * any thread without locking, whatever the current locale is. Getters
+ * return NULL with errno set (ENOENT for an unknown name) on failure; "C"
+ * and "POSIX" are always available, and categories a known locale has no
+ * data for get the "C" values.
+ */
+
+/* Character classes, as returned by crystax_locale_ctype_class() */
+#define CRYSTAX_LOCALE_ALPHA    0x00000100UL
+#define CRYSTAX_LOCALE_CNTRL    0x00000200UL
+#define CRYSTAX_LOCALE_DIGIT    0x00000400UL
+#define CRYSTAX_LOCALE_GRAPH    0x00000800UL
+#define CRYSTAX_LOCALE_LOWER    0x00001000UL
+#define CRYSTAX_LOCALE_PUNCT    0x00002000UL
+#define CRYSTAX_LOCALE_SPACE    0x00004000UL
+#define CRYSTAX_LOCALE_UPPER    0x00008000UL
+#define CRYSTAX_LOCALE_XDIGIT   0x00010000UL
+#define CRYSTAX_LOCALE_BLANK    0x00020000UL
+#define CRYSTAX_LOCALE_PRINT    0x00040000UL
+
+struct crystax_locale_ctype;
+struct crystax_locale_collate;
+
+/*
+ * LC_CTYPE. Only encodings with stateless conversion functions are
+ * available this way: single byte ones, ASCII and UTF-8.
+ */
+const struct crystax_locale_ctype *crystax_locale_ctype(const char *name);
+/* "NONE", "ASCII" or "UTF-8" */
+const char *crystax_locale_ctype_encoding(const struct crystax_locale_ctype *ct);
+int crystax_locale_ctype_mb_cur_max(const struct crystax_locale_ctype *ct);
+unsigned long crystax_locale_ctype_class(const struct crystax_locale_ctype *ct, wint_t wc);
+wint_t crystax_locale_ctype_toupper(const struct crystax_locale_ctype *ct, wint_t wc);
+wint_t crystax_locale_ctype_tolower(const struct crystax_locale_ctype *ct, wint_t wc);
+/* As mbrtowc(), wcrtomb() and mbsinit() in the encoding of ct; ps may not be NULL */
+size_t crystax_locale_mbrtowc(const struct crystax_locale_ctype *ct, wchar_t *pwc,
+    const char *s, size_t n, mbstate_t *ps);
+size_t crystax_locale_wcrtomb(const struct crystax_locale_ctype *ct, char *s,
+    wchar_t wc, mbstate_t *ps);
+int crystax_locale_mbsinit(const struct crystax_locale_ctype *ct, const mbstate_t *ps);
+
+/*
+ * LC_NUMERIC and LC_MONETARY, as localeconv() would report them after
+ * setlocale(LC_NUMERIC, name) or setlocale(LC_MONETARY, name); members of
+ * the other category keep their "C" values.
+ */
+const struct lconv *crystax_locale_numeric(const char *name);
+const struct lconv *crystax_locale_monetary(const char *name);
+
+/* LC_COLLATE. Without collation data strings compare as bytes. */
+const struct crystax_locale_collate *crystax_locale_collate(const char *name);
+int crystax_locale_strcoll(const struct crystax_locale_collate *co,
+    const char *s1, const char *s2);
+size_t crystax_locale_strxfrm(const struct crystax_locale_collate *co,
+    char *dst, const char *src, size_t n);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _CRYSTAX_LOCALE_H_112beec1f0724f95a064a7f2f935b4ff */
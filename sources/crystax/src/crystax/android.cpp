@@ -181,8 +181,12 @@ jint crystax_jni_on_load(JavaVM *vm)
 }
 
 CRYSTAX_GLOBAL
-void crystax_jni_on_unload(JavaVM * /* vm */)
+void crystax_jni_on_unload(JavaVM *vm)
 {
     TRACE;
+    JNIEnv *env = NULL;
+    if (vm->GetEnv((void**)&env, JNI_VERSION_1_4) != JNI_OK)
+        env = NULL;
+    ::crystax::jni::clear_cache(env);
     ::crystax::s_jvm = NULL;
 }
@@ -30,6 +30,7 @@
 #include <crystax.h>
 
 #include "crystax/private.h"
+#include "crystax/lock.hpp"
 
 namespace crystax
 {
@@ -42,9 +43,26 @@ namespace details
 const char * jcast_helper<const char *, jstring>::cast(jstring const &v)
 {
     JNIEnv *env = jnienv();
-    const char *s = env->GetStringUTFChars(v, JNI_FALSE);
-    const char *ret = ::strdup(s);
-    env->ReleaseStringUTFChars(v, s);
+    if (!v)
+        return NULL;
+
+    // Each UTF-16 unit takes at most three bytes in modified UTF-8, so a
+    // buffer of that size is always big enough and the string can be
+    // converted right into it, without a temporary copy
+    jsize n = env->GetStringLength(v);
+    if (env->ExceptionCheck())
+        return NULL;
+    size_t size = (size_t)n * 3 + 1;
+    char *ret = (char *)::malloc(size);
+    if (!ret)
+        return NULL;
+    ::memset(ret, 0, size);
+    env->GetStringUTFRegion(v, 0, n, ret);
+    if (env->ExceptionCheck())
+    {
+        ::free(ret);
+        return NULL;
+    }
     return ret;
 }
 
@@ -194,6 +212,250 @@ template <> const char *jni_signature<jhobjectArray>::signature = "[Ljava/lang/O
 
 } // namespace details
 
+size_t jstring_to_utf(JNIEnv *env, jstring str, char *buf, size_t size)
+{
+    jsize n = env->GetStringLength(str);
+    if (env->ExceptionCheck())
+        return (size_t)-1;
+
+    size_t len;
+    if ((size_t)n * 3 < size)
+    {
+        // Fits for sure; modified UTF-8 never contains zero bytes, so
+        // pre-zeroed buffer gives us both terminator and length
+        ::memset(buf, 0, (size_t)n * 3 + 1);
+        env->GetStringUTFRegion(str, 0, n, buf);
+        len = ::strlen(buf);
+    }
+    else
+    {
+        len = (size_t)env->GetStringUTFLength(str);
+        if (len < size)
+        {
+            env->GetStringUTFRegion(str, 0, n, buf);
+            buf[len] = '\0';
+        }
+        else if (size > 0)
+        {
+            // Truncate to the longest prefix which surely fits
+            jsize k = (jsize)((size - 1) / 3);
+            ::memset(buf, 0, (size_t)k * 3 + 1);
+            env->GetStringUTFRegion(str, 0, k, buf);
+        }
+    }
+
+    if (env->ExceptionCheck())
+        return (size_t)-1;
+    return len;
+}
+
+namespace
+{
+
+enum cache_kind_t
+{
+    CACHE_CLASS,
+    CACHE_METHOD,
+    CACHE_STATIC_METHOD,
+    CACHE_FIELD,
+    CACHE_STATIC_FIELD
+};
+
+struct cache_entry_t
+{
+    cache_entry_t *next;
+    unsigned hash;
+    cache_kind_t kind;
+    void *value;
+    // "clsname\0name\0signature\0"
+    char key[1];
+};
+
+const unsigned CACHE_BUCKETS = 256;
+
+cache_entry_t *volatile cache[CACHE_BUCKETS];
+pthread_mutex_t cache_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned cache_hash(cache_kind_t kind, const char *clsname, const char *name, const char *signature)
+{
+    // FNV-1a over all key components, including terminators
+    unsigned h = 2166136261U ^ (unsigned)kind;
+    const char *parts[] = {clsname, name, signature};
+    for (size_t i = 0; i < sizeof(parts)/sizeof(parts[0]); ++i)
+    {
+        for (const char *p = parts[i]; ; ++p)
+        {
+            h = (h ^ (unsigned char)*p) * 16777619U;
+            if (*p == '\0')
+                break;
+        }
+    }
+    return h;
+}
+
+bool cache_key_equal(cache_entry_t const *e, cache_kind_t kind, const char *clsname, const char *name, const char *signature)
+{
+    if (e->kind != kind)
+        return false;
+    const char *k = e->key;
+    if (::strcmp(k, clsname) != 0)
+        return false;
+    k += ::strlen(k) + 1;
+    if (::strcmp(k, name) != 0)
+        return false;
+    k += ::strlen(k) + 1;
+    return ::strcmp(k, signature) == 0;
+}
+
+cache_entry_t *cache_find(unsigned hash, cache_kind_t kind, const char *clsname, const char *name, const char *signature)
+{
+    cache_entry_t *e = cache[hash % CACHE_BUCKETS];
+    // Pairs with barrier in cache_insert(); entries are immutable once published
+    __sync_synchronize();
+    for (; e; e = e->next)
+        if (e->hash == hash && cache_key_equal(e, kind, clsname, name, signature))
+            return e;
+    return NULL;
+}
+
+void *cache_insert(unsigned hash, cache_kind_t kind, const char *clsname, const char *name, const char *signature,
+    void *value)
+{
+    size_t clen = ::strlen(clsname) + 1;
+    size_t nlen = ::strlen(name) + 1;
+    size_t slen = ::strlen(signature) + 1;
+
+    cache_entry_t *e = (cache_entry_t *)::malloc(sizeof(cache_entry_t) + clen + nlen + slen);
+    if (!e)
+        return value;
+
+    e->hash = hash;
+    e->kind = kind;
+    e->value = value;
+    ::memcpy(e->key, clsname, clen);
+    ::memcpy(e->key + clen, name, nlen);
+    ::memcpy(e->key + clen + nlen, signature, slen);
+
+    cache_entry_t *volatile &head = cache[hash % CACHE_BUCKETS];
+    e->next = head;
+    __sync_synchronize();
+    head = e;
+    return value;
+}
+
+jclass cache_class(JNIEnv *env, unsigned hash, const char *clsname)
+{
+    scope_lock_t guard(cache_mtx);
+
+    // Somebody could insert it while we were waiting for lock
+    cache_entry_t *e = cache_find(hash, CACHE_CLASS, clsname, "", "");
+    if (e)
+        return (jclass)e->value;
+
+    jclass lcls = env->FindClass(clsname);
+    if (!lcls)
+        return NULL;
+    jclass gcls = (jclass)env->NewGlobalRef(lcls);
+    env->DeleteLocalRef(lcls);
+    if (!gcls)
+        return NULL;
+
+    return (jclass)cache_insert(hash, CACHE_CLASS, clsname, "", "", gcls);
+}
+
+void *cache_member(JNIEnv *env, cache_kind_t kind, const char *clsname, const char *name, const char *signature)
+{
+    unsigned hash = cache_hash(kind, clsname, name, signature);
+    cache_entry_t *e = cache_find(hash, kind, clsname, name, signature);
+    if (e)
+        return e->value;
+
+    jclass cls = cached_class(env, clsname);
+    if (!cls)
+        return NULL;
+
+    scope_lock_t guard(cache_mtx);
+
+    e = cache_find(hash, kind, clsname, name, signature);
+    if (e)
+        return e->value;
+
+    void *value = NULL;
+    switch (kind)
+    {
+    case CACHE_METHOD:
+        value = (void *)env->GetMethodID(cls, name, signature);
+        break;
+    case CACHE_STATIC_METHOD:
+        value = (void *)env->GetStaticMethodID(cls, name, signature);
+        break;
+    case CACHE_FIELD:
+        value = (void *)env->GetFieldID(cls, name, signature);
+        break;
+    case CACHE_STATIC_FIELD:
+        value = (void *)env->GetStaticFieldID(cls, name, signature);
+        break;
+    default:
+        break;
+    }
+
+    // Failed lookups leave java exception pending and are not cached
+    if (!value)
+        return NULL;
+
+    return cache_insert(hash, kind, clsname, name, signature, value);
+}
+
+} // anonymous namespace
+
+jclass cached_class(JNIEnv *env, const char *clsname)
+{
+    unsigned hash = cache_hash(CACHE_CLASS, clsname, "", "");
+    cache_entry_t *e = cache_find(hash, CACHE_CLASS, clsname, "", "");
+    if (e)
+        return (jclass)e->value;
+    return cache_class(env, hash, clsname);
+}
+
+jmethodID cached_method_id(JNIEnv *env, const char *clsname, const char *name, const char *signature)
+{
+    return (jmethodID)cache_member(env, CACHE_METHOD, clsname, name, signature);
+}
+
+jmethodID cached_static_method_id(JNIEnv *env, const char *clsname, const char *name, const char *signature)
+{
+    return (jmethodID)cache_member(env, CACHE_STATIC_METHOD, clsname, name, signature);
+}
+
+jfieldID cached_field_id(JNIEnv *env, const char *clsname, const char *name, const char *signature)
+{
+    return (jfieldID)cache_member(env, CACHE_FIELD, clsname, name, signature);
+}
+
+jfieldID cached_static_field_id(JNIEnv *env, const char *clsname, const char *name, const char *signature)
+{
+    return (jfieldID)cache_member(env, CACHE_STATIC_FIELD, clsname, name, signature);
+}
+
+void clear_cache(JNIEnv *env)
+{
+    scope_lock_t guard(cache_mtx);
+
+    for (unsigned i = 0; i < CACHE_BUCKETS; ++i)
+    {
+        cache_entry_t *e = cache[i];
+        cache[i] = NULL;
+        while (e)
+        {
+            cache_entry_t *next = e->next;
+            if (e->kind == CACHE_CLASS && env)
+                env->DeleteGlobalRef((jclass)e->value);
+            ::free(e);
+            e = next;
+        }
+    }
+}
+
 bool jexcheck(JNIEnv *env)
 {
     jhthrowable jex(env->ExceptionOccurred());
@@ -36,6 +36,9 @@
 #include <sys/ioctl.h>
 #include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <signal.h>
 #include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -223,6 +226,9 @@ int system_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 int system_dirfd(DIR *dirp);
 int system_dup(int fd);
 int system_dup2(int fd, int fd2);
+int system_epoll_create(int size);
+int system_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int system_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
 int system_fchdir(int fd);
 int system_fchown(int fd, uid_t uid, gid_t gid);
 int system_fcntl(int fd, int command, ...);
@@ -248,13 +254,15 @@ off_t system_lseek(int fd, off_t offset, int whence);
 loff_t system_lseek64(int fd, loff_t offset, int whence);
 int system_lstat(const char *path, struct stat *st);
 int system_mkdir(const char *path, mode_t mode);
-int system_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+void *system_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 int system_mount(const char *source, const char *target, const char *fstype,
     unsigned long flags, const void *data);
 int system_open(const char *path, int oflag, ...);
 int system_open_v(const char *path, int oflag, va_list &vl);
 DIR *system_opendir(const char *dirpath);
 int system_pipe(int pipefd[2]);
+int system_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+int system_ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const sigset_t *sigmask);
 ssize_t system_pread(int fd, void *buf, size_t count, off_t offset);
 ssize_t system_pwrite(int fd, const void *buf, size_t count, off_t offset);
 int system_pthread_create(pthread_t *pth, pthread_attr_t const *pattr, void * (*func)(void *), void *arg);
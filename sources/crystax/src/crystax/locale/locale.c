@@ -76,6 +76,7 @@ __crystax_locale_whole_data_t __crystax_locale_whole_data[] =
 extern int __crystax_locale_UTF8_init();
 extern int __crystax_locale_el_GR_ISO88597_init();
 extern int __crystax_locale_la_LN_USASCII_init();
+extern int __crystax_locale_la_LN_USASCII_LC_COLLATE_init();
 extern int __crystax_locale_la_LN_ISO88591_init();
 
 int __crystax_locale_init_impl()
@@ -85,6 +86,7 @@ int __crystax_locale_init_impl()
     if (__crystax_locale_UTF8_init() < 0) return -1;
     if (__crystax_locale_el_GR_ISO88597_init() < 0) return -1;
     if (__crystax_locale_la_LN_USASCII_init() < 0) return -1;
+    if (__crystax_locale_la_LN_USASCII_LC_COLLATE_init() < 0) return -1;
     if (__crystax_locale_la_LN_ISO88591_init() < 0) return -1;
 
     DBG("initialization finished");
@@ -88,6 +88,14 @@ static size_t	_ascii_wcrtomb(char * __restrict, wchar_t,
 static size_t	_ascii_wcsnrtombs(char * __restrict, const wchar_t ** __restrict,
 		    size_t, size_t, mbstate_t * __restrict);
 
+const struct __mbops __ascii_mbops = {
+	_ascii_mbrtowc,
+	_ascii_mbsinit,
+	_ascii_wcrtomb,
+	1,
+	128
+};
+
 int
 _ascii_init(_RuneLocale *rl)
 {
@@ -79,44 +79,42 @@ int __collate_substitute_nontrivial;
 u_char __collate_substitute_table[UCHAR_MAX + 1][STR_LEN];
 struct __collate_st_char_pri __collate_char_pri_table[UCHAR_MAX + 1];
 struct __collate_st_chain_pri *__collate_chain_pri_table;
+struct __collate_st_compiled *__collate_compiled;
+
+/* Largest rank the two byte sort key encoding can represent. */
+#define COLLATE_MAX_RANK (0x80 + 0x80 * 255 - 2)
 
 void __collate_err(int ex, const char *f) __dead2;
 
-int
-__collate_load_tables(const char *encoding)
+static struct __collate_st_compiled *__collate_compile(
+    u_char (*)[STR_LEN], struct __collate_st_char_pri *,
+    struct __collate_st_chain_pri *, int);
+
+/*
+ * Read the raw tables of 'encoding' and compile them. On success the caller
+ * owns all four allocations.
+ */
+static int
+__collate_read_tables(const char *encoding, void **substitute_table,
+    void **char_pri_table, void **chain_pri_table,
+    struct __collate_st_compiled **compiled)
 {
 	__crystax_locale_data_t *ld;
-    int fpos;
+	int fpos;
 	int i, saverr, chains;
 	uint32_t u32;
-	char strbuf[STR_LEN], buf[PATH_MAX];
+	char strbuf[STR_LEN];
 	void *TMP_substitute_table, *TMP_char_pri_table, *TMP_chain_pri_table;
-	static char collate_encoding[ENCODING_LEN + 1];
+	struct __collate_st_compiled *TMP_compiled;
 
-	/* 'encoding' must be already checked. */
-	if (strcmp(encoding, "C") == 0 || strcmp(encoding, "POSIX") == 0) {
-		__collate_load_error = 1;
-		return (_LDP_CACHE);
-	}
-
-	/*
-	 * If the locale name is the same as our cache, use the cache.
-	 */
-	if (strcmp(encoding, collate_encoding) == 0) {
-		__collate_load_error = 0;
-		return (_LDP_CACHE);
+	ld = __crystax_locale_get_data(LC_COLLATE, encoding);
+	if (ld == NULL || ld->data == NULL) {
+		errno = ENOENT;
+		return (_LDP_ERROR);
 	}
 
-	/*
-	 * Slurp the locale file into the cache.
-	 */
-
-    ld = __crystax_locale_get_data(LC_COLLATE, encoding);
-    if (ld == NULL)
-        return (_LDP_ERROR);
-
-    (void)strncpy(strbuf, ld->data, sizeof(strbuf));
-    fpos = sizeof(strbuf);
+	(void)strncpy(strbuf, ld->data, sizeof(strbuf));
+	fpos = sizeof(strbuf);
 	chains = -1;
 	if (strcmp(strbuf, COLLATE_VERSION) == 0)
 		chains = 0;
@@ -127,8 +125,8 @@ __collate_load_tables(const char *encoding)
 		return (_LDP_ERROR);
 	}
 	if (chains) {
-        u32 = *(uint32_t *)(ld->data + fpos);
-        fpos += sizeof(u32);
+		memcpy(&u32, ld->data + fpos, sizeof(u32));
+		fpos += sizeof(u32);
 		if ((chains = (int)ntohl(u32)) < 1) {
 			errno = EFTYPE;
 			return (_LDP_ERROR);
@@ -168,6 +166,65 @@ __collate_load_tables(const char *encoding)
 	FREAD(TMP_char_pri_table, sizeof(__collate_char_pri_table));
 	FREAD(TMP_chain_pri_table, sizeof(*__collate_chain_pri_table) * chains);
 
+	for (i = 0; (unsigned)i < UCHAR_MAX + 1; i++) {
+		struct __collate_st_char_pri *p =
+		    &((struct __collate_st_char_pri *)TMP_char_pri_table)[i];
+		p->prim = ntohl(p->prim);
+		p->sec = ntohl(p->sec);
+	}
+	for (i = 0; i < chains; i++) {
+		struct __collate_st_chain_pri *p =
+		    &((struct __collate_st_chain_pri *)TMP_chain_pri_table)[i];
+		p->prim = ntohl(p->prim);
+		p->sec = ntohl(p->sec);
+	}
+	if ((TMP_compiled = __collate_compile(TMP_substitute_table,
+	    TMP_char_pri_table, TMP_chain_pri_table, chains)) == NULL) {
+		saverr = errno;
+		free(TMP_substitute_table);
+		free(TMP_char_pri_table);
+		free(TMP_chain_pri_table);
+		errno = saverr;
+		return (_LDP_ERROR);
+	}
+
+	*substitute_table = TMP_substitute_table;
+	*char_pri_table = TMP_char_pri_table;
+	*chain_pri_table = TMP_chain_pri_table;
+	*compiled = TMP_compiled;
+	return (_LDP_LOADED);
+}
+
+int
+__collate_load_tables(const char *encoding)
+{
+	int i;
+	void *TMP_substitute_table, *TMP_char_pri_table, *TMP_chain_pri_table;
+	struct __collate_st_compiled *TMP_compiled;
+	static char collate_encoding[ENCODING_LEN + 1];
+
+	/* 'encoding' must be already checked. */
+	if (strcmp(encoding, "C") == 0 || strcmp(encoding, "POSIX") == 0) {
+		__collate_load_error = 1;
+		return (_LDP_CACHE);
+	}
+
+	/*
+	 * If the locale name is the same as our cache, use the cache.
+	 */
+	if (strcmp(encoding, collate_encoding) == 0) {
+		__collate_load_error = 0;
+		return (_LDP_CACHE);
+	}
+
+	/*
+	 * Slurp the locale file into the cache.
+	 */
+	if (__collate_read_tables(encoding, &TMP_substitute_table,
+	    &TMP_char_pri_table, &TMP_chain_pri_table,
+	    &TMP_compiled) != _LDP_LOADED)
+		return (_LDP_ERROR);
+
 	(void)strcpy(collate_encoding, encoding);
 	if (__collate_substitute_table_ptr != NULL)
 		free(__collate_substitute_table_ptr);
@@ -175,25 +232,15 @@ __collate_load_tables(const char *encoding)
 	if (__collate_char_pri_table_ptr != NULL)
 		free(__collate_char_pri_table_ptr);
 	__collate_char_pri_table_ptr = TMP_char_pri_table;
-	for (i = 0; (unsigned)i < UCHAR_MAX + 1; i++) {
-		__collate_char_pri_table[i].prim =
-		    ntohl(__collate_char_pri_table[i].prim);
-		__collate_char_pri_table[i].sec =
-		    ntohl(__collate_char_pri_table[i].sec);
-	}
 	if (__collate_chain_pri_table != NULL)
 		free(__collate_chain_pri_table);
 	__collate_chain_pri_table = TMP_chain_pri_table;
-	for (i = 0; i < chains; i++) {
-		__collate_chain_pri_table[i].prim =
-		    ntohl(__collate_chain_pri_table[i].prim);
-		__collate_chain_pri_table[i].sec =
-		    ntohl(__collate_chain_pri_table[i].sec);
-	}
+	if (__collate_compiled != NULL)
+		free(__collate_compiled);
+	__collate_compiled = TMP_compiled;
 	__collate_substitute_nontrivial = 0;
 	for (i = 0; (unsigned)i < UCHAR_MAX + 1; i++) {
-		if (__collate_substitute_table[i][0] != i ||
-		    __collate_substitute_table[i][1] != 0) {
+		if (__collate_compiled->chars[i].subst) {
 			__collate_substitute_nontrivial = 1;
 			break;
 		}
@@ -203,6 +250,26 @@ __collate_load_tables(const char *encoding)
 	return (_LDP_LOADED);
 }
 
+/*
+ * Compiled tables of 'encoding' on their own, leaving the global collation
+ * state alone; NULL with errno set if there are none. Free with free().
+ */
+struct __collate_st_compiled *
+__collate_load_compiled(const char *encoding)
+{
+	void *TMP_substitute_table, *TMP_char_pri_table, *TMP_chain_pri_table;
+	struct __collate_st_compiled *TMP_compiled;
+
+	if (__collate_read_tables(encoding, &TMP_substitute_table,
+	    &TMP_char_pri_table, &TMP_chain_pri_table,
+	    &TMP_compiled) != _LDP_LOADED)
+		return (NULL);
+	free(TMP_substitute_table);
+	free(TMP_char_pri_table);
+	free(TMP_chain_pri_table);
+	return (TMP_compiled);
+}
+
 u_char *
 __collate_substitute(const u_char *s)
 {
@@ -250,6 +317,297 @@ __collate_lookup(const u_char *t, int *len, int *prim, int *sec)
 	*sec = __collate_char_pri_table[*t].sec;
 }
 
+static int
+__collate_cmp_int(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+/*
+ * Map a weight to its 1-based position among the sorted distinct weights.
+ * Zero stays zero when 'keepzero' is set (ignorable primary).
+ */
+static int
+__collate_rank(const int *sorted, int n, int w, int keepzero)
+{
+	int lo = 0, hi = n;
+
+	if (keepzero && w == 0)
+		return (0);
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (sorted[mid] < w)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo + 1);
+}
+
+static int
+__collate_uniq(int *w, int n, int skipzero)
+{
+	int i, j;
+
+	qsort(w, n, sizeof(*w), __collate_cmp_int);
+	for (i = j = 0; i < n; i++) {
+		if (skipzero && w[i] == 0)
+			continue;
+		if (j == 0 || w[j - 1] != w[i])
+			w[j++] = w[i];
+	}
+	return (j);
+}
+
+static struct __collate_st_compiled *
+__collate_compile(u_char (*subst)[STR_LEN], struct __collate_st_char_pri *cp,
+    struct __collate_st_chain_pri *chain, int chains)
+{
+	struct __collate_st_compiled *c;
+	int *prims, *secs;
+	int i, j, n, nchains, nprims, nsecs;
+
+	for (nchains = 0; nchains < chains && chain[nchains].str[0] != '\0';
+	    nchains++)
+		;
+
+	n = UCHAR_MAX + 1 + nchains;
+	c = malloc(sizeof(*c) + sizeof(c->chains[0]) * nchains);
+	prims = malloc(sizeof(int) * n * 2);
+	if (c == NULL || prims == NULL) {
+		free(c);
+		free(prims);
+		return (NULL);
+	}
+	secs = prims + n;
+
+	for (i = 0; i < UCHAR_MAX + 1; i++) {
+		prims[i] = cp[i].prim;
+		secs[i] = cp[i].sec;
+	}
+	for (i = 0; i < nchains; i++) {
+		prims[UCHAR_MAX + 1 + i] = chain[i].prim;
+		secs[UCHAR_MAX + 1 + i] = chain[i].sec;
+	}
+	nprims = __collate_uniq(prims, n, 1);
+	nsecs = __collate_uniq(secs, n, 0);
+	if (nprims > COLLATE_MAX_RANK || nsecs > COLLATE_MAX_RANK) {
+		free(c);
+		free(prims);
+		errno = EFTYPE;
+		return (NULL);
+	}
+
+	for (i = 0; i < UCHAR_MAX + 1; i++) {
+		c->chars[i].prim = __collate_rank(prims, nprims, cp[i].prim, 1);
+		c->chars[i].sec = __collate_rank(secs, nsecs, cp[i].sec, 0);
+		c->chars[i].chain = c->chars[i].nchains = 0;
+		c->chars[i].subst = subst[i][0] != i || subst[i][1] != '\0';
+	}
+	memcpy(c->subst, subst, sizeof(c->subst));
+
+	/*
+	 * Bucket chains by first byte, keeping the table order within a bucket
+	 * since the first matching chain wins.
+	 */
+	c->nchains = nchains;
+	for (i = j = 0; i < UCHAR_MAX + 1; i++) {
+		int k;
+
+		c->chars[i].chain = j;
+		for (k = 0; k < nchains; k++) {
+			if (chain[k].str[0] != i)
+				continue;
+			memcpy(c->chains[j].str, chain[k].str, STR_LEN);
+			c->chains[j].len = strlen((const char *)chain[k].str);
+			c->chains[j].prim = __collate_rank(prims, nprims,
+			    chain[k].prim, 1);
+			c->chains[j].sec = __collate_rank(secs, nsecs,
+			    chain[k].sec, 0);
+			j++;
+		}
+		c->chars[i].nchains = j - c->chars[i].chain;
+	}
+
+	free(prims);
+	return (c);
+}
+
+void
+__collate_cursor_init(struct __collate_cursor *c, const u_char *s,
+    const wchar_t *ws)
+{
+	c->s = s;
+	c->ws = ws;
+	c->sub = NULL;
+	c->error = 0;
+	c->tab = __collate_compiled;
+}
+
+/*
+ * Next byte of the substituted source, or 0 at the end of the string.
+ */
+static __inline int
+__collate_getc(struct __collate_cursor *c)
+{
+	int ch;
+
+	for (;;) {
+		if (c->sub != NULL) {
+			if (*c->sub != '\0')
+				return (*c->sub++);
+			c->sub = NULL;
+		}
+		if (c->ws != NULL) {
+			if (*c->ws == L'\0')
+				return (0);
+			if ((ch = wctob(*c->ws++)) == EOF) {
+				c->error = 1;
+				c->ws = L"";
+				return (0);
+			}
+			ch = (u_char)ch;
+		} else {
+			if (*c->s == '\0')
+				return (0);
+			ch = *c->s++;
+		}
+		if (!c->tab->chars[ch].subst)
+			return (ch);
+		c->sub = c->tab->subst[ch];
+	}
+}
+
+/*
+ * Fetch the next collating element with a non-zero primary weight.
+ * Returns 0 when the source is exhausted.
+ */
+int
+__collate_next(struct __collate_cursor *c, int *prim, int *sec)
+{
+	const struct __collate_st_char_cpri *cp;
+	const struct __collate_st_chain_cpri *p2, *end;
+	struct __collate_cursor la;
+	int ch, i;
+
+	for (;;) {
+		if ((ch = __collate_getc(c)) == 0)
+			return (0);
+		cp = &c->tab->chars[ch];
+		*prim = cp->prim;
+		*sec = cp->sec;
+		p2 = c->tab->chains + cp->chain;
+		for (end = p2 + cp->nchains; p2 < end; p2++) {
+			la = *c;
+			for (i = 1; i < p2->len && __collate_getc(&la) == p2->str[i]; i++)
+				;
+			if (i == p2->len) {
+				*c = la;
+				*prim = p2->prim;
+				*sec = p2->sec;
+				break;
+			}
+		}
+		if (*prim != 0)
+			return (1);
+	}
+}
+
+/*
+ * Single pass comparison: primary weights decide, the first secondary
+ * difference breaks ties between strings with equal primaries.
+ */
+int
+__collate_compare(struct __collate_cursor *c1, struct __collate_cursor *c2)
+{
+	int prim1, sec1, prim2, sec2, r1, r2, ret3;
+
+	ret3 = 0;
+	for (;;) {
+		r1 = __collate_next(c1, &prim1, &sec1);
+		r2 = __collate_next(c2, &prim2, &sec2);
+		if (!r1 || !r2)
+			return (r1 != r2 ? r1 - r2 : ret3);
+		if (prim1 != prim2)
+			return (prim1 - prim2);
+		if (ret3 == 0)
+			ret3 = sec1 - sec2;
+	}
+}
+
+/*
+ * Sort key output. Ranks are biased by one so that the key never contains
+ * a NUL and 1 can serve as the primary/secondary separator. Narrow keys use
+ * an order preserving one or two byte encoding, wide keys one wchar_t per
+ * weight; either way comparing keys with strcmp/memcmp/wcscmp gives the
+ * same order as __collate_compare().
+ */
+struct __collate_key {
+	u_char *d;
+	wchar_t *wd;
+	size_t len, n;
+};
+
+static __inline void
+__collate_putc(struct __collate_key *k, int v)
+{
+	if (k->n + 1 < k->len) {
+		if (k->d != NULL)
+			k->d[k->n] = (u_char)v;
+		else
+			k->wd[k->n] = (wchar_t)v;
+	}
+	k->n++;
+}
+
+static void
+__collate_put(struct __collate_key *k, int rank)
+{
+	int v = rank + 1;
+
+	if (k->wd != NULL || v < 0x80) {
+		__collate_putc(k, v);
+		return;
+	}
+	v -= 0x80;
+	__collate_putc(k, 0x80 + v / 255);
+	__collate_putc(k, 1 + v % 255);
+}
+
+size_t
+__collate_xfrm(struct __collate_cursor *c, u_char *dest, wchar_t *wdest,
+    size_t len)
+{
+	struct __collate_key k;
+	struct __collate_cursor start;
+	int prim, sec;
+
+	k.d = dest;
+	k.wd = wdest;
+	k.len = len;
+	k.n = 0;
+
+	start = *c;
+	while (__collate_next(c, &prim, &sec))
+		__collate_put(&k, prim);
+	if (k.n != 0) {
+		__collate_putc(&k, 1);
+		*c = start;
+		while (__collate_next(c, &prim, &sec))
+			__collate_put(&k, sec);
+	}
+
+	if (len != 0) {
+		if (dest != NULL)
+			dest[k.n < len ? k.n : len - 1] = '\0';
+		else
+			wdest[k.n < len ? k.n : len - 1] = L'\0';
+	}
+	return (k.n);
+}
+
 u_char *
 __collate_strdup(u_char *s)
 {
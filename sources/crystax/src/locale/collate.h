@@ -62,6 +62,7 @@
 #include <sys/cdefs.h>
 #include <sys/types.h>
 #include <limits.h>
+#include <wchar.h>
 
 #define STR_LEN 10
 #define TABLE_SIZE 100
@@ -76,6 +77,43 @@ struct __collate_st_chain_pri {
 	int prim, sec;
 };
 
+/*
+ * Compiled form of the tables above, built once by __collate_load_tables().
+ * Weights are replaced by dense ranks (prim == 0 still means "ignorable"),
+ * chains are bucketed by their first byte and substitutions are flagged
+ * per byte, so that the comparator never scans the whole chain table and
+ * never has to materialize a substituted copy of its arguments.
+ */
+struct __collate_st_char_cpri {
+	int prim, sec;
+	u_short chain, nchains;
+	u_char subst;
+};
+struct __collate_st_chain_cpri {
+	u_char str[STR_LEN];
+	int len;
+	int prim, sec;
+};
+struct __collate_st_compiled {
+	struct __collate_st_char_cpri chars[UCHAR_MAX + 1];
+	u_char subst[UCHAR_MAX + 1][STR_LEN];
+	int nchains;
+	struct __collate_st_chain_cpri chains[1];
+};
+
+/*
+ * Read position in a (possibly wide) source string, as seen after
+ * substitution. Either 's' or 'ws' is used; 'error' is set when a wide
+ * character has no single-byte representation.
+ */
+struct __collate_cursor {
+	const u_char *s;
+	const wchar_t *ws;
+	const u_char *sub;
+	int error;
+	const struct __collate_st_compiled *tab;	/* the global tables by default */
+};
+
 extern int __collate_load_error;
 extern int __collate_substitute_nontrivial;
 #define __collate_substitute_table (*__collate_substitute_table_ptr)
@@ -83,13 +121,21 @@ extern u_char __collate_substitute_table[UCHAR_MAX + 1][STR_LEN];
 #define __collate_char_pri_table (*__collate_char_pri_table_ptr)
 extern struct __collate_st_char_pri __collate_char_pri_table[UCHAR_MAX + 1];
 extern struct __collate_st_chain_pri *__collate_chain_pri_table;
+extern struct __collate_st_compiled *__collate_compiled;
 
 __BEGIN_DECLS
 u_char	*__collate_strdup(u_char *);
 u_char	*__collate_substitute(const u_char *);
 int	__collate_load_tables(const char *);
+struct __collate_st_compiled *
+	__collate_load_compiled(const char *);
 void	__collate_lookup(const u_char *, int *, int *, int *);
 int	__collate_range_cmp(int, int);
+void	__collate_cursor_init(struct __collate_cursor *, const u_char *,
+	    const wchar_t *);
+int	__collate_next(struct __collate_cursor *, int *, int *);
+int	__collate_compare(struct __collate_cursor *, struct __collate_cursor *);
+size_t	__collate_xfrm(struct __collate_cursor *, u_char *, wchar_t *, size_t);
 #ifdef COLLATE_DEBUG
 void	__collate_print_tables(void);
 #endif
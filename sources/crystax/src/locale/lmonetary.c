@@ -112,6 +112,43 @@ cnv(const char *str)
 	return ((char)i);
 }
 
+static void
+fixup(struct lc_monetary_T *mon)
+{
+	mon->mon_grouping = __fix_locale_grouping_str(mon->mon_grouping);
+
+#define M_ASSIGN_CHAR(NAME) (((char *)mon->NAME)[0] = cnv(mon->NAME))
+
+	M_ASSIGN_CHAR(int_frac_digits);
+	M_ASSIGN_CHAR(frac_digits);
+	M_ASSIGN_CHAR(p_cs_precedes);
+	M_ASSIGN_CHAR(p_sep_by_space);
+	M_ASSIGN_CHAR(n_cs_precedes);
+	M_ASSIGN_CHAR(n_sep_by_space);
+	M_ASSIGN_CHAR(p_sign_posn);
+	M_ASSIGN_CHAR(n_sign_posn);
+
+	/*
+	 * The six additional C99 international monetary formatting
+	 * parameters default to the national parameters when
+	 * reading FreeBSD LC_MONETARY data files.
+	 */
+#define	M_ASSIGN_ICHAR(NAME)						\
+	do {								\
+		if (mon->int_##NAME == NULL)				\
+			mon->int_##NAME = mon->NAME;			\
+		else							\
+			M_ASSIGN_CHAR(int_##NAME);			\
+	} while (0)
+
+	M_ASSIGN_ICHAR(p_cs_precedes);
+	M_ASSIGN_ICHAR(n_cs_precedes);
+	M_ASSIGN_ICHAR(p_sep_by_space);
+	M_ASSIGN_ICHAR(n_sep_by_space);
+	M_ASSIGN_ICHAR(p_sign_posn);
+	M_ASSIGN_ICHAR(n_sign_posn);
+}
+
 int
 __monetary_load_locale(const char *name)
 {
@@ -123,43 +160,28 @@ __monetary_load_locale(const char *name)
 		(const char **)&_monetary_locale);
 	if (ret != _LDP_ERROR)
 		__mlocale_changed = 1;
-	if (ret == _LDP_LOADED) {
-		_monetary_locale.mon_grouping =
-		     __fix_locale_grouping_str(_monetary_locale.mon_grouping);
-
-#define M_ASSIGN_CHAR(NAME) (((char *)_monetary_locale.NAME)[0] = \
-			     cnv(_monetary_locale.NAME))
-
-		M_ASSIGN_CHAR(int_frac_digits);
-		M_ASSIGN_CHAR(frac_digits);
-		M_ASSIGN_CHAR(p_cs_precedes);
-		M_ASSIGN_CHAR(p_sep_by_space);
-		M_ASSIGN_CHAR(n_cs_precedes);
-		M_ASSIGN_CHAR(n_sep_by_space);
-		M_ASSIGN_CHAR(p_sign_posn);
-		M_ASSIGN_CHAR(n_sign_posn);
-
-		/*
-		 * The six additional C99 international monetary formatting
-		 * parameters default to the national parameters when
-		 * reading FreeBSD LC_MONETARY data files.
-		 */
-#define	M_ASSIGN_ICHAR(NAME)						\
-		do {							\
-			if (_monetary_locale.int_##NAME == NULL)	\
-				_monetary_locale.int_##NAME =		\
-				    _monetary_locale.NAME;		\
-			else						\
-				M_ASSIGN_CHAR(int_##NAME);		\
-		} while (0)
-
-		M_ASSIGN_ICHAR(p_cs_precedes);
-		M_ASSIGN_ICHAR(n_cs_precedes);
-		M_ASSIGN_ICHAR(p_sep_by_space);
-		M_ASSIGN_ICHAR(n_sep_by_space);
-		M_ASSIGN_ICHAR(p_sign_posn);
-		M_ASSIGN_ICHAR(n_sign_posn);
-	}
+	if (ret == _LDP_LOADED)
+		fixup(&_monetary_locale);
+	return (ret);
+}
+
+/*
+ * Load 'name' into *mon, backed by a new buffer returned in *buf, leaving
+ * the current locale alone. "C" and "POSIX" give the C values and no buffer.
+ */
+int
+__monetary_load_locale_copy(const char *name, struct lc_monetary_T *mon,
+    char **buf)
+{
+	int ret, using_locale;
+
+	*buf = NULL;
+	ret = __part_load_locale(name, &using_locale, buf, "LC_MONETARY",
+		LCMONETARY_SIZE_FULL, LCMONETARY_SIZE_MIN, (const char **)mon);
+	if (ret == _LDP_LOADED)
+		fixup(mon);
+	else if (ret == _LDP_CACHE)
+		*mon = _C_monetary_locale;
 	return (ret);
 }
 
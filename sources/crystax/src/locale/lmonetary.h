@@ -84,5 +84,6 @@ struct lc_monetary_T {
 
 struct lc_monetary_T *__get_current_monetary_locale(void);
 int	__monetary_load_locale(const char *);
+int	__monetary_load_locale_copy(const char *, struct lc_monetary_T *, char **);
 
 #endif /* !_LMONETARY_H_ */
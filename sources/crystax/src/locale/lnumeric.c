@@ -57,6 +57,7 @@
 __FBSDID("$FreeBSD$");
 
 #include <limits.h>
+#include <stddef.h>
 
 #include "ldpart.h"
 #include "lnumeric.h"
@@ -78,6 +79,15 @@ static struct lc_numeric_T _numeric_locale;
 static int	_numeric_using_locale;
 static char	*_numeric_locale_buf;
 
+static void
+fixup(struct lc_numeric_T *num)
+{
+	/* Can't be empty according to C99 */
+	if (*num->decimal_point == '\0')
+		num->decimal_point = _C_numeric_locale.decimal_point;
+	num->grouping = __fix_locale_grouping_str(num->grouping);
+}
+
 int
 __numeric_load_locale(const char *name)
 {
@@ -89,14 +99,28 @@ __numeric_load_locale(const char *name)
 		(const char **)&_numeric_locale);
 	if (ret != _LDP_ERROR)
 		__nlocale_changed = 1;
-	if (ret == _LDP_LOADED) {
-		/* Can't be empty according to C99 */
-		if (*_numeric_locale.decimal_point == '\0')
-			_numeric_locale.decimal_point =
-			    _C_numeric_locale.decimal_point;
-		_numeric_locale.grouping =
-		    __fix_locale_grouping_str(_numeric_locale.grouping);
-	}
+	if (ret == _LDP_LOADED)
+		fixup(&_numeric_locale);
+	return (ret);
+}
+
+/*
+ * Load 'name' into *num, backed by a new buffer returned in *buf, leaving
+ * the current locale alone. "C" and "POSIX" give the C values and no buffer.
+ */
+int
+__numeric_load_locale_copy(const char *name, struct lc_numeric_T *num,
+    char **buf)
+{
+	int ret, using_locale;
+
+	*buf = NULL;
+	ret = __part_load_locale(name, &using_locale, buf, "LC_NUMERIC",
+		LCNUMERIC_SIZE, LCNUMERIC_SIZE, (const char **)num);
+	if (ret == _LDP_LOADED)
+		fixup(num);
+	else if (ret == _LDP_CACHE)
+		*num = _C_numeric_locale;
 	return (ret);
 }
 
@@ -66,5 +66,6 @@ struct lc_numeric_T {
 
 struct lc_numeric_T *__get_current_numeric_locale(void);
 int	__numeric_load_locale(const char *);
+int	__numeric_load_locale_copy(const char *, struct lc_numeric_T *, char **);
 
 #endif /* !_LNUMERIC_H_ */
@@ -85,6 +85,24 @@ extern size_t (*__wcrtomb)(char * __restrict, wchar_t, mbstate_t * __restrict);
 extern size_t (*__wcsnrtombs)(char * __restrict, const wchar_t ** __restrict,
     size_t, size_t, mbstate_t * __restrict);
 
+/*
+ * Conversion functions of an encoding for use apart from the current locale
+ * (see snapshot.c). Only provided by encodings whose functions don't
+ * consult _CurrentRuneLocale.
+ */
+struct __mbops {
+	size_t	(*mbrtowc)(wchar_t * __restrict, const char * __restrict,
+		    size_t, mbstate_t * __restrict);
+	int	(*mbsinit)(const mbstate_t *);
+	size_t	(*wcrtomb)(char * __restrict, wchar_t, mbstate_t * __restrict);
+	int	mb_cur_max;
+	int	mb_sb_limit;
+};
+
+extern const struct __mbops __none_mbops;
+extern const struct __mbops __ascii_mbops;
+extern const struct __mbops __UTF8_mbops;
+
 extern size_t __mbsnrtowcs_std(wchar_t * __restrict, const char ** __restrict,
     size_t, size_t, mbstate_t * __restrict);
 extern size_t __wcsnrtombs_std(char * __restrict, const wchar_t ** __restrict,
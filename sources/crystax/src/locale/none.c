@@ -96,6 +96,14 @@ static size_t	_none_wcsnrtombs(char * __restrict, const wchar_t ** __restrict,
 int __mb_cur_max = 1;
 int __mb_sb_limit = 256; /* Expected to be <= _CACHED_RUNES */
 
+const struct __mbops __none_mbops = {
+	_none_mbrtowc,
+	_none_mbsinit,
+	_none_wcrtomb,
+	1,
+	256
+};
+
 int
 _none_init(_RuneLocale *rl)
 {
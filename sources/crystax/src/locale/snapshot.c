@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+/*
+ * Per-name locale snapshots behind <crystax/locale.h>. Unlike setlocale(),
+ * which keeps a single cached copy of each category and swaps it in and out
+ * of global state, every name asked for here is loaded once and kept for the
+ * life of the process, so callers can hold on to the result and use it from
+ * any thread. Categories a known locale has no data for fall back to "C".
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <pthread.h>
+#include <runetype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <crystax/locale.h>
+
+#include "collate.h"
+#include "ldpart.h"
+#include "lmonetary.h"
+#include "lnumeric.h"
+#include "mblocal.h"
+
+#ifdef __ANDROID__
+#include "crystax/private.h"
+#endif
+
+#if _CTYPE_A != CRYSTAX_LOCALE_ALPHA || _CTYPE_C != CRYSTAX_LOCALE_CNTRL || \
+    _CTYPE_D != CRYSTAX_LOCALE_DIGIT || _CTYPE_G != CRYSTAX_LOCALE_GRAPH || \
+    _CTYPE_L != CRYSTAX_LOCALE_LOWER || _CTYPE_P != CRYSTAX_LOCALE_PUNCT || \
+    _CTYPE_S != CRYSTAX_LOCALE_SPACE || _CTYPE_U != CRYSTAX_LOCALE_UPPER || \
+    _CTYPE_X != CRYSTAX_LOCALE_XDIGIT || _CTYPE_B != CRYSTAX_LOCALE_BLANK || \
+    _CTYPE_R != CRYSTAX_LOCALE_PRINT
+#error CRYSTAX_LOCALE_* classes out of sync with <_ctype.h>
+#endif
+
+#define CLASS_MASK (CRYSTAX_LOCALE_ALPHA | CRYSTAX_LOCALE_CNTRL | \
+    CRYSTAX_LOCALE_DIGIT | CRYSTAX_LOCALE_GRAPH | CRYSTAX_LOCALE_LOWER | \
+    CRYSTAX_LOCALE_PUNCT | CRYSTAX_LOCALE_SPACE | CRYSTAX_LOCALE_UPPER | \
+    CRYSTAX_LOCALE_XDIGIT | CRYSTAX_LOCALE_BLANK | CRYSTAX_LOCALE_PRINT)
+
+extern _RuneLocale *_Read_RuneMagi(char *, size_t);
+
+struct crystax_locale_ctype {
+	const _RuneLocale *rl;
+	const struct __mbops *ops;
+};
+
+struct crystax_locale_collate {
+	const struct __collate_st_compiled *tab;	/* NULL compares bytes */
+};
+
+struct snapshot {
+	struct snapshot *next;
+	int category;
+	union {
+		struct crystax_locale_ctype ctype;
+		struct crystax_locale_collate collate;
+		struct lconv lconv;
+	} u;
+	char name[1];
+};
+
+static pthread_mutex_t snapshots_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct snapshot *snapshots;
+
+static int
+is_c_locale(const char *name)
+{
+	return (strcmp(name, "C") == 0 || strcmp(name, "POSIX") == 0);
+}
+
+static int
+is_known_locale(const char *name)
+{
+	return (is_c_locale(name) ||
+	    __crystax_locale_lookup_whole_data(name) != NULL);
+}
+
+static int
+load_ctype(const char *name, struct crystax_locale_ctype *ct)
+{
+	__crystax_locale_data_t *ld;
+	_RuneLocale *rl;
+
+	if (is_c_locale(name)) {
+		ct->rl = &_DefaultRuneLocale;
+		ct->ops = &__none_mbops;
+		return (0);
+	}
+
+	ld = __crystax_locale_get_data(LC_CTYPE, name);
+	if (ld == NULL || ld->data == NULL)
+		return (ENOENT);
+	errno = 0;
+	if ((rl = _Read_RuneMagi(ld->data, ld->size)) == NULL)
+		return (errno == 0 ? EFTYPE : errno);
+
+	if (strcmp(rl->__encoding, "NONE") == 0)
+		ct->ops = &__none_mbops;
+	else if (strcmp(rl->__encoding, "ASCII") == 0)
+		ct->ops = &__ascii_mbops;
+	else if (strcmp(rl->__encoding, "UTF-8") == 0)
+		ct->ops = &__UTF8_mbops;
+	else {
+		free(rl);
+		return (EFTYPE);
+	}
+	rl->__sputrune = NULL;
+	rl->__sgetrune = NULL;
+	ct->rl = rl;
+	return (0);
+}
+
+static int
+load_collate(const char *name, struct crystax_locale_collate *co)
+{
+	co->tab = NULL;
+	if (is_c_locale(name))
+		return (0);
+	if (!is_known_locale(name))
+		return (ENOENT);
+	if ((co->tab = __collate_load_compiled(name)) == NULL &&
+	    errno == ENOMEM)
+		return (ENOMEM);
+	return (0);
+}
+
+static int
+load_lconv(const char *name, int category, struct lconv *lc)
+{
+	struct lc_numeric_T num;
+	struct lc_monetary_T mon;
+	char *buf;
+
+	if (!is_known_locale(name))
+		return (ENOENT);
+
+	/* The buffers stay with the snapshot */
+	if (category != LC_NUMERIC ||
+	    __numeric_load_locale_copy(name, &num, &buf) == _LDP_ERROR)
+		(void)__numeric_load_locale_copy("C", &num, &buf);
+	if (category != LC_MONETARY ||
+	    __monetary_load_locale_copy(name, &mon, &buf) == _LDP_ERROR)
+		(void)__monetary_load_locale_copy("C", &mon, &buf);
+
+#define N_ASSIGN_STR(NAME) (lc->NAME = (char *)num.NAME)
+#define M_ASSIGN_STR(NAME) (lc->NAME = (char *)mon.NAME)
+#define M_ASSIGN_CHAR(NAME) (lc->NAME = mon.NAME[0])
+
+	N_ASSIGN_STR(decimal_point);
+	N_ASSIGN_STR(thousands_sep);
+	N_ASSIGN_STR(grouping);
+	M_ASSIGN_STR(int_curr_symbol);
+	M_ASSIGN_STR(currency_symbol);
+	M_ASSIGN_STR(mon_decimal_point);
+	M_ASSIGN_STR(mon_thousands_sep);
+	M_ASSIGN_STR(mon_grouping);
+	M_ASSIGN_STR(positive_sign);
+	M_ASSIGN_STR(negative_sign);
+	M_ASSIGN_CHAR(int_frac_digits);
+	M_ASSIGN_CHAR(frac_digits);
+	M_ASSIGN_CHAR(p_cs_precedes);
+	M_ASSIGN_CHAR(p_sep_by_space);
+	M_ASSIGN_CHAR(n_cs_precedes);
+	M_ASSIGN_CHAR(n_sep_by_space);
+	M_ASSIGN_CHAR(p_sign_posn);
+	M_ASSIGN_CHAR(n_sign_posn);
+	M_ASSIGN_CHAR(int_p_cs_precedes);
+	M_ASSIGN_CHAR(int_n_cs_precedes);
+	M_ASSIGN_CHAR(int_p_sep_by_space);
+	M_ASSIGN_CHAR(int_n_sep_by_space);
+	M_ASSIGN_CHAR(int_p_sign_posn);
+	M_ASSIGN_CHAR(int_n_sign_posn);
+	return (0);
+}
+
+static struct snapshot *
+snapshot(int category, const char *name)
+{
+	struct snapshot *s;
+	size_t len;
+	int error;
+
+	if (name == NULL) {
+		errno = EINVAL;
+		return (NULL);
+	}
+	if (*name == '\0')
+		name = "C";
+
+	pthread_mutex_lock(&snapshots_lock);
+	for (s = snapshots; s != NULL; s = s->next)
+		if (s->category == category && strcmp(s->name, name) == 0)
+			goto out;
+
+	len = strlen(name);
+	if ((s = malloc(sizeof(*s) + len)) == NULL) {
+		error = ENOMEM;
+		goto fail;
+	}
+	s->category = category;
+	memcpy(s->name, name, len + 1);
+
+	switch (category) {
+	case LC_CTYPE:
+		error = load_ctype(name, &s->u.ctype);
+		break;
+	case LC_COLLATE:
+		error = load_collate(name, &s->u.collate);
+		break;
+	default:
+		error = load_lconv(name, category, &s->u.lconv);
+		break;
+	}
+	if (error != 0) {
+		free(s);
+		goto fail;
+	}
+
+	s->next = snapshots;
+	snapshots = s;
+out:
+	pthread_mutex_unlock(&snapshots_lock);
+	return (s);
+
+fail:
+	pthread_mutex_unlock(&snapshots_lock);
+	errno = error;
+	return (NULL);
+}
+
+const struct crystax_locale_ctype *
+crystax_locale_ctype(const char *name)
+{
+	struct snapshot *s = snapshot(LC_CTYPE, name);
+
+	return (s != NULL ? &s->u.ctype : NULL);
+}
+
+const char *
+crystax_locale_ctype_encoding(const struct crystax_locale_ctype *ct)
+{
+	return (ct->rl->__encoding);
+}
+
+int
+crystax_locale_ctype_mb_cur_max(const struct crystax_locale_ctype *ct)
+{
+	return (ct->ops->mb_cur_max);
+}
+
+/* Binary search -- see bsearch.c for explanation. */
+static const _RuneEntry *
+rune_entry(const _RuneRange *rr, __ct_rune_t c)
+{
+	const _RuneEntry *base, *re;
+	size_t lim;
+
+	base = rr->__ranges;
+	for (lim = rr->__nranges; lim != 0; lim >>= 1) {
+		re = base + (lim >> 1);
+		if (re->__min <= c && c <= re->__max)
+			return (re);
+		else if (c > re->__max) {
+			base = re + 1;
+			lim--;
+		}
+	}
+	return (NULL);
+}
+
+unsigned long
+crystax_locale_ctype_class(const struct crystax_locale_ctype *ct, wint_t wc)
+{
+	__ct_rune_t c = (__ct_rune_t)wc;
+	const _RuneEntry *re;
+
+	if (c < 0)
+		return (0);
+	if (c < _CACHED_RUNES)
+		return (ct->rl->__runetype[c] & CLASS_MASK);
+	if ((re = rune_entry(&ct->rl->__runetype_ext, c)) == NULL)
+		return (0);
+	return ((re->__types != NULL ? re->__types[c - re->__min] :
+	    re->__map) & CLASS_MASK);
+}
+
+wint_t
+crystax_locale_ctype_toupper(const struct crystax_locale_ctype *ct, wint_t wc)
+{
+	__ct_rune_t c = (__ct_rune_t)wc;
+	const _RuneEntry *re;
+
+	if (c < 0)
+		return (wc);
+	if (c < _CACHED_RUNES)
+		return (ct->rl->__mapupper[c]);
+	if ((re = rune_entry(&ct->rl->__mapupper_ext, c)) == NULL)
+		return (wc);
+	return (re->__map + c - re->__min);
+}
+
+wint_t
+crystax_locale_ctype_tolower(const struct crystax_locale_ctype *ct, wint_t wc)
+{
+	__ct_rune_t c = (__ct_rune_t)wc;
+	const _RuneEntry *re;
+
+	if (c < 0)
+		return (wc);
+	if (c < _CACHED_RUNES)
+		return (ct->rl->__maplower[c]);
+	if ((re = rune_entry(&ct->rl->__maplower_ext, c)) == NULL)
+		return (wc);
+	return (re->__map + c - re->__min);
+}
+
+size_t
+crystax_locale_mbrtowc(const struct crystax_locale_ctype *ct, wchar_t *pwc,
+    const char *s, size_t n, mbstate_t *ps)
+{
+	return (ct->ops->mbrtowc(pwc, s, n, ps));
+}
+
+size_t
+crystax_locale_wcrtomb(const struct crystax_locale_ctype *ct, char *s,
+    wchar_t wc, mbstate_t *ps)
+{
+	return (ct->ops->wcrtomb(s, wc, ps));
+}
+
+int
+crystax_locale_mbsinit(const struct crystax_locale_ctype *ct,
+    const mbstate_t *ps)
+{
+	return (ct->ops->mbsinit(ps));
+}
+
+const struct lconv *
+crystax_locale_numeric(const char *name)
+{
+	struct snapshot *s = snapshot(LC_NUMERIC, name);
+
+	return (s != NULL ? &s->u.lconv : NULL);
+}
+
+const struct lconv *
+crystax_locale_monetary(const char *name)
+{
+	struct snapshot *s = snapshot(LC_MONETARY, name);
+
+	return (s != NULL ? &s->u.lconv : NULL);
+}
+
+const struct crystax_locale_collate *
+crystax_locale_collate(const char *name)
+{
+	struct snapshot *s = snapshot(LC_COLLATE, name);
+
+	return (s != NULL ? &s->u.collate : NULL);
+}
+
+int
+crystax_locale_strcoll(const struct crystax_locale_collate *co,
+    const char *s1, const char *s2)
+{
+	struct __collate_cursor c1, c2;
+
+	if (co->tab == NULL)
+		return (strcmp(s1, s2));
+	__collate_cursor_init(&c1, (const u_char *)s1, NULL);
+	__collate_cursor_init(&c2, (const u_char *)s2, NULL);
+	c1.tab = c2.tab = co->tab;
+	return (__collate_compare(&c1, &c2));
+}
+
+size_t
+crystax_locale_strxfrm(const struct crystax_locale_collate *co,
+    char *dst, const char *src, size_t n)
+{
+	struct __collate_cursor c;
+	size_t len;
+
+	if (co->tab == NULL) {
+		len = strlen(src);
+		if (n != 0) {
+			if (len < n)
+				memcpy(dst, src, len + 1);
+			else {
+				memcpy(dst, src, n - 1);
+				dst[n - 1] = '\0';
+			}
+		}
+		return (len);
+	}
+	__collate_cursor_init(&c, (const u_char *)src, NULL);
+	c.tab = co->tab;
+	return (__collate_xfrm(&c, (u_char *)dst, NULL, n));
+}
@@ -87,6 +87,14 @@ typedef struct {
 	wchar_t	lbound;
 } _UTF8State;
 
+const struct __mbops __UTF8_mbops = {
+	_UTF8_mbrtowc,
+	_UTF8_mbsinit,
+	_UTF8_wcrtomb,
+	6,
+	128
+};
+
 int
 _UTF8_init(_RuneLocale *rl)
 {
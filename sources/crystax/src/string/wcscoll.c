@@ -62,18 +62,16 @@ __FBSDID("$FreeBSD$");
 #include <wchar.h>
 #include "collate.h"
 
-static char *__mbsdup(const wchar_t *);
-
 /*
- * Placeholder implementation of wcscoll(). Attempts to use the single-byte
- * collation ordering where possible, and falls back on wcscmp() in locales
- * with extended character sets.
+ * Uses the single-byte collation ordering where possible, and falls back on
+ * wcscmp() in locales with extended character sets. Wide characters are
+ * narrowed one at a time while comparing, so nothing is allocated.
  */
 int
 wcscoll(const wchar_t *ws1, const wchar_t *ws2)
 {
-	char *mbs1, *mbs2;
-	int diff, sverrno;
+	struct __collate_cursor c1, c2;
+	int diff;
 
 	if (__collate_load_error || MB_CUR_MAX > 1)
 		/*
@@ -83,45 +81,18 @@ wcscoll(const wchar_t *ws1, const wchar_t *ws2)
 		 */
 		return (wcscmp(ws1, ws2));
 
-	if ((mbs1 = __mbsdup(ws1)) == NULL || (mbs2 = __mbsdup(ws2)) == NULL) {
+	__collate_cursor_init(&c1, NULL, ws1);
+	__collate_cursor_init(&c2, NULL, ws2);
+	diff = __collate_compare(&c1, &c2);
+	if (c1.error || c2.error) {
 		/*
-		 * Out of memory or illegal wide chars; fall back to wcscmp()
-		 * but leave errno indicating the error. Callers that don't
-		 * check for error will get a reasonable but often slightly
-		 * incorrect result.
+		 * Illegal wide chars; fall back to wcscmp() but leave errno
+		 * indicating the error. Callers that don't check for error
+		 * will get a reasonable but often slightly incorrect result.
 		 */
-		sverrno = errno;
-		free(mbs1);
-		errno = sverrno;
+		errno = EILSEQ;
 		return (wcscmp(ws1, ws2));
 	}
 
-	diff = strcoll(mbs1, mbs2);
-	sverrno = errno;
-	free(mbs1);
-	free(mbs2);
-	errno = sverrno;
-
 	return (diff);
 }
-
-static char *
-__mbsdup(const wchar_t *ws)
-{
-	static const mbstate_t initial;
-	mbstate_t st;
-	const wchar_t *wcp;
-	size_t len;
-	char *mbs;
-
-	wcp = ws;
-	st = initial;
-	if ((len = wcsrtombs(NULL, &wcp, 0, &st)) == (size_t)-1)
-		return (NULL);
-	if ((mbs = malloc(len + 1)) == NULL)
-		return (NULL);
-	st = initial;
-	wcsrtombs(mbs, &ws, len + 1, &st);
-
-	return (mbs);
-}
@@ -65,18 +65,16 @@ __FBSDID("$FreeBSD$");
 #include <wchar.h>
 #include "collate.h"
 
-static char *__mbsdup(const wchar_t *);
-
 /*
- * Placeholder wcsxfrm() implementation. See wcscoll.c for a description of
- * the logic used.
+ * wcsxfrm() implementation. See wcscoll.c for a description of the logic
+ * used. The result is a compact sort key (see __collate_xfrm()), so that
+ * comparing two results with wcscmp() matches wcscoll() on the originals.
  */
 size_t
 wcsxfrm(wchar_t * __restrict dest, const wchar_t * __restrict src, size_t len)
 {
-	int prim, sec, l;
+	struct __collate_cursor c;
 	size_t slen;
-	char *mbsrc, *s, *ss;
 
 	if (*src == L'\0') {
 		if (len != 0)
@@ -84,62 +82,21 @@ wcsxfrm(wchar_t * __restrict dest, const wchar_t * __restrict src, size_t len)
 		return (0);
 	}
 
-	if (__collate_load_error || MB_CUR_MAX > 1) {
-		slen = wcslen(src);
-		if (len > 0) {
-			if (slen < len)
-				wcscpy(dest, src);
-			else {
-				wcsncpy(dest, src, len - 1);
-				dest[len - 1] = L'\0';
-			}
-		}
-		return (slen);
+	if (!__collate_load_error && MB_CUR_MAX == 1) {
+		__collate_cursor_init(&c, NULL, src);
+		slen = __collate_xfrm(&c, NULL, dest, len);
+		if (!c.error)
+			return (slen);
 	}
 
-	mbsrc = __mbsdup(src);
-	slen = 0;
-	prim = sec = 0;
-	ss = s = (char *)__collate_substitute((const u_char *)mbsrc);
-	while (*s != '\0') {
-		while (*s != '\0' && prim == 0) {
-			__collate_lookup((const u_char *)s, &l, &prim, &sec);
-			s += l;
-		}
-		if (prim != 0) {
-			if (len > 1) {
-				*dest++ = (wchar_t)prim;
-				len--;
-			}
-			slen++;
-			prim = 0;
+	slen = wcslen(src);
+	if (len > 0) {
+		if (slen < len)
+			wcscpy(dest, src);
+		else {
+			wcsncpy(dest, src, len - 1);
+			dest[len - 1] = L'\0';
 		}
 	}
-	free(ss);
-	free(mbsrc);
-	if (len != 0)
-		*dest = L'\0';
-
 	return (slen);
 }
-
-static char *
-__mbsdup(const wchar_t *ws)
-{
-	static const mbstate_t initial;
-	mbstate_t st;
-	const wchar_t *wcp;
-	size_t len;
-	char *mbs;
-
-	wcp = ws;
-	st = initial;
-	if ((len = wcsrtombs(NULL, &wcp, 0, &st)) == (size_t)-1)
-		return (NULL);
-	if ((mbs = malloc(len + 1)) == NULL)
-		return (NULL);
-	st = initial;
-	wcsrtombs(mbs, &ws, len + 1, &st);
-
-	return (mbs);
-}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#include "aio/pool.hpp"
+#include <time.h>
+
+struct crystax_vfs_aio_queue
+{
+    struct crystax_vfs_aiocb *head;
+    struct crystax_vfs_aiocb *tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+namespace crystax
+{
+namespace fileio
+{
+namespace aio
+{
+
+CRYSTAX_LOCAL
+void post(struct crystax_vfs_aio_queue *q, struct crystax_vfs_aiocb *cb)
+{
+    scope_lock_t lock(q->mutex);
+
+    cb->__next = NULL;
+    if (q->tail)
+        q->tail->__next = cb;
+    else
+        q->head = cb;
+    q->tail = cb;
+    ::pthread_cond_signal(&q->cond);
+}
+
+CRYSTAX_LOCAL
+void complete(struct crystax_vfs_aiocb *cb, long result, int error)
+{
+    DBG("cb=%p, fd=%d, result=%ld, error=%d", cb, cb->fd, result, error);
+
+    // Once the state is published, a request without callback or queue may
+    // be reused by its owner right away
+    void (*callback)(struct crystax_vfs_aiocb *) = cb->callback;
+    struct crystax_vfs_aio_queue *q = cb->queue;
+
+    cb->__result = result;
+    cb->__error = error;
+    __atomic_store_n(&cb->__state, STATE_DONE, __ATOMIC_RELEASE);
+
+    if (callback)
+        callback(cb);
+    else if (q)
+        post(q, cb);
+}
+
+CRYSTAX_LOCAL
+int submit(struct crystax_vfs_aiocb *cb)
+{
+    if (!cb || (cb->opcode != CRYSTAX_VFS_AIO_READ && cb->opcode != CRYSTAX_VFS_AIO_WRITE) ||
+        cb->offset < 0 || (long long)(off_t)cb->offset != cb->offset || (ssize_t)cb->count < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    DIR *dirp;
+    int extfd;
+    driver_t *driver;
+    if (!resolve(cb->fd, &dirp, &extfd, NULL, &driver) || !driver || dirp)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    pool_t *pool = pool_t::get(driver);
+    if (!pool)
+        return -1;
+
+    cb->__extfd = extfd;
+    cb->__result = -1;
+    cb->__error = EINPROGRESS;
+    return pool->submit(cb) ? 0 : -1;
+}
+
+} // namespace aio
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+int crystax_vfs_aio_submit(struct crystax_vfs_aiocb *cbs[], int n)
+{
+    if (!cbs || n < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int i = 0;
+    for (; i < n; ++i)
+        if (::crystax::fileio::aio::submit(cbs[i]) < 0)
+            break;
+
+    return i > 0 || n == 0 ? i : -1;
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_aio_cancel(struct crystax_vfs_aiocb *cb)
+{
+    using namespace ::crystax::fileio;
+
+    if (!cb || !cb->__pool)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The pool of a completed request may be gone with its driver
+    if (crystax_vfs_aio_error(cb) != EINPROGRESS)
+        return CRYSTAX_VFS_AIO_ALLDONE;
+
+    return static_cast<aio::pool_t *>(cb->__pool)->cancel(cb);
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_aio_error(const struct crystax_vfs_aiocb *cb)
+{
+    using namespace ::crystax::fileio;
+
+    if (!cb)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int state = __atomic_load_n(&cb->__state, __ATOMIC_ACQUIRE);
+    if (state < aio::STATE_QUEUED || state > aio::STATE_DONE)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return state == aio::STATE_DONE ? cb->__error : EINPROGRESS;
+}
+
+CRYSTAX_GLOBAL
+long crystax_vfs_aio_return(const struct crystax_vfs_aiocb *cb)
+{
+    int err = crystax_vfs_aio_error(cb);
+    if (err == EINPROGRESS)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (err != 0)
+    {
+        if (err > 0)
+            errno = err;
+        return -1;
+    }
+    return cb->__result;
+}
+
+CRYSTAX_GLOBAL
+struct crystax_vfs_aio_queue *crystax_vfs_aio_queue_create(void)
+{
+    struct crystax_vfs_aio_queue *q = (struct crystax_vfs_aio_queue *)::malloc(sizeof(*q));
+    if (!q)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    q->head = q->tail = NULL;
+    if (::pthread_mutex_init(&q->mutex, NULL) != 0)
+        ::abort();
+    if (::pthread_cond_init(&q->cond, NULL) != 0)
+        ::abort();
+    return q;
+}
+
+CRYSTAX_GLOBAL
+void crystax_vfs_aio_queue_destroy(struct crystax_vfs_aio_queue *q)
+{
+    if (!q)
+        return;
+
+    if (::pthread_cond_destroy(&q->cond) != 0)
+        ::abort();
+    if (::pthread_mutex_destroy(&q->mutex) != 0)
+        ::abort();
+    ::free(q);
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_aio_queue_wait(struct crystax_vfs_aio_queue *q, struct crystax_vfs_aiocb *done[],
+    int max, int timeout_ms)
+{
+    if (!q || !done || max <= 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct timespec deadline;
+    if (timeout_ms > 0)
+    {
+        ::clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    ::crystax::scope_lock_t lock(q->mutex);
+
+    while (!q->head && timeout_ms != 0)
+    {
+        if (timeout_ms < 0)
+            ::pthread_cond_wait(&q->cond, &q->mutex);
+        else if (::pthread_cond_timedwait(&q->cond, &q->mutex, &deadline) == ETIMEDOUT)
+            break;
+    }
+
+    int n = 0;
+    while (q->head && n < max)
+    {
+        done[n++] = q->head;
+        q->head = q->head->__next;
+    }
+    if (!q->head)
+        q->tail = NULL;
+    return n;
+}
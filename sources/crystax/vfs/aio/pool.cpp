@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#include "aio/pool.hpp"
+#include "system/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace aio
+{
+
+enum
+{
+    // The kernel serves concurrent preads of one file in parallel, other
+    // drivers mostly serialize on their own locks
+    NATIVE_WORKERS = 4,
+    DRIVER_WORKERS = 2
+};
+
+static pool_t *pools = NULL;
+static pthread_mutex_t pools_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+
+CRYSTAX_LOCAL
+pool_t::pool_t(driver_t *d, unsigned max)
+    :driver(d), native(d == system::driver_t::instance()), max_workers(max),
+    workers(0), idle(0), queued(0), stopping(false), head(NULL), tail(NULL), next(NULL)
+{
+    if (::pthread_mutex_init(&mutex, NULL) != 0)
+        ::abort();
+    if (::pthread_cond_init(&cond, NULL) != 0)
+        ::abort();
+}
+
+CRYSTAX_LOCAL
+pool_t::~pool_t()
+{
+    if (::pthread_cond_destroy(&cond) != 0)
+        ::abort();
+    if (::pthread_mutex_destroy(&mutex) != 0)
+        ::abort();
+}
+
+CRYSTAX_LOCAL
+pool_t *pool_t::get(driver_t *driver)
+{
+    scope_lock_t lock(pools_mutex);
+
+    for (pool_t *p = pools; p; p = p->next)
+        if (p->driver == driver)
+            return p;
+
+    unsigned max = driver == system::driver_t::instance() ? NATIVE_WORKERS : DRIVER_WORKERS;
+    pool_t *p = new pool_t(driver, max);
+    DBG("new pool for %s (%s), %u workers max", driver->name(), driver->info(), max);
+    p->next = pools;
+    pools = p;
+    return p;
+}
+
+CRYSTAX_LOCAL
+void pool_t::shutdown(driver_t *driver)
+{
+    pool_t *p = NULL;
+    {
+        scope_lock_t lock(pools_mutex);
+        for (pool_t **pp = &pools; *pp; pp = &(*pp)->next)
+        {
+            if ((*pp)->driver != driver)
+                continue;
+            p = *pp;
+            *pp = p->next;
+            break;
+        }
+    }
+    if (!p)
+        return;
+
+    DBG("drain pool for %s (%s)", driver->name(), driver->info());
+    ::pthread_mutex_lock(&p->mutex);
+    p->stopping = true;
+    ::pthread_cond_broadcast(&p->cond);
+    ::pthread_mutex_unlock(&p->mutex);
+
+    // Workers leave only when nothing is left queued
+    for (unsigned i = 0; i < p->workers; ++i)
+        ::pthread_join(p->threads[i], NULL);
+
+    delete p;
+}
+
+CRYSTAX_LOCAL
+bool pool_t::submit(struct crystax_vfs_aiocb *cb)
+{
+    scope_lock_t lock(mutex);
+
+    if (stopping)
+    {
+        errno = EAGAIN;
+        return false;
+    }
+
+    if (queued >= idle && workers < max_workers)
+    {
+        if (system_pthread_create(&threads[workers], NULL, &pool_t::worker, this) == 0)
+            ++workers;
+        else if (workers == 0)
+        {
+            ERR("can't start worker for %s", driver->name());
+            errno = EAGAIN;
+            return false;
+        }
+    }
+
+    cb->__pool = this;
+    cb->__next = NULL;
+    __atomic_store_n(&cb->__state, STATE_QUEUED, __ATOMIC_RELAXED);
+    if (tail)
+        tail->__next = cb;
+    else
+        head = cb;
+    tail = cb;
+    ++queued;
+
+    ::pthread_cond_signal(&cond);
+    return true;
+}
+
+CRYSTAX_LOCAL
+int pool_t::cancel(struct crystax_vfs_aiocb *cb)
+{
+    {
+        scope_lock_t lock(mutex);
+
+        int state = __atomic_load_n(&cb->__state, __ATOMIC_ACQUIRE);
+        if (state != STATE_QUEUED)
+            return state == STATE_RUNNING ? CRYSTAX_VFS_AIO_NOTCANCELED : CRYSTAX_VFS_AIO_ALLDONE;
+
+        struct crystax_vfs_aiocb *prev = NULL;
+        for (struct crystax_vfs_aiocb *p = head; p != cb; prev = p, p = p->__next)
+            ;
+        if (prev)
+            prev->__next = cb->__next;
+        else
+            head = cb->__next;
+        if (tail == cb)
+            tail = prev;
+        --queued;
+        __atomic_store_n(&cb->__state, STATE_RUNNING, __ATOMIC_RELAXED);
+    }
+
+    complete(cb, -1, ECANCELED);
+    return CRYSTAX_VFS_AIO_CANCELED;
+}
+
+CRYSTAX_LOCAL
+void *pool_t::worker(void *arg)
+{
+    static_cast<pool_t *>(arg)->run();
+    return NULL;
+}
+
+CRYSTAX_LOCAL
+void pool_t::run()
+{
+    ::pthread_mutex_lock(&mutex);
+    for (;;)
+    {
+        while (!head && !stopping)
+        {
+            ++idle;
+            ::pthread_cond_wait(&cond, &mutex);
+            --idle;
+        }
+        if (!head)
+            break;
+
+        struct crystax_vfs_aiocb *cb = head;
+        head = cb->__next;
+        if (!head)
+            tail = NULL;
+        --queued;
+        __atomic_store_n(&cb->__state, STATE_RUNNING, __ATOMIC_RELAXED);
+
+        ::pthread_mutex_unlock(&mutex);
+        perform(cb);
+        ::pthread_mutex_lock(&mutex);
+    }
+    ::pthread_mutex_unlock(&mutex);
+}
+
+CRYSTAX_LOCAL
+void pool_t::perform(struct crystax_vfs_aiocb *cb)
+{
+    ssize_t n;
+    if (cb->opcode == CRYSTAX_VFS_AIO_READ)
+        n = native ? system_pread(cb->__extfd, cb->buf, cb->count, (off_t)cb->offset)
+                   : driver->pread(cb->__extfd, cb->buf, cb->count, (off_t)cb->offset);
+    else
+        n = native ? system_pwrite(cb->__extfd, cb->buf, cb->count, (off_t)cb->offset)
+                   : driver->pwrite(cb->__extfd, cb->buf, cb->count, (off_t)cb->offset);
+
+    complete(cb, n, n < 0 ? errno : 0);
+}
+
+} // namespace aio
+} // namespace fileio
+} // namespace crystax
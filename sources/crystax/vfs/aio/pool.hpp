@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#ifndef _CRYSTAX_FILEIO_AIO_POOL_HPP_3c8e1f4a92d04b6e8a7d5c21f0b9e6d4
+#define _CRYSTAX_FILEIO_AIO_POOL_HPP_3c8e1f4a92d04b6e8a7d5c21f0b9e6d4
+
+#include <crystax/vfs.h>
+#include "fileio/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace aio
+{
+
+enum
+{
+    STATE_QUEUED = 1,
+    STATE_RUNNING,
+    STATE_DONE
+};
+
+// Worker threads serving asynchronous requests on one driver. Threads are
+// started on demand, up to a limit, and live until the pool is destroyed;
+// requests are taken in submission order.
+class pool_t : non_copyable_t
+{
+public:
+    enum {MAX_WORKERS = 8};
+
+    // Pool serving driver, created on first use; NULL with errno set if it
+    // can't be created
+    static pool_t *get(driver_t *driver);
+    // Waits for everything queued on driver's pool to complete and stops its
+    // workers. Called before the driver is unloaded.
+    static void shutdown(driver_t *driver);
+
+    bool submit(struct crystax_vfs_aiocb *cb);
+    int cancel(struct crystax_vfs_aiocb *cb);
+
+private:
+    pool_t(driver_t *d, unsigned max);
+    ~pool_t();
+
+    static void *worker(void *arg);
+    void run();
+    void perform(struct crystax_vfs_aiocb *cb);
+
+    driver_t *driver;
+    // Kernel descriptors are used directly for the system driver
+    bool native;
+    unsigned max_workers;
+    unsigned workers;
+    unsigned idle;
+    unsigned queued;
+    bool stopping;
+    pthread_t threads[MAX_WORKERS];
+
+    struct crystax_vfs_aiocb *head;
+    struct crystax_vfs_aiocb *tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    pool_t *next;
+};
+
+// Publishes the result of cb and delivers it to the callback or queue
+void complete(struct crystax_vfs_aiocb *cb, long result, int error);
+
+} // namespace aio
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_AIO_POOL_HPP_3c8e1f4a92d04b6e8a7d5c21f0b9e6d4
@@ -28,6 +28,7 @@
  */
 
 #include "assets/driver.hpp"
+#include "trace/trace.hpp"
 
 #define METADATA_V1 1
 
@@ -174,6 +175,9 @@ void driver_t::init_jni(JNIEnv *env, jhobject const &objContext)
     midIsRead = get_method_id(env, clsInputStream, "read", "([B)I");
     JCHECK;
 
+    midIsReadRegion = get_method_id(env, clsInputStream, "read", "([BII)I");
+    JCHECK;
+
     midIsSkip = get_method_id(env, clsInputStream, "skip", "(J)J");
     JCHECK;
 
@@ -363,6 +367,9 @@ driver_t::~driver_t()
 {
     jnienv()->DeleteGlobalRef(objAssetManager);
 
+    for (size_t fd = 0; fd != sizeof(fd_table)/sizeof(fd_table[0]); ++fd)
+        if (::pthread_mutex_destroy(&fd_table[fd].stream_mutex) != 0)
+            ::abort();
     if (::pthread_mutex_destroy(&fd_table_mutex) != 0)
         ::abort();
     if (::pthread_mutex_destroy(&metadata_mutex) != 0)
@@ -381,6 +388,8 @@ void driver_t::init_fd()
         e.size = 0;
         e.extfd = -1;
         e.path.reset();
+        if (::pthread_mutex_init(&e.stream_mutex, NULL) != 0)
+            ::abort();
     }
 }
 
@@ -489,6 +498,42 @@ bool driver_t::update(int fd, size_t pos)
     return true;
 }
 
+CRYSTAX_LOCAL
+pthread_mutex_t *driver_t::stream_mutex(int fd)
+{
+    if (fd < 0 || (size_t)fd >= sizeof(fd_table)/sizeof(fd_table[0]))
+        return NULL;
+    return &fd_table[fd].stream_mutex;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::seek_stream(JNIEnv *env, jobject obj, size_t pos)
+{
+    trace::jni_calls(this, 1);
+    jni::call_method<void>(env, obj, midIsReset);
+    if (env->ExceptionCheck())
+    {
+        env->ExceptionClear();
+        errno = EFAULT;
+        return false;
+    }
+    while (pos > 0)
+    {
+        trace::jni_calls(this, 1);
+        jlong n = jni::call_method<jlong>(env, obj, midIsSkip, (jlong)pos);
+        if (env->ExceptionCheck())
+        {
+            env->ExceptionClear();
+            errno = EFAULT;
+            return false;
+        }
+        if (n <= 0)
+            break;
+        pos -= (size_t)n;
+    }
+    return true;
+}
+
 CRYSTAX_LOCAL
 bool driver_t::check_subpath(abspath_t const &abspath)
 {
@@ -527,10 +572,16 @@ int driver_t::close(int fd)
 
     DBG("use obj=%p", obj);
     jhobject objInputStream(obj ? env->NewLocalRef(obj) : 0);
-    free_fd(fd);
+    {
+        // Let reads in progress on the stream finish
+        scope_lock_t guard(stream_mutex(fd));
+        free_fd(fd);
+    }
 
     if (objInputStream)
     {
+        // NewLocalRef, close() and DeleteGlobalRef
+        trace::jni_calls(this, 3);
         jni::call_method<void>(env, objInputStream, midIsClose);
         env->ExceptionClear();
     }
@@ -566,6 +617,8 @@ bool driver_t::copy_from_assets(abspath_t const &abspath, path_t const &rpath)
     TRACE;
     JNIEnv *env = jnienv();
 
+    // NewStringUTF, open(), NewByteArray and close()
+    trace::jni_calls(this, 4);
     jhobject objInputStream = jni::call_method<jhobject>(env,
         objAssetManager, midAmOpen, jcast<jhstring>(rpath), ACCESS_STREAMING);
     if (env->ExceptionCheck())
@@ -590,6 +643,7 @@ bool driver_t::copy_from_assets(abspath_t const &abspath, path_t const &rpath)
     jhbyteArray objArray(env->NewByteArray(sizeof(buf)));
     for (;;)
     {
+        trace::jni_calls(this, 2);
         jint n = jni::call_method<jint>(env, objInputStream, midIsReset, objArray);
         DBG("n=%d", n);
         bool success = !env->ExceptionCheck();
@@ -786,11 +840,8 @@ loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
 {
     DBG("fd=%d, offset=%ld, whence=%d", fd, (long)offset, whence);
 
-    jobject obj;
-    size_t pos;
-    size_t size;
     int extfd;
-    if (!resolve(fd, &obj, &pos, &size, &extfd, NULL))
+    if (!resolve(fd, NULL, NULL, NULL, &extfd, NULL))
     {
         errno = EINVAL;
         return -1;
@@ -802,6 +853,17 @@ loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
         return underlying()->lseek64(extfd, offset, whence);
     }
 
+    scope_lock_t guard(stream_mutex(fd));
+
+    jobject obj;
+    size_t pos;
+    size_t size;
+    if (!resolve(fd, &obj, &pos, &size, NULL, NULL) || !obj)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
     DBG("use obj=%p", obj);
 
     JNIEnv *env = jnienv();
@@ -836,20 +898,8 @@ loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
         DBG("fd=%d: unknown whence value: %d", fd, whence);
     }
 
-    jni::call_method<void>(env, obj, midIsReset);
-    if (env->ExceptionCheck())
-    {
-        env->ExceptionClear();
-        errno = EFAULT;
-        return -1;
-    }
-    jni::call_method<jlong>(env, obj, midIsSkip, (jlong)pos);
-    if (env->ExceptionCheck())
-    {
-        env->ExceptionClear();
-        errno = EFAULT;
+    if (!seek_stream(env, obj, pos))
         return -1;
-    }
 
     update(fd, pos);
 
@@ -956,6 +1006,8 @@ int driver_t::open(const char *path, int oflag, va_list &vl)
 
     JNIEnv *env = jnienv();
 
+    // NewStringUTF, open(), mark(), skip(), reset() and NewGlobalRef
+    trace::jni_calls(this, 6);
     jhobject objInputStream = jni::call_method<jhobject>(env, objAssetManager, midAmOpen,
         jcast<jhstring>(rpath), ACCESS_STREAMING);
     if (env->ExceptionCheck())
@@ -1015,15 +1067,109 @@ DIR *driver_t::opendir(const char *dirpath)
 }
 
 CRYSTAX_LOCAL
-ssize_t driver_t::pread(int /* fd */, void * /* buf */, size_t /* count */, off_t /* offset */)
+ssize_t driver_t::pread(int fd, void *buf, size_t count, off_t offset)
 {
-    NOT_IMPLEMENTED;
+    DBG("fd=%d, count=%u, offset=%ld", fd, (unsigned)count, (long)offset);
+
+    int extfd;
+    if (!resolve(fd, NULL, NULL, NULL, &extfd, NULL))
+    {
+        ERR("wrong fd passed");
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (extfd != -1)
+    {
+        DBG("use extfd=%d", extfd);
+        return underlying()->pread(extfd, buf, count, offset);
+    }
+
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // AssetManager gives nothing but a stream, shared with read() and
+    // lseek(); concurrent requests on one descriptor take turns on it and
+    // leave it at the descriptor's position
+    scope_lock_t guard(stream_mutex(fd));
+
+    jobject obj;
+    size_t pos;
+    size_t size;
+    if (!resolve(fd, &obj, &pos, &size, NULL, NULL) || !obj)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((size_t)offset >= size || count == 0)
+        return 0;
+    if (count > size - offset)
+        count = size - offset;
+
+    JNIEnv *env = jnienv();
+
+    // NewByteArray and GetByteArrayRegion
+    trace::jni_calls(this, 2);
+    jhbyteArray objArray(env->NewByteArray(count));
+    if (env->ExceptionCheck())
+    {
+        env->ExceptionClear();
+        ERR("can't allocate %u bytes", (unsigned)count);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if (!seek_stream(env, obj, offset))
+        return -1;
+
+    size_t total = 0;
+    while (total < count)
+    {
+        trace::jni_calls(this, 1);
+        jint n = jni::call_method<jint>(env, obj, midIsReadRegion, objArray, (jint)total, (jint)(count - total));
+        if (env->ExceptionCheck())
+        {
+            ERR("java read failed");
+            env->ExceptionClear();
+            errno = EFAULT;
+            seek_stream(env, obj, pos);
+            return -1;
+        }
+        if (n <= 0)
+            break;
+        total += n;
+    }
+
+    if (!seek_stream(env, obj, pos))
+        return -1;
+
+    env->GetByteArrayRegion(objArray.get(), 0, total, (jbyte*)buf);
+
+    DBG("return %u bytes", (unsigned)total);
+    return total;
 }
 
 CRYSTAX_LOCAL
-ssize_t driver_t::pwrite(int /* fd */, const void * /* buf */, size_t /* count */, off_t /* offset */)
+ssize_t driver_t::pwrite(int fd, const void *buf, size_t count, off_t offset)
 {
-    NOT_IMPLEMENTED;
+    int extfd;
+    if (!resolve(fd, NULL, NULL, NULL, &extfd, NULL))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (extfd == -1)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return underlying()->pwrite(extfd, buf, count, offset);
 }
 
 CRYSTAX_LOCAL
@@ -1037,10 +1183,8 @@ ssize_t driver_t::read(int fd, void *buf, size_t count)
         return 0;
     }
 
-    jobject obj;
-    size_t pos;
     int extfd;
-    if (!resolve(fd, &obj, &pos, NULL, &extfd, NULL))
+    if (!resolve(fd, NULL, NULL, NULL, &extfd, NULL))
     {
         ERR("wrong fd passed");
         errno = EINVAL;
@@ -1053,9 +1197,22 @@ ssize_t driver_t::read(int fd, void *buf, size_t count)
         return underlying()->read(extfd, buf, count);
     }
 
+    scope_lock_t guard(stream_mutex(fd));
+
+    jobject obj;
+    size_t pos;
+    if (!resolve(fd, &obj, &pos, NULL, NULL, NULL) || !obj)
+    {
+        ERR("wrong fd passed");
+        errno = EINVAL;
+        return -1;
+    }
+
     DBG("use obj=%p", obj);
     JNIEnv *env = jnienv();
 
+    // NewByteArray, read() and GetByteArrayRegion
+    trace::jni_calls(this, 3);
     jhbyteArray objArray(env->NewByteArray(count));
     if (env->ExceptionCheck())
     {
@@ -1246,6 +1403,8 @@ int driver_t::stat_as(path_t const &rpath, struct stat *st)
     JNIEnv *env = jnienv();
 
     DBG("is it file?");
+    // NewStringUTF and open()
+    trace::jni_calls(this, 2);
     jhstring objPath = jcast<jhstring>(rpath);
     jhobject objInputStream = jni::call_method<jhobject>(env, objAssetManager, midAmOpen,
         objPath, ACCESS_STREAMING);
@@ -1254,6 +1413,7 @@ int driver_t::stat_as(path_t const &rpath, struct stat *st)
     {
         DBG("it is file");
 
+        trace::jni_calls(this, 2);
         jlong skipped = jni::call_method<jlong>(env, objInputStream, midIsSkip, (jlong)INT_MAX);
         env->ExceptionClear();
         jni::call_method<void>(env, objInputStream, midIsClose);
@@ -1267,6 +1427,8 @@ int driver_t::stat_as(path_t const &rpath, struct stat *st)
     }
 
     DBG("is it directory?");
+    // list() and GetArrayLength
+    trace::jni_calls(this, 2);
     jhobjectArray objArray = jni::call_method<jhobjectArray>(env, objAssetManager, midAmList, objPath);
     env->ExceptionClear();
     if (objArray && env->GetArrayLength(objArray.get()) > 0)
@@ -1318,6 +1480,18 @@ int driver_t::symlink(const char * /* src */, const char * /* dst */)
     NOT_IMPLEMENTED;
 }
 
+CRYSTAX_LOCAL
+int driver_t::sysfd(int fd)
+{
+    // Files copied out of the APK are served by the underlying driver;
+    // the ones read straight from AssetManager have no kernel descriptor
+    int extfd;
+    if (!resolve(fd, NULL, NULL, NULL, &extfd, NULL) || extfd < 0 || !underlying())
+        return -1;
+
+    return underlying()->sysfd(extfd);
+}
+
 CRYSTAX_LOCAL
 long driver_t::telldir(DIR * /* dirp */)
 {
@@ -90,6 +90,7 @@ public:
     int    select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv);
     int    stat(const char *path, struct stat *st);
     int    symlink(const char *src, const char *dst);
+    int    sysfd(int fd);
     long   telldir(DIR *dirp);
     int    unlink(const char *path);
     ssize_t write(int fd, const void *buf, size_t count);
@@ -111,6 +112,8 @@ private:
     void free_fd(int fd);
     bool resolve(int fd, jobject *obj, size_t *pos, size_t *size, int *extfd, abspath_t *abspath);
     bool update(int fd, size_t pos);
+    pthread_mutex_t *stream_mutex(int fd);
+    bool seek_stream(JNIEnv *env, jobject obj, size_t pos);
 
     void load_metadata();
     void save_metadata();
@@ -125,6 +128,7 @@ private:
     jmethodID midIsClose;
     jmethodID midIsAvail;
     jmethodID midIsRead;
+    jmethodID midIsReadRegion;
     jmethodID midIsSkip;
     jmethodID midIsMark;
     jmethodID midIsReset;
@@ -138,6 +142,8 @@ private:
         size_t size;
         int extfd;
         abspath_t path;
+        // Serializes use of obj, whose position is the stream's
+        pthread_mutex_t stream_mutex;
     };
 
     fd_entry_t fd_table[FD_TABLE_SIZE];
@@ -0,0 +1,1051 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "cache/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace cache
+{
+
+enum
+{
+    CACHE_DEFAULT_SIZE = 1024 * 1024,
+    CACHE_DEFAULT_BLOCK = 16 * 1024,
+    CACHE_DEFAULT_READAHEAD = 256 * 1024,
+    CACHE_MIN_BLOCK = 512,
+    CACHE_MAX_BLOCK = 1024 * 1024
+};
+
+CRYSTAX_LOCAL
+driver_t *driver_t::create(const char *root, const char *options, fileio::driver_t *d)
+{
+    DBG("root=%s, options=%s", root, options ? options : "(null)");
+
+    size_t size = CACHE_DEFAULT_SIZE;
+    size_t block = CACHE_DEFAULT_BLOCK;
+    size_t readahead = CACHE_DEFAULT_READAHEAD;
+
+    for (const char *s = options; s && *s != '\0';)
+    {
+        const char *e = ::strchr(s, ',');
+        size_t len = e ? (size_t)(e - s) : ::strlen(s);
+        const char *eq = (const char *)::memchr(s, '=', len);
+        size_t klen = eq ? (size_t)(eq - s) : 0;
+
+        size_t *value = NULL;
+        if (klen == 4 && ::strncmp(s, "size", klen) == 0)
+            value = &size;
+        else if (klen == 5 && ::strncmp(s, "block", klen) == 0)
+            value = &block;
+        else if (klen == 9 && ::strncmp(s, "readahead", klen) == 0)
+            value = &readahead;
+
+        if (!value || !parse_size_option(eq + 1, len - klen - 1, value))
+        {
+            ERR("bad cache option: %.*s", (int)len, s);
+            errno = EINVAL;
+            return NULL;
+        }
+
+        s = e ? e + 1 : NULL;
+    }
+
+    if (block < CACHE_MIN_BLOCK || block > CACHE_MAX_BLOCK || size / block < 2)
+    {
+        ERR("bad cache geometry: size=%lu, block=%lu", (unsigned long)size, (unsigned long)block);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t nblocks = size / block;
+    // Keep read-ahead within half of the cache, so a single reader can't
+    // evict the block it is about to copy from
+    size_t maxwindow = readahead / block;
+    if (maxwindow > nblocks / 2)
+        maxwindow = nblocks / 2;
+
+    driver_t *driver = new driver_t(root, nblocks, block, maxwindow, d);
+    if (!driver->buckets)
+    {
+        delete driver;
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return driver;
+}
+
+CRYSTAX_LOCAL
+driver_t::driver_t(const char *root, size_t nblocks, size_t bsize, size_t maxwindow, fileio::driver_t *d)
+    :fileio::driver_t(root, d), capacity(nblocks), block_size(bsize), max_window(maxwindow),
+    buckets(0), nbuckets(1)
+{
+    pthread_mutexattr_t attr;
+    if (::pthread_mutexattr_init(&attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+        ::abort();
+    if (::pthread_mutex_init(&mutex, &attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_destroy(&attr) != 0)
+        ::abort();
+    if (::pthread_cond_init(&readers, NULL) != 0)
+        ::abort();
+
+    ::memset(fd_table, 0, sizeof(fd_table));
+    ::memset(&counters, 0, sizeof(counters));
+
+    while (nbuckets < capacity * 2)
+        nbuckets <<= 1;
+    buckets = (block_t **)::calloc(nbuckets, sizeof(block_t *));
+}
+
+CRYSTAX_LOCAL
+driver_t::~driver_t()
+{
+    lru.clear();
+    files.clear();
+    ::free(buckets);
+
+    if (::pthread_cond_destroy(&readers) != 0)
+        ::abort();
+    if (::pthread_mutex_destroy(&mutex) != 0)
+        ::abort();
+}
+
+CRYSTAX_LOCAL
+void driver_t::stats(struct crystax_vfs_cache_stats *st)
+{
+    scope_lock_t lock(mutex);
+    *st = counters;
+    st->blocks = lru.size();
+    st->capacity = capacity;
+    st->block_size = block_size;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::same_file(file_t const &f, const char *path)
+{
+    return ::strcmp(f.path.c_str(), path) == 0;
+}
+
+CRYSTAX_LOCAL
+driver_t::file_t *driver_t::lookup_file(const char *path)
+{
+    return files.find(same_file, path);
+}
+
+CRYSTAX_LOCAL
+driver_t::file_t *driver_t::acquire_file(const char *path, struct stat const *st)
+{
+    file_t *f = lookup_file(path);
+    if (!f)
+    {
+        f = new file_t(path);
+        files.push_back(f);
+    }
+    ++f->refs;
+
+    if (st)
+    {
+        if (f->size != st->st_size || f->mtime != st->st_mtime)
+        {
+            DBG("%s changed, drop %lu blocks", path, (unsigned long)f->nblocks);
+            invalidate(f);
+        }
+        f->size = st->st_size;
+        f->mtime = st->st_mtime;
+    }
+
+    return f;
+}
+
+CRYSTAX_LOCAL
+void driver_t::release_file(file_t *f)
+{
+    // Blocks outlive the descriptors, so the next open() of the same file
+    // finds them; the record itself goes away with its last block
+    if (--f->refs == 0 && f->nblocks == 0)
+        delete files.pop(f);
+}
+
+CRYSTAX_LOCAL
+void driver_t::invalidate(file_t *f)
+{
+    ++f->epoch;
+    for (block_t *b = lru.head(); b && f->nblocks > 0;)
+    {
+        block_t *next = b->next;
+        if (b->file == f)
+        {
+            unhash(lru.pop(b));
+            --f->nblocks;
+            delete b;
+        }
+        b = next;
+    }
+
+    if (f->refs == 0)
+        delete files.pop(f);
+}
+
+CRYSTAX_LOCAL
+void driver_t::invalidate(const char *path)
+{
+    abspath_t abspath(path);
+    scope_lock_t lock(mutex);
+    file_t *f = lookup_file(abspath.c_str());
+    if (f)
+        invalidate(f);
+}
+
+CRYSTAX_LOCAL
+void driver_t::invalidate(int fd)
+{
+    if (fd < 0 || fd >= FD_TABLE_SIZE)
+        return;
+
+    {
+        scope_lock_t lock(mutex);
+        if (!fd_table[fd].file)
+            return;
+    }
+
+    // Writes may have grown the file; descriptors reading it through the
+    // cache must see the new size, not just drop old blocks
+    struct stat st;
+    bool known = underlying()->fstat(fd, &st) == 0;
+
+    scope_lock_t lock(mutex);
+    file_t *f = fd_table[fd].file;
+    if (!f)
+        return;
+    if (f->nblocks > 0)
+        invalidate(f);
+    if (known)
+    {
+        f->size = st.st_size;
+        f->mtime = st.st_mtime;
+    }
+}
+
+CRYSTAX_LOCAL
+size_t driver_t::bucket(file_t *file, size_t index) const
+{
+    size_t h = (size_t)file / sizeof(void *);
+    h ^= index * 0x9e3779b1u;
+    h ^= h >> 16;
+    return h & (nbuckets - 1);
+}
+
+CRYSTAX_LOCAL
+driver_t::block_t *driver_t::lookup(file_t *file, size_t index)
+{
+    for (block_t *b = buckets[bucket(file, index)]; b; b = b->hnext)
+        if (b->file == file && b->index == index)
+            return b;
+    return NULL;
+}
+
+CRYSTAX_LOCAL
+void driver_t::unhash(block_t *b)
+{
+    for (block_t **p = &buckets[bucket(b->file, b->index)]; *p; p = &(*p)->hnext)
+    {
+        if (*p == b)
+        {
+            *p = b->hnext;
+            break;
+        }
+    }
+    b->hnext = NULL;
+}
+
+CRYSTAX_LOCAL
+driver_t::block_t *driver_t::allocate()
+{
+    if (lru.size() < capacity)
+    {
+        char *data = (char *)::malloc(block_size);
+        if (data)
+            return new block_t(data);
+        if (lru.empty())
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return evict();
+}
+
+CRYSTAX_LOCAL
+driver_t::block_t *driver_t::evict()
+{
+    block_t *b = lru.pop_back();
+    unhash(b);
+    file_t *f = b->file;
+    if (--f->nblocks == 0 && f->refs == 0)
+        delete files.pop(f);
+    b->file = NULL;
+    ++counters.evictions;
+    return b;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::sync(int fd, fd_entry_t &e, loff_t offset)
+{
+    if (e.extpos == offset)
+        return true;
+
+    // Underlying drivers aren't required to support pread() (assets don't),
+    // so every positioned read goes through lseek(). Those which can't seek
+    // past the end of file stop short of offset; extpos tells where, or is
+    // -1 on error.
+    e.extpos = underlying()->lseek64(fd, offset, SEEK_SET);
+    return e.extpos == offset;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::wait_reader(fd_entry_t &e)
+{
+    // Callers hold the mutex exactly once, so waiting releases it for real
+    file_t *f = e.file;
+    while (e.reading)
+        ::pthread_cond_wait(&readers, &mutex);
+    if (e.file != f)
+    {
+        // Closed by another thread meanwhile
+        errno = EBADF;
+        return false;
+    }
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::fill(int fd, fd_entry_t &e, size_t index)
+{
+    file_t *f = e.file;
+
+    // Concurrent reads of the same descriptor (aio does them) share its
+    // position, so they go to the underlying driver one at a time
+    if (!wait_reader(e))
+        return false;
+    // Could be read by the one we've waited for
+    if (lookup(f, index))
+        return true;
+
+    // Take the blocks out of the LRU first, then read them with the mutex
+    // released: underlying reads (assets, JNI) are slow, and other readers
+    // shouldn't wait for them. Blocks are put in only after the read, so
+    // nobody sees them half-filled.
+    block_t *chain = NULL;
+    block_t **tail = &chain;
+    for (size_t i = 0; i <= e.window; ++i)
+    {
+        loff_t offset = (loff_t)(index + i) * block_size;
+        if (offset >= f->size || (i > 0 && lookup(f, index + i)))
+            break;
+
+        block_t *b = allocate();
+        if (!b)
+            break;
+        b->index = index + i;
+        b->length = 0;
+        *tail = b;
+        tail = &b->hnext;
+    }
+    if (!chain)
+        return false;
+
+    if (!sync(fd, e, (loff_t)index * block_size))
+    {
+        for (block_t *b = chain, *next; b; b = next)
+        {
+            next = b->hnext;
+            delete b;
+        }
+        if (e.extpos < 0)
+            return false;
+        // File has been truncated behind our back
+        f->size = e.extpos;
+        return true;
+    }
+
+    // Pinned, so a close() from another thread meanwhile doesn't free it
+    ++f->refs;
+    unsigned epoch = f->epoch;
+    loff_t extpos = e.extpos;
+    e.reading = true;
+    unsigned reads = 0;
+    size_t bytes = 0;
+    bool eof = false;
+    int error = 0;
+
+    ::pthread_mutex_unlock(&mutex);
+    for (block_t *b = chain; b && !eof && !error; b = b->hnext)
+    {
+        while (b->length < block_size)
+        {
+            ssize_t n = underlying()->read(fd, b->data + b->length, block_size - b->length);
+            ++reads;
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                error = errno;
+            if (n == 0)
+                eof = true;
+            if (n <= 0)
+                break;
+            b->length += n;
+            extpos += n;
+            bytes += n;
+        }
+    }
+    ::pthread_mutex_lock(&mutex);
+
+    // Descriptor closed by another thread meanwhile
+    bool closed = e.file != f;
+    if (!closed)
+    {
+        e.extpos = extpos;
+        e.reading = false;
+    }
+    ::pthread_cond_broadcast(&readers);
+    counters.ext_reads += reads;
+    counters.ext_bytes += bytes;
+
+    // Written meanwhile: what has been read may be stale already, so it's
+    // thrown away and the caller looks the block up once again
+    bool stale = f->epoch != epoch;
+    // File has been truncated behind our back
+    if (eof && !stale && extpos < f->size)
+        f->size = extpos;
+
+    for (block_t *b = chain, *next; b; b = next)
+    {
+        next = b->hnext;
+        b->hnext = NULL;
+
+        // Another reader could fill the same block while we were reading
+        if (stale || b->length == 0 || lookup(f, b->index))
+        {
+            delete b;
+            continue;
+        }
+
+        b->file = f;
+        size_t h = bucket(f, b->index);
+        b->hnext = buckets[h];
+        buckets[h] = b;
+        lru.push_front(b);
+        ++f->nblocks;
+        if (b != chain)
+            ++counters.readahead;
+    }
+
+    // Blocks being read aren't counted in the LRU, so concurrent fills could
+    // allocate past capacity; the blocks just read are at the front and stay
+    while (lru.size() > capacity)
+        delete evict();
+
+    bool failed = closed || (error && !stale && !lookup(f, index));
+    release_file(f);
+
+    if (failed)
+    {
+        errno = closed ? EBADF : error;
+        return false;
+    }
+    return true;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::cached_read(int fd, fd_entry_t &e, char *buf, size_t count, loff_t offset)
+{
+    file_t *f = e.file;
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (offset >= f->size || count == 0)
+        return 0;
+    if ((loff_t)count > f->size - offset)
+        count = f->size - offset;
+
+    // Grow the read-ahead window while the reader goes sequentially, drop it
+    // on the first seek
+    if (offset == e.last)
+        e.window = e.window == 0 ? 1 : e.window * 2;
+    else
+        e.window = 0;
+    if (e.window > max_window)
+        e.window = max_window;
+
+    size_t done = 0;
+
+    if (count >= capacity * block_size / 2)
+    {
+        // Would flush the whole cache for nothing
+        ++counters.bypassed;
+        if (!wait_reader(e))
+            return -1;
+        if (!sync(fd, e, offset))
+            return e.extpos < 0 ? -1 : 0;
+        while (done < count)
+        {
+            ssize_t n = underlying()->read(fd, buf + done, count - done);
+            ++counters.ext_reads;
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && done == 0)
+                return -1;
+            if (n <= 0)
+                break;
+            done += n;
+            e.extpos += n;
+            counters.ext_bytes += n;
+        }
+        e.last = offset + done;
+        return done;
+    }
+
+    while (done < count)
+    {
+        loff_t pos = offset + done;
+        size_t index = pos / block_size;
+        size_t skip = pos % block_size;
+
+        block_t *b = lookup(f, index);
+        if (b)
+        {
+            ++counters.hits;
+            lru.push_front(lru.pop(b));
+        }
+        else
+        {
+            ++counters.misses;
+            if (!fill(fd, e, index))
+            {
+                if (done == 0)
+                    return -1;
+                break;
+            }
+            // Premature end of file shrinks it
+            if (pos >= f->size)
+                break;
+            // Not there if a write has raced with the read; try once again
+            b = lookup(f, index);
+            if (!b)
+                continue;
+        }
+
+        // Short block: the file has been truncated behind our back
+        if (skip >= b->length)
+            break;
+
+        size_t n = b->length - skip;
+        if (n > count - done)
+            n = count - done;
+        ::memcpy(buf + done, b->data + skip, n);
+        done += n;
+
+        if (b->length < block_size)
+            break;
+    }
+
+    e.last = offset + done;
+    return done;
+}
+
+CRYSTAX_LOCAL
+driver_t::fd_entry_t *driver_t::entry(int fd)
+{
+    if (fd < 0 || fd >= FD_TABLE_SIZE || !fd_table[fd].cached)
+        return NULL;
+    return &fd_table[fd];
+}
+
+CRYSTAX_LOCAL
+void driver_t::uncache(int fd)
+{
+    // Make the underlying descriptor current and let it own the position
+    // from now on; needed before it gets shared with another descriptor
+    scope_lock_t lock(mutex);
+    fd_entry_t *e = entry(fd);
+    if (!e || !wait_reader(*e))
+        return;
+    sync(fd, *e, e->pos);
+    e->cached = false;
+}
+
+CRYSTAX_LOCAL
+int driver_t::chown(const char *path, uid_t uid, gid_t gid)
+{
+    return underlying()->chown(path, uid, gid);
+}
+
+CRYSTAX_LOCAL
+int driver_t::close(int fd)
+{
+    DBG("fd=%d", fd);
+
+    if (fd >= 0 && fd < FD_TABLE_SIZE)
+    {
+        scope_lock_t lock(mutex);
+        fd_entry_t &e = fd_table[fd];
+        if (e.file)
+            release_file(e.file);
+        ::memset(&e, 0, sizeof(e));
+    }
+
+    return underlying()->close(fd);
+}
+
+CRYSTAX_LOCAL
+int driver_t::closedir(DIR *dirp)
+{
+    return underlying()->closedir(dirp);
+}
+
+CRYSTAX_LOCAL
+int driver_t::dirfd(DIR *dirp)
+{
+    return underlying()->dirfd(dirp);
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup(int fd)
+{
+    uncache(fd);
+    return underlying()->dup(fd);
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup2(int fd, int fd2)
+{
+    uncache(fd);
+    int ret = underlying()->dup2(fd, fd2);
+    if (ret >= 0 && ret < FD_TABLE_SIZE && ret != fd)
+    {
+        // fd2 has been closed implicitly
+        scope_lock_t lock(mutex);
+        fd_entry_t &e = fd_table[ret];
+        if (e.file)
+            release_file(e.file);
+        ::memset(&e, 0, sizeof(e));
+    }
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fchown(int fd, uid_t uid, gid_t gid)
+{
+    return underlying()->fchown(fd, uid, gid);
+}
+
+CRYSTAX_LOCAL
+int driver_t::fcntl(int fd, int command, va_list &vl)
+{
+    if (command == F_DUPFD
+#ifdef F_DUPFD_CLOEXEC
+        || command == F_DUPFD_CLOEXEC
+#endif
+       )
+        uncache(fd);
+    return underlying()->fcntl(fd, command, vl);
+}
+
+CRYSTAX_LOCAL
+int driver_t::fdatasync(int fd)
+{
+    return underlying()->fdatasync(fd);
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::fdopendir(int fd)
+{
+    return underlying()->fdopendir(fd);
+}
+
+CRYSTAX_LOCAL
+int driver_t::flock(int fd, int operation)
+{
+    return underlying()->flock(fd, operation);
+}
+
+CRYSTAX_LOCAL
+int driver_t::fstat(int fd, struct stat *st)
+{
+    return underlying()->fstat(fd, st);
+}
+
+CRYSTAX_LOCAL
+int driver_t::fsync(int fd)
+{
+    return underlying()->fsync(fd);
+}
+
+CRYSTAX_LOCAL
+int driver_t::ftruncate(int fd, off_t offset)
+{
+    int ret = underlying()->ftruncate(fd, offset);
+    if (ret == 0)
+        invalidate(fd);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::getdents(unsigned int fd, struct dirent *entry, unsigned int count)
+{
+    return underlying()->getdents(fd, entry, count);
+}
+
+CRYSTAX_LOCAL
+int driver_t::ioctl(int fd, int request, va_list &vl)
+{
+    return underlying()->ioctl(fd, request, vl);
+}
+
+CRYSTAX_LOCAL
+int driver_t::lchown(const char *path, uid_t uid, gid_t gid)
+{
+    return underlying()->lchown(path, uid, gid);
+}
+
+CRYSTAX_LOCAL
+int driver_t::link(const char *src, const char *dst)
+{
+    return underlying()->link(src, dst);
+}
+
+CRYSTAX_LOCAL
+off_t driver_t::lseek(int fd, off_t offset, int whence)
+{
+    return lseek64(fd, offset, whence);
+}
+
+CRYSTAX_LOCAL
+loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
+{
+    DBG("fd=%d, offset=%lld, whence=%d", fd, (long long)offset, whence);
+
+    {
+        scope_lock_t lock(mutex);
+        fd_entry_t *e = entry(fd);
+        if (e)
+        {
+            loff_t pos;
+            switch (whence)
+            {
+            case SEEK_SET: pos = offset; break;
+            case SEEK_CUR: pos = e->pos + offset; break;
+            case SEEK_END: pos = e->file->size + offset; break;
+            default: pos = -1;
+            }
+            if (pos < 0)
+            {
+                errno = EINVAL;
+                return -1;
+            }
+            e->pos = pos;
+            return pos;
+        }
+    }
+
+    return underlying()->lseek64(fd, offset, whence);
+}
+
+CRYSTAX_LOCAL
+int driver_t::lstat(const char *path, struct stat *st)
+{
+    return underlying()->lstat(path, st);
+}
+
+CRYSTAX_LOCAL
+int driver_t::mkdir(const char *path, mode_t mode)
+{
+    return underlying()->mkdir(path, mode);
+}
+
+CRYSTAX_LOCAL
+int driver_t::open(const char *path, int oflag, va_list &vl)
+{
+    DBG("path=%s, oflag=%d", path, oflag);
+
+    int fd = underlying()->open(path, oflag, vl);
+    if (fd < 0 || fd >= FD_TABLE_SIZE)
+        return fd;
+
+    abspath_t abspath(path);
+    bool readonly = (oflag & O_ACCMODE) == O_RDONLY && !(oflag & O_TRUNC);
+
+    struct stat st;
+    bool regular = underlying()->fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+
+    scope_lock_t lock(mutex);
+
+    fd_entry_t &e = fd_table[fd];
+    ::memset(&e, 0, sizeof(e));
+    if (!regular)
+        return fd;
+
+    e.file = acquire_file(abspath.c_str(), readonly ? &st : NULL);
+    e.cached = readonly;
+    if (!readonly && e.file->nblocks > 0)
+        invalidate(e.file);
+
+    return fd;
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::opendir(const char *dirpath)
+{
+    return underlying()->opendir(dirpath);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pread(int fd, void *buf, size_t count, off_t offset)
+{
+    {
+        scope_lock_t lock(mutex);
+        fd_entry_t *e = entry(fd);
+        if (e)
+            return cached_read(fd, *e, (char *)buf, count, offset);
+    }
+
+    return underlying()->pread(fd, buf, count, offset);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    ssize_t ret = underlying()->pwrite(fd, buf, count, offset);
+    if (ret > 0)
+        invalidate(fd);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::read(int fd, void *buf, size_t count)
+{
+    DBG("fd=%d, count=%lu", fd, (unsigned long)count);
+
+    {
+        scope_lock_t lock(mutex);
+        fd_entry_t *e = entry(fd);
+        if (e)
+        {
+            ssize_t n = cached_read(fd, *e, (char *)buf, count, e->pos);
+            if (n > 0)
+                e->pos += n;
+            return n;
+        }
+    }
+
+    return underlying()->read(fd, buf, count);
+}
+
+CRYSTAX_LOCAL
+int driver_t::readv(int fd, const struct iovec *iov, int count)
+{
+    {
+        scope_lock_t lock(mutex);
+        fd_entry_t *e = entry(fd);
+        if (e)
+        {
+            ssize_t total = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                ssize_t n = cached_read(fd, *e, (char *)iov[i].iov_base, iov[i].iov_len, e->pos);
+                if (n < 0)
+                    return total > 0 ? total : -1;
+                e->pos += n;
+                total += n;
+                if ((size_t)n < iov[i].iov_len)
+                    break;
+            }
+            return total;
+        }
+    }
+
+    return underlying()->readv(fd, iov, count);
+}
+
+CRYSTAX_LOCAL
+struct dirent *driver_t::readdir(DIR *dirp)
+{
+    return underlying()->readdir(dirp);
+}
+
+CRYSTAX_LOCAL
+int driver_t::readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result)
+{
+    return underlying()->readdir_r(dirp, entry, result);
+}
+
+CRYSTAX_LOCAL
+int driver_t::readlink(const char *path, char *buf, size_t bufsize)
+{
+    return underlying()->readlink(path, buf, bufsize);
+}
+
+CRYSTAX_LOCAL
+int driver_t::remove(const char *path)
+{
+    int ret = underlying()->remove(path);
+    if (ret == 0)
+        invalidate(path);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::rename(const char *oldpath, const char *newpath)
+{
+    int ret = underlying()->rename(oldpath, newpath);
+    if (ret == 0)
+    {
+        invalidate(oldpath);
+        invalidate(newpath);
+    }
+    return ret;
+}
+
+CRYSTAX_LOCAL
+void driver_t::rewinddir(DIR *dirp)
+{
+    underlying()->rewinddir(dirp);
+}
+
+CRYSTAX_LOCAL
+int driver_t::rmdir(const char *path)
+{
+    return underlying()->rmdir(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+    int (*compar)(const struct dirent **, const struct dirent **))
+{
+    return underlying()->scandir(dir, namelist, filter, compar);
+}
+
+CRYSTAX_LOCAL
+void driver_t::seekdir(DIR *dirp, long offset)
+{
+    underlying()->seekdir(dirp, offset);
+}
+
+CRYSTAX_LOCAL
+int driver_t::select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv)
+{
+    return underlying()->select(maxfd, rfd, wfd, efd, tv);
+}
+
+CRYSTAX_LOCAL
+int driver_t::stat(const char *path, struct stat *st)
+{
+    return underlying()->stat(path, st);
+}
+
+CRYSTAX_LOCAL
+int driver_t::symlink(const char *src, const char *dst)
+{
+    return underlying()->symlink(src, dst);
+}
+
+CRYSTAX_LOCAL
+int driver_t::sysfd(int fd)
+{
+    return underlying()->sysfd(fd);
+}
+
+CRYSTAX_LOCAL
+void *driver_t::mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    return underlying()->mmap(addr, length, prot, flags, fd, offset);
+}
+
+CRYSTAX_LOCAL
+long driver_t::telldir(DIR *dirp)
+{
+    return underlying()->telldir(dirp);
+}
+
+CRYSTAX_LOCAL
+int driver_t::unlink(const char *path)
+{
+    int ret = underlying()->unlink(path);
+    if (ret == 0)
+        invalidate(path);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::write(int fd, const void *buf, size_t count)
+{
+    ssize_t ret = underlying()->write(fd, buf, count);
+    if (ret > 0)
+        invalidate(fd);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::writev(int fd, const struct iovec *iov, int count)
+{
+    int ret = underlying()->writev(fd, iov, count);
+    if (ret > 0)
+        invalidate(fd);
+    return ret;
+}
+
+} // namespace cache
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+int crystax_vfs_cache_stats(const char *target, struct crystax_vfs_cache_stats *stats)
+{
+    using namespace ::crystax::fileio;
+
+    driver_t *d = find_driver(target);
+    if (!d || !stats || ::strcmp(d->name(), "CACHE") != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    static_cast<cache::driver_t *>(d)->stats(stats);
+    return 0;
+}
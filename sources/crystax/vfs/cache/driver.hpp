@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#ifndef _CRYSTAX_FILEIO_CACHE_DRIVER_HPP_5d0b6f3e2a7c4e19b81f9d6c0e4a72b3
+#define _CRYSTAX_FILEIO_CACHE_DRIVER_HPP_5d0b6f3e2a7c4e19b81f9d6c0e4a72b3
+
+#include <crystax/list.hpp>
+#include <crystax/vfs.h>
+#include "fileio/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace cache
+{
+
+// Read cache stacked over another mount. Files opened read-only through it
+// are read from the underlying driver in fixed-size blocks kept in a bounded
+// LRU; sequential readers get an adaptive read-ahead window. Everything else
+// (writes, directories, path operations) goes straight to the underlying
+// driver, invalidating cached blocks of the affected files.
+class driver_t : public ::crystax::fileio::driver_t
+{
+public:
+    // Parses mount() data ("size=1m,block=16k,readahead=256k", any key may
+    // be omitted) and returns NULL with errno set on bad options
+    static driver_t *create(const char *root, const char *options, fileio::driver_t *d);
+    ~driver_t();
+
+    const char *name() const {return "CACHE";}
+    const char *info() const {return root().c_str();}
+
+    void stats(struct crystax_vfs_cache_stats *st);
+
+    int    chown(const char *path, uid_t uid, gid_t gid);
+    int    close(int fd);
+    int    closedir(DIR *dirp);
+    int    dirfd(DIR *dirp);
+    int    dup(int fd);
+    int    dup2(int fd, int fd2);
+    int    fchown(int fd, uid_t uid, gid_t gid);
+    int    fcntl(int fd, int command, va_list &vl);
+    int    fdatasync(int fd);
+    DIR *  fdopendir(int fd);
+    int    flock(int fd, int operation);
+    int    fstat(int fd, struct stat *st);
+    int    fsync(int fd);
+    int    ftruncate(int fd, off_t offset);
+    int    getdents(unsigned int fd, struct dirent *entry, unsigned int count);
+    int    ioctl(int fd, int request, va_list &vl);
+    int    lchown(const char *path, uid_t uid, gid_t gid);
+    int    link(const char *src, const char *dst);
+    off_t  lseek(int fd, off_t offset, int whence);
+    loff_t lseek64(int fd, loff_t offset, int whence);
+    int    lstat(const char *path, struct stat *st);
+    int    mkdir(const char *path, mode_t mode);
+    int    open(const char *path, int oflag, va_list &vl);
+    DIR *  opendir(const char *dirpath);
+    ssize_t pread(int fd, void *buf, size_t count, off_t offset);
+    ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
+    ssize_t read(int fd, void *buf, size_t count);
+    int    readv(int fd, const struct iovec *iov, int count);
+    struct dirent *readdir(DIR *dirp);
+    int    readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result);
+    int    readlink(const char *path, char *buf, size_t bufsize);
+    int    remove(const char *path);
+    int    rename(const char *oldpath, const char *newpath);
+    void   rewinddir(DIR *dirp);
+    int    rmdir(const char *path);
+    int    scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+        int (*compar)(const struct dirent **, const struct dirent **));
+    void   seekdir(DIR *dirp, long offset);
+    int    select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv);
+    int    stat(const char *path, struct stat *st);
+    int    symlink(const char *src, const char *dst);
+    int    sysfd(int fd);
+    void * mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+    long   telldir(DIR *dirp);
+    int    unlink(const char *path);
+    ssize_t write(int fd, const void *buf, size_t count);
+    int    writev(int fd, const struct iovec *iov, int count);
+
+private:
+    driver_t(const char *root, size_t nblocks, size_t bsize, size_t maxwindow, fileio::driver_t *d);
+
+    struct file_t
+    {
+        abspath_t path;
+        loff_t size;
+        time_t mtime;
+        unsigned refs;
+        size_t nblocks;
+        // Bumped on every invalidation; tells blocks read before a write
+        unsigned epoch;
+
+        file_t *next;
+        file_t *prev;
+
+        explicit file_t(const char *p)
+            :path(p), size(0), mtime(0), refs(0), nblocks(0), epoch(0), next(0), prev(0)
+        {}
+    };
+
+    struct block_t
+    {
+        file_t *file;
+        size_t index;
+        size_t length;
+        char *data;
+
+        block_t *hnext;
+
+        block_t *next;
+        block_t *prev;
+
+        explicit block_t(char *buf)
+            :file(0), index(0), length(0), data(buf), hnext(0), next(0), prev(0)
+        {}
+        ~block_t() {::free(data);}
+    };
+
+    struct fd_entry_t
+    {
+        // File the descriptor was opened on; NULL if it isn't a regular file
+        file_t *file;
+        // False for descriptors passed through to the underlying driver:
+        // opened for writing, or dup'ed and so sharing their position
+        bool cached;
+        // Position seen by the caller and the one of underlying descriptor;
+        // they diverge as soon as a read is served from the cache
+        loff_t pos;
+        loff_t extpos;
+        // End of the previous read and current read-ahead window, in blocks
+        loff_t last;
+        size_t window;
+        // Set while fill() reads from the descriptor with the mutex released;
+        // nobody else may move the underlying position meanwhile
+        bool reading;
+    };
+
+    file_t *acquire_file(const char *path, struct stat const *st);
+    void release_file(file_t *file);
+    file_t *lookup_file(const char *path);
+    void invalidate(file_t *file);
+    void invalidate(const char *path);
+    void invalidate(int fd);
+
+    size_t bucket(file_t *file, size_t index) const;
+    block_t *lookup(file_t *file, size_t index);
+    block_t *allocate();
+    block_t *evict();
+    void unhash(block_t *b);
+    bool fill(int fd, fd_entry_t &e, size_t index);
+    bool sync(int fd, fd_entry_t &e, loff_t offset);
+    bool wait_reader(fd_entry_t &e);
+    void uncache(int fd);
+
+    ssize_t cached_read(int fd, fd_entry_t &e, char *buf, size_t count, loff_t offset);
+    fd_entry_t *entry(int fd);
+
+    static bool same_file(file_t const &f, const char *path);
+
+private:
+    size_t capacity;
+    size_t block_size;
+    size_t max_window;
+
+    list_t<file_t> files;
+    list_t<block_t> lru;
+    block_t **buckets;
+    size_t nbuckets;
+
+    fd_entry_t fd_table[FD_TABLE_SIZE];
+    pthread_mutex_t mutex;
+    pthread_cond_t readers;
+
+    struct crystax_vfs_cache_stats counters;
+};
+
+} // namespace cache
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_CACHE_DRIVER_HPP_5d0b6f3e2a7c4e19b81f9d6c0e4a72b3
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,7 +45,14 @@ int close(int fd)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    epoll_forget(fd);
     free_fd(fd);
+
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_CLOSE);
+        return t.done(driver->close(extfd));
+    }
     return driver->close(extfd);
 }
 
@@ -41,10 +41,23 @@ int dup(int fd)
 
     int extfd;
     driver_t *driver;
-    if (!resolve(fd, NULL, &extfd, NULL, &driver))
+    path_t path;
+    if (!resolve(fd, NULL, &extfd, NULL, &driver, &path))
         return -1;
 
-    return driver->dup(extfd);
+    int extfd2 = driver->dup(extfd);
+    if (extfd2 == -1)
+        return -1;
+
+    int fd2 = alloc_fd(path.c_str(), extfd2, driver);
+    if (fd2 < 0)
+    {
+        driver->close(extfd2);
+        errno = EMFILE;
+        return -1;
+    }
+
+    return fd2;
 }
 
 } // namespace fileio
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "fileio/api.hpp"
+#include "crystax/list.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+
+// Bookkeeping for epoll members which have no kernel descriptor behind them
+// and so can't be added to the kernel epoll instance. They never block, so
+// epoll_wait() reports them right away and collects the rest from kernel.
+
+struct epoll_member_t
+{
+    int epfd;
+    int fd;
+    struct epoll_event event;
+    bool armed;
+
+    epoll_member_t *next;
+    epoll_member_t *prev;
+
+    epoll_member_t(int e, int f, struct epoll_event const &ev)
+        :epfd(e), fd(f), event(ev), armed(true), next(0), prev(0)
+    {}
+};
+
+list_t<epoll_member_t> epoll_members;
+pthread_mutex_t epoll_members_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+
+CRYSTAX_LOCAL
+bool epoll_ctl_virtual(int epfd, int op, int fd, struct epoll_event *event)
+{
+    DBG("epfd=%d, op=%d, fd=%d", epfd, op, fd);
+
+    scope_lock_t lock(epoll_members_mutex);
+
+    epoll_member_t *m = epoll_members.head();
+    for (; m; m = m->next)
+    {
+        if (m->epfd == epfd && m->fd == fd)
+            break;
+    }
+
+    if (op != EPOLL_CTL_ADD && !m)
+    {
+        errno = ENOENT;
+        return false;
+    }
+    if (op != EPOLL_CTL_DEL && !event)
+    {
+        errno = EFAULT;
+        return false;
+    }
+
+    switch (op)
+    {
+    case EPOLL_CTL_ADD:
+        if (m)
+        {
+            errno = EEXIST;
+            return false;
+        }
+        epoll_members.push_back(new epoll_member_t(epfd, fd, *event));
+        return true;
+    case EPOLL_CTL_MOD:
+        m->event = *event;
+        m->armed = true;
+        return true;
+    case EPOLL_CTL_DEL:
+        delete epoll_members.pop(m);
+        return true;
+    default:
+        errno = EINVAL;
+        return false;
+    }
+}
+
+CRYSTAX_LOCAL
+int epoll_wait_virtual(int epfd, struct epoll_event *events, int maxevents)
+{
+    scope_lock_t lock(epoll_members_mutex);
+
+    if (epoll_members.empty())
+        return 0;
+
+    int n = 0;
+    epoll_member_t *last = epoll_members.tail();
+    for (epoll_member_t *m = epoll_members.head(), *next; m && n < maxevents; m = next)
+    {
+        next = m == last ? NULL : m->next;
+        if (m->epfd != epfd || !m->armed)
+            continue;
+
+        uint32_t ready = m->event.events & (EPOLLIN | EPOLLOUT);
+        if (!ready)
+            continue;
+
+        events[n].events = ready;
+        events[n].data = m->event.data;
+        ++n;
+
+        // Edge triggered and one-shot members are reported once until
+        // re-armed with EPOLL_CTL_MOD. Level triggered ones stay ready
+        // forever, so move them to the end to let the others have their
+        // turn when there are more of them than maxevents
+        if (m->event.events & (EPOLLET | EPOLLONESHOT))
+            m->armed = false;
+        else if (m != last)
+            epoll_members.push_back(epoll_members.pop(m));
+    }
+
+    DBG("epfd=%d: %d virtual members ready", epfd, n);
+    return n;
+}
+
+CRYSTAX_LOCAL
+void epoll_forget(int fd)
+{
+    scope_lock_t lock(epoll_members_mutex);
+
+    // Closed descriptor leaves all epoll sets it was in; closed epoll
+    // instance takes its members with it
+    for (epoll_member_t *m = epoll_members.head(), *next; m; m = next)
+    {
+        next = m->next;
+        if (m->fd == fd || m->epfd == fd)
+            delete epoll_members.pop(m);
+    }
+}
+
+} // namespace fileio
+} // namespace crystax
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "fileio/api.hpp"
+#include "system/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+
+CRYSTAX_LOCAL
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    DBG("epfd=%d, op=%d, fd=%d, event=%p", epfd, op, fd, event);
+
+    int extepfd;
+    driver_t *epdriver;
+    if (!resolve(epfd, NULL, &extepfd, NULL, &epdriver))
+        return -1;
+    if (extepfd < 0 || epdriver != system::driver_t::instance())
+    {
+        errno = extepfd < 0 ? EBADF : EINVAL;
+        return -1;
+    }
+
+    int extfd;
+    driver_t *driver;
+    if (!resolve(fd, NULL, &extfd, NULL, &driver))
+        return -1;
+    if (extfd < 0 || !driver)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    // Caller's data goes to kernel untouched, so events come back tagged
+    // the way caller registered them and need no translation
+    int sfd = driver->sysfd(extfd);
+    if (sfd >= 0)
+        return system_epoll_ctl(extepfd, op, sfd, event);
+
+    return epoll_ctl_virtual(epfd, op, fd, event) ? 0 : -1;
+}
+
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    return ::crystax::fileio::epoll_ctl(epfd, op, fd, event);
+}
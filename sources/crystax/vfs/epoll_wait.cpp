@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "fileio/api.hpp"
+#include "system/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+
+CRYSTAX_LOCAL
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    DBG("epfd=%d, events=%p, maxevents=%d, timeout=%d", epfd, events, maxevents, timeout);
+
+    if (maxevents <= 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int extepfd;
+    driver_t *epdriver;
+    if (!resolve(epfd, NULL, &extepfd, NULL, &epdriver))
+        return -1;
+    if (extepfd < 0 || epdriver != system::driver_t::instance())
+    {
+        errno = extepfd < 0 ? EBADF : EINVAL;
+        return -1;
+    }
+
+    int n = epoll_wait_virtual(epfd, events, maxevents);
+    if (n == maxevents)
+        return n;
+
+    // Don't sleep if there is something to report already
+    int ret = system_epoll_wait(extepfd, events + n, maxevents - n, n > 0 ? 0 : timeout);
+    if (ret < 0)
+        return n > 0 ? n : -1;
+
+    DBG("return %d", n + ret);
+    return n + ret;
+}
+
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    return ::crystax::fileio::epoll_wait(epfd, events, maxevents, timeout);
+}
@@ -31,6 +31,10 @@
 #include "fileio/driver.hpp"
 #include "system/driver.hpp"
 #include "assets/driver.hpp"
+#include "cache/driver.hpp"
+#include "tmpfs/driver.hpp"
+#include "zip/driver.hpp"
+#include "aio/pool.hpp"
 
 namespace crystax
 {
@@ -73,6 +77,13 @@ driver_t *load_driver(const char *source, const char *target, const char *fstype
         return new assets::driver_t(target, context, underlying);
     }
 
+    if (fstype != NULL && ::strcmp(fstype, "cache") == 0)
+        return cache::driver_t::create(target, (const char *)data, underlying);
+    if (fstype != NULL && ::strcmp(fstype, "tmpfs") == 0)
+        return tmpfs::driver_t::create(target, (const char *)data, underlying);
+    if (fstype != NULL && (::strcmp(fstype, "zip") == 0 || ::strcmp(fstype, "pak") == 0))
+        return zip::driver_t::create(source, target, (const char *)data, underlying);
+
     ERR("unknown source %s and/or fstype %s", source, fstype);
     return NULL;
 }
@@ -80,6 +91,7 @@ driver_t *load_driver(const char *source, const char *target, const char *fstype
 CRYSTAX_LOCAL
 void unload_driver(driver_t *driver)
 {
+    aio::pool_t::shutdown(driver);
     delete driver;
 }
 
@@ -183,7 +195,7 @@ int alloc_fd(const char *path, int extfd, driver_t *driver)
 CRYSTAX_LOCAL
 void free_fd(int fd)
 {
-    if (fd < 0 || fd > FD_TABLE_SIZE)
+    if (fd < 0 || fd >= FD_TABLE_SIZE)
         return;
 
     scope_lock_t lock(fd_table_mutex);
@@ -272,7 +284,7 @@ void free_dirp(DIR *dirp)
 CRYSTAX_LOCAL
 bool resolve(int fd, DIR **dirp, int *extfd, DIR **extdirp, driver_t **driver, path_t *path)
 {
-    if (fd < 0 || fd > FD_TABLE_SIZE)
+    if (fd < 0 || fd >= FD_TABLE_SIZE)
     {
         errno = EBADFD;
         return false;
@@ -44,6 +44,12 @@ void free_fd(int fd);
 DIR *alloc_dirp(const char *path, DIR *extdirp, driver_t *driver);
 void free_dirp(DIR *dirp);
 
+int poll(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const sigset_t *sigmask);
+
+bool epoll_ctl_virtual(int epfd, int op, int fd, struct epoll_event *event);
+int epoll_wait_virtual(int epfd, struct epoll_event *events, int maxevents);
+void epoll_forget(int fd);
+
 } // namespace fileio
 } // namespace crystax
 
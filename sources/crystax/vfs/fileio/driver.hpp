@@ -31,18 +31,26 @@
 #define _CRYSTAX_FILEIO_DRIVER_HPP_acf1e17ac4114b9a8387b40660a8fc61
 
 #include "fileio/common.hpp"
+#include <sys/mman.h>
 
 namespace crystax
 {
 namespace fileio
 {
 
+namespace trace
+{
+struct counters_t;
+void release(counters_t *c);
+}
+
 class driver_t : non_copyable_t
 {
 public:
     driver_t(const char *root, driver_t *d)
-        :rootpath(root), underlying_driver(d)
+        :trace_counters(NULL), rootpath(root), underlying_driver(d)
     {}
+    virtual ~driver_t() {trace::release(trace_counters);}
 
     virtual const char *name() const = 0;
     virtual const char *info() const = 0;
@@ -97,6 +105,24 @@ public:
     virtual ssize_t write(int fd, const void *buf, size_t count) = 0;
     virtual int    writev(int fd, const struct iovec *iov, int count) = 0;
 
+    // Kernel descriptor backing the driver's fd, if any. poll(), select() and
+    // epoll hand such descriptors to the kernel; ones without it (-1) are
+    // considered always ready for reading and writing, like regular files.
+    virtual int    sysfd(int /* fd */) {return -1;}
+
+    // Maps the kernel descriptor reported by sysfd(). Drivers keeping file
+    // data elsewhere have to override this to be mappable at all.
+    virtual void * mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+    {
+        int sfd = sysfd(fd);
+        if (sfd < 0)
+        {
+            errno = ENODEV;
+            return MAP_FAILED;
+        }
+        return system_mmap(addr, length, prot, flags, sfd, offset);
+    }
+
     int open(const char *path, int oflag, ...)
     {
         va_list vl;
@@ -124,12 +150,17 @@ public:
         return ret;
     }
 
+    // Allocated by tracing the first time the driver is traced
+    trace::counters_t *volatile trace_counters;
+
 private:
     path_t rootpath;
     driver_t *underlying_driver;
 };
 
 driver_t *find_driver(const char *path);
+// Size in mount() data: decimal number with optional k, m or g suffix
+bool parse_size_option(const char *s, size_t len, size_t *value);
 bool resolve(int fd, DIR **dirp = 0, int *extfd = 0, DIR **extdirp = 0, driver_t **driver = 0, path_t *path = 0);
 bool resolve(DIR *dirp, int *fd = 0, int *extfd = 0, DIR **extdirp = 0, driver_t **driver = 0, path_t *path = 0);
 
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ int fstat(int fd, struct stat *st)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_FSTAT);
+        return t.done(driver->fstat(extfd, st));
+    }
     return driver->fstat(extfd, st);
 }
 
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ int getdents(unsigned int fd, struct dirent *entry, unsigned int count)
     if (!resolve((int)fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_GETDENTS);
+        return t.done(driver->getdents((unsigned int)extfd, entry, count));
+    }
     return driver->getdents((unsigned int)extfd, entry, count);
 }
 
@@ -31,6 +31,7 @@
 #define _CRYSTAX_VFS_H_86150e922dc84672bc8fc4003d28619e
 
 #include <jni.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,163 @@ extern "C" {
 int crystax_vfs_jni_on_load(JavaVM *vm);
 void crystax_vfs_jni_on_unload(JavaVM *vm);
 
+/*
+ * Read cache stacked over the mount covering target, e.g.
+ *
+ *     mount("/dev/assets", "/assets", NULL, 0, context);
+ *     mount("cache", "/assets", "cache", 0, "size=4m,block=32k,readahead=512k");
+ *
+ * All options are optional; defaults are size=1m, block=16k, readahead=256k.
+ * Counters below are cumulative since mount; block lookups are counted once
+ * per block touched by a read.
+ */
+struct crystax_vfs_cache_stats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long readahead;   /* blocks fetched ahead of the reader */
+    unsigned long long evictions;
+    unsigned long long bypassed;    /* reads too large to go through the cache */
+    unsigned long long ext_reads;   /* calls made to the underlying driver */
+    unsigned long long ext_bytes;
+    size_t blocks;                  /* blocks currently cached */
+    size_t capacity;                /* in blocks */
+    size_t block_size;
+};
+
+/* Returns -1 with errno EINVAL if no cache is mounted at target */
+int crystax_vfs_cache_stats(const char *target, struct crystax_vfs_cache_stats *stats);
+
+/*
+ * Asynchronous reads and writes on VFS descriptors. Requests are served by
+ * a few worker threads per mounted driver with pread()/pwrite() semantics,
+ * so any number of them may be in flight on the same descriptor and the
+ * file position is never touched. Descriptors of the system driver are
+ * served straight from the kernel descriptor, without VFS locks.
+ *
+ * Completion is reported, in this order of precedence, by calling the
+ * request's callback on a worker thread, by posting the request to its
+ * queue, or only through crystax_vfs_aio_error(). A request with a callback
+ * or queue must stay valid until it has been delivered. The descriptor should
+ * stay open until the request completes: requests still queued when it is
+ * closed fail with EBADF at best. Unmounting waits for queued requests.
+ */
+enum
+{
+    CRYSTAX_VFS_AIO_READ = 0,
+    CRYSTAX_VFS_AIO_WRITE = 1
+};
+
+enum
+{
+    CRYSTAX_VFS_AIO_CANCELED = 0,
+    CRYSTAX_VFS_AIO_NOTCANCELED = 1,
+    CRYSTAX_VFS_AIO_ALLDONE = 2
+};
+
+struct crystax_vfs_aio_queue;
+
+struct crystax_vfs_aiocb
+{
+    int fd;
+    int opcode;
+    void *buf;
+    size_t count;
+    long long offset;
+    void (*callback)(struct crystax_vfs_aiocb *cb);
+    struct crystax_vfs_aio_queue *queue;
+    void *data;                     /* for the caller, never touched */
+
+    /* private */
+    struct crystax_vfs_aiocb *__next;
+    void *__pool;
+    int __extfd;
+    int __state;
+    int __error;
+    long __result;
+};
+
+/*
+ * Queues the first n requests; returns how many were accepted, or -1 with
+ * errno set (EBADF, EINVAL, EAGAIN) if the first one was rejected
+ */
+int crystax_vfs_aio_submit(struct crystax_vfs_aiocb *cbs[], int n);
+/* Completes the request with ECANCELED if no worker has picked it up yet */
+int crystax_vfs_aio_cancel(struct crystax_vfs_aiocb *cb);
+/* EINPROGRESS until the request completes, then 0 or its errno */
+int crystax_vfs_aio_error(const struct crystax_vfs_aiocb *cb);
+/* Byte count of a completed request, -1 if it failed */
+long crystax_vfs_aio_return(const struct crystax_vfs_aiocb *cb);
+
+struct crystax_vfs_aio_queue *crystax_vfs_aio_queue_create(void);
+/* Requests still undelivered are dropped from the queue, not completed */
+void crystax_vfs_aio_queue_destroy(struct crystax_vfs_aio_queue *q);
+/*
+ * Takes up to max completed requests in completion order, waiting up to
+ * timeout_ms (negative is forever) for the first one; returns how many
+ */
+int crystax_vfs_aio_queue_wait(struct crystax_vfs_aio_queue *q, struct crystax_vfs_aiocb *done[],
+    int max, int timeout_ms);
+
+/*
+ * Operation tracing, off by default. When enabled, every VFS call below is
+ * timed and counted against the driver serving it; latencies go to
+ * log-linear histograms (8 buckets per power of two, so ~12% resolution up
+ * to 2^40 ns). The slowest path operations (open, stat, lstat, opendir)
+ * are remembered with their paths. While disabled, a call costs one extra
+ * branch.
+ */
+enum
+{
+    CRYSTAX_VFS_OP_OPEN,
+    CRYSTAX_VFS_OP_CLOSE,
+    CRYSTAX_VFS_OP_READ,
+    CRYSTAX_VFS_OP_WRITE,
+    CRYSTAX_VFS_OP_PREAD,
+    CRYSTAX_VFS_OP_PWRITE,
+    CRYSTAX_VFS_OP_READV,
+    CRYSTAX_VFS_OP_WRITEV,
+    CRYSTAX_VFS_OP_LSEEK,
+    CRYSTAX_VFS_OP_STAT,
+    CRYSTAX_VFS_OP_LSTAT,
+    CRYSTAX_VFS_OP_FSTAT,
+    CRYSTAX_VFS_OP_OPENDIR,
+    CRYSTAX_VFS_OP_READDIR,
+    CRYSTAX_VFS_OP_GETDENTS,
+    CRYSTAX_VFS_OP_MMAP,
+    CRYSTAX_VFS_OP_COUNT
+};
+
+#define CRYSTAX_VFS_TRACE_BUCKETS 304
+
+struct crystax_vfs_trace_stats
+{
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long bytes;       /* moved by read and write calls */
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    unsigned int histogram[CRYSTAX_VFS_TRACE_BUCKETS];
+};
+
+void crystax_vfs_trace_enable(int on);
+int crystax_vfs_trace_enabled(void);
+/* Zeroes all counters and forgets the slowest operations */
+void crystax_vfs_trace_reset(void);
+/* "open", "read"...; NULL for an unknown op */
+const char *crystax_vfs_trace_op_name(int op);
+/*
+ * Counters of op on the driver serving path target, zeroed if nothing was
+ * traced there yet; -1 with errno EINVAL on bad arguments
+ */
+int crystax_vfs_trace_stats(const char *target, int op, struct crystax_vfs_trace_stats *stats);
+/* JNI calls made by the driver serving target, e.g. an assets mount */
+unsigned long long crystax_vfs_trace_jni_calls(const char *target);
+/* Latency in ns below which fraction p (0..1) of the calls completed */
+unsigned long long crystax_vfs_trace_percentile(const struct crystax_vfs_trace_stats *stats, double p);
+/* Writes a human readable report of everything traced so far to fd */
+int crystax_vfs_trace_dump(int fd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ off_t lseek(int fd, off_t offset, int whence)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_LSEEK);
+        return t.done(driver->lseek(extfd, offset, whence));
+    }
     return driver->lseek(extfd, offset, whence);
 }
 
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ loff_t lseek64(int fd, loff_t offset, int whence)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_LSEEK);
+        return t.done(driver->lseek64(extfd, offset, whence));
+    }
     return driver->lseek64(extfd, offset, whence);
 }
 
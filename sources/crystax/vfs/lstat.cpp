@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -43,6 +44,11 @@ int lstat(const char *path, struct stat *st)
     if (!driver)
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_LSTAT, path);
+        return t.done(driver->lstat(path, st));
+    }
     return driver->lstat(path, st);
 }
 
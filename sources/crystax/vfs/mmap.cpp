@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -35,33 +36,37 @@ namespace fileio
 {
 
 CRYSTAX_LOCAL
-int mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     DBG("fd=%d", fd);
 
+    if (fd < 0 || (flags & MAP_ANONYMOUS))
+        return system_mmap(addr, length, prot, flags, fd, offset);
+
     int extfd;
-    if (fd < 0)
-        extfd = fd;
-    else
-    {
-        if (!resolve(fd, NULL, &extfd, NULL, NULL))
-            return -1;
+    driver_t *driver;
+    if (!resolve(fd, NULL, &extfd, NULL, &driver))
+        return MAP_FAILED;
 
-        if (extfd == -1)
-        {
-            errno = EBADF;
-            return -1;
-        }
+    if (extfd == -1)
+    {
+        errno = EBADF;
+        return MAP_FAILED;
     }
 
-    return system_mmap(addr, length, prot, flags, extfd, offset);
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_MMAP);
+        return t.done(driver->mmap(addr, length, prot, flags, extfd, offset));
+    }
+    return driver->mmap(addr, length, prot, flags, extfd, offset);
 }
 
 } // namespace fileio
 } // namespace crystax
 
 CRYSTAX_GLOBAL
-int mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     return ::crystax::fileio::mmap(addr, length, prot, flags, fd, offset);
 }
@@ -55,6 +55,30 @@ static driver_t *mount_table[MOUNT_TABLE_SIZE];
 static int mount_table_pos = 0;
 static pthread_mutex_t mount_table_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
 
+CRYSTAX_LOCAL
+bool parse_size_option(const char *s, size_t len, size_t *value)
+{
+    char buf[32];
+    if (len == 0 || len >= sizeof(buf))
+        return false;
+    ::memcpy(buf, s, len);
+    buf[len] = '\0';
+
+    char *end;
+    unsigned long long v = ::strtoull(buf, &end, 10);
+    switch (*end)
+    {
+    case 'k': case 'K': v <<= 10; ++end; break;
+    case 'm': case 'M': v <<= 20; ++end; break;
+    case 'g': case 'G': v <<= 30; ++end; break;
+    }
+    if (end == buf || *end != '\0' || v > (size_t)-1)
+        return false;
+
+    *value = (size_t)v;
+    return true;
+}
+
 CRYSTAX_LOCAL
 driver_t *find_driver(const char *path)
 {
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -57,7 +58,14 @@ int open(const char *path, int oflag, va_list &vl)
         return -1;
 
     DBG("use driver %s (%s)", driver->name(), driver->info());
-    int extfd = driver->open(path, oflag, vl);
+    int extfd;
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_OPEN, path);
+        extfd = t.done(driver->open(path, oflag, vl));
+    }
+    else
+        extfd = driver->open(path, oflag, vl);
     DBG("extfd=%d", extfd);
 
     if (extfd == -1)
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -43,7 +44,14 @@ DIR *opendir(const char *dirpath)
     if (!driver)
         return NULL;
 
-    DIR *extdirp = driver->opendir(dirpath);
+    DIR *extdirp;
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_OPENDIR, dirpath);
+        extdirp = t.done(driver->opendir(dirpath));
+    }
+    else
+        extdirp = driver->opendir(dirpath);
     if (!extdirp)
         return NULL;
 
@@ -45,6 +45,7 @@
 
 #include "osfs/osfs.hpp"
 #include "osfs/asyncsocketclosemonitor.h"
+#include "osfs/pollset.hpp"
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -1402,6 +1403,17 @@ static jint Posix_poll(JNIEnv* env, jobject, jobjectArray javaStructs, jint time
     static jfieldID eventsFid = env->GetFieldID(structPollfdClass.get(), "events", "S");
     static jfieldID reventsFid = env->GetFieldID(structPollfdClass.get(), "revents", "S");
 
+    // Selector keeps polling the same set of channels; serve it from epoll
+    // registrations kept between calls
+    pollfd_fields_t fields = {fdFid, eventsFid, reventsFid, fidFD};
+    int prc;
+    if (pollset_t::poll(env, javaStructs, timeoutMs, fields, &prc)) {
+        if (prc == -1) {
+            throwErrnoException(env, "poll");
+        }
+        return prc;
+    }
+
     // Turn the Java libcore.io.StructPollfd[] into a C++ struct pollfd[].
     size_t arrayLength = env->GetArrayLength(javaStructs);
     UniquePtr<struct pollfd[]> fds(new struct pollfd[arrayLength]);
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "osfs/osfs.hpp"
+#include "osfs/pollset.hpp"
+#include "crystax/list.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace crystax
+{
+namespace fileio
+{
+namespace osfs
+{
+
+// Plain poll() is cheap enough for short arrays, and these are mostly one-off
+// calls from IoBridge (connect with timeout and so on) anyway
+#define POLLSET_MIN_LENGTH 8
+
+// Array elements read per JNI local frame
+#define POLLSET_FRAME_LENGTH 128
+
+// Sets kept at most; the least recently created idle one goes when exceeded
+#define POLLSET_MAX_COUNT 16
+
+static list_t<pollset_t> pollsets;
+static pthread_mutex_t pollsets_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+
+CRYSTAX_LOCAL
+pollset_t::pollset_t(jweak k, int fd)
+    :next(0), prev(0), key(k), epfd(fd), busy(false), gen(0),
+    fds(0), nfds(0), registered(0), nregistered(0),
+    immediate(0), immediate_revents(0), nimmediate(0), events(0), nslots(0)
+{}
+
+CRYSTAX_LOCAL
+pollset_t::~pollset_t()
+{
+    ::free(fds);
+    ::free(registered);
+    ::free(immediate);
+    ::free(immediate_revents);
+    ::free(events);
+}
+
+CRYSTAX_LOCAL
+void pollset_t::release(JNIEnv *env)
+{
+    DBG("epfd=%d", epfd);
+    for (size_t i = 0; i != nregistered; ++i)
+        env->DeleteWeakGlobalRef(fds[registered[i]].fdobj);
+    nregistered = 0;
+    env->DeleteWeakGlobalRef(key);
+    key = 0;
+    ::close(epfd);
+    epfd = -1;
+}
+
+CRYSTAX_LOCAL
+bool pollset_t::reserve_fd(int fd)
+{
+    if ((size_t)fd < nfds)
+        return true;
+
+    size_t n = nfds ? nfds : 64;
+    while (n <= (size_t)fd)
+        n *= 2;
+
+    fdinfo_t *f = (fdinfo_t *)::realloc(fds, n * sizeof(fdinfo_t));
+    if (!f)
+        return false;
+    fds = f;
+    ::memset(fds + nfds, 0, (n - nfds) * sizeof(fdinfo_t));
+
+    int *r = (int *)::realloc(registered, n * sizeof(int));
+    if (!r)
+        return false;
+    registered = r;
+
+    nfds = n;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool pollset_t::reserve_slots(size_t n)
+{
+    if (n <= nslots)
+        return true;
+
+#define POLLSET_GROW(ptr, type) \
+    { \
+        type *p = (type *)::realloc(ptr, n * sizeof(type)); \
+        if (!p) \
+            return false; \
+        ptr = p; \
+    }
+    POLLSET_GROW(immediate, size_t);
+    POLLSET_GROW(immediate_revents, short);
+    POLLSET_GROW(events, struct epoll_event);
+#undef POLLSET_GROW
+
+    nslots = n;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool pollset_t::report(JNIEnv *env, jobjectArray javaStructs, size_t slot, short revents,
+    pollfd_fields_t const &fields)
+{
+    jni::jhobject javaStruct(env->GetObjectArrayElement(javaStructs, slot));
+    if (!javaStruct)
+        return false;
+    env->SetShortField(javaStruct.get(), fields.revents, revents);
+    return true;
+}
+
+CRYSTAX_LOCAL
+void pollset_t::forget(JNIEnv *env, bool unseen)
+{
+    size_t n = 0;
+    for (size_t i = 0; i != nregistered; ++i)
+    {
+        int fd = registered[i];
+        fdinfo_t &d = fds[fd];
+        if (!d.registered)
+            continue;
+        if (!unseen || d.gen == gen)
+        {
+            registered[n++] = fd;
+            continue;
+        }
+        ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, events);
+        env->DeleteWeakGlobalRef(d.fdobj);
+        d.fdobj = 0;
+        d.registered = false;
+    }
+    nregistered = n;
+}
+
+CRYSTAX_LOCAL
+int pollset_t::scan(JNIEnv *env, jobjectArray javaStructs, size_t begin, size_t end,
+    pollfd_fields_t const &fields)
+{
+    for (size_t i = begin; i != end; ++i)
+    {
+        // Local references are released with the frame, not one by one
+        jobject javaStruct = env->GetObjectArrayElement(javaStructs, i);
+        if (!javaStruct)
+            return SCAN_END; // Trailing nulls are allowed, as in Posix.poll()
+        jobject javaFd = env->GetObjectField(javaStruct, fields.fd);
+        if (!javaFd)
+            return SCAN_END; // So is cleared fd field (this is what Selector does)
+
+        int fd = env->GetIntField(javaFd, fields.descriptor);
+        short ev = env->GetShortField(javaStruct, fields.events);
+
+        // Whatever is left from the last call (served by us or by plain
+        // poll()) is stale; the slots ready again get set after the wait
+        if (env->GetShortField(javaStruct, fields.revents) != 0)
+            env->SetShortField(javaStruct, fields.revents, 0);
+
+        if (fd < 0)
+            continue; // Closed descriptor; ignored by poll() too
+
+        if (!reserve_fd(fd))
+            return SCAN_NOMEM;
+
+        fdinfo_t &d = fds[fd];
+        if (d.gen == gen)
+        {
+            DBG("fd=%d listed twice", fd);
+            return SCAN_DUPLICATE;
+        }
+        d.gen = gen;
+
+        // Descriptor number could be closed and reused by another channel
+        // since last call; then kernel has dropped it from epoll already
+        bool same = d.registered && env->IsSameObject(d.fdobj, javaFd);
+        if (same && d.slot == i && d.events == ev)
+            continue;
+
+        // poll and epoll event bits have the same values on Linux
+        struct epoll_event e;
+        e.events = ev & (POLLIN | POLLPRI | POLLOUT);
+        e.data.u64 = 0;
+        e.data.u32 = i;
+
+        int op = EPOLL_CTL_MOD;
+        if (!same)
+        {
+            if (d.registered)
+            {
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &e);
+                env->DeleteWeakGlobalRef(d.fdobj);
+                d.fdobj = env->NewWeakGlobalRef(javaFd);
+            }
+            op = EPOLL_CTL_ADD;
+        }
+
+        int ret = ::epoll_ctl(epfd, op, fd, &e);
+        if (ret < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+            ret = ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e);
+        if (ret < 0)
+        {
+            // Same answers as poll() would give: regular files are always
+            // ready, bad descriptors are reported as such
+            DBG("epoll_ctl(%d) failed: %s", fd, ::strerror(errno));
+            short revents = errno == EPERM ? (ev & (POLLIN | POLLOUT)) : POLLNVAL;
+            if (revents)
+            {
+                immediate[nimmediate] = i;
+                immediate_revents[nimmediate] = revents;
+                ++nimmediate;
+            }
+            if (d.registered)
+            {
+                env->DeleteWeakGlobalRef(d.fdobj);
+                d.fdobj = 0;
+                d.registered = false;
+            }
+            continue;
+        }
+
+        if (!d.registered)
+        {
+            if (!d.fdobj)
+                d.fdobj = env->NewWeakGlobalRef(javaFd);
+            registered[nregistered++] = fd;
+            d.registered = true;
+        }
+        d.slot = i;
+        d.events = ev;
+    }
+
+    return SCAN_MORE;
+}
+
+CRYSTAX_LOCAL
+bool pollset_t::poll(JNIEnv *env, jobjectArray javaStructs, size_t length, jint timeoutMs,
+    pollfd_fields_t const &fields, int *rc)
+{
+    if (!reserve_slots(length))
+    {
+        errno = ENOMEM;
+        *rc = -1;
+        return true;
+    }
+
+    // Generation tells descriptors seen in this call from the ones left
+    // from previous calls
+    if (++gen == 0)
+    {
+        for (size_t i = 0; i != nfds; ++i)
+            fds[i].gen = 0;
+        gen = 1;
+    }
+
+    nimmediate = 0;
+    int st = SCAN_MORE;
+    for (size_t begin = 0; st == SCAN_MORE && begin < length; begin += POLLSET_FRAME_LENGTH)
+    {
+        if (env->PushLocalFrame(2 * POLLSET_FRAME_LENGTH) < 0)
+        {
+            errno = ENOMEM;
+            *rc = -1;
+            return true;
+        }
+        size_t end = begin + POLLSET_FRAME_LENGTH < length ? begin + POLLSET_FRAME_LENGTH : length;
+        st = scan(env, javaStructs, begin, end, fields);
+        env->PopLocalFrame(NULL);
+    }
+    if (st == SCAN_DUPLICATE || st == SCAN_NOMEM)
+    {
+        // Array wasn't scanned to the end, so gen says nothing about the
+        // rest; only drop entries scan() has unregistered already
+        forget(env, false);
+        if (st == SCAN_DUPLICATE)
+            return false;
+        errno = ENOMEM;
+        *rc = -1;
+        return true;
+    }
+
+    // Forget descriptors which aren't in the array anymore
+    forget(env, true);
+
+    int ready = 0;
+    if (nregistered > 0 || nimmediate == 0)
+    {
+        ready = TEMP_FAILURE_RETRY(::epoll_wait(epfd, events, nslots, nimmediate ? 0 : timeoutMs));
+        if (ready < 0)
+        {
+            *rc = -1;
+            return true;
+        }
+    }
+
+    for (int i = 0; i != ready; ++i)
+    {
+        size_t slot = events[i].data.u32;
+        if (!report(env, javaStructs, slot, (short)events[i].events, fields))
+        {
+            *rc = -1;
+            return true;
+        }
+    }
+    for (size_t i = 0; i != nimmediate; ++i)
+    {
+        if (!report(env, javaStructs, immediate[i], immediate_revents[i], fields))
+        {
+            *rc = -1;
+            return true;
+        }
+    }
+
+    *rc = ready + nimmediate;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool pollset_t::poll(JNIEnv *env, jobjectArray javaStructs, jint timeoutMs,
+    pollfd_fields_t const &fields, int *rc)
+{
+    size_t length = env->GetArrayLength(javaStructs);
+    if (length < POLLSET_MIN_LENGTH)
+        return false;
+
+    jni::jhobject first(env->GetObjectArrayElement(javaStructs, 0));
+    if (!first)
+        return false;
+
+    pollset_t *ps = NULL;
+    {
+        scope_lock_t lock(pollsets_mutex);
+
+        for (pollset_t *p = pollsets.head(), *next; p; p = next)
+        {
+            next = p->next;
+            if (!p->busy && env->IsSameObject(p->key, NULL))
+            {
+                p->release(env);
+                delete pollsets.pop(p);
+                continue;
+            }
+            if (env->IsSameObject(p->key, first.get()))
+            {
+                if (p->busy)
+                    return false;
+                ps = p;
+                break;
+            }
+        }
+
+        if (!ps)
+        {
+            if (pollsets.size() >= POLLSET_MAX_COUNT)
+            {
+                for (pollset_t *p = pollsets.head(); p; p = p->next)
+                {
+                    if (p->busy)
+                        continue;
+                    p->release(env);
+                    delete pollsets.pop(p);
+                    break;
+                }
+            }
+
+            int epfd = ::epoll_create(length);
+            if (epfd < 0)
+                return false;
+            ps = new pollset_t(env->NewWeakGlobalRef(first.get()), epfd);
+            pollsets.push_back(ps);
+            DBG("new pollset: epfd=%d", epfd);
+        }
+
+        ps->busy = true;
+    }
+
+    bool ret = ps->poll(env, javaStructs, length, timeoutMs, fields, rc);
+
+    {
+        scope_lock_t lock(pollsets_mutex);
+        ps->busy = false;
+    }
+
+    return ret;
+}
+
+} // namespace osfs
+} // namespace fileio
+} // namespace crystax
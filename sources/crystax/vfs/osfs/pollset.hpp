@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#ifndef _CRYSTAX_FILEIO_OSFS_POLLSET_HPP_3b1f0d2e6c5a4e9b8d7f41a2c9e06b57
+#define _CRYSTAX_FILEIO_OSFS_POLLSET_HPP_3b1f0d2e6c5a4e9b8d7f41a2c9e06b57
+
+#include <jni.h>
+#include <sys/epoll.h>
+#include <crystax/common.hpp>
+
+namespace crystax
+{
+namespace fileio
+{
+namespace osfs
+{
+
+// Field IDs of libcore.io.StructPollfd and java.io.FileDescriptor
+struct pollfd_fields_t
+{
+    jfieldID fd;
+    jfieldID events;
+    jfieldID revents;
+    jfieldID descriptor;
+};
+
+// Persistent interest set behind libcore Posix.poll().
+//
+// java.nio Selector polls the same StructPollfd objects over and over, changing
+// just few of them between calls. Instead of building pollfd[] from scratch each
+// time, pollset_t keeps descriptors registered with epoll (one instance per
+// Selector, recognized by the StructPollfd of its wakeup pipe in the first slot)
+// and only issues epoll_ctl() for the slots which have changed. Results are
+// written back to ready slots only; stale revents are reset while scanning, so
+// JNI writes are O(ready) in the steady state as well.
+class pollset_t : public non_copyable_t
+{
+public:
+    // Serves Posix.poll() from a persistent set. Returns false if the call
+    // can't be served this way (too few descriptors to bother, set is being
+    // polled from another thread, same descriptor listed twice, ...); caller
+    // should do plain poll() then. Otherwise *rc is what poll() would return.
+    static bool poll(JNIEnv *env, jobjectArray javaStructs, jint timeoutMs,
+        pollfd_fields_t const &fields, int *rc);
+
+    ~pollset_t();
+
+    pollset_t *next;
+    pollset_t *prev;
+
+private:
+    pollset_t(jweak k, int fd);
+
+    void release(JNIEnv *env);
+
+    bool poll(JNIEnv *env, jobjectArray javaStructs, size_t length, jint timeoutMs,
+        pollfd_fields_t const &fields, int *rc);
+
+    enum {SCAN_MORE, SCAN_END, SCAN_DUPLICATE, SCAN_NOMEM};
+    int scan(JNIEnv *env, jobjectArray javaStructs, size_t begin, size_t end,
+        pollfd_fields_t const &fields);
+
+    bool reserve_fd(int fd);
+    bool reserve_slots(size_t n);
+
+    // Drops descriptors unregistered by scan() and, if unseen is true, the
+    // ones missing from the array just scanned
+    void forget(JNIEnv *env, bool unseen);
+
+    bool report(JNIEnv *env, jobjectArray javaStructs, size_t slot, short revents,
+        pollfd_fields_t const &fields);
+
+private:
+    struct fdinfo_t
+    {
+        jweak fdobj;
+        size_t slot;
+        short events;
+        unsigned gen;
+        bool registered;
+    };
+
+    jweak key;
+    int epfd;
+    bool busy;
+    unsigned gen;
+
+    // Indexed by descriptor
+    fdinfo_t *fds;
+    size_t nfds;
+
+    // Descriptors currently registered with epoll
+    int *registered;
+    size_t nregistered;
+
+    // Slots which can't go to epoll and are reported right away
+    size_t *immediate;
+    short *immediate_revents;
+    size_t nimmediate;
+
+    struct epoll_event *events;
+    size_t nslots;
+};
+
+} // namespace osfs
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_OSFS_POLLSET_HPP_3b1f0d2e6c5a4e9b8d7f41a2c9e06b57
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "fileio/api.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+
+// Events reported for descriptors which have no kernel object behind them
+// (assets read through AssetManager and so on); like regular files they
+// never block, so they're always ready
+#define CRYSTAX_POLL_ALWAYS_READY (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM)
+
+CRYSTAX_LOCAL
+int poll(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const sigset_t *sigmask)
+{
+    DBG("fds=%p, nfds=%lu, ts=%p, sigmask=%p", fds, (unsigned long)nfds, ts, sigmask);
+
+    struct pollfd stackfds[64];
+    struct pollfd *extfds = stackfds;
+    if (nfds > sizeof(stackfds)/sizeof(stackfds[0]))
+    {
+        extfds = (struct pollfd *)::malloc(nfds * sizeof(struct pollfd));
+        if (!extfds)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    int ready = 0;
+    nfds_t nsys = 0;
+    for (nfds_t i = 0; i != nfds; ++i)
+    {
+        fds[i].revents = 0;
+
+        struct pollfd &e = extfds[i];
+        e.fd = -1;
+        e.events = fds[i].events;
+        e.revents = 0;
+
+        // Negative descriptors are ignored, as the kernel does
+        if (fds[i].fd < 0)
+            continue;
+
+        int extfd;
+        driver_t *driver;
+        if (!resolve(fds[i].fd, NULL, &extfd, NULL, &driver) || !driver || extfd < 0)
+        {
+            fds[i].revents = POLLNVAL;
+            ++ready;
+            continue;
+        }
+
+        e.fd = driver->sysfd(extfd);
+        if (e.fd >= 0)
+        {
+            ++nsys;
+            continue;
+        }
+
+        fds[i].revents = fds[i].events & CRYSTAX_POLL_ALWAYS_READY;
+        if (fds[i].revents)
+            ++ready;
+    }
+
+    if (nsys > 0 || ready == 0)
+    {
+        // Something is ready already, so just collect what kernel has
+        // without sleeping
+        struct timespec zero = {0, 0};
+        int ret = system_ppoll(extfds, nfds, ready > 0 ? &zero : ts, sigmask);
+        if (ret < 0 && ready == 0)
+        {
+            if (extfds != stackfds)
+                ::free(extfds);
+            return -1;
+        }
+
+        for (nfds_t i = 0; ret > 0 && i != nfds; ++i)
+        {
+            if (extfds[i].fd < 0 || extfds[i].revents == 0)
+                continue;
+            fds[i].revents = extfds[i].revents;
+            ++ready;
+            --ret;
+        }
+    }
+
+    if (extfds != stackfds)
+        ::free(extfds);
+
+    DBG("return %d", ready);
+    return ready;
+}
+
+CRYSTAX_LOCAL
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if (timeout < 0)
+        return poll(fds, nfds, NULL, NULL);
+
+    struct timespec ts;
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000;
+    return poll(fds, nfds, &ts, NULL);
+}
+
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    return ::crystax::fileio::poll(fds, nfds, timeout);
+}
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ ssize_t pread(int fd, void *buf, size_t count, off_t offset)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_PREAD);
+        return t.done(driver->pread(extfd, buf, count, offset));
+    }
     return driver->pread(extfd, buf, count, offset);
 }
 
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ struct dirent *readdir(DIR *dirp)
     if (!resolve(dirp, NULL, NULL, &extdirp, &driver))
         return NULL;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_READDIR);
+        return t.done(driver->readdir(extdirp));
+    }
     return driver->readdir(extdirp);
 }
 
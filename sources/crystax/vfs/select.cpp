@@ -27,6 +27,7 @@
  * or implied, of Dmitry Moskalchuk.
  */
 
+
 #include "fileio/api.hpp"
 
 namespace crystax
@@ -34,55 +35,96 @@ namespace crystax
 namespace fileio
 {
 
+// select() is done on top of poll(): descriptors from different drivers may
+// be mixed freely and results come back as VFS descriptors, not the ones of
+// underlying drivers
 CRYSTAX_LOCAL
 int select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv)
 {
     DBG("maxfd=%d, rfd=%p, wfd=%p, efd=%p, tv=%p", maxfd, rfd, wfd, efd, tv);
 
-    driver_t *driver = NULL;
-    int extmaxfd = 0;
-    fd_set extrfd;
-    fd_set extwfd;
-    fd_set extefd;
-
-    if (rfd) FD_ZERO(&extrfd);
-    if (wfd) FD_ZERO(&extwfd);
-    if (efd) FD_ZERO(&extefd);
+    if (maxfd < 0 || maxfd > FD_SETSIZE)
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
+    struct pollfd fds[FD_SETSIZE];
+    nfds_t nfds = 0;
     for (int fd = 0; fd < maxfd; ++fd)
     {
-#define CRYSTAX_SELECT_SET(fd, fds, extfds)                        \
-        if (fds && FD_ISSET(fd, fds))                              \
-        {                                                          \
-            int extfd;                                             \
-            driver_t *d;                                           \
-            if (!resolve(fd, NULL, &extfd, NULL, &d))              \
-                return -1;                                         \
-            if (!driver)                                           \
-                driver = d;                                        \
-            else if (driver != d)                                  \
-            {                                                      \
-                ERR("select across sources not supported yet");    \
-                errno = EXDEV;                                     \
-                return -1;                                         \
-            }                                                      \
-            if (extmaxfd <= extfd)                                 \
-                extmaxfd = extfd + 1;                              \
-            FD_SET(extfd, &extfds);                                \
+        short events = 0;
+        if (rfd && FD_ISSET(fd, rfd)) events |= POLLIN;
+        if (wfd && FD_ISSET(fd, wfd)) events |= POLLOUT;
+        if (efd && FD_ISSET(fd, efd)) events |= POLLPRI;
+        if (!events)
+            continue;
+
+        fds[nfds].fd = fd;
+        fds[nfds].events = events;
+        fds[nfds].revents = 0;
+        ++nfds;
+    }
+
+    struct timespec ts;
+    if (tv)
+    {
+        if (tv->tv_sec < 0 || tv->tv_usec < 0)
+        {
+            errno = EINVAL;
+            return -1;
         }
-        CRYSTAX_SELECT_SET(fd, rfd, extrfd);
-        CRYSTAX_SELECT_SET(fd, wfd, extwfd);
-        CRYSTAX_SELECT_SET(fd, efd, extefd);
-#undef CRYSTAX_SELECT_SET
+        ts.tv_sec = tv->tv_sec + tv->tv_usec / 1000000;
+        ts.tv_nsec = (tv->tv_usec % 1000000) * 1000;
     }
-    if (!driver)
+
+    int ret = poll(fds, nfds, tv ? &ts : NULL, NULL);
+    if (ret < 0)
+        return -1;
+
+    for (nfds_t i = 0; i != nfds; ++i)
     {
-        DBG("empty sets");
-        return 0;
+        if (fds[i].revents & POLLNVAL)
+        {
+            errno = EBADF;
+            return -1;
+        }
+    }
+
+    if (rfd) FD_ZERO(rfd);
+    if (wfd) FD_ZERO(wfd);
+    if (efd) FD_ZERO(efd);
+
+    // Same mapping as kernel's select does: hangup and error make descriptor
+    // readable, error makes it writable too
+    int count = 0;
+    for (nfds_t i = 0; ret > 0 && i != nfds; ++i)
+    {
+        short revents = fds[i].revents;
+        if (!revents)
+            continue;
+        --ret;
+
+        int fd = fds[i].fd;
+        if (rfd && (fds[i].events & POLLIN) && (revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+            FD_SET(fd, rfd);
+            ++count;
+        }
+        if (wfd && (fds[i].events & POLLOUT) && (revents & (POLLOUT | POLLERR)))
+        {
+            FD_SET(fd, wfd);
+            ++count;
+        }
+        if (efd && (fds[i].events & POLLPRI) && (revents & POLLPRI))
+        {
+            FD_SET(fd, efd);
+            ++count;
+        }
     }
 
-    return driver->select(extmaxfd, rfd ? &extrfd : NULL, wfd ? &extwfd : NULL,
-        efd ? &extefd : NULL, tv);
+    DBG("return %d", count);
+    return count;
 }
 
 } // namespace fileio
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -43,6 +44,11 @@ int stat(const char *path, struct stat *st)
     if (!driver)
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_STAT, path);
+        return t.done(driver->stat(path, st));
+    }
     return driver->stat(path, st);
 }
 
@@ -96,6 +96,7 @@ public:
     int    select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv);
     int    stat(const char *path, struct stat *st);
     int    symlink(const char *src, const char *dst);
+    int    sysfd(int fd);
     long   telldir(DIR *dirp);
     int    unlink(const char *path);
     ssize_t write(int fd, const void *buf, size_t count);
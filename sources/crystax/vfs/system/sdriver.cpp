@@ -30,6 +30,7 @@
 #include "system/driver.hpp"
 
 #include <new>
+#include <limits.h>
 
 #ifdef MODULE_INIT
 #undef MODULE_INIT
@@ -61,6 +62,9 @@ typedef int (*func_connect_t)(int sockfd, const struct sockaddr *addr, socklen_t
 typedef int (*func_dirfd_t)(DIR *dirp);
 typedef int (*func_dup2_t)(int fd, int fd2);
 typedef int (*func_dup_t)(int fd);
+typedef int (*func_epoll_create_t)(int size);
+typedef int (*func_epoll_ctl_t)(int epfd, int op, int fd, struct epoll_event *event);
+typedef int (*func_epoll_wait_t)(int epfd, struct epoll_event *events, int maxevents, int timeout);
 typedef int (*func_fchdir_t)(int fd);
 typedef int (*func_fchown_t)(int fd, uid_t uid, gid_t gid);
 typedef int (*func_fcntl_t)(int fd, int command, ...);
@@ -84,12 +88,14 @@ typedef off_t (*func_lseek_t)(int fd, off_t offset, int whence);
 typedef loff_t (*func_lseek64_t)(int fd, loff_t offset, int whence);
 typedef int (*func_lstat_t)(const char *path, struct stat *buf);
 typedef int (*func_mkdir_t)(const char *path, mode_t mode);
-typedef int (*func_mmap_t)(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+typedef void *(*func_mmap_t)(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 typedef int (*func_mount_t)(const char *source, const char *target, const char *fstype,
     unsigned long flags, const void *data);
 typedef int (*func_open_t)(const char *path, int oflag, ...);
 typedef DIR *(*func_opendir_t)(const char *dirpath);
 typedef int (*func_pipe_t)(int pipefd[2]);
+typedef int (*func_poll_t)(struct pollfd *fds, nfds_t nfds, int timeout);
+typedef int (*func_ppoll_t)(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const sigset_t *sigmask);
 typedef ssize_t (*func_pread_t)(int fd, void *buf, size_t count, off_t offset);
 typedef ssize_t (*func_pwrite_t)(int fd, const void *buf, size_t count, off_t offset);
 typedef int (*func_pthread_create_t)(pthread_t *pth, pthread_attr_t const *pattr, void * (*func)(void *), void *arg);
@@ -139,6 +145,9 @@ func_connect_t func_connect = NULL;
 func_dirfd_t func_dirfd = NULL;
 func_dup2_t func_dup2 = NULL;
 func_dup_t func_dup = NULL;
+func_epoll_create_t func_epoll_create = NULL;
+func_epoll_ctl_t func_epoll_ctl = NULL;
+func_epoll_wait_t func_epoll_wait = NULL;
 func_fchdir_t func_fchdir = NULL;
 func_fchown_t func_fchown = NULL;
 func_fcntl_t func_fcntl = NULL;
@@ -167,6 +176,8 @@ func_mount_t func_mount = NULL;
 func_open_t func_open = NULL;
 func_opendir_t func_opendir = NULL;
 func_pipe_t func_pipe = NULL;
+func_poll_t func_poll = NULL;
+func_ppoll_t func_ppoll = NULL;
 func_pread_t func_pread = NULL;
 func_pwrite_t func_pwrite = NULL;
 func_pthread_create_t func_pthread_create = NULL;
@@ -234,6 +245,9 @@ bool init_impl()
     CRYSTAX_LOAD_SYMBOL(dirfd);
     CRYSTAX_LOAD_SYMBOL(dup);
     CRYSTAX_LOAD_SYMBOL(dup2);
+    CRYSTAX_LOAD_SYMBOL(epoll_create);
+    CRYSTAX_LOAD_SYMBOL(epoll_ctl);
+    CRYSTAX_LOAD_SYMBOL(epoll_wait);
     CRYSTAX_LOAD_SYMBOL(fchdir);
     CRYSTAX_LOAD_SYMBOL(fchown);
     CRYSTAX_LOAD_SYMBOL(fcntl);
@@ -259,6 +273,7 @@ bool init_impl()
     CRYSTAX_LOAD_SYMBOL(open);
     CRYSTAX_LOAD_SYMBOL(opendir);
     CRYSTAX_LOAD_SYMBOL(pipe);
+    CRYSTAX_LOAD_SYMBOL(poll);
     CRYSTAX_LOAD_SYMBOL(pread);
     CRYSTAX_LOAD_SYMBOL(pwrite);
     CRYSTAX_LOAD_SYMBOL(pthread_create);
@@ -303,6 +318,9 @@ bool init_impl()
     func_seekdir = (func_seekdir_t)dlsym(pc, "seekdir");
     func_telldir = (func_telldir_t)dlsym(pc, "telldir");
 
+    /* Older Bionic have no ppoll; system_ppoll() emulates it on top of poll */
+    func_ppoll = (func_ppoll_t)dlsym(pc, "ppoll");
+
     func_getpwnam_r = (func_getpwnam_r_t)dlsym(pc, "getpwnam_r");
     func_getpwuid_r = (func_getpwuid_r_t)dlsym(pc, "getpwuid_r");
 
@@ -627,6 +645,12 @@ int driver_t::stat(const char *path, struct stat *st)
     return system_stat(path, st);
 }
 
+CRYSTAX_LOCAL
+int driver_t::sysfd(int fd)
+{
+    return fd;
+}
+
 CRYSTAX_LOCAL
 int driver_t::symlink(const char *src, const char *dst)
 {
@@ -744,6 +768,27 @@ int system_dup2(int fd, int fd2)
     return fileio::system::func_dup2(fd, fd2);
 }
 
+CRYSTAX_LOCAL
+int system_epoll_create(int size)
+{
+    MODULE_INIT;
+    return fileio::system::func_epoll_create(size);
+}
+
+CRYSTAX_LOCAL
+int system_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    MODULE_INIT;
+    return fileio::system::func_epoll_ctl(epfd, op, fd, event);
+}
+
+CRYSTAX_LOCAL
+int system_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    MODULE_INIT;
+    return fileio::system::func_epoll_wait(epfd, events, maxevents, timeout);
+}
+
 CRYSTAX_LOCAL
 int system_fchdir(int fd)
 {
@@ -940,7 +985,7 @@ int system_mkdir(const char *path, mode_t mode)
 }
 
 CRYSTAX_LOCAL
-int system_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+void *system_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     MODULE_INIT;
     return fileio::system::func_mmap(addr, length, prot, flags, fd, offset);
@@ -992,6 +1037,43 @@ int system_pipe(int pipefd[2])
     return fileio::system::func_pipe(pipefd);
 }
 
+CRYSTAX_LOCAL
+int system_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    MODULE_INIT;
+    return fileio::system::func_poll(fds, nfds, timeout);
+}
+
+CRYSTAX_LOCAL
+int system_ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *ts, const sigset_t *sigmask)
+{
+    MODULE_INIT;
+    if (fileio::system::func_ppoll)
+        return fileio::system::func_ppoll(fds, nfds, ts, sigmask);
+
+    int timeout = -1;
+    if (ts)
+    {
+        if (ts->tv_sec >= INT_MAX / 1000 - 1)
+            timeout = INT_MAX;
+        else
+            timeout = ts->tv_sec * 1000 + (ts->tv_nsec + 999999) / 1000000;
+    }
+
+    if (!sigmask)
+        return fileio::system::func_poll(fds, nfds, timeout);
+
+    // Unlike real ppoll this is not atomic: a signal unblocked by sigmask and
+    // delivered before poll() goes to sleep doesn't interrupt it
+    sigset_t origmask;
+    ::pthread_sigmask(SIG_SETMASK, sigmask, &origmask);
+    int ret = fileio::system::func_poll(fds, nfds, timeout);
+    int err = errno;
+    ::pthread_sigmask(SIG_SETMASK, &origmask, NULL);
+    errno = err;
+    return ret;
+}
+
 CRYSTAX_LOCAL
 ssize_t system_pread(int fd, void *buf, size_t count, off_t offset)
 {
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#ifndef _CRYSTAX_FILEIO_TMPFS_DRIVER_HPP_e3a1c07b5f2d4b8e9c6a41d7f0b25e98
+#define _CRYSTAX_FILEIO_TMPFS_DRIVER_HPP_e3a1c07b5f2d4b8e9c6a41d7f0b25e98
+
+#include <crystax/list.hpp>
+#include "fileio/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace tmpfs
+{
+
+// File system kept entirely in memory. File contents live on the heap and
+// move into a memfd the first time a file is mapped shared, so that every
+// mapping and every read()/write() see the same pages.
+class driver_t : public ::crystax::fileio::driver_t
+{
+public:
+    // Parses mount() data ("size=64m,mode=0755", any key may be omitted) and
+    // returns NULL with errno set on bad options
+    static driver_t *create(const char *root, const char *options, fileio::driver_t *d);
+    ~driver_t();
+
+    const char *name() const {return "TMPFS";}
+    const char *info() const {return root().c_str();}
+
+    int    chown(const char *path, uid_t uid, gid_t gid);
+    int    close(int fd);
+    int    closedir(DIR *dirp);
+    int    dirfd(DIR *dirp);
+    int    dup(int fd);
+    int    dup2(int fd, int fd2);
+    int    fchown(int fd, uid_t uid, gid_t gid);
+    int    fcntl(int fd, int command, va_list &vl);
+    int    fdatasync(int fd);
+    DIR *  fdopendir(int fd);
+    int    flock(int fd, int operation);
+    int    fstat(int fd, struct stat *st);
+    int    fsync(int fd);
+    int    ftruncate(int fd, off_t offset);
+    int    getdents(unsigned int fd, struct dirent *entry, unsigned int count);
+    int    ioctl(int fd, int request, va_list &vl);
+    int    lchown(const char *path, uid_t uid, gid_t gid);
+    int    link(const char *src, const char *dst);
+    off_t  lseek(int fd, off_t offset, int whence);
+    loff_t lseek64(int fd, loff_t offset, int whence);
+    int    lstat(const char *path, struct stat *st);
+    int    mkdir(const char *path, mode_t mode);
+    void * mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+    int    open(const char *path, int oflag, va_list &vl);
+    DIR *  opendir(const char *dirpath);
+    ssize_t pread(int fd, void *buf, size_t count, off_t offset);
+    ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
+    ssize_t read(int fd, void *buf, size_t count);
+    int    readv(int fd, const struct iovec *iov, int count);
+    struct dirent *readdir(DIR *dirp);
+    int    readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result);
+    int    readlink(const char *path, char *buf, size_t bufsize);
+    int    remove(const char *path);
+    int    rename(const char *oldpath, const char *newpath);
+    void   rewinddir(DIR *dirp);
+    int    rmdir(const char *path);
+    int    scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+        int (*compar)(const struct dirent **, const struct dirent **));
+    void   seekdir(DIR *dirp, long offset);
+    int    select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv);
+    int    stat(const char *path, struct stat *st);
+    int    symlink(const char *src, const char *dst);
+    long   telldir(DIR *dirp);
+    int    unlink(const char *path);
+    ssize_t write(int fd, const void *buf, size_t count);
+    int    writev(int fd, const struct iovec *iov, int count);
+
+private:
+    driver_t(const char *root, size_t quota, mode_t mode, fileio::driver_t *d);
+
+    struct inode_t;
+
+    struct dentry_t
+    {
+        char *name;
+        size_t hash;
+        inode_t *parent;
+        inode_t *inode;
+
+        // Siblings in parent directory, in creation order
+        dentry_t *next;
+        dentry_t *prev;
+        // Chain in the name hash
+        dentry_t *hnext;
+
+        ~dentry_t() {::free(name);}
+    };
+
+    struct inode_t
+    {
+        ino_t ino;
+        mode_t mode;
+        uid_t uid;
+        gid_t gid;
+        nlink_t nlink;
+        time_t atime;
+        time_t mtime;
+        time_t ctime;
+
+        // Regular file contents or symlink target
+        char *data;
+        size_t size;
+        size_t capacity;
+        // Backing memfd once the file has been mapped shared, -1 before
+        int memfd;
+
+        // Directories only
+        inode_t *parent;
+        list_t<dentry_t> children;
+
+        // Open descriptions and directory streams
+        unsigned refs;
+    };
+
+    // Open file description, shared by dup'ed descriptors
+    struct file_t
+    {
+        inode_t *inode;
+        loff_t pos;
+        int oflag;
+        unsigned refs;
+    };
+
+    struct fd_entry_t
+    {
+        file_t *file;
+        bool cloexec;
+    };
+
+    // Directory stream; entries are taken at opendir() and rewinddir()
+    struct dir_t
+    {
+        inode_t *inode;
+        char *buf;
+        size_t len;
+        size_t off;
+        long index;
+        struct dirent entry;
+    };
+
+    struct lookup_t
+    {
+        abspath_t path;
+        // Directory holding the last component; NULL for the root
+        inode_t *dir;
+        const char *name;
+        size_t namelen;
+        // Existing entry, NULL if the last component doesn't exist yet
+        dentry_t *dentry;
+        inode_t *inode;
+    };
+
+    bool lookup(const char *path, bool follow, lookup_t &r);
+
+    inode_t *new_inode(mode_t mode);
+    void put_inode(inode_t *inode);
+    void destroy(inode_t *inode);
+
+    dentry_t *find(inode_t *dir, const char *name, size_t len);
+    dentry_t *attach(inode_t *dir, const char *name, size_t len, inode_t *inode);
+    void detach(dentry_t *d);
+    void rehash();
+
+    bool resize(inode_t *inode, size_t size);
+    bool reserve(inode_t *inode, size_t capacity);
+    bool share(inode_t *inode);
+    void release_data(inode_t *inode);
+
+    int alloc_fd(file_t *file, int from = 0);
+    file_t *resolve(int fd);
+    void put_file(file_t *file);
+
+    size_t fill_dirents(inode_t *dir, size_t *index, char *buf, size_t len);
+    bool snapshot(dir_t *dir);
+
+    ssize_t do_read(file_t *f, void *buf, size_t count, loff_t offset);
+    ssize_t do_write(file_t *f, const void *buf, size_t count, loff_t offset);
+    void fill_stat(inode_t *inode, struct stat *st);
+
+    static size_t name_hash(inode_t *dir, const char *name, size_t len);
+
+private:
+    dev_t dev;
+    ino_t next_ino;
+
+    size_t quota;
+    size_t used;
+
+    inode_t *rootnode;
+
+    dentry_t **buckets;
+    size_t nbuckets;
+    size_t nentries;
+
+    fd_entry_t fd_table[FD_TABLE_SIZE];
+    pthread_mutex_t mutex;
+};
+
+} // namespace tmpfs
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_TMPFS_DRIVER_HPP_e3a1c07b5f2d4b8e9c6a41d7f0b25e98
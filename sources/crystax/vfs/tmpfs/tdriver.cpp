@@ -0,0 +1,1731 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "tmpfs/driver.hpp"
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <stddef.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef __NR_memfd_create
+#   if defined(__arm__)
+#       define __NR_memfd_create 385
+#   elif defined(__aarch64__)
+#       define __NR_memfd_create 279
+#   elif defined(__i386__)
+#       define __NR_memfd_create 356
+#   elif defined(__x86_64__)
+#       define __NR_memfd_create 319
+#   elif defined(__mips__)
+#       define __NR_memfd_create 4354
+#   endif
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#ifndef MAXSYMLINKS
+#define MAXSYMLINKS 8
+#endif
+
+namespace crystax
+{
+namespace fileio
+{
+namespace tmpfs
+{
+
+static size_t page_size()
+{
+    static size_t pg = 0;
+    if (pg == 0)
+        pg = (size_t)::sysconf(_SC_PAGESIZE);
+    return pg;
+}
+
+static size_t round_page(size_t n)
+{
+    return (n + page_size() - 1) & ~(page_size() - 1);
+}
+
+static int memfd_create(const char *name)
+{
+#ifdef __NR_memfd_create
+    return (int)::syscall(__NR_memfd_create, name, MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static unsigned char dirent_type(mode_t mode)
+{
+    if (S_ISDIR(mode)) return DT_DIR;
+    if (S_ISLNK(mode)) return DT_LNK;
+    return DT_REG;
+}
+
+static unsigned next_dev = 0;
+
+CRYSTAX_LOCAL
+driver_t *driver_t::create(const char *root, const char *options, fileio::driver_t *d)
+{
+    DBG("root=%s, options=%s", root, options ? options : "(null)");
+
+    // Same default as Linux: half of physical memory
+    size_t quota = (size_t)::sysconf(_SC_PHYS_PAGES) / 2 * page_size();
+    size_t mode = 01777;
+
+    for (const char *s = options; s && *s != '\0';)
+    {
+        const char *e = ::strchr(s, ',');
+        size_t len = e ? (size_t)(e - s) : ::strlen(s);
+        const char *eq = (const char *)::memchr(s, '=', len);
+        size_t klen = eq ? (size_t)(eq - s) : 0;
+
+        bool ok = false;
+        if (klen == 4 && ::strncmp(s, "size", klen) == 0)
+            ok = parse_size_option(eq + 1, len - klen - 1, &quota);
+        else if (klen == 4 && ::strncmp(s, "mode", klen) == 0)
+        {
+            char *end;
+            mode = ::strtoul(eq + 1, &end, 8);
+            ok = end == s + len && end != eq + 1 && mode <= 07777;
+        }
+
+        if (!ok)
+        {
+            ERR("bad tmpfs option: %.*s", (int)len, s);
+            errno = EINVAL;
+            return NULL;
+        }
+
+        s = e ? e + 1 : NULL;
+    }
+
+    driver_t *driver = new driver_t(root, quota, (mode_t)mode, d);
+    if (!driver->buckets)
+    {
+        delete driver;
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return driver;
+}
+
+CRYSTAX_LOCAL
+driver_t::driver_t(const char *root, size_t q, mode_t mode, fileio::driver_t *d)
+    :fileio::driver_t(root, d), next_ino(1), quota(q), used(0),
+    buckets(0), nbuckets(64), nentries(0)
+{
+    pthread_mutexattr_t attr;
+    if (::pthread_mutexattr_init(&attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+        ::abort();
+    if (::pthread_mutex_init(&mutex, &attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_destroy(&attr) != 0)
+        ::abort();
+
+    dev = __sync_add_and_fetch(&next_dev, 1);
+    ::memset(fd_table, 0, sizeof(fd_table));
+    buckets = (dentry_t **)::calloc(nbuckets, sizeof(dentry_t *));
+
+    rootnode = new_inode(S_IFDIR | mode);
+    rootnode->nlink = 2;
+    rootnode->parent = rootnode;
+}
+
+CRYSTAX_LOCAL
+driver_t::~driver_t()
+{
+    for (size_t fd = 0; fd < FD_TABLE_SIZE; ++fd)
+    {
+        if (fd_table[fd].file)
+            put_file(fd_table[fd].file);
+    }
+    destroy(rootnode);
+    ::free(buckets);
+
+    if (::pthread_mutex_destroy(&mutex) != 0)
+        ::abort();
+}
+
+CRYSTAX_LOCAL
+void driver_t::destroy(inode_t *n)
+{
+    while (!n->children.empty())
+    {
+        dentry_t *d = n->children.pop_front();
+        inode_t *c = d->inode;
+        delete d;
+        if (S_ISDIR(c->mode))
+            destroy(c);
+        else if (--c->nlink == 0 && c->refs == 0)
+        {
+            release_data(c);
+            delete c;
+        }
+    }
+    delete n;
+}
+
+CRYSTAX_LOCAL
+driver_t::inode_t *driver_t::new_inode(mode_t mode)
+{
+    inode_t *n = new inode_t;
+    n->ino = next_ino++;
+    n->mode = mode;
+    n->uid = ::getuid();
+    n->gid = ::getgid();
+    n->nlink = S_ISDIR(mode) ? 1 : 0;
+    n->atime = n->mtime = n->ctime = ::time(NULL);
+    n->data = NULL;
+    n->size = 0;
+    n->capacity = 0;
+    n->memfd = -1;
+    n->parent = NULL;
+    n->refs = 0;
+    return n;
+}
+
+CRYSTAX_LOCAL
+void driver_t::put_inode(inode_t *n)
+{
+    if (n->nlink == 0 && n->refs == 0)
+    {
+        release_data(n);
+        delete n;
+    }
+}
+
+CRYSTAX_LOCAL
+size_t driver_t::name_hash(inode_t *dir, const char *name, size_t len)
+{
+    size_t h = (size_t)dir / sizeof(void *);
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+CRYSTAX_LOCAL
+driver_t::dentry_t *driver_t::find(inode_t *dir, const char *name, size_t len)
+{
+    size_t h = name_hash(dir, name, len);
+    for (dentry_t *d = buckets[h & (nbuckets - 1)]; d; d = d->hnext)
+    {
+        if (d->hash == h && d->parent == dir &&
+            ::strncmp(d->name, name, len) == 0 && d->name[len] == '\0')
+            return d;
+    }
+    return NULL;
+}
+
+CRYSTAX_LOCAL
+void driver_t::rehash()
+{
+    size_t n = nbuckets * 2;
+    dentry_t **b = (dentry_t **)::calloc(n, sizeof(dentry_t *));
+    if (!b)
+        return;
+
+    for (size_t i = 0; i < nbuckets; ++i)
+    {
+        while (dentry_t *d = buckets[i])
+        {
+            buckets[i] = d->hnext;
+            d->hnext = b[d->hash & (n - 1)];
+            b[d->hash & (n - 1)] = d;
+        }
+    }
+
+    ::free(buckets);
+    buckets = b;
+    nbuckets = n;
+}
+
+CRYSTAX_LOCAL
+driver_t::dentry_t *driver_t::attach(inode_t *dir, const char *name, size_t len, inode_t *n)
+{
+    if (nentries >= nbuckets)
+        rehash();
+
+    dentry_t *d = new dentry_t;
+    d->name = (char *)::malloc(len + 1);
+    ::memcpy(d->name, name, len);
+    d->name[len] = '\0';
+    d->hash = name_hash(dir, name, len);
+    d->parent = dir;
+    d->inode = n;
+    d->next = d->prev = NULL;
+
+    dentry_t **b = &buckets[d->hash & (nbuckets - 1)];
+    d->hnext = *b;
+    *b = d;
+    ++nentries;
+
+    dir->children.push_back(d);
+    ++n->nlink;
+    if (S_ISDIR(n->mode))
+    {
+        n->parent = dir;
+        ++dir->nlink;
+    }
+    dir->mtime = dir->ctime = ::time(NULL);
+    return d;
+}
+
+CRYSTAX_LOCAL
+void driver_t::detach(dentry_t *d)
+{
+    for (dentry_t **p = &buckets[d->hash & (nbuckets - 1)]; *p; p = &(*p)->hnext)
+    {
+        if (*p == d)
+        {
+            *p = d->hnext;
+            break;
+        }
+    }
+    --nentries;
+
+    inode_t *dir = d->parent;
+    inode_t *n = d->inode;
+    dir->children.pop(d);
+    --n->nlink;
+    if (S_ISDIR(n->mode))
+        --dir->nlink;
+    dir->mtime = dir->ctime = n->ctime = ::time(NULL);
+    delete d;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::lookup(const char *path, bool follow, lookup_t &r)
+{
+    r.path.reset(path);
+
+    for (int depth = 0;; ++depth)
+    {
+        if (!r.path || !r.path.subpath(root()))
+        {
+            errno = EXDEV;
+            return false;
+        }
+
+        const char *s = r.path.c_str() + root().length();
+        while (*s == '/')
+            ++s;
+
+        r.dir = NULL;
+        r.name = s;
+        r.namelen = 0;
+        r.dentry = NULL;
+        r.inode = rootnode;
+        if (*s == '\0')
+            return true;
+
+        inode_t *dir = rootnode;
+        dentry_t *link = NULL;
+        const char *rest = NULL;
+        for (;;)
+        {
+            const char *e = ::strchr(s, '/');
+            size_t len = e ? (size_t)(e - s) : ::strlen(s);
+            if (len > NAME_MAX)
+            {
+                errno = ENAMETOOLONG;
+                return false;
+            }
+
+            dentry_t *d = find(dir, s, len);
+            if (!e)
+            {
+                if (d && follow && S_ISLNK(d->inode->mode))
+                {
+                    link = d;
+                    rest = "";
+                    break;
+                }
+                r.dir = dir;
+                r.name = s;
+                r.namelen = len;
+                r.dentry = d;
+                r.inode = d ? d->inode : NULL;
+                return true;
+            }
+
+            if (!d)
+            {
+                errno = ENOENT;
+                return false;
+            }
+            if (S_ISLNK(d->inode->mode))
+            {
+                link = d;
+                rest = e;
+                break;
+            }
+            if (!S_ISDIR(d->inode->mode))
+            {
+                errno = ENOTDIR;
+                return false;
+            }
+
+            dir = d->inode;
+            s = e + 1;
+        }
+
+        if (depth >= MAXSYMLINKS)
+        {
+            errno = ELOOP;
+            return false;
+        }
+
+        // Put link's target in place of the component and start over
+        inode_t *t = link->inode;
+        size_t prefix = t->data[0] == '/' ? 0 : (size_t)(s - r.path.c_str());
+        size_t restlen = ::strlen(rest);
+        char *np = (char *)::malloc(prefix + t->size + restlen + 1);
+        if (!np)
+        {
+            errno = ENOMEM;
+            return false;
+        }
+        ::memcpy(np, r.path.c_str(), prefix);
+        ::memcpy(np + prefix, t->data, t->size);
+        ::memcpy(np + prefix + t->size, rest, restlen + 1);
+        r.path.reset(np);
+        ::free(np);
+    }
+}
+
+CRYSTAX_LOCAL
+bool driver_t::reserve(inode_t *n, size_t capacity)
+{
+    if (capacity <= n->capacity)
+        return true;
+
+    size_t cap = n->capacity * 2;
+    if (cap < capacity)
+        cap = capacity;
+
+    if (n->memfd >= 0)
+    {
+        cap = round_page(cap);
+        if (system_ftruncate(n->memfd, cap) != 0)
+            return false;
+        void *p = ::mremap(n->data, n->capacity, cap, MREMAP_MAYMOVE);
+        if (p == MAP_FAILED)
+            return false;
+        n->data = (char *)p;
+    }
+    else
+    {
+        if (cap < 64)
+            cap = 64;
+        char *p = (char *)::realloc(n->data, cap);
+        if (!p)
+        {
+            errno = ENOSPC;
+            return false;
+        }
+        ::memset(p + n->capacity, 0, cap - n->capacity);
+        n->data = p;
+    }
+
+    n->capacity = cap;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::resize(inode_t *n, size_t size)
+{
+    // Bytes past the end of file are kept zeroed, so growing never has to
+    // clear anything
+    size_t was = round_page(n->size);
+    size_t will = round_page(size);
+    if (will > was && will - was > quota - used)
+    {
+        errno = ENOSPC;
+        return false;
+    }
+
+    if (size > n->capacity && !reserve(n, size))
+        return false;
+
+    if (size < n->size)
+    {
+        size_t cap = n->memfd >= 0 ? will : size;
+        if (cap < n->capacity / 4)
+        {
+            // Give memory back once most of it is gone
+            if (n->memfd >= 0)
+            {
+                if (cap > 0 && system_ftruncate(n->memfd, cap) == 0 &&
+                    ::mremap(n->data, n->capacity, cap, 0) != MAP_FAILED)
+                    n->capacity = cap;
+            }
+            else if (cap == 0)
+            {
+                ::free(n->data);
+                n->data = NULL;
+                n->capacity = 0;
+            }
+            else
+            {
+                char *p = (char *)::realloc(n->data, cap);
+                if (p)
+                {
+                    n->data = p;
+                    n->capacity = cap;
+                }
+            }
+        }
+        size_t end = n->size < n->capacity ? n->size : n->capacity;
+        if (end > size)
+            ::memset(n->data + size, 0, end - size);
+    }
+
+    used = used - was + will;
+    n->size = size;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::share(inode_t *n)
+{
+    if (n->memfd >= 0)
+        return true;
+
+    int fd = memfd_create("crystax-tmpfs");
+    if (fd < 0)
+    {
+        ERR("memfd_create failed: %s", ::strerror(errno));
+        errno = ENODEV;
+        return false;
+    }
+
+    size_t cap = round_page(n->size > 0 ? n->size : 1);
+    void *p = MAP_FAILED;
+    if (system_ftruncate(fd, cap) == 0)
+        p = system_mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        system_close(fd);
+        errno = ENOMEM;
+        return false;
+    }
+
+    if (n->size > 0)
+        ::memcpy(p, n->data, n->size);
+    ::free(n->data);
+    n->data = (char *)p;
+    n->capacity = cap;
+    n->memfd = fd;
+    return true;
+}
+
+CRYSTAX_LOCAL
+void driver_t::release_data(inode_t *n)
+{
+    if (S_ISREG(n->mode))
+        used -= round_page(n->size);
+
+    if (n->memfd >= 0)
+    {
+        ::munmap(n->data, n->capacity);
+        system_close(n->memfd);
+    }
+    else
+        ::free(n->data);
+
+    n->data = NULL;
+    n->size = n->capacity = 0;
+    n->memfd = -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::alloc_fd(file_t *f, int from)
+{
+    for (int fd = from < 0 ? 0 : from; fd < FD_TABLE_SIZE; ++fd)
+    {
+        if (fd_table[fd].file)
+            continue;
+        fd_table[fd].file = f;
+        fd_table[fd].cloexec = false;
+        return fd;
+    }
+
+    errno = EMFILE;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+driver_t::file_t *driver_t::resolve(int fd)
+{
+    if (fd < 0 || fd >= FD_TABLE_SIZE || !fd_table[fd].file)
+    {
+        errno = EBADF;
+        return NULL;
+    }
+    return fd_table[fd].file;
+}
+
+CRYSTAX_LOCAL
+void driver_t::put_file(file_t *f)
+{
+    if (--f->refs > 0)
+        return;
+    inode_t *n = f->inode;
+    --n->refs;
+    put_inode(n);
+    delete f;
+}
+
+CRYSTAX_LOCAL
+void driver_t::fill_stat(inode_t *n, struct stat *st)
+{
+    ::memset(st, 0, sizeof(*st));
+    st->st_dev = dev;
+    st->st_ino = n->ino;
+    st->st_mode = n->mode;
+    st->st_nlink = n->nlink;
+    st->st_uid = n->uid;
+    st->st_gid = n->gid;
+    st->st_size = S_ISDIR(n->mode) ? (off_t)(n->children.size() + 2) * 32 : (off_t)n->size;
+    st->st_blksize = page_size();
+    st->st_blocks = S_ISREG(n->mode) ? round_page(n->size) / 512 : 0;
+    st->st_atime = n->atime;
+    st->st_mtime = n->mtime;
+    st->st_ctime = n->ctime;
+}
+
+CRYSTAX_LOCAL
+size_t driver_t::fill_dirents(inode_t *dir, size_t *index, char *buf, size_t len)
+{
+    size_t total = dir->children.size() + 2;
+    dentry_t *d = dir->children.head();
+    for (size_t i = 2; i < *index && d; ++i)
+        d = d->next;
+
+    size_t off = 0;
+    while (*index < total)
+    {
+        const char *name;
+        ino_t ino;
+        unsigned char type = DT_DIR;
+        if (*index == 0)
+        {
+            name = ".";
+            ino = dir->ino;
+        }
+        else if (*index == 1)
+        {
+            name = "..";
+            ino = dir->parent ? dir->parent->ino : dir->ino;
+        }
+        else
+        {
+            name = d->name;
+            ino = d->inode->ino;
+            type = dirent_type(d->inode->mode);
+        }
+
+        size_t nlen = ::strlen(name);
+        size_t reclen = (offsetof(struct dirent, d_name) + nlen + 1 + 7) & ~(size_t)7;
+        if (off + reclen > len)
+            break;
+
+        struct dirent *e = (struct dirent *)(buf + off);
+        e->d_ino = ino;
+        e->d_off = *index + 1;
+        e->d_reclen = reclen;
+        e->d_type = type;
+        ::memcpy(e->d_name, name, nlen + 1);
+
+        off += reclen;
+        if (*index >= 2)
+            d = d->next;
+        ++*index;
+    }
+
+    return off;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::snapshot(dir_t *d)
+{
+    size_t total = d->inode->children.size() + 2;
+    size_t cap = 256 + total * 32;
+    size_t index = 0;
+    size_t len = 0;
+    char *buf = NULL;
+
+    while (index < total)
+    {
+        char *p = (char *)::realloc(buf, cap);
+        if (!p)
+        {
+            ::free(buf);
+            errno = ENOMEM;
+            return false;
+        }
+        buf = p;
+        len += fill_dirents(d->inode, &index, buf + len, cap - len);
+        cap *= 2;
+    }
+
+    ::free(d->buf);
+    d->buf = buf;
+    d->len = len;
+    d->off = 0;
+    d->index = 0;
+    return true;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::do_read(file_t *f, void *buf, size_t count, loff_t offset)
+{
+    inode_t *n = f->inode;
+    if ((f->oflag & O_ACCMODE) == O_WRONLY)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (S_ISDIR(n->mode))
+    {
+        errno = EISDIR;
+        return -1;
+    }
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((size_t)offset >= n->size)
+        return 0;
+
+    if (count > n->size - offset)
+        count = n->size - offset;
+    ::memcpy(buf, n->data + offset, count);
+    return count;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::do_write(file_t *f, const void *buf, size_t count, loff_t offset)
+{
+    inode_t *n = f->inode;
+    if ((f->oflag & O_ACCMODE) == O_RDONLY)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (offset < 0 || (size_t)offset + count < (size_t)offset)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (count == 0)
+        return 0;
+
+    size_t end = offset + count;
+    if (end > n->size && !resize(n, end))
+        return -1;
+
+    ::memcpy(n->data + offset, buf, count);
+    n->mtime = n->ctime = ::time(NULL);
+    return count;
+}
+
+CRYSTAX_LOCAL
+int driver_t::chown(const char *path, uid_t uid, gid_t gid)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, true, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (uid != (uid_t)-1) r.inode->uid = uid;
+    if (gid != (gid_t)-1) r.inode->gid = gid;
+    r.inode->ctime = ::time(NULL);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::close(int fd)
+{
+    DBG("fd=%d", fd);
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    fd_table[fd].file = NULL;
+    put_file(f);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::closedir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    scope_lock_t lock(mutex);
+    --d->inode->refs;
+    put_inode(d->inode);
+    ::free(d->buf);
+    delete d;
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dirfd(DIR * /* dirp */)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup(int fd)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    int fd2 = alloc_fd(f);
+    if (fd2 >= 0)
+        ++f->refs;
+    return fd2;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup2(int fd, int fd2)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+    if (fd2 < 0 || fd2 >= FD_TABLE_SIZE)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (fd == fd2)
+        return fd2;
+
+    if (fd_table[fd2].file)
+        put_file(fd_table[fd2].file);
+    fd_table[fd2].file = f;
+    fd_table[fd2].cloexec = false;
+    ++f->refs;
+    return fd2;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fchown(int fd, uid_t uid, gid_t gid)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    if (uid != (uid_t)-1) f->inode->uid = uid;
+    if (gid != (gid_t)-1) f->inode->gid = gid;
+    f->inode->ctime = ::time(NULL);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fcntl(int fd, int command, va_list &vl)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    switch (command)
+    {
+    case F_DUPFD:
+#ifdef F_DUPFD_CLOEXEC
+    case F_DUPFD_CLOEXEC:
+#endif
+        {
+            int fd2 = alloc_fd(f, va_arg(vl, int));
+            if (fd2 < 0)
+                return -1;
+            ++f->refs;
+#ifdef F_DUPFD_CLOEXEC
+            fd_table[fd2].cloexec = command == F_DUPFD_CLOEXEC;
+#endif
+            return fd2;
+        }
+    case F_GETFD:
+        return fd_table[fd].cloexec ? FD_CLOEXEC : 0;
+    case F_SETFD:
+        fd_table[fd].cloexec = (va_arg(vl, int) & FD_CLOEXEC) != 0;
+        return 0;
+    case F_GETFL:
+        return f->oflag;
+    case F_SETFL:
+        {
+            int mask = O_APPEND | O_NONBLOCK;
+            f->oflag = (f->oflag & ~mask) | (va_arg(vl, int) & mask);
+            return 0;
+        }
+    case F_GETLK:
+        {
+            // Nobody else can see these files, so there is never a
+            // conflicting lock
+            struct flock *lk = va_arg(vl, struct flock *);
+            lk->l_type = F_UNLCK;
+            return 0;
+        }
+    case F_SETLK:
+    case F_SETLKW:
+        return 0;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+CRYSTAX_LOCAL
+int driver_t::fdatasync(int fd)
+{
+    return fsync(fd);
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::fdopendir(int fd)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return NULL;
+    if (!S_ISDIR(f->inode->mode))
+    {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    dir_t *d = new dir_t;
+    d->inode = f->inode;
+    d->buf = NULL;
+    if (!snapshot(d))
+    {
+        delete d;
+        return NULL;
+    }
+    ++d->inode->refs;
+    return (DIR *)d;
+}
+
+CRYSTAX_LOCAL
+int driver_t::flock(int fd, int /* operation */)
+{
+    scope_lock_t lock(mutex);
+    return resolve(fd) ? 0 : -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fstat(int fd, struct stat *st)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    fill_stat(f->inode, st);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fsync(int fd)
+{
+    scope_lock_t lock(mutex);
+    return resolve(fd) ? 0 : -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::ftruncate(int fd, off_t offset)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+    if (!S_ISREG(f->inode->mode) || (f->oflag & O_ACCMODE) == O_RDONLY || offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!resize(f->inode, offset))
+        return -1;
+    f->inode->mtime = f->inode->ctime = ::time(NULL);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::getdents(unsigned int fd, struct dirent *entry, unsigned int count)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve((int)fd);
+    if (!f)
+        return -1;
+
+    inode_t *n = f->inode;
+    if (!S_ISDIR(n->mode))
+    {
+        errno = ENOTDIR;
+        return -1;
+    }
+
+    size_t index = f->pos;
+    size_t len = fill_dirents(n, &index, (char *)entry, count);
+    if (len == 0 && index < n->children.size() + 2)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    f->pos = index;
+    return len;
+}
+
+CRYSTAX_LOCAL
+int driver_t::ioctl(int fd, int request, va_list &vl)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    if (request == FIONREAD && S_ISREG(f->inode->mode))
+    {
+        int *avail = va_arg(vl, int *);
+        *avail = f->pos < (loff_t)f->inode->size ? (int)(f->inode->size - f->pos) : 0;
+        return 0;
+    }
+
+    errno = ENOTTY;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::lchown(const char *path, uid_t uid, gid_t gid)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (uid != (uid_t)-1) r.inode->uid = uid;
+    if (gid != (gid_t)-1) r.inode->gid = gid;
+    r.inode->ctime = ::time(NULL);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::link(const char *src, const char *dst)
+{
+    scope_lock_t lock(mutex);
+    lookup_t a, b;
+    if (!lookup(src, false, a) || !lookup(dst, false, b))
+        return -1;
+    if (!a.inode || !b.dir)
+    {
+        errno = a.inode ? EEXIST : ENOENT;
+        return -1;
+    }
+    if (S_ISDIR(a.inode->mode))
+    {
+        errno = EPERM;
+        return -1;
+    }
+    if (b.inode)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    attach(b.dir, b.name, b.namelen, a.inode);
+    a.inode->ctime = ::time(NULL);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+off_t driver_t::lseek(int fd, off_t offset, int whence)
+{
+    return lseek64(fd, offset, whence);
+}
+
+CRYSTAX_LOCAL
+loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    loff_t pos;
+    switch (whence)
+    {
+    case SEEK_SET: pos = offset; break;
+    case SEEK_CUR: pos = f->pos + offset; break;
+    case SEEK_END: pos = (loff_t)f->inode->size + offset; break;
+    default: pos = -1;
+    }
+    // Position of directory is index of the next entry for getdents()
+    if (pos < 0 || (S_ISDIR(f->inode->mode) && whence != SEEK_SET))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    f->pos = pos;
+    return pos;
+}
+
+CRYSTAX_LOCAL
+int driver_t::lstat(const char *path, struct stat *st)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    fill_stat(r.inode, st);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::mkdir(const char *path, mode_t mode)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (r.inode)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    attach(r.dir, r.name, r.namelen, new_inode(S_IFDIR | (mode & 07777)));
+    return 0;
+}
+
+CRYSTAX_LOCAL
+void *driver_t::mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    DBG("fd=%d, length=%lu, offset=%ld", fd, (unsigned long)length, (long)offset);
+
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return MAP_FAILED;
+
+    inode_t *n = f->inode;
+    int acc = f->oflag & O_ACCMODE;
+    if (!S_ISREG(n->mode))
+    {
+        errno = ENODEV;
+        return MAP_FAILED;
+    }
+    if (offset < 0 || offset % page_size() != 0 || length == 0)
+    {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+    if (acc == O_WRONLY || ((flags & MAP_SHARED) && (prot & PROT_WRITE) && acc != O_RDWR))
+    {
+        errno = EACCES;
+        return MAP_FAILED;
+    }
+
+    // Shared mappings need pages the kernel knows about; private ones can
+    // use them as well once they exist
+    if ((flags & MAP_SHARED) && !share(n))
+        return MAP_FAILED;
+    if (n->memfd >= 0)
+        return system_mmap(addr, length, prot, flags, n->memfd, offset);
+
+    void *p = system_mmap(addr, length, prot | PROT_WRITE, flags | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return p;
+
+    if ((size_t)offset < n->size)
+    {
+        size_t len = n->size - offset;
+        ::memcpy(p, n->data + offset, len < length ? len : length);
+    }
+    if (!(prot & PROT_WRITE))
+        ::mprotect(p, length, prot);
+    return p;
+}
+
+CRYSTAX_LOCAL
+int driver_t::open(const char *path, int oflag, va_list &vl)
+{
+    DBG("path=%s, oflag=%d", path, oflag);
+
+    mode_t mode = (oflag & O_CREAT) ? (mode_t)va_arg(vl, int) : 0;
+    int acc = oflag & O_ACCMODE;
+    bool excl = (oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL);
+
+    scope_lock_t lock(mutex);
+
+    lookup_t r;
+    if (!lookup(path, !excl && !(oflag & O_NOFOLLOW), r))
+        return -1;
+
+    inode_t *n = r.inode;
+    if (n)
+    {
+        if (excl)
+        {
+            errno = EEXIST;
+            return -1;
+        }
+        if (S_ISLNK(n->mode))
+        {
+            errno = ELOOP;
+            return -1;
+        }
+        if (S_ISDIR(n->mode) && (acc != O_RDONLY || (oflag & (O_CREAT | O_TRUNC))))
+        {
+            errno = EISDIR;
+            return -1;
+        }
+        if ((oflag & O_DIRECTORY) && !S_ISDIR(n->mode))
+        {
+            errno = ENOTDIR;
+            return -1;
+        }
+        if ((oflag & O_TRUNC) && acc != O_RDONLY && n->size > 0)
+        {
+            if (!resize(n, 0))
+                return -1;
+            n->mtime = n->ctime = ::time(NULL);
+        }
+    }
+    else
+    {
+        if (!(oflag & O_CREAT) || (oflag & O_DIRECTORY))
+        {
+            errno = ENOENT;
+            return -1;
+        }
+        n = new_inode(S_IFREG | (mode & 07777));
+        attach(r.dir, r.name, r.namelen, n);
+    }
+
+    file_t *f = new file_t;
+    f->inode = n;
+    f->pos = 0;
+    f->oflag = oflag;
+    f->refs = 1;
+    ++n->refs;
+
+    int fd = alloc_fd(f);
+    if (fd < 0)
+    {
+        put_file(f);
+        return -1;
+    }
+#ifdef O_CLOEXEC
+    fd_table[fd].cloexec = (oflag & O_CLOEXEC) != 0;
+#endif
+
+    DBG("return fd=%d", fd);
+    return fd;
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::opendir(const char *dirpath)
+{
+    DBG("dirpath=%s", dirpath);
+
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(dirpath, true, r))
+        return NULL;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+    if (!S_ISDIR(r.inode->mode))
+    {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    dir_t *d = new dir_t;
+    d->inode = r.inode;
+    d->buf = NULL;
+    if (!snapshot(d))
+    {
+        delete d;
+        return NULL;
+    }
+    ++d->inode->refs;
+    return (DIR *)d;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pread(int fd, void *buf, size_t count, off_t offset)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    return do_read(f, buf, count, offset);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    return do_write(f, buf, count, offset);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::read(int fd, void *buf, size_t count)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    ssize_t n = do_read(f, buf, count, f->pos);
+    if (n > 0)
+        f->pos += n;
+    return n;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readv(int fd, const struct iovec *iov, int count)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    ssize_t total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        ssize_t n = do_read(f, iov[i].iov_base, iov[i].iov_len, f->pos);
+        if (n < 0)
+            return total > 0 ? total : -1;
+        f->pos += n;
+        total += n;
+        if ((size_t)n < iov[i].iov_len)
+            break;
+    }
+    return total;
+}
+
+CRYSTAX_LOCAL
+struct dirent *driver_t::readdir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    struct dirent *result;
+    if (readdir_r(dirp, &d->entry, &result) != 0)
+        return NULL;
+    return result;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+        return EBADF;
+
+    scope_lock_t lock(mutex);
+    if (d->off >= d->len)
+    {
+        *result = NULL;
+        return 0;
+    }
+
+    struct dirent *e = (struct dirent *)(d->buf + d->off);
+    ::memcpy(entry, e, e->d_reclen);
+    d->off += e->d_reclen;
+    ++d->index;
+    *result = entry;
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readlink(const char *path, char *buf, size_t bufsize)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!S_ISLNK(r.inode->mode))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t n = r.inode->size < bufsize ? r.inode->size : bufsize;
+    ::memcpy(buf, r.inode->data, n);
+    return n;
+}
+
+CRYSTAX_LOCAL
+int driver_t::remove(const char *path)
+{
+    scope_lock_t lock(mutex);
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return -1;
+    return S_ISDIR(st.st_mode) ? rmdir(path) : unlink(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::rename(const char *oldpath, const char *newpath)
+{
+    DBG("oldpath=%s, newpath=%s", oldpath, newpath);
+
+    scope_lock_t lock(mutex);
+    lookup_t a, b;
+    if (!lookup(oldpath, false, a) || !lookup(newpath, false, b))
+        return -1;
+    if (!a.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!a.dir || !b.dir)
+    {
+        errno = EBUSY;
+        return -1;
+    }
+
+    inode_t *n = a.inode;
+    inode_t *victim = b.inode;
+    if (victim == n)
+        return 0;
+
+    if (S_ISDIR(n->mode))
+    {
+        // Can't move directory into itself
+        for (inode_t *p = b.dir; p != rootnode; p = p->parent)
+        {
+            if (p == n)
+            {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        if (victim && !S_ISDIR(victim->mode))
+        {
+            errno = ENOTDIR;
+            return -1;
+        }
+        if (victim && !victim->children.empty())
+        {
+            errno = ENOTEMPTY;
+            return -1;
+        }
+    }
+    else if (victim && S_ISDIR(victim->mode))
+    {
+        errno = EISDIR;
+        return -1;
+    }
+
+    if (victim)
+    {
+        detach(b.dentry);
+        if (S_ISDIR(victim->mode))
+            victim->nlink = 0;
+        put_inode(victim);
+    }
+
+    detach(a.dentry);
+    attach(b.dir, b.name, b.namelen, n);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+void driver_t::rewinddir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+        return;
+
+    scope_lock_t lock(mutex);
+    snapshot(d);
+}
+
+CRYSTAX_LOCAL
+int driver_t::rmdir(const char *path)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!r.dir)
+    {
+        errno = EBUSY;
+        return -1;
+    }
+    if (!S_ISDIR(r.inode->mode))
+    {
+        errno = ENOTDIR;
+        return -1;
+    }
+    if (!r.inode->children.empty())
+    {
+        errno = ENOTEMPTY;
+        return -1;
+    }
+
+    inode_t *n = r.inode;
+    detach(r.dentry);
+    n->nlink = 0;
+    put_inode(n);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+    int (*compar)(const struct dirent **, const struct dirent **))
+{
+    DIR *dirp = opendir(dir);
+    if (!dirp)
+        return -1;
+
+    struct dirent **list = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    for (struct dirent *e; (e = readdir(dirp)) != NULL;)
+    {
+        if (filter && !filter(e))
+            continue;
+
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 16;
+            struct dirent **p = (struct dirent **)::realloc(list, capacity * sizeof(*list));
+            if (!p)
+                break;
+            list = p;
+        }
+
+        struct dirent *copy = (struct dirent *)::malloc(sizeof(struct dirent));
+        if (!copy)
+            break;
+        ::memcpy(copy, e, e->d_reclen);
+        list[count++] = copy;
+    }
+    closedir(dirp);
+
+    if (compar && count > 1)
+        ::qsort(list, count, sizeof(*list), (int (*)(const void *, const void *))compar);
+
+    *namelist = list;
+    return count;
+}
+
+CRYSTAX_LOCAL
+void driver_t::seekdir(DIR *dirp, long offset)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+        return;
+
+    scope_lock_t lock(mutex);
+    d->off = 0;
+    d->index = 0;
+    while (d->index < offset && d->off < d->len)
+    {
+        d->off += ((struct dirent *)(d->buf + d->off))->d_reclen;
+        ++d->index;
+    }
+}
+
+CRYSTAX_LOCAL
+int driver_t::select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv)
+{
+    return underlying()->select(maxfd, rfd, wfd, efd, tv);
+}
+
+CRYSTAX_LOCAL
+int driver_t::stat(const char *path, struct stat *st)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, true, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    fill_stat(r.inode, st);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::symlink(const char *src, const char *dst)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(dst, false, r))
+        return -1;
+    if (r.inode)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+    if (!src || *src == '\0')
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    inode_t *n = new_inode(S_IFLNK | 0777);
+    n->size = ::strlen(src);
+    n->data = ::strdup(src);
+    attach(r.dir, r.name, r.namelen, n);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+long driver_t::telldir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    return d ? d->index : -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::unlink(const char *path)
+{
+    scope_lock_t lock(mutex);
+    lookup_t r;
+    if (!lookup(path, false, r))
+        return -1;
+    if (!r.inode)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    if (S_ISDIR(r.inode->mode))
+    {
+        errno = EISDIR;
+        return -1;
+    }
+
+    inode_t *n = r.inode;
+    detach(r.dentry);
+    put_inode(n);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::write(int fd, const void *buf, size_t count)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = resolve(fd);
+    if (!f)
+        return -1;
+
+    loff_t offset = (f->oflag & O_APPEND) ? (loff_t)f->inode->size : f->pos;
+    ssize_t n = do_write(f, buf, count, offset);
+    if (n >= 0)
+        f->pos = offset + n;
+    return n;
+}
+
+CRYSTAX_LOCAL
+int driver_t::writev(int fd, const struct iovec *iov, int count)
+{
+    scope_lock_t lock(mutex);
+    ssize_t total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        ssize_t n = write(fd, iov[i].iov_base, iov[i].iov_len);
+        if (n < 0)
+            return total > 0 ? total : -1;
+        total += n;
+    }
+    return total;
+}
+
+} // namespace tmpfs
+} // namespace fileio
+} // namespace crystax
@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#include "trace/trace.hpp"
+#include <time.h>
+
+namespace crystax
+{
+namespace fileio
+{
+namespace trace
+{
+
+enum
+{
+    SUB_BITS = 3,
+    SUB_BUCKETS = 1 << SUB_BITS,
+    MAX_BITS = 40,
+    SLOWEST = 16
+};
+
+struct op_counters_t
+{
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long bytes;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    unsigned int histogram[CRYSTAX_VFS_TRACE_BUCKETS];
+};
+
+struct counters_t
+{
+    char *name;
+    char *info;
+    unsigned long long jni_calls;
+    op_counters_t ops[CRYSTAX_VFS_OP_COUNT];
+
+    counters_t *next;
+    counters_t *prev;
+};
+
+struct slow_op_t
+{
+    unsigned long long ns;
+    int op;
+    char *path;
+};
+
+bool volatile enabled = false;
+
+static const char *op_names[CRYSTAX_VFS_OP_COUNT] = {
+    "open", "close", "read", "write", "pread", "pwrite", "readv", "writev",
+    "lseek", "stat", "lstat", "fstat", "opendir", "readdir", "getdents", "mmap"
+};
+
+// Every counters_t allocated and not yet released with its driver. Never
+// torn down at exit, as the system driver lives until the very end.
+static counters_t *registry = NULL;
+static pthread_mutex_t registry_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+
+static slow_op_t slowest[SLOWEST];
+static unsigned long long volatile slowest_min = 0;
+static pthread_mutex_t slowest_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
+
+// Values below 2 * SUB_BUCKETS are exact, above that each power of two is
+// split into SUB_BUCKETS equal parts
+static unsigned bucket(unsigned long long ns)
+{
+    if (ns >= (1ULL << MAX_BITS))
+        ns = (1ULL << MAX_BITS) - 1;
+    if (ns < 2 * SUB_BUCKETS)
+        return (unsigned)ns;
+    unsigned shift = 63 - __builtin_clzll(ns) - SUB_BITS;
+    return shift * SUB_BUCKETS + (unsigned)(ns >> shift);
+}
+
+static unsigned long long bucket_value(unsigned b)
+{
+    if (b < 2 * SUB_BUCKETS)
+        return b;
+    unsigned shift = b / SUB_BUCKETS - 1;
+    return (unsigned long long)(b - shift * SUB_BUCKETS) << shift;
+}
+
+static counters_t *counters(driver_t *driver)
+{
+    counters_t *c = driver->trace_counters;
+    if (c)
+        return c;
+
+    scope_lock_t lock(registry_mutex);
+
+    if (driver->trace_counters)
+        return driver->trace_counters;
+
+    c = (counters_t *)::calloc(1, sizeof(counters_t));
+    if (!c)
+        return NULL;
+    c->name = ::strdup(driver->name());
+    c->info = ::strdup(driver->info());
+    c->next = registry;
+    if (registry)
+        registry->prev = c;
+    registry = c;
+
+    __sync_synchronize();
+    driver->trace_counters = c;
+    return c;
+}
+
+static void remember(int op, const char *path, unsigned long long ns)
+{
+    scope_lock_t lock(slowest_mutex);
+
+    if (ns <= slowest_min)
+        return;
+
+    size_t min = 0;
+    for (size_t i = 1; i < SLOWEST; ++i)
+        if (slowest[i].ns < slowest[min].ns)
+            min = i;
+
+    char *p = ::strdup(path);
+    if (!p)
+        return;
+    ::free(slowest[min].path);
+    slowest[min].ns = ns;
+    slowest[min].op = op;
+    slowest[min].path = p;
+
+    unsigned long long m = slowest[0].ns;
+    for (size_t i = 1; i < SLOWEST; ++i)
+        if (slowest[i].ns < m)
+            m = slowest[i].ns;
+    slowest_min = m;
+}
+
+CRYSTAX_LOCAL
+unsigned long long now()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+CRYSTAX_LOCAL
+void record(driver_t *driver, int op, unsigned long long start, bool failed, size_t bytes, const char *path)
+{
+    unsigned long long ns = now() - start;
+
+    counters_t *c = counters(driver);
+    if (!c)
+        return;
+
+    op_counters_t &o = c->ops[op];
+    __sync_fetch_and_add(&o.calls, 1);
+    if (failed)
+        __sync_fetch_and_add(&o.errors, 1);
+    if (bytes)
+        __sync_fetch_and_add(&o.bytes, (unsigned long long)bytes);
+    __sync_fetch_and_add(&o.total_ns, ns);
+    for (unsigned long long m = o.max_ns; ns > m; m = o.max_ns)
+        if (__sync_bool_compare_and_swap(&o.max_ns, m, ns))
+            break;
+    __sync_fetch_and_add(&o.histogram[bucket(ns)], 1);
+
+    if (path && ns > slowest_min)
+        remember(op, path, ns);
+}
+
+CRYSTAX_LOCAL
+void count_jni(driver_t *driver, unsigned calls)
+{
+    counters_t *c = counters(driver);
+    if (c)
+        __sync_fetch_and_add(&c->jni_calls, (unsigned long long)calls);
+}
+
+CRYSTAX_LOCAL
+void release(counters_t *c)
+{
+    if (!c)
+        return;
+
+    scope_lock_t lock(registry_mutex);
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        registry = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+    ::free(c->name);
+    ::free(c->info);
+    ::free(c);
+}
+
+// Upper end of the bucket holding the p-th call, but never above the slowest
+static unsigned long long percentile(unsigned int const *histogram, unsigned long long calls,
+    unsigned long long max, double p)
+{
+    if (calls == 0)
+        return 0;
+    if (p < 0)
+        p = 0;
+    if (p > 1)
+        p = 1;
+
+    unsigned long long want = (unsigned long long)(p * calls + 0.5);
+    if (want == 0)
+        want = 1;
+    unsigned long long seen = 0;
+    unsigned b = 0;
+    for (; b < CRYSTAX_VFS_TRACE_BUCKETS - 1; ++b)
+    {
+        seen += histogram[b];
+        if (seen >= want)
+            break;
+    }
+    unsigned long long v = bucket_value(b + 1) - 1;
+    return v < max ? v : max;
+}
+
+static void print(int fd, const char *fmt, ...)
+{
+    char buf[512];
+    va_list vl;
+    va_start(vl, fmt);
+    int n = ::vsnprintf(buf, sizeof(buf), fmt, vl);
+    va_end(vl);
+    if (n <= 0)
+        return;
+    if ((size_t)n >= sizeof(buf))
+        n = sizeof(buf) - 1;
+    for (const char *p = buf; n > 0;)
+    {
+        ssize_t w = ::write(fd, p, n);
+        if (w <= 0)
+            break;
+        p += w;
+        n -= w;
+    }
+}
+
+static void dump(int fd, counters_t const &c)
+{
+    print(fd, "%s %s: %llu JNI calls\n", c.name, c.info, c.jni_calls);
+    print(fd, "  %-8s %10s %8s %12s %10s %10s %10s %10s %10s\n",
+        "op", "calls", "errors", "bytes", "mean us", "p50 us", "p90 us", "p99 us", "max us");
+    for (int op = 0; op < CRYSTAX_VFS_OP_COUNT; ++op)
+    {
+        op_counters_t const &o = c.ops[op];
+        if (o.calls == 0)
+            continue;
+        print(fd, "  %-8s %10llu %8llu %12llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+            op_names[op], o.calls, o.errors, o.bytes,
+            o.total_ns / 1e3 / o.calls,
+            percentile(o.histogram, o.calls, o.max_ns, 0.5) / 1e3,
+            percentile(o.histogram, o.calls, o.max_ns, 0.9) / 1e3,
+            percentile(o.histogram, o.calls, o.max_ns, 0.99) / 1e3,
+            o.max_ns / 1e3);
+    }
+}
+
+CRYSTAX_LOCAL
+int dump(int fd)
+{
+    {
+        scope_lock_t lock(registry_mutex);
+        for (counters_t *c = registry; c; c = c->next)
+            dump(fd, *c);
+    }
+
+    slow_op_t ops[SLOWEST];
+    size_t n = 0;
+    {
+        scope_lock_t lock(slowest_mutex);
+        for (size_t i = 0; i < SLOWEST; ++i)
+        {
+            if (!slowest[i].path)
+                continue;
+            ops[n] = slowest[i];
+            ops[n].path = ::strdup(slowest[i].path);
+            if (ops[n].path)
+                ++n;
+        }
+    }
+
+    // Slowest first
+    for (size_t i = 1; i < n; ++i)
+        for (size_t j = i; j > 0 && ops[j].ns > ops[j - 1].ns; --j)
+        {
+            slow_op_t t = ops[j];
+            ops[j] = ops[j - 1];
+            ops[j - 1] = t;
+        }
+
+    if (n > 0)
+        print(fd, "slowest path operations:\n");
+    for (size_t i = 0; i < n; ++i)
+    {
+        print(fd, "  %10.1f us %-8s %s\n", ops[i].ns / 1e3, op_names[ops[i].op], ops[i].path);
+        ::free(ops[i].path);
+    }
+    return 0;
+}
+
+CRYSTAX_LOCAL
+void reset()
+{
+    {
+        scope_lock_t lock(registry_mutex);
+        for (counters_t *c = registry; c; c = c->next)
+        {
+            c->jni_calls = 0;
+            ::memset(c->ops, 0, sizeof(c->ops));
+        }
+    }
+
+    scope_lock_t lock(slowest_mutex);
+    for (size_t i = 0; i < SLOWEST; ++i)
+    {
+        ::free(slowest[i].path);
+        slowest[i].path = NULL;
+        slowest[i].ns = 0;
+    }
+    slowest_min = 0;
+}
+
+} // namespace trace
+} // namespace fileio
+} // namespace crystax
+
+CRYSTAX_GLOBAL
+void crystax_vfs_trace_enable(int on)
+{
+    ::crystax::fileio::trace::enabled = on != 0;
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_trace_enabled(void)
+{
+    return ::crystax::fileio::trace::enabled ? 1 : 0;
+}
+
+CRYSTAX_GLOBAL
+void crystax_vfs_trace_reset(void)
+{
+    ::crystax::fileio::trace::reset();
+}
+
+CRYSTAX_GLOBAL
+const char *crystax_vfs_trace_op_name(int op)
+{
+    if (op < 0 || op >= CRYSTAX_VFS_OP_COUNT)
+        return NULL;
+    return ::crystax::fileio::trace::op_names[op];
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_trace_stats(const char *target, int op, struct crystax_vfs_trace_stats *stats)
+{
+    using namespace ::crystax::fileio;
+
+    driver_t *d = find_driver(target);
+    if (!d || !stats || op < 0 || op >= CRYSTAX_VFS_OP_COUNT)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    trace::counters_t *c = d->trace_counters;
+    if (!c)
+    {
+        ::memset(stats, 0, sizeof(*stats));
+        return 0;
+    }
+
+    trace::op_counters_t const &o = c->ops[op];
+    stats->calls = o.calls;
+    stats->errors = o.errors;
+    stats->bytes = o.bytes;
+    stats->total_ns = o.total_ns;
+    stats->max_ns = o.max_ns;
+    ::memcpy(stats->histogram, o.histogram, sizeof(stats->histogram));
+    return 0;
+}
+
+CRYSTAX_GLOBAL
+unsigned long long crystax_vfs_trace_jni_calls(const char *target)
+{
+    using namespace ::crystax::fileio;
+
+    // JNI is called by the driver at the bottom of a stack, e.g. assets under
+    // a cache
+    unsigned long long calls = 0;
+    for (driver_t *d = find_driver(target); d; d = d->underlying())
+        if (d->trace_counters)
+            calls += d->trace_counters->jni_calls;
+    return calls;
+}
+
+CRYSTAX_GLOBAL
+unsigned long long crystax_vfs_trace_percentile(const struct crystax_vfs_trace_stats *stats, double p)
+{
+    if (!stats)
+        return 0;
+    return ::crystax::fileio::trace::percentile(stats->histogram, stats->calls, stats->max_ns, p);
+}
+
+CRYSTAX_GLOBAL
+int crystax_vfs_trace_dump(int fd)
+{
+    return ::crystax::fileio::trace::dump(fd);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+#ifndef _CRYSTAX_FILEIO_TRACE_HPP_e41b7c09d2f84a3c9b6a58d1f7023ce5
+#define _CRYSTAX_FILEIO_TRACE_HPP_e41b7c09d2f84a3c9b6a58d1f7023ce5
+
+#include <crystax/vfs.h>
+#include "fileio/driver.hpp"
+
+// The only cost of tracing while it's off
+#define CRYSTAX_VFS_TRACING __builtin_expect(::crystax::fileio::trace::enabled, 0)
+
+namespace crystax
+{
+namespace fileio
+{
+namespace trace
+{
+
+extern bool volatile enabled;
+
+unsigned long long now();
+// Counts a finished call of op on driver; path, if given, makes the call a
+// candidate for the slowest operations list
+void record(driver_t *driver, int op, unsigned long long start, bool failed, size_t bytes, const char *path);
+void count_jni(driver_t *driver, unsigned calls);
+
+inline bool failed(long long ret) {return ret < 0;}
+inline bool failed(const void *ret) {return ret == NULL || ret == MAP_FAILED;}
+// readdir() returns NULL at the end of directory as well
+inline bool failed(struct dirent *) {return false;}
+inline size_t moved(long long ret) {return ret > 0 ? (size_t)ret : 0;}
+inline size_t moved(const void *) {return 0;}
+
+// Times one driver call:
+//
+//     if (CRYSTAX_VFS_TRACING)
+//     {
+//         trace::op_timer_t t(driver, CRYSTAX_VFS_OP_READ);
+//         return t.done(driver->read(extfd, buf, count));
+//     }
+//     return driver->read(extfd, buf, count);
+class op_timer_t : non_copyable_t
+{
+public:
+    op_timer_t(driver_t *d, int o, const char *p = NULL)
+        :driver(d), op(o), path(p), start(now())
+    {}
+
+    template <typename T>
+    T done(T ret)
+    {
+        int e = errno;
+        bool data = op >= CRYSTAX_VFS_OP_READ && op <= CRYSTAX_VFS_OP_WRITEV;
+        record(driver, op, start, failed(ret), data ? moved(ret) : 0, path);
+        errno = e;
+        return ret;
+    }
+
+private:
+    driver_t *driver;
+    int op;
+    const char *path;
+    unsigned long long start;
+};
+
+// JNI calls made on behalf of driver, counted only while tracing
+inline void jni_calls(driver_t *driver, unsigned calls)
+{
+    if (CRYSTAX_VFS_TRACING)
+        count_jni(driver, calls);
+}
+
+} // namespace trace
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_TRACE_HPP_e41b7c09d2f84a3c9b6a58d1f7023ce5
@@ -28,6 +28,7 @@
  */
 
 #include "fileio/api.hpp"
+#include "trace/trace.hpp"
 
 namespace crystax
 {
@@ -44,6 +45,11 @@ int writev(int fd, const struct iovec *iov, int count)
     if (!resolve(fd, NULL, &extfd, NULL, &driver))
         return -1;
 
+    if (CRYSTAX_VFS_TRACING)
+    {
+        trace::op_timer_t t(driver, CRYSTAX_VFS_OP_WRITEV);
+        return t.done(driver->writev(extfd, iov, count));
+    }
     return driver->writev(extfd, iov, count);
 }
 
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#ifndef _CRYSTAX_FILEIO_ZIP_DRIVER_HPP_7c41e2a95b0d4f6a8e3d19b6c2f05a74
+#define _CRYSTAX_FILEIO_ZIP_DRIVER_HPP_7c41e2a95b0d4f6a8e3d19b6c2f05a74
+
+#include <zlib.h>
+#include "fileio/driver.hpp"
+
+namespace crystax
+{
+namespace fileio
+{
+namespace zip
+{
+
+// Read-only view of a zip archive (.zip, .pak, .obb, .apk). The central
+// directory is read once at mount time and indexed by full path; stored
+// entries are read straight from the archive, deflated ones through a
+// per-descriptor inflate stream which can restart from checkpoints recorded
+// every "span" bytes of output instead of from the beginning.
+class driver_t : public ::crystax::fileio::driver_t
+{
+public:
+    // Opens 'source' through whatever driver serves that path, so archives
+    // may live on any mount supporting pread(). Parses mount() data
+    // ("span=1m") and returns NULL with errno set on bad options or archive.
+    static driver_t *create(const char *source, const char *root, const char *options, fileio::driver_t *d);
+    ~driver_t();
+
+    const char *name() const {return "ZIP";}
+    const char *info() const {return archive.c_str();}
+
+    int    chown(const char *path, uid_t uid, gid_t gid);
+    int    close(int fd);
+    int    closedir(DIR *dirp);
+    int    dirfd(DIR *dirp);
+    int    dup(int fd);
+    int    dup2(int fd, int fd2);
+    int    fchown(int fd, uid_t uid, gid_t gid);
+    int    fcntl(int fd, int command, va_list &vl);
+    int    fdatasync(int fd);
+    DIR *  fdopendir(int fd);
+    int    flock(int fd, int operation);
+    int    fstat(int fd, struct stat *st);
+    int    fsync(int fd);
+    int    ftruncate(int fd, off_t offset);
+    int    getdents(unsigned int fd, struct dirent *entry, unsigned int count);
+    int    ioctl(int fd, int request, va_list &vl);
+    int    lchown(const char *path, uid_t uid, gid_t gid);
+    int    link(const char *src, const char *dst);
+    off_t  lseek(int fd, off_t offset, int whence);
+    loff_t lseek64(int fd, loff_t offset, int whence);
+    int    lstat(const char *path, struct stat *st);
+    int    mkdir(const char *path, mode_t mode);
+    void * mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
+    int    open(const char *path, int oflag, va_list &vl);
+    DIR *  opendir(const char *dirpath);
+    ssize_t pread(int fd, void *buf, size_t count, off_t offset);
+    ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
+    ssize_t read(int fd, void *buf, size_t count);
+    int    readv(int fd, const struct iovec *iov, int count);
+    struct dirent *readdir(DIR *dirp);
+    int    readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result);
+    int    readlink(const char *path, char *buf, size_t bufsize);
+    int    remove(const char *path);
+    int    rename(const char *oldpath, const char *newpath);
+    void   rewinddir(DIR *dirp);
+    int    rmdir(const char *path);
+    int    scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+        int (*compar)(const struct dirent **, const struct dirent **));
+    void   seekdir(DIR *dirp, long offset);
+    int    select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv);
+    int    stat(const char *path, struct stat *st);
+    int    symlink(const char *src, const char *dst);
+    long   telldir(DIR *dirp);
+    int    unlink(const char *path);
+    ssize_t write(int fd, const void *buf, size_t count);
+    int    writev(int fd, const struct iovec *iov, int count);
+
+private:
+    driver_t(const char *source, const char *root, size_t span, fileio::driver_t *d);
+
+    enum
+    {
+        NONE = ~0u,
+        // Deflate history; also the output ring of every stream
+        WINDOW = 32768,
+        INPUT = 16384
+    };
+
+    // Inflate state to resume from: output offset 'out' starts at bit
+    // 'bits' before compressed offset 'in', with 'window' preceding it
+    struct checkpoint_t
+    {
+        loff_t in;
+        loff_t out;
+        int bits;
+        unsigned char window[WINDOW];
+    };
+
+    // Files and directories, implicit ones included. Names point into the
+    // central directory buffer and are full paths relative to the root.
+    struct node_t
+    {
+        const char *name;
+        unsigned namelen;
+        unsigned hash;
+        unsigned parent;
+        unsigned child;
+        unsigned sibling;
+        unsigned hnext;
+
+        mode_t mode;
+        time_t mtime;
+
+        unsigned method;
+        unsigned flags;
+        loff_t header;
+        // Start of data, -1 until local header is read
+        loff_t data;
+        loff_t csize;
+        loff_t usize;
+
+        checkpoint_t **points;
+        unsigned npoints;
+    };
+
+    struct stream_t
+    {
+        z_stream z;
+        // Compressed bytes fetched and bytes produced so far
+        loff_t in;
+        loff_t out;
+        bool eof;
+        // Output byte 'n' is at window[n % WINDOW]
+        unsigned char window[WINDOW];
+        unsigned char input[INPUT];
+    };
+
+    // Open file description, shared by dup'ed descriptors
+    struct file_t
+    {
+        unsigned node;
+        loff_t pos;
+        int oflag;
+        unsigned refs;
+        // Directories: child at index 'dirpos' for getdents()
+        unsigned dirnext;
+        loff_t dirpos;
+        // Deflated files, created on first read
+        stream_t *stream;
+        pthread_mutex_t mutex;
+    };
+
+    struct fd_entry_t
+    {
+        file_t *file;
+        bool cloexec;
+    };
+
+    struct dir_t
+    {
+        unsigned node;
+        unsigned next;
+        long index;
+        struct dirent entry;
+    };
+
+    bool load(size_t size);
+    unsigned insert(const char *name, size_t len, bool dir);
+    unsigned find(const char *name, size_t len, unsigned hash) const;
+    bool grow();
+    unsigned lookup(const char *path);
+    bool locate(node_t &n);
+
+    ssize_t fetch(void *buf, size_t count, loff_t offset);
+    ssize_t do_read(file_t *f, void *buf, size_t count, loff_t offset);
+    ssize_t inflate_at(file_t *f, node_t &n, unsigned char *buf, size_t count, loff_t offset);
+    bool restart(node_t &n, stream_t *s, loff_t offset);
+    bool advance(node_t &n, stream_t *s);
+    void checkpoint(node_t &n, stream_t *s);
+
+    int alloc_fd(file_t *file, int from = 0);
+    file_t *acquire(int fd);
+    void release(file_t *file);
+
+    unsigned child_at(unsigned dir, long index);
+    bool fill_dirent(unsigned dir, long index, unsigned child, struct dirent *e);
+    void fill_stat(unsigned node, struct stat *st);
+    int readonly(const char *path);
+
+    static unsigned name_hash(const char *name, size_t len);
+
+private:
+    abspath_t archive;
+    fileio::driver_t *src;
+    int srcfd;
+    loff_t size;
+    dev_t dev;
+    time_t mtime;
+    size_t span;
+
+    char *cd;
+    node_t *nodes;
+    unsigned nnodes;
+    unsigned capacity;
+    unsigned *buckets;
+    unsigned nbuckets;
+
+    fd_entry_t fd_table[FD_TABLE_SIZE];
+    pthread_mutex_t mutex;
+};
+
+} // namespace zip
+} // namespace fileio
+} // namespace crystax
+
+#endif // _CRYSTAX_FILEIO_ZIP_DRIVER_HPP_7c41e2a95b0d4f6a8e3d19b6c2f05a74
@@ -0,0 +1,1664 @@
+/*
+ * Copyright (c) 2011-2012 Dmitry Moskalchuk <dm@crystax.net>.
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY Dmitry Moskalchuk ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Dmitry Moskalchuk OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation are those of the
+ * authors and should not be interpreted as representing official policies, either expressed
+ * or implied, of Dmitry Moskalchuk.
+ */
+
+
+#include "zip/driver.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+namespace crystax
+{
+namespace fileio
+{
+namespace zip
+{
+
+enum
+{
+    LOCAL_HEADER_SIGNATURE = 0x04034b50,
+    CENTRAL_HEADER_SIGNATURE = 0x02014b50,
+    END_SIGNATURE = 0x06054b50,
+    END64_SIGNATURE = 0x06064b50,
+    END64_LOCATOR_SIGNATURE = 0x07064b50,
+
+    LOCAL_HEADER_SIZE = 30,
+    CENTRAL_HEADER_SIZE = 46,
+    END_SIZE = 22,
+    END64_SIZE = 56,
+    END64_LOCATOR_SIZE = 20,
+    MAX_COMMENT = 65535,
+
+    METHOD_STORED = 0,
+    METHOD_DEFLATED = 8,
+    FLAG_ENCRYPTED = 1,
+    HOST_UNIX = 3,
+
+    EXTRA_ZIP64 = 0x0001,
+    EXTRA_TIMESTAMP = 0x5455,
+
+    // Entries keep at most this many inflate checkpoints, however small
+    // the span is
+    MAX_CHECKPOINTS = 64
+};
+
+static unsigned get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const unsigned char *p)
+{
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static time_t dos_time(unsigned date, unsigned time)
+{
+    struct tm tm;
+    ::memset(&tm, 0, sizeof(tm));
+    tm.tm_year = ((date >> 9) & 0x7f) + 80;
+    tm.tm_mon = ((date >> 5) & 0x0f) - 1;
+    tm.tm_mday = date & 0x1f;
+    tm.tm_hour = (time >> 11) & 0x1f;
+    tm.tm_min = (time >> 5) & 0x3f;
+    tm.tm_sec = (time & 0x1f) * 2;
+    tm.tm_isdst = -1;
+    return ::mktime(&tm);
+}
+
+// Rejects names which would escape the root or can't be looked up
+static bool valid_name(const char *name, size_t len)
+{
+    if (len == 0 || ::memchr(name, '\0', len))
+        return false;
+
+    for (size_t i = 0; i < len;)
+    {
+        size_t j = i;
+        while (j < len && name[j] != '/')
+            ++j;
+        size_t n = j - i;
+        if (n == 0 || n > NAME_MAX)
+            return false;
+        if (name[i] == '.' && (n == 1 || (n == 2 && name[i + 1] == '.')))
+            return false;
+        i = j + 1;
+    }
+    return true;
+}
+
+static void init_mutex(pthread_mutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+    if (::pthread_mutexattr_init(&attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+        ::abort();
+    if (::pthread_mutex_init(mutex, &attr) != 0)
+        ::abort();
+    if (::pthread_mutexattr_destroy(&attr) != 0)
+        ::abort();
+}
+
+static unsigned next_dev = 0;
+
+CRYSTAX_LOCAL
+driver_t *driver_t::create(const char *source, const char *root, const char *options, fileio::driver_t *d)
+{
+    DBG("source=%s, root=%s, options=%s", source, root, options ? options : "(null)");
+
+    size_t span = 1024 * 1024;
+    for (const char *s = options; s && *s != '\0';)
+    {
+        const char *e = ::strchr(s, ',');
+        size_t len = e ? (size_t)(e - s) : ::strlen(s);
+        const char *eq = (const char *)::memchr(s, '=', len);
+        size_t klen = eq ? (size_t)(eq - s) : 0;
+
+        bool ok = false;
+        if (klen == 4 && ::strncmp(s, "span", klen) == 0)
+            ok = parse_size_option(eq + 1, len - klen - 1, &span) && span >= 2 * WINDOW;
+
+        if (!ok)
+        {
+            ERR("bad zip option: %.*s", (int)len, s);
+            errno = EINVAL;
+            return NULL;
+        }
+
+        s = e ? e + 1 : NULL;
+    }
+
+    if (source == NULL || *source == '\0')
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    driver_t *driver = new driver_t(source, root, span, d);
+
+    struct stat st;
+    driver->src = find_driver(driver->archive.c_str());
+    if (driver->src)
+        driver->srcfd = driver->src->open(driver->archive.c_str(), O_RDONLY);
+    bool ok = driver->srcfd >= 0 && driver->src->fstat(driver->srcfd, &st) == 0;
+    if (ok)
+    {
+        driver->mtime = st.st_mtime;
+        ok = driver->load(st.st_size);
+    }
+    if (!ok)
+    {
+        int err = errno;
+        ERR("can't mount %s: %s", source, ::strerror(err));
+        delete driver;
+        errno = err;
+        return NULL;
+    }
+
+    DBG("%s: %u nodes", source, driver->nnodes);
+    return driver;
+}
+
+CRYSTAX_LOCAL
+driver_t::driver_t(const char *source, const char *root, size_t s, fileio::driver_t *d)
+    :fileio::driver_t(root, d), archive(source), src(0), srcfd(-1), size(0), mtime(0), span(s),
+    cd(0), nodes(0), nnodes(0), capacity(0), buckets(0), nbuckets(0)
+{
+    init_mutex(&mutex);
+    dev = __sync_add_and_fetch(&next_dev, 1);
+    ::memset(fd_table, 0, sizeof(fd_table));
+}
+
+CRYSTAX_LOCAL
+driver_t::~driver_t()
+{
+    for (size_t fd = 0; fd < FD_TABLE_SIZE; ++fd)
+    {
+        if (fd_table[fd].file)
+            release(fd_table[fd].file);
+    }
+
+    for (unsigned i = 0; i < nnodes; ++i)
+    {
+        for (unsigned j = 0; j < nodes[i].npoints; ++j)
+            ::free(nodes[i].points[j]);
+        ::free(nodes[i].points);
+    }
+    ::free(nodes);
+    ::free(buckets);
+    ::free(cd);
+
+    if (srcfd >= 0)
+        src->close(srcfd);
+
+    if (::pthread_mutex_destroy(&mutex) != 0)
+        ::abort();
+}
+
+CRYSTAX_LOCAL
+unsigned driver_t::name_hash(const char *name, size_t len)
+{
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+CRYSTAX_LOCAL
+unsigned driver_t::find(const char *name, size_t len, unsigned hash) const
+{
+    if (len == 0)
+        return 0;
+
+    for (unsigned i = buckets[hash & (nbuckets - 1)]; i != NONE; i = nodes[i].hnext)
+    {
+        node_t const &n = nodes[i];
+        if (n.hash == hash && n.namelen == len && ::memcmp(n.name, name, len) == 0)
+            return i;
+    }
+    return NONE;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::grow()
+{
+    if (nnodes == capacity)
+    {
+        unsigned cap = capacity * 2;
+        node_t *p = (node_t *)::realloc(nodes, cap * sizeof(node_t));
+        if (!p)
+            return false;
+        nodes = p;
+        capacity = cap;
+    }
+
+    if (nnodes >= nbuckets)
+    {
+        unsigned n = nbuckets * 2;
+        unsigned *b = (unsigned *)::malloc(n * sizeof(unsigned));
+        if (!b)
+            return false;
+        ::memset(b, 0xff, n * sizeof(unsigned));
+        for (unsigned i = 1; i < nnodes; ++i)
+        {
+            nodes[i].hnext = b[nodes[i].hash & (n - 1)];
+            b[nodes[i].hash & (n - 1)] = i;
+        }
+        ::free(buckets);
+        buckets = b;
+        nbuckets = n;
+    }
+
+    return true;
+}
+
+CRYSTAX_LOCAL
+unsigned driver_t::insert(const char *name, size_t len, bool dir)
+{
+    unsigned h = name_hash(name, len);
+    unsigned i = find(name, len, h);
+    if (i != NONE)
+        return i;
+
+    // Archives don't have to list directories, so make up missing ones
+    size_t plen = len;
+    while (plen > 0 && name[plen - 1] != '/')
+        --plen;
+    unsigned parent = plen > 0 ? insert(name, plen - 1, true) : 0;
+    if (parent == NONE || !S_ISDIR(nodes[parent].mode) || !grow())
+        return NONE;
+
+    i = nnodes++;
+    node_t &n = nodes[i];
+    ::memset(&n, 0, sizeof(n));
+    n.name = name;
+    n.namelen = len;
+    n.hash = h;
+    n.parent = parent;
+    n.child = NONE;
+    n.sibling = nodes[parent].child;
+    nodes[parent].child = i;
+    n.hnext = buckets[h & (nbuckets - 1)];
+    buckets[h & (nbuckets - 1)] = i;
+    n.mode = dir ? S_IFDIR | 0555 : S_IFREG | 0444;
+    n.mtime = mtime;
+    n.data = -1;
+    return i;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::load(size_t asize)
+{
+    size = asize;
+
+    size_t tail = END_SIZE + MAX_COMMENT + END64_LOCATOR_SIZE;
+    if (tail > asize)
+        tail = asize;
+    if (tail < END_SIZE)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    unsigned char *buf = (unsigned char *)::malloc(tail);
+    if (!buf)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    if (fetch(buf, tail, asize - tail) != (ssize_t)tail)
+    {
+        ::free(buf);
+        errno = EIO;
+        return false;
+    }
+
+    // End of central directory record is followed by comment only
+    long end = -1;
+    for (long i = tail - END_SIZE; i >= 0; --i)
+    {
+        if (get32(buf + i) == END_SIGNATURE && (size_t)i + END_SIZE + get16(buf + i + 20) <= tail)
+        {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0)
+    {
+        ::free(buf);
+        ERR("%s: not a zip archive", archive.c_str());
+        errno = EINVAL;
+        return false;
+    }
+
+    uint64_t entries = get16(buf + end + 10);
+    uint64_t cdsize = get32(buf + end + 12);
+    uint64_t cdoff = get32(buf + end + 16);
+    if ((entries == 0xffff || cdsize == 0xffffffff || cdoff == 0xffffffff) &&
+        end >= END64_LOCATOR_SIZE && get32(buf + end - END64_LOCATOR_SIZE) == END64_LOCATOR_SIGNATURE)
+    {
+        unsigned char e64[END64_SIZE];
+        uint64_t off = get64(buf + end - END64_LOCATOR_SIZE + 8);
+        if (off > asize - END64_SIZE || fetch(e64, END64_SIZE, off) != END64_SIZE ||
+            get32(e64) != END64_SIGNATURE)
+        {
+            ::free(buf);
+            errno = EINVAL;
+            return false;
+        }
+        entries = get64(e64 + 32);
+        cdsize = get64(e64 + 40);
+        cdoff = get64(e64 + 48);
+    }
+    ::free(buf);
+
+    if (cdsize > asize || cdoff > asize - cdsize || entries > cdsize / CENTRAL_HEADER_SIZE + 1)
+    {
+        ERR("%s: bad central directory", archive.c_str());
+        errno = EINVAL;
+        return false;
+    }
+
+    cd = (char *)::malloc(cdsize + 1);
+    capacity = entries + 16;
+    nodes = (node_t *)::malloc(capacity * sizeof(node_t));
+    for (nbuckets = 64; nbuckets < capacity; nbuckets *= 2);
+    buckets = (unsigned *)::malloc(nbuckets * sizeof(unsigned));
+    if (!cd || !nodes || !buckets)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+    ::memset(buckets, 0xff, nbuckets * sizeof(unsigned));
+    if (fetch(cd, cdsize, cdoff) != (ssize_t)cdsize)
+    {
+        errno = EIO;
+        return false;
+    }
+
+    node_t &root = nodes[nnodes++];
+    ::memset(&root, 0, sizeof(root));
+    root.name = cd;
+    root.parent = 0;
+    root.child = NONE;
+    root.hnext = NONE;
+    root.mode = S_IFDIR | 0555;
+    root.mtime = mtime;
+    root.data = -1;
+
+    const unsigned char *p = (const unsigned char *)cd;
+    const unsigned char *last = p + cdsize;
+    for (uint64_t e = 0; e < entries; ++e)
+    {
+        if (last - p < CENTRAL_HEADER_SIZE || get32(p) != CENTRAL_HEADER_SIGNATURE)
+        {
+            ERR("%s: bad central directory entry %llu", archive.c_str(), (unsigned long long)e);
+            errno = EINVAL;
+            return false;
+        }
+
+        unsigned namelen = get16(p + 28);
+        unsigned extralen = get16(p + 30);
+        const unsigned char *extra = p + CENTRAL_HEADER_SIZE + namelen;
+        const unsigned char *next = extra + extralen + get16(p + 32);
+        if (next > last)
+        {
+            errno = EINVAL;
+            return false;
+        }
+
+        const char *name = (const char *)p + CENTRAL_HEADER_SIZE;
+        bool dir = namelen > 0 && name[namelen - 1] == '/';
+        size_t len = dir ? namelen - 1 : namelen;
+        if (!valid_name(name, len))
+        {
+            WARN("%s: skip entry '%.*s'", archive.c_str(), (int)namelen, name);
+            p = next;
+            continue;
+        }
+
+        unsigned i = insert(name, len, dir);
+        if (i == NONE || (S_ISDIR(nodes[i].mode) != 0) != dir)
+        {
+            WARN("%s: skip conflicting entry '%.*s'", archive.c_str(), (int)namelen, name);
+            p = next;
+            continue;
+        }
+
+        node_t &n = nodes[i];
+        n.flags = get16(p + 8);
+        n.method = get16(p + 10);
+        n.mtime = dos_time(get16(p + 14), get16(p + 12));
+        n.csize = get32(p + 20);
+        n.usize = get32(p + 24);
+        n.header = get32(p + 42);
+        if ((get16(p + 4) >> 8) == HOST_UNIX && (get32(p + 38) >> 16) != 0)
+            n.mode = (n.mode & S_IFMT) | ((get32(p + 38) >> 16) & 0777);
+
+        for (const unsigned char *x = extra; x + 4 <= extra + extralen;)
+        {
+            unsigned id = get16(x);
+            unsigned xlen = get16(x + 2);
+            const unsigned char *v = x + 4;
+            const unsigned char *vend = v + xlen;
+            if (vend > extra + extralen)
+                break;
+
+            if (id == EXTRA_ZIP64)
+            {
+                // Present only for fields saturated in the fixed header
+                if (get32(p + 24) == 0xffffffff && v + 8 <= vend)
+                    n.usize = get64(v), v += 8;
+                if (get32(p + 20) == 0xffffffff && v + 8 <= vend)
+                    n.csize = get64(v), v += 8;
+                if (get32(p + 42) == 0xffffffff && v + 8 <= vend)
+                    n.header = get64(v), v += 8;
+            }
+            else if (id == EXTRA_TIMESTAMP && xlen >= 5 && (v[0] & 1))
+                n.mtime = (time_t)get32(v + 1);
+
+            x = vend;
+        }
+
+        if (n.csize < 0 || n.usize < 0 || n.header < 0 || n.header > (loff_t)asize)
+        {
+            errno = EINVAL;
+            return false;
+        }
+
+        p = next;
+    }
+
+    return true;
+}
+
+CRYSTAX_LOCAL
+unsigned driver_t::lookup(const char *path)
+{
+    abspath_t abspath(path);
+    if (!abspath || !abspath.subpath(root()))
+    {
+        errno = ENOENT;
+        return NONE;
+    }
+
+    const char *s = abspath.c_str() + root().length();
+    while (*s == '/')
+        ++s;
+    size_t len = ::strlen(s);
+
+    unsigned i = find(s, len, name_hash(s, len));
+    if (i == NONE)
+        errno = ENOENT;
+    return i;
+}
+
+// Finds where data starts; the local header may have its own extra field
+CRYSTAX_LOCAL
+bool driver_t::locate(node_t &n)
+{
+    if (n.data >= 0)
+        return true;
+
+    unsigned char h[LOCAL_HEADER_SIZE];
+    if (fetch(h, sizeof(h), n.header) != (ssize_t)sizeof(h) || get32(h) != LOCAL_HEADER_SIGNATURE)
+    {
+        ERR("%s: bad local header of '%.*s'", archive.c_str(), (int)n.namelen, n.name);
+        errno = EIO;
+        return false;
+    }
+
+    loff_t data = n.header + LOCAL_HEADER_SIZE + get16(h + 26) + get16(h + 28);
+    if (data > size || n.csize > size - data ||
+        (n.method == METHOD_STORED && n.csize != n.usize))
+    {
+        ERR("%s: bad entry '%.*s'", archive.c_str(), (int)n.namelen, n.name);
+        errno = EIO;
+        return false;
+    }
+
+    n.data = data;
+    return true;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::fetch(void *buf, size_t count, loff_t offset)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t n = src->pread(srcfd, (char *)buf + done, count - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return done > 0 ? (ssize_t)done : -1;
+        if (n == 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::do_read(file_t *f, void *buf, size_t count, loff_t offset)
+{
+    node_t &n = nodes[f->node];
+    if (S_ISDIR(n.mode))
+    {
+        errno = EISDIR;
+        return -1;
+    }
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (offset >= n.usize)
+        return 0;
+    if ((loff_t)count > n.usize - offset)
+        count = n.usize - offset;
+
+    if (n.method == METHOD_STORED)
+        return fetch(buf, count, n.data + offset);
+
+    scope_lock_t lock(f->mutex);
+    return inflate_at(f, n, (unsigned char *)buf, count, offset);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::inflate_at(file_t *f, node_t &n, unsigned char *buf, size_t count, loff_t offset)
+{
+    stream_t *s = f->stream;
+    if (!s)
+    {
+        s = (stream_t *)::malloc(sizeof(stream_t));
+        if (!s)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        ::memset(&s->z, 0, sizeof(s->z));
+        if (::inflateInit2(&s->z, -MAX_WBITS) != Z_OK)
+        {
+            ::free(s);
+            errno = ENOMEM;
+            return -1;
+        }
+        s->in = s->out = 0;
+        s->eof = false;
+        f->stream = s;
+    }
+
+    // Last WINDOW bytes of output are still in the ring
+    loff_t kept = s->out < WINDOW ? s->out : (loff_t)WINDOW;
+    if ((offset < s->out - kept || offset > s->out) && !restart(n, s, offset))
+        return -1;
+
+    size_t done = 0;
+    while (done < count)
+    {
+        loff_t pos = offset + done;
+        if (pos < s->out)
+        {
+            size_t at = pos % WINDOW;
+            size_t len = WINDOW - at;
+            if ((loff_t)len > s->out - pos)
+                len = s->out - pos;
+            if (len > count - done)
+                len = count - done;
+            ::memcpy(buf + done, s->window + at, len);
+            done += len;
+            continue;
+        }
+
+        if (!advance(n, s))
+            return done > 0 ? (ssize_t)done : -1;
+    }
+
+    return done;
+}
+
+// Moves stream to the closest checkpoint before 'offset', unless going on
+// from where it is now is closer
+CRYSTAX_LOCAL
+bool driver_t::restart(node_t &n, stream_t *s, loff_t offset)
+{
+    checkpoint_t *pt = NULL;
+    {
+        scope_lock_t lock(mutex);
+        unsigned lo = 0, hi = n.npoints;
+        while (lo < hi)
+        {
+            unsigned mid = (lo + hi) / 2;
+            if (n.points[mid]->out <= offset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > 0)
+            pt = n.points[lo - 1];
+    }
+
+    if (offset >= s->out && (!pt || pt->out <= s->out))
+        return true;
+
+    ::inflateReset(&s->z);
+    s->z.avail_in = 0;
+    s->eof = false;
+    if (!pt)
+    {
+        s->in = s->out = 0;
+        return true;
+    }
+
+    s->in = pt->in;
+    if (pt->bits)
+    {
+        unsigned char c;
+        if (fetch(&c, 1, n.data + pt->in - 1) != 1)
+        {
+            errno = EIO;
+            return false;
+        }
+        ::inflatePrime(&s->z, pt->bits, c >> (8 - pt->bits));
+    }
+    ::inflateSetDictionary(&s->z, pt->window, WINDOW);
+
+    size_t at = pt->out % WINDOW;
+    ::memcpy(s->window + at, pt->window, WINDOW - at);
+    ::memcpy(s->window, pt->window + WINDOW - at, at);
+    s->out = pt->out;
+    return true;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::advance(node_t &n, stream_t *s)
+{
+    if (s->eof)
+    {
+        errno = EIO;
+        return false;
+    }
+
+    if (s->z.avail_in == 0)
+    {
+        loff_t left = n.csize - s->in;
+        size_t len = left < INPUT ? (size_t)left : (size_t)INPUT;
+        ssize_t r = len > 0 ? fetch(s->input, len, n.data + s->in) : 0;
+        if (r <= 0)
+        {
+            ERR("%s: truncated entry '%.*s'", archive.c_str(), (int)n.namelen, n.name);
+            errno = EIO;
+            return false;
+        }
+        s->z.next_in = s->input;
+        s->z.avail_in = r;
+        s->in += r;
+    }
+
+    size_t at = s->out % WINDOW;
+    s->z.next_out = s->window + at;
+    s->z.avail_out = WINDOW - at;
+    // Z_BLOCK stops at deflate block boundaries, where checkpoints can be made
+    int rc = ::inflate(&s->z, Z_BLOCK);
+    s->out += WINDOW - at - s->z.avail_out;
+
+    if (rc == Z_STREAM_END)
+        s->eof = true;
+    if ((rc != Z_OK && rc != Z_STREAM_END) || s->out > n.usize || (s->eof && s->out != n.usize))
+    {
+        ERR("%s: corrupted entry '%.*s'", archive.c_str(), (int)n.namelen, n.name);
+        errno = EIO;
+        return false;
+    }
+
+    if ((s->z.data_type & 128) && !(s->z.data_type & 64))
+        checkpoint(n, s);
+    return true;
+}
+
+CRYSTAX_LOCAL
+void driver_t::checkpoint(node_t &n, stream_t *s)
+{
+    loff_t distance = n.usize / MAX_CHECKPOINTS;
+    if (distance < (loff_t)span)
+        distance = span;
+
+    scope_lock_t lock(mutex);
+    loff_t last = n.npoints > 0 ? n.points[n.npoints - 1]->out : 0;
+    if (s->out - last < distance)
+        return;
+
+    checkpoint_t **points = (checkpoint_t **)::realloc(n.points, (n.npoints + 1) * sizeof(checkpoint_t *));
+    if (!points)
+        return;
+    n.points = points;
+
+    checkpoint_t *pt = (checkpoint_t *)::malloc(sizeof(checkpoint_t));
+    if (!pt)
+        return;
+    pt->in = s->in - s->z.avail_in;
+    pt->out = s->out;
+    pt->bits = s->z.data_type & 7;
+    size_t at = s->out % WINDOW;
+    ::memcpy(pt->window, s->window + at, WINDOW - at);
+    ::memcpy(pt->window + WINDOW - at, s->window, at);
+    n.points[n.npoints++] = pt;
+}
+
+CRYSTAX_LOCAL
+int driver_t::alloc_fd(file_t *f, int from)
+{
+    for (int fd = from < 0 ? 0 : from; fd < FD_TABLE_SIZE; ++fd)
+    {
+        if (fd_table[fd].file)
+            continue;
+        fd_table[fd].file = f;
+        fd_table[fd].cloexec = false;
+        return fd;
+    }
+
+    errno = EMFILE;
+    return -1;
+}
+
+// Descriptor may be closed by another thread while we read from it, so
+// readers hold a reference until they are done
+CRYSTAX_LOCAL
+driver_t::file_t *driver_t::acquire(int fd)
+{
+    scope_lock_t lock(mutex);
+    if (fd < 0 || fd >= FD_TABLE_SIZE || !fd_table[fd].file)
+    {
+        errno = EBADF;
+        return NULL;
+    }
+    file_t *f = fd_table[fd].file;
+    ++f->refs;
+    return f;
+}
+
+CRYSTAX_LOCAL
+void driver_t::release(file_t *f)
+{
+    scope_lock_t lock(mutex);
+    if (--f->refs > 0)
+        return;
+
+    if (f->stream)
+    {
+        ::inflateEnd(&f->stream->z);
+        ::free(f->stream);
+    }
+    ::pthread_mutex_destroy(&f->mutex);
+    delete f;
+}
+
+CRYSTAX_LOCAL
+unsigned driver_t::child_at(unsigned dir, long index)
+{
+    unsigned c = nodes[dir].child;
+    for (long i = 2; i < index && c != NONE; ++i)
+        c = nodes[c].sibling;
+    return c;
+}
+
+CRYSTAX_LOCAL
+bool driver_t::fill_dirent(unsigned dir, long index, unsigned child, struct dirent *e)
+{
+    const char *name;
+    size_t len;
+    unsigned ino;
+    unsigned char type = DT_DIR;
+    if (index == 0)
+    {
+        name = ".";
+        len = 1;
+        ino = dir;
+    }
+    else if (index == 1)
+    {
+        name = "..";
+        len = 2;
+        ino = nodes[dir].parent;
+    }
+    else if (child == NONE)
+        return false;
+    else
+    {
+        node_t const &n = nodes[child];
+        len = 0;
+        while (len < n.namelen && n.name[n.namelen - len - 1] != '/')
+            ++len;
+        name = n.name + n.namelen - len;
+        ino = child;
+        type = S_ISDIR(n.mode) ? DT_DIR : DT_REG;
+    }
+
+    e->d_ino = ino + 1;
+    e->d_off = index + 1;
+    e->d_reclen = (offsetof(struct dirent, d_name) + len + 1 + 7) & ~(size_t)7;
+    e->d_type = type;
+    ::memcpy(e->d_name, name, len);
+    e->d_name[len] = '\0';
+    return true;
+}
+
+CRYSTAX_LOCAL
+void driver_t::fill_stat(unsigned i, struct stat *st)
+{
+    node_t const &n = nodes[i];
+    ::memset(st, 0, sizeof(*st));
+    st->st_dev = dev;
+    st->st_ino = i + 1;
+    st->st_mode = n.mode;
+    st->st_nlink = S_ISDIR(n.mode) ? 2 : 1;
+    st->st_uid = ::getuid();
+    st->st_gid = ::getgid();
+    st->st_size = S_ISDIR(n.mode) ? 0 : n.usize;
+    st->st_blksize = WINDOW;
+    st->st_blocks = (n.csize + 511) / 512;
+    st->st_atime = st->st_mtime = st->st_ctime = n.mtime;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readonly(const char *path)
+{
+    DBG("path=%s", path);
+    errno = EROFS;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::chown(const char *path, uid_t, gid_t)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::close(int fd)
+{
+    DBG("fd=%d", fd);
+    scope_lock_t lock(mutex);
+    if (fd < 0 || fd >= FD_TABLE_SIZE || !fd_table[fd].file)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    file_t *f = fd_table[fd].file;
+    fd_table[fd].file = NULL;
+    release(f);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::closedir(DIR *dirp)
+{
+    if (!dirp)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    delete (dir_t *)dirp;
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dirfd(DIR * /* dirp */)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup(int fd)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    int fd2 = alloc_fd(f);
+    if (fd2 < 0)
+        release(f);
+    return fd2;
+}
+
+CRYSTAX_LOCAL
+int driver_t::dup2(int fd, int fd2)
+{
+    scope_lock_t lock(mutex);
+    if (fd2 < 0 || fd2 >= FD_TABLE_SIZE)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+    if (fd == fd2)
+    {
+        release(f);
+        return fd2;
+    }
+
+    if (fd_table[fd2].file)
+        release(fd_table[fd2].file);
+    fd_table[fd2].file = f;
+    fd_table[fd2].cloexec = false;
+    return fd2;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fchown(int fd, uid_t, gid_t)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+    release(f);
+    errno = EROFS;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fcntl(int fd, int command, va_list &vl)
+{
+    scope_lock_t lock(mutex);
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    int ret = 0;
+    switch (command)
+    {
+    case F_DUPFD:
+#ifdef F_DUPFD_CLOEXEC
+    case F_DUPFD_CLOEXEC:
+#endif
+        ret = alloc_fd(f, va_arg(vl, int));
+        if (ret < 0)
+            break;
+#ifdef F_DUPFD_CLOEXEC
+        fd_table[ret].cloexec = command == F_DUPFD_CLOEXEC;
+#endif
+        // The new descriptor keeps the reference
+        return ret;
+    case F_GETFD:
+        ret = fd_table[fd].cloexec ? FD_CLOEXEC : 0;
+        break;
+    case F_SETFD:
+        fd_table[fd].cloexec = (va_arg(vl, int) & FD_CLOEXEC) != 0;
+        break;
+    case F_GETFL:
+        ret = f->oflag;
+        break;
+    case F_SETFL:
+        f->oflag = (f->oflag & ~O_NONBLOCK) | (va_arg(vl, int) & O_NONBLOCK);
+        break;
+    case F_GETLK:
+        va_arg(vl, struct flock *)->l_type = F_UNLCK;
+        break;
+    case F_SETLK:
+    case F_SETLKW:
+        break;
+    default:
+        errno = EINVAL;
+        ret = -1;
+    }
+
+    release(f);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fdatasync(int fd)
+{
+    return fsync(fd);
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::fdopendir(int fd)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return NULL;
+
+    unsigned i = f->node;
+    release(f);
+    if (!S_ISDIR(nodes[i].mode))
+    {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    dir_t *d = new dir_t;
+    d->node = i;
+    d->next = nodes[i].child;
+    d->index = 0;
+    return (DIR *)d;
+}
+
+CRYSTAX_LOCAL
+int driver_t::flock(int fd, int /* operation */)
+{
+    return fsync(fd);
+}
+
+CRYSTAX_LOCAL
+int driver_t::fstat(int fd, struct stat *st)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    fill_stat(f->node, st);
+    release(f);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::fsync(int fd)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+    release(f);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::ftruncate(int fd, off_t /* offset */)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+    release(f);
+    errno = EINVAL;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::getdents(unsigned int fd, struct dirent *entry, unsigned int count)
+{
+    file_t *f = acquire((int)fd);
+    if (!f)
+        return -1;
+
+    unsigned dir = f->node;
+    if (!S_ISDIR(nodes[dir].mode))
+    {
+        release(f);
+        errno = ENOTDIR;
+        return -1;
+    }
+
+    char *buf = (char *)entry;
+    size_t off = 0;
+    bool full = false;
+    {
+        scope_lock_t lock(f->mutex);
+        for (;;)
+        {
+            long index = f->pos;
+            unsigned child = NONE;
+            if (index >= 2)
+                child = f->dirpos == index ? f->dirnext : child_at(dir, index);
+
+            struct dirent e;
+            if (!fill_dirent(dir, index, child, &e))
+                break;
+            if (off + e.d_reclen > count)
+            {
+                full = true;
+                break;
+            }
+
+            ::memcpy(buf + off, &e, e.d_reclen);
+            off += e.d_reclen;
+            f->pos = index + 1;
+            if (index >= 2)
+            {
+                f->dirnext = nodes[child].sibling;
+                f->dirpos = index + 1;
+            }
+        }
+    }
+
+    release(f);
+    if (off == 0 && full)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return off;
+}
+
+CRYSTAX_LOCAL
+int driver_t::ioctl(int fd, int request, va_list &vl)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    int ret = 0;
+    node_t const &n = nodes[f->node];
+    if (request == FIONREAD && !S_ISDIR(n.mode))
+        *va_arg(vl, int *) = f->pos < n.usize ? (int)(n.usize - f->pos) : 0;
+    else
+    {
+        errno = ENOTTY;
+        ret = -1;
+    }
+
+    release(f);
+    return ret;
+}
+
+CRYSTAX_LOCAL
+int driver_t::lchown(const char *path, uid_t, gid_t)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::link(const char *src, const char * /* dst */)
+{
+    return readonly(src);
+}
+
+CRYSTAX_LOCAL
+off_t driver_t::lseek(int fd, off_t offset, int whence)
+{
+    return lseek64(fd, offset, whence);
+}
+
+CRYSTAX_LOCAL
+loff_t driver_t::lseek64(int fd, loff_t offset, int whence)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    node_t const &n = nodes[f->node];
+    loff_t pos;
+    {
+        scope_lock_t lock(f->mutex);
+        switch (whence)
+        {
+        case SEEK_SET: pos = offset; break;
+        case SEEK_CUR: pos = f->pos + offset; break;
+        case SEEK_END: pos = n.usize + offset; break;
+        default: pos = -1;
+        }
+        // Position of directory is index of the next entry for getdents()
+        if (S_ISDIR(n.mode) && whence != SEEK_SET)
+            pos = -1;
+        if (pos >= 0)
+            f->pos = pos;
+    }
+
+    release(f);
+    if (pos < 0)
+        errno = EINVAL;
+    return pos;
+}
+
+CRYSTAX_LOCAL
+int driver_t::lstat(const char *path, struct stat *st)
+{
+    return stat(path, st);
+}
+
+CRYSTAX_LOCAL
+int driver_t::mkdir(const char *path, mode_t)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+void *driver_t::mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    DBG("fd=%d, length=%lu, offset=%ld", fd, (unsigned long)length, (long)offset);
+
+    file_t *f = acquire(fd);
+    if (!f)
+        return MAP_FAILED;
+
+    node_t const &n = nodes[f->node];
+    size_t page = ::sysconf(_SC_PAGESIZE);
+    void *p = MAP_FAILED;
+    if (S_ISDIR(n.mode))
+        errno = ENODEV;
+    else if (offset < 0 || offset % page != 0 || length == 0)
+        errno = EINVAL;
+    else if ((flags & MAP_SHARED) && (prot & PROT_WRITE))
+        errno = EACCES;
+    else
+    {
+        loff_t avail = offset < n.usize ? n.usize - offset : 0;
+
+        if (n.method == METHOD_STORED && (n.data + offset) % page == 0)
+        {
+            // Page aligned stored entry (zipalign -p) maps straight from
+            // the archive
+            p = src->mmap(addr, length, prot, flags, srcfd, n.data + offset);
+            if (p != MAP_FAILED && (loff_t)length > avail)
+            {
+                // Past the end of entry there must be zeros, not the rest
+                // of the archive
+                size_t keep = avail & ~(loff_t)(page - 1);
+                char *tail = (char *)system_mmap((char *)p + keep, length - keep, prot | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+                if (tail == MAP_FAILED ||
+                    fetch(tail, avail - keep, n.data + offset + keep) != (ssize_t)(avail - keep))
+                {
+                    ::munmap(p, length);
+                    p = MAP_FAILED;
+                    errno = EIO;
+                }
+                else if (!(prot & PROT_WRITE))
+                    ::mprotect(tail, length - keep, prot);
+            }
+        }
+        else
+        {
+            p = system_mmap(addr, length, prot | PROT_WRITE,
+                (flags & ~MAP_SHARED) | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            size_t len = avail < (loff_t)length ? (size_t)avail : length;
+            if (p != MAP_FAILED && len > 0 && do_read(f, p, len, offset) != (ssize_t)len)
+            {
+                ::munmap(p, length);
+                p = MAP_FAILED;
+                errno = EIO;
+            }
+            else if (p != MAP_FAILED && !(prot & PROT_WRITE))
+                ::mprotect(p, length, prot);
+        }
+    }
+
+    release(f);
+    return p;
+}
+
+CRYSTAX_LOCAL
+int driver_t::open(const char *path, int oflag, va_list & /* vl */)
+{
+    DBG("path=%s, oflag=%d", path, oflag);
+
+    scope_lock_t lock(mutex);
+
+    unsigned i = lookup(path);
+    if (i == NONE)
+    {
+        if (oflag & O_CREAT)
+            errno = EROFS;
+        return -1;
+    }
+
+    node_t &n = nodes[i];
+    if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+    {
+        errno = EEXIST;
+        return -1;
+    }
+    if (S_ISDIR(n.mode) && (oflag & O_ACCMODE) != O_RDONLY)
+    {
+        errno = EISDIR;
+        return -1;
+    }
+    if ((oflag & O_ACCMODE) != O_RDONLY || (oflag & O_TRUNC))
+    {
+        errno = EROFS;
+        return -1;
+    }
+    if ((oflag & O_DIRECTORY) && !S_ISDIR(n.mode))
+    {
+        errno = ENOTDIR;
+        return -1;
+    }
+    if (!S_ISDIR(n.mode))
+    {
+        if (n.flags & FLAG_ENCRYPTED)
+        {
+            errno = EACCES;
+            return -1;
+        }
+        if (n.method != METHOD_STORED && n.method != METHOD_DEFLATED)
+        {
+            ERR("%s: '%s' is compressed with unsupported method %u", archive.c_str(), path, n.method);
+            errno = ENOTSUP;
+            return -1;
+        }
+        if (!locate(n))
+            return -1;
+    }
+
+    file_t *f = new file_t;
+    f->node = i;
+    f->pos = 0;
+    f->oflag = oflag;
+    f->refs = 1;
+    f->dirnext = NONE;
+    f->dirpos = -1;
+    f->stream = NULL;
+    init_mutex(&f->mutex);
+
+    int fd = alloc_fd(f);
+    if (fd < 0)
+    {
+        release(f);
+        return -1;
+    }
+#ifdef O_CLOEXEC
+    fd_table[fd].cloexec = (oflag & O_CLOEXEC) != 0;
+#endif
+
+    DBG("return fd=%d", fd);
+    return fd;
+}
+
+CRYSTAX_LOCAL
+DIR *driver_t::opendir(const char *dirpath)
+{
+    DBG("dirpath=%s", dirpath);
+
+    unsigned i;
+    {
+        scope_lock_t lock(mutex);
+        i = lookup(dirpath);
+    }
+    if (i == NONE)
+        return NULL;
+    if (!S_ISDIR(nodes[i].mode))
+    {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    dir_t *d = new dir_t;
+    d->node = i;
+    d->next = nodes[i].child;
+    d->index = 0;
+    return (DIR *)d;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pread(int fd, void *buf, size_t count, off_t offset)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    ssize_t n = do_read(f, buf, count, offset);
+    release(f);
+    return n;
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::pwrite(int fd, const void *, size_t, off_t)
+{
+    return write(fd, NULL, 0);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::read(int fd, void *buf, size_t count)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    ssize_t n;
+    {
+        scope_lock_t lock(f->mutex);
+        n = do_read(f, buf, count, f->pos);
+        if (n > 0)
+            f->pos += n;
+    }
+
+    release(f);
+    return n;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readv(int fd, const struct iovec *iov, int count)
+{
+    file_t *f = acquire(fd);
+    if (!f)
+        return -1;
+
+    ssize_t total = 0;
+    {
+        scope_lock_t lock(f->mutex);
+        for (int i = 0; i < count; ++i)
+        {
+            ssize_t n = do_read(f, iov[i].iov_base, iov[i].iov_len, f->pos);
+            if (n < 0)
+            {
+                if (total == 0)
+                    total = -1;
+                break;
+            }
+            f->pos += n;
+            total += n;
+            if ((size_t)n < iov[i].iov_len)
+                break;
+        }
+    }
+
+    release(f);
+    return total;
+}
+
+CRYSTAX_LOCAL
+struct dirent *driver_t::readdir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    struct dirent *result;
+    if (!d || readdir_r(dirp, &d->entry, &result) != 0)
+        return NULL;
+    return result;
+}
+
+// Index is immutable once mounted, so directory streams need no locking
+CRYSTAX_LOCAL
+int driver_t::readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+        return EBADF;
+
+    if (!fill_dirent(d->node, d->index, d->next, entry))
+    {
+        *result = NULL;
+        return 0;
+    }
+
+    if (d->index >= 2)
+        d->next = nodes[d->next].sibling;
+    ++d->index;
+    *result = entry;
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::readlink(const char *path, char *, size_t)
+{
+    scope_lock_t lock(mutex);
+    if (lookup(path) != NONE)
+        errno = EINVAL;
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::remove(const char *path)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::rename(const char *oldpath, const char * /* newpath */)
+{
+    return readonly(oldpath);
+}
+
+CRYSTAX_LOCAL
+void driver_t::rewinddir(DIR *dirp)
+{
+    seekdir(dirp, 0);
+}
+
+CRYSTAX_LOCAL
+int driver_t::rmdir(const char *path)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+int driver_t::scandir(const char *dir, struct dirent ***namelist, int (*filter)(const struct dirent *),
+    int (*compar)(const struct dirent **, const struct dirent **))
+{
+    DIR *dirp = opendir(dir);
+    if (!dirp)
+        return -1;
+
+    struct dirent **list = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+    for (struct dirent *e; (e = readdir(dirp)) != NULL;)
+    {
+        if (filter && !filter(e))
+            continue;
+
+        if (count == cap)
+        {
+            cap = cap ? cap * 2 : 16;
+            struct dirent **p = (struct dirent **)::realloc(list, cap * sizeof(*list));
+            if (!p)
+                break;
+            list = p;
+        }
+
+        struct dirent *copy = (struct dirent *)::malloc(sizeof(struct dirent));
+        if (!copy)
+            break;
+        ::memcpy(copy, e, e->d_reclen);
+        list[count++] = copy;
+    }
+    closedir(dirp);
+
+    if (compar && count > 1)
+        ::qsort(list, count, sizeof(*list), (int (*)(const void *, const void *))compar);
+
+    *namelist = list;
+    return count;
+}
+
+CRYSTAX_LOCAL
+void driver_t::seekdir(DIR *dirp, long offset)
+{
+    dir_t *d = (dir_t *)dirp;
+    if (!d)
+        return;
+
+    d->index = offset < 0 ? 0 : offset;
+    d->next = d->index >= 2 ? child_at(d->node, d->index) : nodes[d->node].child;
+}
+
+CRYSTAX_LOCAL
+int driver_t::select(int maxfd, fd_set *rfd, fd_set *wfd, fd_set *efd, struct timeval *tv)
+{
+    return underlying()->select(maxfd, rfd, wfd, efd, tv);
+}
+
+CRYSTAX_LOCAL
+int driver_t::stat(const char *path, struct stat *st)
+{
+    unsigned i;
+    {
+        scope_lock_t lock(mutex);
+        i = lookup(path);
+    }
+    if (i == NONE)
+        return -1;
+
+    fill_stat(i, st);
+    return 0;
+}
+
+CRYSTAX_LOCAL
+int driver_t::symlink(const char * /* src */, const char *dst)
+{
+    return readonly(dst);
+}
+
+CRYSTAX_LOCAL
+long driver_t::telldir(DIR *dirp)
+{
+    dir_t *d = (dir_t *)dirp;
+    return d ? d->index : -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::unlink(const char *path)
+{
+    return readonly(path);
+}
+
+CRYSTAX_LOCAL
+ssize_t driver_t::write(int fd, const void *, size_t)
+{
+    file_t *f = acquire(fd);
+    if (f)
+    {
+        release(f);
+        errno = EBADF;
+    }
+    return -1;
+}
+
+CRYSTAX_LOCAL
+int driver_t::writev(int fd, const struct iovec *, int)
+{
+    return write(fd, NULL, 0);
+}
+
+} // namespace zip
+} // namespace fileio
+} // namespace crystax
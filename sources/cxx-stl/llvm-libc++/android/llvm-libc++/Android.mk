@@ -11,6 +11,7 @@ llvm_libc++_sources := \
 	chrono.cpp \
 	condition_variable.cpp \
 	debug.cpp \
+	execution.cpp \
 	exception.cpp \
 	future.cpp \
 	hash.cpp \
@@ -27,10 +28,19 @@ llvm_libc++_sources := \
 	strstream.cpp \
 	system_error.cpp \
 	thread.cpp \
+	thread_pool.cpp \
 	typeinfo.cpp \
 	utility.cpp \
 	valarray.cpp
 
+# valarray.cpp calls the NEON kernels after checking the CPU with
+# cpufeatures, so only this file is built with NEON on armeabi-v7a.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+llvm_libc++_sources += valarray_neon.cpp.neon
+else
+llvm_libc++_sources += valarray_neon.cpp
+endif
+
 llvm_libc++_sources += \
     support/android/locale_support.c \
     support/android/nl_types_support.c \
@@ -53,6 +63,7 @@ LOCAL_SRC_FILES += $(libgabi++_src_files:%=../gabi++/%)
 LOCAL_C_INCLUDES := $(llvm_libc++_includes)
 LOCAL_CPPFLAGS := $(llvm_libc++_cxxflags)
 LOCAL_CPP_FEATURES := rtti exceptions
+LOCAL_STATIC_LIBRARIES := cpufeatures
 LOCAL_EXPORT_C_INCLUDES := $(llvm_libc++_export_includes)
 LOCAL_EXPORT_CPPFLAGS := $(llvm_libc++_export_cxxflags)
 include $(BUILD_STATIC_LIBRARY)
@@ -64,6 +75,9 @@ LOCAL_SRC_FILES += $(libgabi++_src_files:%=../gabi++/%)
 LOCAL_C_INCLUDES := $(llvm_libc++_includes)
 LOCAL_CPPFLAGS := $(llvm_libc++_cxxflags) -DGABIXX_LIBCXX=1 -DLIBCXXRT=1
 LOCAL_CPP_FEATURES := rtti exceptions
+LOCAL_STATIC_LIBRARIES := cpufeatures
 LOCAL_EXPORT_C_INCLUDES := $(llvm_libc++_export_includes)
 LOCAL_EXPORT_CPPFLAGS := $(llvm_libc++_export_cxxflags)
 include $(BUILD_SHARED_LIBRARY)
+
+$(call import-module,android/cpufeatures)
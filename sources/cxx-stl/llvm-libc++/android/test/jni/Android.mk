@@ -16,4 +16,65 @@ LOCAL_SRC_FILES := test_1.cc
 LOCAL_STATIC_LIBRARIES := llvm_libc++_static
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_async
+LOCAL_SRC_FILES := bench_async.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_shared_ptr_atomic
+LOCAL_SRC_FILES := bench_shared_ptr_atomic.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_regex
+LOCAL_SRC_FILES := bench_regex.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_shared_mutex
+LOCAL_SRC_FILES := bench_shared_mutex.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_random_device
+LOCAL_SRC_FILES := bench_random_device.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_flat_hash_map
+LOCAL_SRC_FILES := bench_flat_hash_map.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_parallel
+LOCAL_SRC_FILES := bench_parallel.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_valarray
+LOCAL_SRC_FILES := bench_valarray.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_debug_db
+LOCAL_SRC_FILES := bench_debug_db.cc
+LOCAL_CPPFLAGS := -D_LIBCPP_DEBUG2=1
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_debug_db_release
+LOCAL_SRC_FILES := bench_debug_db.cc
+LOCAL_STATIC_LIBRARIES := llvm_libc++_static
+include $(BUILD_EXECUTABLE)
+
 include $(LOCAL_PATH)/../../llvm-libc++/Android.mk
@@ -0,0 +1,55 @@
+// -*- C++ -*-
+//===--------------------------- bench_async.cc ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Spawn and join latency of std::async with a thread per task
+// (launch::async) versus the shared pool (launch::__pool).
+
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static int work(int i) {
+  return i * 2;
+}
+
+static void bench(const char* name, std::launch policy, int tasks) {
+  std::vector<std::future<int> > futures;
+  futures.reserve(tasks);
+
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < tasks; ++i)
+    futures.push_back(std::async(policy, work, i));
+  Clock::time_point t1 = Clock::now();
+  long sum = 0;
+  for (int i = 0; i < tasks; ++i)
+    sum += futures[i].get();
+  Clock::time_point t2 = Clock::now();
+
+  typedef std::chrono::duration<double, std::micro> us;
+  std::printf("%-8s %6d tasks: spawn %8.2f us/task, join %8.2f us/task, "
+              "total %10.0f us (sum %ld)\n",
+              name, tasks,
+              us(t1 - t0).count() / tasks,
+              us(t2 - t1).count() / tasks,
+              us(t2 - t0).count(), sum);
+}
+
+int main(void) {
+  std::printf("hardware_concurrency: %u\n", std::thread::hardware_concurrency());
+  const int sizes[] = {10, 100, 1000, 10000};
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    bench("async", std::launch::async, sizes[i]);
+    bench("pool", std::launch::__pool, sizes[i]);
+  }
+  return 0;
+}
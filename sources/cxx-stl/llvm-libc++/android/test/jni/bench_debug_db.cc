@@ -0,0 +1,72 @@
+// -*- C++ -*-
+//===------------------------ bench_debug_db.cc ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Container and iterator churn on independent containers, one set per
+// thread. Built twice: bench_debug_db with _LIBCPP_DEBUG2, where every
+// iterator is tracked by the debug database, and bench_debug_db_release
+// without it. Compare the two outputs for the cost of checked builds; the
+// checked times should grow little with the thread count. Times are in
+// milliseconds for the whole run.
+
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> ms;
+
+static const int rounds = 20000;
+
+static void work(unsigned seed, long* out) {
+  long sum = 0;
+  for (int r = 0; r < rounds; ++r) {
+    std::vector<int> v;
+    for (int i = 0; i < 32; ++i)
+      v.push_back(static_cast<int>(seed) + i);
+    for (std::vector<int>::const_iterator i = v.begin(); i != v.end(); ++i)
+      sum += *i;
+    std::vector<int>::iterator mid = v.begin() + 16;
+    sum += mid[3];
+    v.erase(mid, v.end());
+    std::list<int> l(v.begin(), v.end());
+    std::list<int> m(8, r);
+    l.splice(l.begin(), m);
+    for (std::list<int>::iterator i = l.begin(); i != l.end(); ++i)
+      sum += *i;
+  }
+  *out = sum;
+}
+
+int main(void) {
+#ifdef _LIBCPP_DEBUG2
+  const char* mode = "checked";
+#else
+  const char* mode = "release";
+#endif
+  unsigned max = std::thread::hardware_concurrency();
+  if (max == 0)
+    max = 1;
+  std::printf("%-8s %8s %10s\n", mode, "threads", "ms");
+  for (unsigned t = 1;; t = t * 2 < max ? t * 2 : max) {
+    std::vector<std::thread> threads;
+    std::vector<long> sums(t);
+    Clock::time_point t0 = Clock::now();
+    for (unsigned i = 0; i < t; ++i)
+      threads.push_back(std::thread(work, i, &sums[i]));
+    for (unsigned i = 0; i < t; ++i)
+      threads[i].join();
+    std::printf("%-8s %8u %10.1f\n", "", t, ms(Clock::now() - t0).count());
+    if (t == max)
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// -*- C++ -*-
+//===----------------------- bench_flat_hash_map.cc -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// __gnu_cxx::flat_hash_map against std::unordered_map on integer and string
+// keys: inserting n keys, looking up present and absent keys, and erasing
+// every key, for table sizes from L1 resident to well past the caches.
+
+#include <chrono>
+#include <cstdio>
+#include <ext/flat_hash_map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::nano> ns;
+
+struct Times {
+  double insert, hit, miss, erase;
+};
+
+static unsigned next(unsigned& x) {
+  x = x * 1664525 + 1013904223;
+  return x;
+}
+
+template <class Map, class Key>
+static Times run(const std::vector<Key>& keys, const std::vector<Key>& absent) {
+  Times t;
+  Map m;
+  size_t n = keys.size();
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < n; ++i)
+    m[keys[i]] = i;
+  t.insert = ns(Clock::now() - t0).count() / n;
+
+  const size_t lookups = 2000000;
+  size_t found = 0;
+  t0 = Clock::now();
+  for (size_t i = 0, j = 0; i < lookups; ++i, j = j + 1 == n ? 0 : j + 1)
+    found += m.find(keys[j]) != m.end();
+  t.hit = ns(Clock::now() - t0).count() / lookups;
+  t0 = Clock::now();
+  for (size_t i = 0, j = 0; i < lookups; ++i, j = j + 1 == n ? 0 : j + 1)
+    found += m.find(absent[j]) != m.end();
+  t.miss = ns(Clock::now() - t0).count() / lookups;
+  if (found != lookups)
+    std::printf("lookup mismatch %zu\n", found);
+
+  t0 = Clock::now();
+  for (size_t i = 0; i < n; ++i)
+    m.erase(keys[i]);
+  t.erase = ns(Clock::now() - t0).count() / n;
+  if (!m.empty())
+    std::printf("erase mismatch\n");
+  return t;
+}
+
+static void report(const char* what, size_t n, const Times& f, const Times& u) {
+  std::printf("%-7s %8zu  %6.1f %6.1f  %6.1f %6.1f  %6.1f %6.1f  %6.1f %6.1f\n",
+              what, n, f.insert, u.insert, f.hit, u.hit, f.miss, u.miss,
+              f.erase, u.erase);
+}
+
+int main(void) {
+  std::printf("ns/op, flat then unordered\n");
+  std::printf("%-7s %8s  %13s  %13s  %13s  %13s\n", "keys", "n", "insert",
+              "hit", "miss", "erase");
+  const size_t sizes[] = {1000, 100000, 1000000};
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    size_t n = sizes[s];
+    unsigned x = 1;
+    std::vector<unsigned> keys(n), absent(n);
+    for (size_t i = 0; i < n; ++i) {
+      keys[i] = next(x) << 1;         // even keys are present
+      absent[i] = next(x) << 1 | 1;   // odd keys never are
+    }
+    report("int", n,
+           run<__gnu_cxx::flat_hash_map<unsigned, size_t> >(keys, absent),
+           run<std::unordered_map<unsigned, size_t> >(keys, absent));
+
+    std::vector<std::string> skeys(n), sabsent(n);
+    for (size_t i = 0; i < n; ++i) {
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), "symbol_%u", keys[i]);
+      skeys[i] = buf;
+      std::snprintf(buf, sizeof(buf), "symbol_%u", absent[i]);
+      sabsent[i] = buf;
+    }
+    report("string", n,
+           run<__gnu_cxx::flat_hash_map<std::string, size_t> >(skeys, sabsent),
+           run<std::unordered_map<std::string, size_t> >(skeys, sabsent));
+  }
+  return 0;
+}
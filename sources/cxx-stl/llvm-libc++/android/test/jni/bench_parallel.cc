@@ -0,0 +1,87 @@
+// -*- C++ -*-
+//===------------------------ bench_parallel.cc ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Scaling of the execution::par algorithms from one thread up to every core.
+// The thread count is capped with __libcpp_set_parallelism; the first row is
+// the sequential algorithm. Times are in milliseconds for `n` elements.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> ms;
+
+static std::vector<unsigned> input(size_t n) {
+  std::vector<unsigned> v(n);
+  unsigned x = 12345;
+  for (size_t i = 0; i < n; ++i) {
+    x = x * 1103515245 + 12345;
+    v[i] = x >> 4;
+  }
+  return v;
+}
+
+struct scaled {
+  unsigned operator()(unsigned x) const { return x * 3 + 1; }
+};
+
+template <class F>
+static double time(F f) {
+  Clock::time_point t0 = Clock::now();
+  f();
+  return ms(Clock::now() - t0).count();
+}
+
+template <class Policy>
+static void run(const Policy& policy, const char* name, size_t n) {
+  const std::vector<unsigned> in = input(n);
+  std::vector<unsigned> v(in);
+  std::vector<unsigned> out(n);
+  double sort = time([&] { std::sort(policy, v.begin(), v.end()); });
+  v = in;
+  double stable = time([&] { std::stable_sort(policy, v.begin(), v.end()); });
+  unsigned long long sum = 0;
+  double reduce = time([&] {
+    sum = std::reduce(policy, in.begin(), in.end(), 0ULL);
+  });
+  double scan = time([&] {
+    std::inclusive_scan(policy, in.begin(), in.end(), out.begin());
+  });
+  double transform = time([&] {
+    std::transform(policy, in.begin(), in.end(), out.begin(), scaled());
+  });
+  std::printf("%7s %10.1f %12.1f %10.1f %10.1f %10.1f\n", name, sort, stable,
+              reduce, scan, transform);
+  if (sum == 0)
+    std::printf("unexpected\n");
+}
+
+int main(void) {
+  const size_t n = 10000000;
+  std::printf("%7s %10s %12s %10s %10s %10s\n", "threads", "sort",
+              "stable_sort", "reduce", "scan", "transform");
+  run(std::execution::seq, "seq", n);
+  unsigned max = std::__libcpp_parallelism();
+  for (unsigned t = 1;; t = t * 2 < max ? t * 2 : max) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%u", t);
+    std::__libcpp_set_parallelism(t);
+    run(std::execution::par, name, n);
+    if (t == max)
+      break;
+  }
+  std::__libcpp_set_parallelism(0);
+  return 0;
+}
@@ -0,0 +1,99 @@
+// -*- C++ -*-
+//===----------------------- bench_random_device.cc -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// random_device throughput: single draws, bulk generate() and seeding
+// mt19937 engines through seed_seq, against a plain read() of /dev/urandom
+// per 32-bit value (what operator() used to cost), with 1 to 8 threads
+// sharing one device.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::nano> ns;
+
+static double raw_read(int n) {
+  int f = open("/dev/urandom", O_RDONLY);
+  unsigned sum = 0;
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < n; ++i) {
+    unsigned r;
+    if (read(f, &r, sizeof(r)) != sizeof(r))
+      std::printf("short read\n");
+    sum += r;
+  }
+  double d = ns(Clock::now() - t0).count() / n;
+  close(f);
+  if (sum == 1)
+    std::printf("unexpected\n");
+  return d;
+}
+
+static double draw(std::random_device& rd, int threads, int n) {
+  Clock::time_point t0 = Clock::now();
+  std::vector<std::thread> v;
+  for (int t = 0; t < threads; ++t) {
+    v.push_back(std::thread([&] {
+      unsigned sum = 0;
+      for (int i = 0; i < n; ++i)
+        sum += rd();
+      if (sum == 1)
+        std::printf("unexpected\n");
+    }));
+  }
+  for (int t = 0; t < threads; ++t)
+    v[t].join();
+  return ns(Clock::now() - t0).count() / (double(n) * threads);
+}
+
+static double bulk(std::random_device& rd, int n) {
+  std::vector<unsigned> buf(4096);
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < n; i += buf.size())
+    rd.generate(buf.begin(), buf.end());
+  return ns(Clock::now() - t0).count() / n;
+}
+
+static double seed(std::random_device& rd, int engines) {
+  unsigned sum = 0;
+  Clock::time_point t0 = Clock::now();
+  for (int i = 0; i < engines; ++i) {
+    unsigned s[8];
+    for (int j = 0; j < 8; ++j)
+      s[j] = rd();
+    std::seed_seq seq(s, s + 8);
+    std::mt19937 e(seq);
+    sum += e();
+  }
+  if (sum == 1)
+    std::printf("unexpected\n");
+  return ns(Clock::now() - t0).count() / engines;
+}
+
+int main(void) {
+  const int n = 1 << 20;
+  std::random_device rd;
+  std::printf("%-22s %10.1f ns/value\n", "read() per value", raw_read(n / 16));
+  const int threads[] = {1, 2, 4, 8};
+  for (unsigned i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "operator() x%d", threads[i]);
+    std::printf("%-22s %10.1f ns/value\n", name, draw(rd, threads[i], n));
+  }
+  std::printf("%-22s %10.1f ns/value\n", "generate()", bulk(rd, n));
+  std::printf("%-22s %10.1f ns/engine\n", "seed mt19937", seed(rd, 10000));
+  std::printf("entropy %g\n", rd.entropy());
+  return 0;
+}
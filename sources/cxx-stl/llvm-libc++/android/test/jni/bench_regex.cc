@@ -0,0 +1,98 @@
+// -*- C++ -*-
+//===---------------------------- bench_regex.cc --------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// regex_search throughput over synthetic log lines, and matching time for
+// expressions that are exponential for a backtracking matcher.  Every
+// expression here is free of back references, so all of them go through
+// the lock step matcher; the "backref" row shows the backtracker for
+// comparison on the same input.
+
+#include <chrono>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> ms;
+
+static std::vector<std::string> make_log(int lines) {
+  static const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+  static const char* const tags[] = {"ActivityManager", "dalvikvm", "vold",
+                                     "NetworkStats", "WifiService"};
+  std::vector<std::string> log;
+  char buf[256];
+  for (int i = 0; i < lines; ++i) {
+    std::snprintf(buf, sizeof(buf),
+                  "2013-04-%02d 12:%02d:%02d.%03d %5d %s %s: request %d took "
+                  "%d ms from 10.0.%d.%d",
+                  i % 28 + 1, i % 60, (i * 7) % 60, i % 1000, 1000 + i % 5000,
+                  levels[i % 4], tags[i % 5], i, (i * 31) % 977, i % 256,
+                  (i * 13) % 256);
+    log.push_back(buf);
+  }
+  return log;
+}
+
+static void throughput(const char* name, const char* pattern,
+                       std::regex::flag_type flags,
+                       const std::vector<std::string>& log) {
+  std::regex re(pattern, flags);
+  size_t bytes = 0;
+  int hits = 0;
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < log.size(); ++i) {
+    bytes += log[i].size();
+    if (std::regex_search(log[i], re))
+      ++hits;
+  }
+  double t = ms(Clock::now() - t0).count();
+  std::printf("%-10s %-40s %7d hits %8.2f MB/s\n", name, pattern, hits,
+              bytes / (t * 1000.0));
+}
+
+static void worst_case(const char* name, std::string pattern,
+                       const std::string& subject) {
+  std::regex re(pattern);
+  std::smatch m;
+  Clock::time_point t0 = Clock::now();
+  bool found = std::regex_search(subject, m, re);
+  double t = ms(Clock::now() - t0).count();
+  std::printf("%-10s n=%-4d %-5s %10.3f ms\n", name, (int)subject.size(),
+              found ? "match" : "no", t);
+}
+
+int main(void) {
+  std::vector<std::string> log = make_log(20000);
+
+  throughput("literal", "WifiService", std::regex::ECMAScript, log);
+  throughput("class", "took [0-9]{3} ms", std::regex::ECMAScript, log);
+  throughput("alternate", "(ERROR|WARN) (vold|dalvikvm)",
+             std::regex::ECMAScript, log);
+  throughput("anchored", "^2013-04-1[0-9] ", std::regex::ECMAScript, log);
+  throughput("ip", "10\\.0\\.([0-9]+)\\.25[0-5]$", std::regex::ECMAScript,
+             log);
+  throughput("posix", "(ERROR|WARN).*ms", std::regex::extended, log);
+  throughput("backref", "(ERROR|WARN) \\1", std::regex::ECMAScript, log);
+
+  for (int n = 8; n <= 64; n *= 2) {
+    // (a?){n}a{n} against a^n
+    std::string p;
+    for (int i = 0; i < n; ++i)
+      p += "a?";
+    p += std::string(n, 'a');
+    worst_case("a?^na^n", p, std::string(n, 'a'));
+  }
+  for (int n = 16; n <= 4096; n *= 4) {
+    worst_case("(a|aa)*b", "(a|aa)*b", std::string(n, 'a'));
+    worst_case("(x+x+)+y", "(x+x+)+y", std::string(n, 'x'));
+  }
+  return 0;
+}
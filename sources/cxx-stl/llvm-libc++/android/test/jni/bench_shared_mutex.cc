@@ -0,0 +1,112 @@
+// -*- C++ -*-
+//===------------------------ bench_shared_mutex.cc -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Read-mostly contention on shared_timed_mutex against a plain mutex: readers
+// take the lock around a short critical section while one writer in every
+// `ratio` operations takes it exclusively. A second table measures call_once
+// on many independent flags, which used to serialize on one global mutex.
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::nano> ns;
+
+struct Shared {
+  std::shared_timed_mutex m;
+  void read_lock() { m.lock_shared(); }
+  void read_unlock() { m.unlock_shared(); }
+  void write_lock() { m.lock(); }
+  void write_unlock() { m.unlock(); }
+};
+
+struct Exclusive {
+  std::mutex m;
+  void read_lock() { m.lock(); }
+  void read_unlock() { m.unlock(); }
+  void write_lock() { m.lock(); }
+  void write_unlock() { m.unlock(); }
+};
+
+template <class Lock>
+static double run(int threads, int ratio, int ops) {
+  Lock lock;
+  volatile long data[8] = {0};
+  Clock::time_point t0 = Clock::now();
+  std::vector<std::thread> v;
+  for (int t = 0; t < threads; ++t) {
+    v.push_back(std::thread([&, t] {
+      long sum = 0;
+      for (int i = 0; i < ops; ++i) {
+        if ((i + t) % ratio == 0) {
+          lock.write_lock();
+          for (int j = 0; j < 8; ++j)
+            ++data[j];
+          lock.write_unlock();
+        } else {
+          lock.read_lock();
+          for (int j = 0; j < 8; ++j)
+            sum += data[j];
+          lock.read_unlock();
+        }
+      }
+      if (sum < 0)
+        std::printf("unexpected\n");
+    }));
+  }
+  for (int t = 0; t < threads; ++t)
+    v[t].join();
+  return ns(Clock::now() - t0).count() / (double(ops) * threads);
+}
+
+static double run_once(int threads, int flags) {
+  std::vector<std::once_flag> once(flags);
+  std::vector<int> hits(flags);
+  Clock::time_point t0 = Clock::now();
+  std::vector<std::thread> v;
+  for (int t = 0; t < threads; ++t) {
+    v.push_back(std::thread([&, t] {
+      for (int i = 0; i < flags; ++i) {
+        int k = (i + t * (flags / threads)) % flags;
+        std::call_once(once[k], [&hits, k] { ++hits[k]; });
+      }
+    }));
+  }
+  for (int t = 0; t < threads; ++t)
+    v[t].join();
+  double r = ns(Clock::now() - t0).count() / (double(flags) * threads);
+  for (int i = 0; i < flags; ++i)
+    if (hits[i] != 1)
+      std::printf("call_once ran %d times\n", hits[i]);
+  return r;
+}
+
+int main(void) {
+  const int ops = 200000;
+  const int threads[] = {1, 2, 4, 8};
+  const int ratios[] = {10, 100, 1000};
+  std::printf("%7s %6s %14s %14s\n", "threads", "ratio", "shared ns/op",
+              "mutex ns/op");
+  for (unsigned r = 0; r < sizeof(ratios) / sizeof(ratios[0]); ++r) {
+    for (unsigned i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+      double s = run<Shared>(threads[i], ratios[r], ops);
+      double m = run<Exclusive>(threads[i], ratios[r], ops);
+      std::printf("%7d %6d %14.1f %14.1f\n", threads[i], ratios[r], s, m);
+    }
+  }
+  std::printf("\n%7s %16s\n", "threads", "call_once ns/op");
+  for (unsigned i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i)
+    std::printf("%7d %16.1f\n", threads[i], run_once(threads[i], 100000));
+  return 0;
+}
@@ -0,0 +1,108 @@
+// -*- C++ -*-
+//===---------------------- bench_shared_ptr_atomic.cc --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Read-mostly contention on atomic_load/atomic_store of shared_ptr: a single
+// writer republishes a snapshot while readers keep loading it, once with
+// every reader on the same shared_ptr and once with each reader on its own.
+// The "striped" column reproduces the former 16 mutex pool for comparison.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Config {
+  explicit Config(int v) : version(v) {}
+  int version;
+};
+
+typedef std::shared_ptr<Config> Ptr;
+
+static std::mutex stripes[16];
+
+static std::mutex& stripe(const void* p) {
+  return stripes[std::hash<const void*>()(p) & 15];
+}
+
+struct Native {
+  static Ptr load(const Ptr* p) { return std::atomic_load(p); }
+  static void store(Ptr* p, Ptr v) { std::atomic_store(p, v); }
+};
+
+struct Striped {
+  static Ptr load(const Ptr* p) {
+    std::lock_guard<std::mutex> g(stripe(p));
+    return *p;
+  }
+  static void store(Ptr* p, Ptr v) {
+    std::lock_guard<std::mutex> g(stripe(p));
+    p->swap(v);
+  }
+};
+
+template <class Impl>
+static double run(int readers, bool shared, int loads) {
+  std::vector<Ptr> slots(readers);
+  for (int i = 0; i < readers; ++i)
+    slots[i] = std::make_shared<Config>(0);
+  std::atomic<bool> done(false);
+
+  std::thread writer([&] {
+    int v = 0;
+    while (!done.load()) {
+      for (int i = 0; i < (shared ? 1 : readers); ++i)
+        Impl::store(&slots[i], std::make_shared<Config>(++v));
+      std::this_thread::yield();
+    }
+  });
+
+  Clock::time_point t0 = Clock::now();
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.push_back(std::thread([&, r] {
+      const Ptr* slot = &slots[shared ? 0 : r];
+      long sum = 0;
+      for (int i = 0; i < loads; ++i)
+        sum += Impl::load(slot)->version;
+      if (sum < 0)
+        std::printf("unexpected\n");
+    }));
+  }
+  for (int r = 0; r < readers; ++r)
+    threads[r].join();
+  Clock::time_point t1 = Clock::now();
+  done.store(true);
+  writer.join();
+
+  typedef std::chrono::duration<double, std::nano> ns;
+  return ns(t1 - t0).count() / (double(loads) * readers);
+}
+
+int main(void) {
+  const int loads = 200000;
+  const int readers[] = {1, 2, 4, 8};
+  std::printf("%-8s %7s %14s %14s\n", "layout", "readers", "native ns/load",
+              "striped ns/load");
+  for (int s = 0; s < 2; ++s) {
+    for (unsigned i = 0; i < sizeof(readers) / sizeof(readers[0]); ++i) {
+      double n = run<Native>(readers[i], s == 0, loads);
+      double m = run<Striped>(readers[i], s == 0, loads);
+      std::printf("%-8s %7d %14.1f %14.1f\n", s == 0 ? "shared" : "distinct",
+                  readers[i], n, m);
+    }
+  }
+  return 0;
+}
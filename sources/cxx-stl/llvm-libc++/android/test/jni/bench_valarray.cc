@@ -0,0 +1,103 @@
+// -*- C++ -*-
+//===------------------------ bench_valarray.cc ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// valarray arithmetic next to the equivalent element loop, for the element
+// types with contiguous kernels. Strided and gslice rows use the element
+// loops inside valarray and show the gap to unit stride. Times are in
+// milliseconds for `reps` passes over `n` elements.
+
+#include <chrono>
+#include <cstdio>
+#include <valarray>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> ms;
+
+static const size_t n = 1 << 16;
+static const int reps = 2000;
+
+template <class F>
+static double time(F f) {
+  Clock::time_point t0 = Clock::now();
+  for (int r = 0; r < reps; ++r)
+    f();
+  return ms(Clock::now() - t0).count();
+}
+
+template <class T>
+static void fill(std::valarray<T>& v, unsigned salt) {
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<T>((i * 7 + salt) % 31 + 1);
+}
+
+template <class T>
+static void run(const char* type) {
+  std::valarray<T> a(n), b(n), r(n), w(4 * n);
+  fill(a, 1);
+  fill(b, 2);
+  fill(w, 3);
+  T* pa = &a[0];
+  T* pb = &b[0];
+  T* pr = &r[0];
+  const T s = 3;
+  volatile T sink = T();
+
+  std::printf("%-6s %-16s %10s %10s\n", type, "operation", "valarray", "loop");
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "r = a + b",
+              time([&] { r = a + b; }),
+              time([&] { for (size_t i = 0; i < n; ++i) pr[i] = pa[i] + pb[i]; }));
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "r = a * s",
+              time([&] { r = a * s; }),
+              time([&] { for (size_t i = 0; i < n; ++i) pr[i] = pa[i] * s; }));
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "r = a, r /= b",
+              time([&] { r = a; r /= b; }),
+              time([&] { for (size_t i = 0; i < n; ++i) pr[i] = pa[i] / pb[i]; }));
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "r = a, r *= s",
+              time([&] { r = a; r *= s; }),
+              time([&] { for (size_t i = 0; i < n; ++i) pr[i] = pa[i] * s; }));
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "sum()",
+              time([&] { sink = a.sum(); }),
+              time([&] {
+                T t = pa[0];
+                for (size_t i = 1; i < n; ++i) t += pa[i];
+                sink = t;
+              }));
+  std::printf("%-6s %-16s %10.1f %10.1f\n", "", "min(), max()",
+              time([&] { sink = a.min() + a.max(); }),
+              time([&] {
+                T lo = pa[0], hi = pa[0];
+                for (size_t i = 1; i < n; ++i) {
+                  if (pa[i] < lo) lo = pa[i];
+                  if (hi < pa[i]) hi = pa[i];
+                }
+                sink = lo + hi;
+              }));
+  std::printf("%-6s %-16s %10.1f\n", "", "cshift(5)",
+              time([&] { r = a.cshift(5); }));
+  std::printf("%-6s %-16s %10.1f\n", "", "shift(5)",
+              time([&] { r = a.shift(5); }));
+  std::printf("%-6s %-16s %10.1f\n", "", "slice 1 += a",
+              time([&] { w[std::slice(0, n, 1)] += a; }));
+  std::printf("%-6s %-16s %10.1f\n", "", "slice 4 += a",
+              time([&] { w[std::slice(0, n, 4)] += a; }));
+  size_t len[] = {n / 256, 256};
+  size_t str[] = {512, 2};
+  std::gslice g(0, std::valarray<size_t>(len, 2), std::valarray<size_t>(str, 2));
+  std::printf("%-6s %-16s %10.1f\n", "", "gslice += a",
+              time([&] { w[g] += a; }));
+  (void)sink;
+}
+
+int main(void) {
+  run<float>("float");
+  run<double>("double");
+  run<int>("int");
+  return 0;
+}
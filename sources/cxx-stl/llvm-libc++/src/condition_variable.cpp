@@ -42,15 +42,10 @@ condition_variable::wait(unique_lock<mutex>& lk)
         __throw_system_error(ec, "condition_variable wait failed");
 }
 
-void
-condition_variable::__do_timed_wait(unique_lock<mutex>& lk,
-               chrono::time_point<chrono::system_clock, chrono::nanoseconds> tp)
+static timespec
+__to_timespec(chrono::nanoseconds d)
 {
     using namespace chrono;
-    if (!lk.owns_lock())
-        __throw_system_error(EPERM,
-                            "condition_variable::timed wait: mutex not locked");
-    nanoseconds d = tp.time_since_epoch();
     if (d > nanoseconds(0x59682F000000E941))
         d = nanoseconds(0x59682F000000E941);
     timespec ts;
@@ -67,11 +62,46 @@ condition_variable::__do_timed_wait(unique_lock<mutex>& lk,
         ts.tv_sec = ts_sec_max;
         ts.tv_nsec = giga::num - 1;
     }
+    return ts;
+}
+
+void
+condition_variable::__do_timed_wait(unique_lock<mutex>& lk,
+               chrono::time_point<chrono::system_clock, chrono::nanoseconds> tp)
+{
+    using namespace chrono;
+    if (!lk.owns_lock())
+        __throw_system_error(EPERM,
+                            "condition_variable::timed wait: mutex not locked");
+    timespec ts = __to_timespec(tp.time_since_epoch());
     int ec = pthread_cond_timedwait(&__cv_, lk.mutex()->native_handle(), &ts);
     if (ec != 0 && ec != ETIMEDOUT)
         __throw_system_error(ec, "condition_variable timed_wait failed");
 }
 
+// Steady deadlines can't be moved by changes to the wall clock where
+// pthread waits on CLOCK_MONOTONIC; elsewhere they become system_clock ones.
+void
+condition_variable::__do_timed_wait(unique_lock<mutex>& lk,
+               chrono::time_point<chrono::steady_clock, chrono::nanoseconds> tp)
+{
+    using namespace chrono;
+#if defined(HAVE_PTHREAD_COND_TIMEDWAIT_MONOTONIC)
+    if (!lk.owns_lock())
+        __throw_system_error(EPERM,
+                            "condition_variable::timed wait: mutex not locked");
+    timespec ts = __to_timespec(tp.time_since_epoch());
+    int ec = pthread_cond_timedwait_monotonic_np(&__cv_, lk.mutex()->native_handle(), &ts);
+    if (ec != 0 && ec != ETIMEDOUT)
+        __throw_system_error(ec, "condition_variable timed_wait failed");
+#else
+    nanoseconds d = tp - steady_clock::now();
+    if (d > nanoseconds(0x59682F000000E941))
+        d = nanoseconds(0x59682F000000E941);
+    __do_timed_wait(lk, system_clock::now() + d);
+#endif
+}
+
 void
 notify_all_at_thread_exit(condition_variable& cond, unique_lock<mutex> lk)
 {
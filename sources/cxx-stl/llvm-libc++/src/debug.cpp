@@ -15,6 +15,9 @@
 #include "__hash_table"
 #include "mutex"
 
+#include <pthread.h>
+#include <sched.h>
+
 _LIBCPP_BEGIN_NAMESPACE_STD
 
 _LIBCPP_VISIBLE
@@ -32,22 +35,378 @@ __get_const_db()
     return __get_db();
 }
 
+// The database is split three ways, each in __db_shards parts picked by
+// address:
+//
+// - container shards map container addresses to their __c_node,
+// - iterator shards map iterator addresses to their __i_node,
+// - node stripes, picked by the address of a __c_node, guard the iterator
+//   list of that __c_node and the __c_ member of the iterators in it.
+//
+// Container shards are leaf locks. Stripes are taken before iterator
+// shards, and locks of one kind in increasing order. An iterator reads its
+// __c_ under its shard lock, then locks that stripe and checks __c_ again:
+// __c_ only leaves a __c_node under the stripe of that node and is only set
+// from nullptr under the iterator's shard lock.
+
 namespace
 {
 
-typedef mutex mutex_type;
-typedef lock_guard<mutex_type> WLock;
-typedef lock_guard<mutex_type> RLock;
+// Guarded sections are a few loads and stores long.
+class __db_lock
+{
+    volatile int __v_;
+public:
+    void lock()
+    {
+        for (unsigned __n = 0; __sync_lock_test_and_set(&__v_, 1) != 0; ++__n)
+            if (__n >= 64)
+                sched_yield();
+    }
+
+    bool try_lock() {return __sync_lock_test_and_set(&__v_, 1) == 0;}
+
+    void unlock() {__sync_lock_release(&__v_);}
+};
+
+typedef lock_guard<__db_lock> WLock;
+typedef lock_guard<__db_lock> RLock;
+
+const size_t __db_shards = 64;
+
+inline
+size_t
+__db_shard(const void* __p)
+{
+    size_t __h = reinterpret_cast<size_t>(__p);
+    return ((__h >> 4) ^ (__h >> 12)) & (__db_shards - 1);
+}
+
+void*
+__db_alloc(size_t __n)
+{
+    void* __p = malloc(__n);
+    if (__p == nullptr)
+#ifndef _LIBCPP_NO_EXCEPTIONS
+        throw bad_alloc();
+#else
+        abort();
+#endif
+    return __p;
+}
+
+// Containers are found through entries of their own: the caller of
+// __insert_c constructs the __c_node after it is published.
+struct __c_entry
+{
+    const void* __c_;
+    __c_node* __node_;
+    __c_entry* __next_;
+};
+
+inline const void* __db_key(const __c_entry* __p) {return __p->__c_;}
+inline const void* __db_key(const __i_node* __p) {return __p->__i_;}
+
+inline
+void
+__db_destroy(__c_entry* __p)
+{
+    __p->__node_->~__c_node();
+    free(__p->__node_);
+    free(__p);
+}
 
-mutex_type&
-mut()
+inline
+void
+__db_destroy(__i_node* __p)
 {
-    static mutex_type m;
-    return m;
+    free(__p);
 }
 
+// One shard of the container or the iterator hash table.
+template <class _Node>
+struct __db_table
+{
+    __db_lock __lock_;
+    _Node** __beg_;
+    _Node** __end_;
+    size_t __size_;
+
+    static size_t __bucket(const void* __k, size_t __n)
+        {return hash<const void*>()(__k) % __n;}
+
+    _Node* __find(const void* __k) const
+    {
+        if (__beg_ != __end_)
+        {
+            size_t __h = __bucket(__k, static_cast<size_t>(__end_ - __beg_));
+            for (_Node* __p = __beg_[__h]; __p != nullptr; __p = __p->__next_)
+                if (__db_key(__p) == __k)
+                    return __p;
+        }
+        return nullptr;
+    }
+
+    // Links __p, whose key is set.
+    void __link(_Node* __p)
+    {
+        if (__size_ + 1 > static_cast<size_t>(__end_ - __beg_))
+        {
+            size_t __nc = __next_prime(2*static_cast<size_t>(__end_ - __beg_) + 1);
+            _Node** __b = static_cast<_Node**>(calloc(__nc, sizeof(void*)));
+            if (__b == nullptr)
+#ifndef _LIBCPP_NO_EXCEPTIONS
+                throw bad_alloc();
+#else
+                abort();
+#endif
+            for (_Node** __q = __beg_; __q != __end_; ++__q)
+            {
+                _Node* __r = *__q;
+                while (__r != nullptr)
+                {
+                    size_t __h = __bucket(__db_key(__r), __nc);
+                    _Node* __t = __r->__next_;
+                    __r->__next_ = __b[__h];
+                    __b[__h] = __r;
+                    __r = __t;
+                }
+            }
+            free(__beg_);
+            __beg_ = __b;
+            __end_ = __beg_ + __nc;
+        }
+        size_t __h = __bucket(__db_key(__p), static_cast<size_t>(__end_ - __beg_));
+        __p->__next_ = __beg_[__h];
+        __beg_[__h] = __p;
+        ++__size_;
+    }
+
+    // Unlinks and returns the node of __k, or nullptr.
+    _Node* __unlink(const void* __k)
+    {
+        if (__beg_ == __end_)
+            return nullptr;
+        size_t __h = __bucket(__k, static_cast<size_t>(__end_ - __beg_));
+        _Node* __q = nullptr;
+        for (_Node* __p = __beg_[__h]; __p != nullptr; __q = __p, __p = __p->__next_)
+        {
+            if (__db_key(__p) == __k)
+            {
+                if (__q == nullptr)
+                    __beg_[__h] = __p->__next_;
+                else
+                    __q->__next_ = __p->__next_;
+                --__size_;
+                return __p;
+            }
+        }
+        return nullptr;
+    }
+
+    void __clear()
+    {
+        for (_Node** __p = __beg_; __p != __end_; ++__p)
+        {
+            while (*__p != nullptr)
+            {
+                _Node* __q = *__p;
+                *__p = __q->__next_;
+                __db_destroy(__q);
+            }
+        }
+        free(__beg_);
+    }
+};
+
+// Per thread state: a cache of freed __i_nodes, which iterator temporaries
+// churn through, and the stripes held between __find_c_and_lock and
+// unlock.
+struct __db_thread
+{
+    __i_node* __free_;
+    size_t __nfree_;
+    __db_lock* __held_[2];
+};
+
+const size_t __db_thread_cache = 64;
+
+void
+__db_thread_exit(void* __p)
+{
+    __db_thread* __t = static_cast<__db_thread*>(__p);
+    while (__t->__free_ != nullptr)
+    {
+        __i_node* __n = __t->__free_;
+        __t->__free_ = __n->__next_;
+        free(__n);
+    }
+    free(__t);
+}
+
+pthread_key_t
+__db_make_key()
+{
+    pthread_key_t __k;
+    pthread_key_create(&__k, __db_thread_exit);
+    return __k;
+}
+
+__db_thread&
+__this_thread()
+{
+    static pthread_key_t __k = __db_make_key();
+    __db_thread* __t = static_cast<__db_thread*>(pthread_getspecific(__k));
+    if (__t == nullptr)
+    {
+        __t = static_cast<__db_thread*>(__db_alloc(sizeof(__db_thread)));
+        memset(__t, 0, sizeof(__db_thread));
+        pthread_setspecific(__k, __t);
+    }
+    return *__t;
+}
+
+__i_node*
+__new_i_node(void* __i)
+{
+    __db_thread& __t = __this_thread();
+    void* __p = __t.__free_;
+    if (__p != nullptr)
+    {
+        __t.__free_ = __t.__free_->__next_;
+        --__t.__nfree_;
+    }
+    else
+        __p = __db_alloc(sizeof(__i_node));
+    return ::new(__p) __i_node(__i, nullptr, nullptr);
+}
+
+void
+__delete_i_node(__i_node* __p)
+{
+    __db_thread& __t = __this_thread();
+    if (__t.__nfree_ < __db_thread_cache)
+    {
+        __p->__next_ = __t.__free_;
+        __t.__free_ = __p;
+        ++__t.__nfree_;
+    }
+    else
+        free(__p);
+}
+
+// Two locks of one kind, taken in order; either may be null or both the
+// same.
+class __db_lock_pair
+{
+    __db_lock* __a_;
+    __db_lock* __b_;
+
+    __db_lock_pair(const __db_lock_pair&);
+    __db_lock_pair& operator=(const __db_lock_pair&);
+public:
+    __db_lock_pair(__db_lock* __a, __db_lock* __b)
+        : __a_(__a), __b_(__b)
+    {
+        if (__a_ == __b_)
+            __b_ = nullptr;
+        else if (__a_ == nullptr || (__b_ != nullptr && __b_ < __a_))
+            _VSTD::swap(__a_, __b_);
+    }
+
+    void lock()
+    {
+        if (__a_ != nullptr)
+            __a_->lock();
+        if (__b_ != nullptr)
+            __b_->lock();
+    }
+
+    bool try_lock()
+    {
+        if (__a_ != nullptr && !__a_->try_lock())
+            return false;
+        if (__b_ != nullptr && !__b_->try_lock())
+        {
+            if (__a_ != nullptr)
+                __a_->unlock();
+            return false;
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        if (__b_ != nullptr)
+            __b_->unlock();
+        if (__a_ != nullptr)
+            __a_->unlock();
+    }
+};
+
 }  // unnamed namespace
 
+struct __libcpp_db::__shards
+{
+    __db_table<__c_entry> __c_[__db_shards];
+    __db_table<__i_node> __i_[__db_shards];
+    __db_lock __n_[__db_shards];
+
+    __db_table<__c_entry>& __c_table(const void* __c) {return __c_[__db_shard(__c)];}
+    __db_table<__i_node>& __i_table(const void* __i) {return __i_[__db_shard(__i)];}
+    __db_lock& __stripe(const __c_node* __c) {return __n_[__db_shard(__c)];}
+
+    // The __c_node of __c, or nullptr.
+    __c_node* __find_c(const void* __c)
+    {
+        __db_table<__c_entry>& __t = __c_table(__c);
+        RLock _(__t.__lock_);
+        __c_entry* __e = __t.__find(__c);
+        return __e != nullptr ? __e->__node_ : nullptr;
+    }
+
+    __i_node* __pin(const void* __i, __db_lock*& __n);
+    void __unpin(const void* __i, __db_lock* __n)
+    {
+        if (__n != nullptr)
+            __n->unlock();
+        __i_table(__i).__lock_.unlock();
+    }
+};
+
+// Locks the shard of __i and the stripe of the container it belongs to,
+// and returns the node of __i or nullptr. __n is set to the stripe locked,
+// nullptr when the iterator belongs to no container.
+__i_node*
+__libcpp_db::__shards::__pin(const void* __i, __db_lock*& __n)
+{
+    __db_table<__i_node>& __t = __i_table(__i);
+    for (;;)
+    {
+        __t.__lock_.lock();
+        __i_node* __p = __t.__find(__i);
+        __c_node* __c = __p != nullptr ? __p->__c_ : nullptr;
+        __n = nullptr;
+        if (__c == nullptr)
+            return __p;
+        __db_lock& __l = __stripe(__c);
+        if (!__l.try_lock())
+        {
+            __t.__lock_.unlock();
+            __l.lock();
+            __t.__lock_.lock();
+            __p = __t.__find(__i);
+        }
+        if (__p != nullptr && __p->__c_ == __c)
+        {
+            __n = &__l;
+            return __p;
+        }
+        __l.unlock();
+        __t.__lock_.unlock();
+    }
+}
+
 __i_node::~__i_node()
 {
     if (__next_)
@@ -68,71 +427,46 @@ __c_node::~__c_node()
 }
 
 __libcpp_db::__libcpp_db()
-    : __cbeg_(nullptr),
-      __cend_(nullptr),
-      __csz_(0),
-      __ibeg_(nullptr),
-      __iend_(nullptr),
-      __isz_(0)
+    : __s_(new __shards())
 {
 }
 
 __libcpp_db::~__libcpp_db()
 {
-    if (__cbeg_)
+    for (size_t __k = 0; __k < __db_shards; ++__k)
     {
-        for (__c_node** p = __cbeg_; p != __cend_; ++p)
-        {
-            if (*p != nullptr)
-            {
-                (*p)->~__c_node();
-                free(*p);
-            }
-        }
-        free(__cbeg_);
-    }
-    if (__ibeg_)
-    {
-        for (__i_node** p = __ibeg_; p != __iend_; ++p)
-        {
-            if (*p != nullptr)
-            {
-                (*p)->~__i_node();
-                free(*p);
-            }
-        }
-        free(__ibeg_);
+        __s_->__c_[__k].__clear();
+        __s_->__i_[__k].__clear();
     }
+    delete __s_;
 }
 
 void*
 __libcpp_db::__find_c_from_i(void* __i) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
+    __db_lock* __n;
+    __i_node* i = __s_->__pin(__i, __n);
     _LIBCPP_ASSERT(i != nullptr, "iterator constructed in translation unit with debug mode not enabled."
                    "  #define _LIBCPP_DEBUG2 1 for that translation unit.");
-    return i->__c_ != nullptr ? i->__c_->__c_ : nullptr;
+    void* __r = i->__c_ != nullptr ? i->__c_->__c_ : nullptr;
+    __s_->__unpin(__i, __n);
+    return __r;
 }
 
 void
 __libcpp_db::__insert_ic(void* __i, const void* __c)
 {
-    WLock _(mut());
-    __i_node* i = __insert_iterator(__i);
     const char* errmsg =
         "Container constructed in a translation unit with debug mode disabled."
         " But it is being used in a translation unit with debug mode enabled."
         " Enable it in the other translation unit with #define _LIBCPP_DEBUG2 1";
-    _LIBCPP_ASSERT(__cbeg_ != __cend_, errmsg);
-    size_t hc = hash<const void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* c = __cbeg_[hc];
+    __c_node* c = __s_->__find_c(__c);
     _LIBCPP_ASSERT(c != nullptr, errmsg);
-    while (c->__c_ != __c)
-    {
-        c = c->__next_;
-        _LIBCPP_ASSERT(c != nullptr, errmsg);
-    }
+    WLock _(__s_->__stripe(c));
+    __db_table<__i_node>& __t = __s_->__i_table(__i);
+    WLock __l(__t.__lock_);
+    __i_node* i = __new_i_node(__i);
+    __t.__link(i);
     c->__add(i);
     i->__c_ = c;
 }
@@ -140,91 +474,49 @@ __libcpp_db::__insert_ic(void* __i, const void* __c)
 __c_node*
 __libcpp_db::__insert_c(void* __c)
 {
-    WLock _(mut());
-    if (__csz_ + 1 > static_cast<size_t>(__cend_ - __cbeg_))
+    __c_entry* e = static_cast<__c_entry*>(__db_alloc(sizeof(__c_entry)));
+    __c_node* r = static_cast<__c_node*>(malloc(sizeof(__c_node)));
+    if (r == nullptr)
     {
-        size_t nc = __next_prime(2*static_cast<size_t>(__cend_ - __cbeg_) + 1);
-        __c_node** cbeg = (__c_node**)calloc(nc, sizeof(void*));
-        if (cbeg == nullptr)
-#ifndef _LIBCPP_NO_EXCEPTIONS
-            throw bad_alloc();
-#else
-            abort();
-#endif
-        for (__c_node** p = __cbeg_; p != __cend_; ++p)
-        {
-            __c_node* q = *p;
-            while (q != nullptr)
-            {
-                size_t h = hash<void*>()(q->__c_) % nc;
-                __c_node* r = q->__next_;
-                q->__next_ = cbeg[h];
-                cbeg[h] = q;
-                q = r;
-            }
-        }
-        free(__cbeg_);
-        __cbeg_ = cbeg;
-        __cend_ = __cbeg_ + nc;
-    }
-    size_t hc = hash<void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p = __cbeg_[hc];
-    __c_node* r = __cbeg_[hc] = (__c_node*)malloc(sizeof(__c_node));
-    if (__cbeg_[hc] == nullptr)
+        free(e);
 #ifndef _LIBCPP_NO_EXCEPTIONS
         throw bad_alloc();
 #else
         abort();
 #endif
+    }
     r->__c_ = __c;
-    r->__next_ = p;
-    ++__csz_;
+    r->__next_ = nullptr;
+    e->__c_ = __c;
+    e->__node_ = r;
+    __db_table<__c_entry>& __t = __s_->__c_table(__c);
+    WLock _(__t.__lock_);
+    __t.__link(e);
     return r;
 }
 
 void
 __libcpp_db::__erase_i(void* __i)
 {
-    WLock _(mut());
-    if (__ibeg_ != __iend_)
+    __db_lock* __n;
+    __i_node* p = __s_->__pin(__i, __n);
+    if (p != nullptr)
     {
-        size_t hi = hash<void*>()(__i) % static_cast<size_t>(__iend_ - __ibeg_);
-        __i_node* p = __ibeg_[hi];
-        if (p != nullptr)
-        {
-            __i_node* q = nullptr;
-            while (p->__i_ != __i)
-            {
-                q = p;
-                p = p->__next_;
-                if (p == nullptr)
-                    return;
-            }
-            if (q == nullptr)
-                __ibeg_[hi] = p->__next_;
-            else
-                q->__next_ = p->__next_;
-            __c_node* c = p->__c_;
-            free(p);
-            --__isz_;
-            if (c != nullptr)
-                c->__remove(p);
-        }
+        __s_->__i_table(__i).__unlink(__i);
+        if (p->__c_ != nullptr)
+            p->__c_->__remove(p);
     }
+    __s_->__unpin(__i, __n);
+    if (p != nullptr)
+        __delete_i_node(p);
 }
 
 void
 __libcpp_db::__invalidate_all(void* __c)
 {
-    WLock _(mut());
-    size_t hc = hash<void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p = __cbeg_[hc];
+    __c_node* p = __s_->__find_c(__c);
     _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __invalidate_all A");
-    while (p->__c_ != __c)
-    {
-        p = p->__next_;
-        _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __invalidate_all B");
-    }
+    WLock _(__s_->__stripe(p));
     while (p->end_ != p->beg_)
     {
         --p->end_;
@@ -235,28 +527,37 @@ __libcpp_db::__invalidate_all(void* __c)
 __c_node*
 __libcpp_db::__find_c_and_lock(void* __c) const
 {
-    mut().lock();
-    size_t hc = hash<void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p = __cbeg_[hc];
+    __c_node* p = __s_->__find_c(__c);
     _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __find_c_and_lock A");
-    while (p->__c_ != __c)
-    {
-        p = p->__next_;
-        _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __find_c_and_lock B");
-    }
+    __db_lock& __l = __s_->__stripe(p);
+    __l.lock();
+    __db_thread& __t = __this_thread();
+    __t.__held_[0] = &__l;
+    __t.__held_[1] = nullptr;
     return p;
 }
 
+// Called between __find_c_and_lock and unlock: also locks the stripe of
+// __c, keeping the stripes in order.
 __c_node*
 __libcpp_db::__find_c(void* __c) const
 {
-    size_t hc = hash<void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p = __cbeg_[hc];
+    __c_node* p = __s_->__find_c(__c);
     _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __find_c A");
-    while (p->__c_ != __c)
+    __db_thread& __t = __this_thread();
+    __db_lock* __h = __t.__held_[0];
+    __db_lock* __l = &__s_->__stripe(p);
+    if (__h != nullptr && __l != __h && __t.__held_[1] == nullptr)
     {
-        p = p->__next_;
-        _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __find_c B");
+        if (__h < __l)
+            __l->lock();
+        else if (!__l->try_lock())
+        {
+            __h->unlock();
+            __l->lock();
+            __h->lock();
+        }
+        __t.__held_[1] = __l;
     }
     return p;
 }
@@ -264,101 +565,139 @@ __libcpp_db::__find_c(void* __c) const
 void
 __libcpp_db::unlock() const
 {
-    mut().unlock();
+    __db_thread& __t = __this_thread();
+    if (__t.__held_[1] != nullptr)
+        __t.__held_[1]->unlock();
+    if (__t.__held_[0] != nullptr)
+        __t.__held_[0]->unlock();
+    __t.__held_[0] = __t.__held_[1] = nullptr;
 }
 
 void
 __libcpp_db::__erase_c(void* __c)
 {
-    WLock _(mut());
-    size_t hc = hash<void*>()(__c) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p = __cbeg_[hc];
-    __c_node* q = nullptr;
-    _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __erase_c A");
-    while (p->__c_ != __c)
+    __c_entry* e;
     {
-        q = p;
-        p = p->__next_;
-        _LIBCPP_ASSERT(p != nullptr, "debug mode internal logic error __erase_c B");
+        __db_table<__c_entry>& __t = __s_->__c_table(__c);
+        WLock _(__t.__lock_);
+        e = __t.__unlink(__c);
     }
-    if (q == nullptr)
-        __cbeg_[hc] = p->__next_;
-    else
-        q->__next_ = p->__next_;
-    while (p->end_ != p->beg_)
+    _LIBCPP_ASSERT(e != nullptr, "debug mode internal logic error __erase_c A");
+    __c_node* p = e->__node_;
+    free(e);
     {
-        --p->end_;
-        (*p->end_)->__c_ = nullptr;
+        WLock _(__s_->__stripe(p));
+        while (p->end_ != p->beg_)
+        {
+            --p->end_;
+            (*p->end_)->__c_ = nullptr;
+        }
     }
     free(p->beg_);
     free(p);
-    --__csz_;
 }
 
 void
 __libcpp_db::__iterator_copy(void* __i, const void* __i0)
 {
-    WLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    __i_node* i0 = __find_iterator(__i0);
-    __c_node* c0 = i0 != nullptr ? i0->__c_ : nullptr;
-    if (i == nullptr && c0 != nullptr)
-        i = __insert_iterator(__i);
-    __c_node* c = i != nullptr ? i->__c_ : nullptr;
-    if (c != c0)
+    __db_table<__i_node>& __t = __s_->__i_table(__i);
+    __db_table<__i_node>& __t0 = __s_->__i_table(__i0);
+    __db_lock_pair __il(&__t.__lock_, &__t0.__lock_);
+    unique_lock<__db_lock_pair> __ilk(__il);
+    for (;;)
     {
-        if (c != nullptr)
-            c->__remove(i);
-        if (i != nullptr)
+        __i_node* i = __t.__find(__i);
+        __i_node* i0 = __t0.__find(__i0);
+        __c_node* c = i != nullptr ? i->__c_ : nullptr;
+        __c_node* c0 = i0 != nullptr ? i0->__c_ : nullptr;
+        __db_lock_pair __nl(c != nullptr ? &__s_->__stripe(c) : nullptr,
+                            c0 != nullptr ? &__s_->__stripe(c0) : nullptr);
+        unique_lock<__db_lock_pair> __nlk(__nl, try_to_lock);
+        if (!__nlk.owns_lock())
+        {
+            // Stripes go first: wait for them without the shards, then
+            // check the iterators did not move meanwhile.
+            __ilk.unlock();
+            __nlk.lock();
+            __ilk.lock();
+            i = __t.__find(__i);
+            i0 = __t0.__find(__i0);
+            if ((i != nullptr ? i->__c_ : nullptr) != c ||
+                (i0 != nullptr ? i0->__c_ : nullptr) != c0)
+                continue;
+        }
+        if (i == nullptr && c0 != nullptr)
         {
-            i->__c_ = nullptr;
-            if (c0 != nullptr)
+            i = __new_i_node(__i);
+            __t.__link(i);
+        }
+        if (c != c0)
+        {
+            if (c != nullptr)
+                c->__remove(i);
+            if (i != nullptr)
             {
-                i->__c_ = c0;
-                i->__c_->__add(i);
+                i->__c_ = nullptr;
+                if (c0 != nullptr)
+                {
+                    i->__c_ = c0;
+                    i->__c_->__add(i);
+                }
             }
         }
+        return;
     }
 }
 
 bool
 __libcpp_db::__dereferenceable(const void* __i) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    return i != nullptr && i->__c_ != nullptr && i->__c_->__dereferenceable(__i);
+    __db_lock* __n;
+    __i_node* i = __s_->__pin(__i, __n);
+    bool __r = i != nullptr && i->__c_ != nullptr && i->__c_->__dereferenceable(__i);
+    __s_->__unpin(__i, __n);
+    return __r;
 }
 
 bool
 __libcpp_db::__decrementable(const void* __i) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    return i != nullptr && i->__c_ != nullptr && i->__c_->__decrementable(__i);
+    __db_lock* __n;
+    __i_node* i = __s_->__pin(__i, __n);
+    bool __r = i != nullptr && i->__c_ != nullptr && i->__c_->__decrementable(__i);
+    __s_->__unpin(__i, __n);
+    return __r;
 }
 
 bool
 __libcpp_db::__addable(const void* __i, ptrdiff_t __n) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    return i != nullptr && i->__c_ != nullptr && i->__c_->__addable(__i, __n);
+    __db_lock* __l;
+    __i_node* i = __s_->__pin(__i, __l);
+    bool __r = i != nullptr && i->__c_ != nullptr && i->__c_->__addable(__i, __n);
+    __s_->__unpin(__i, __l);
+    return __r;
 }
 
 bool
 __libcpp_db::__subscriptable(const void* __i, ptrdiff_t __n) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    return i != nullptr && i->__c_ != nullptr && i->__c_->__subscriptable(__i, __n);
+    __db_lock* __l;
+    __i_node* i = __s_->__pin(__i, __l);
+    bool __r = i != nullptr && i->__c_ != nullptr && i->__c_->__subscriptable(__i, __n);
+    __s_->__unpin(__i, __l);
+    return __r;
 }
 
 bool
 __libcpp_db::__comparable(const void* __i, const void* __j) const
 {
-    RLock _(mut());
-    __i_node* i = __find_iterator(__i);
-    __i_node* j = __find_iterator(__j);
+    __db_table<__i_node>& __ti = __s_->__i_table(__i);
+    __db_table<__i_node>& __tj = __s_->__i_table(__j);
+    __db_lock_pair __l(&__ti.__lock_, &__tj.__lock_);
+    lock_guard<__db_lock_pair> _(__l);
+    __i_node* i = __ti.__find(__i);
+    __i_node* j = __tj.__find(__j);
     __c_node* ci = i != nullptr ? i->__c_ : nullptr;
     __c_node* cj = j != nullptr ? j->__c_ : nullptr;
     return ci != nullptr && ci == cj;
@@ -367,23 +706,12 @@ __libcpp_db::__comparable(const void* __i, const void* __j) const
 void
 __libcpp_db::swap(void* c1, void* c2)
 {
-    WLock _(mut());
-    size_t hc = hash<void*>()(c1) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p1 = __cbeg_[hc];
+    __c_node* p1 = __s_->__find_c(c1);
     _LIBCPP_ASSERT(p1 != nullptr, "debug mode internal logic error swap A");
-    while (p1->__c_ != c1)
-    {
-        p1 = p1->__next_;
-        _LIBCPP_ASSERT(p1 != nullptr, "debug mode internal logic error swap B");
-    }
-    hc = hash<void*>()(c2) % static_cast<size_t>(__cend_ - __cbeg_);
-    __c_node* p2 = __cbeg_[hc];
+    __c_node* p2 = __s_->__find_c(c2);
     _LIBCPP_ASSERT(p2 != nullptr, "debug mode internal logic error swap C");
-    while (p2->__c_ != c2)
-    {
-        p2 = p2->__next_;
-        _LIBCPP_ASSERT(p2 != nullptr, "debug mode internal logic error swap D");
-    }
+    __db_lock_pair __l(&__s_->__stripe(p1), &__s_->__stripe(p2));
+    lock_guard<__db_lock_pair> _(__l);
     std::swap(p1->beg_, p2->beg_);
     std::swap(p1->end_, p2->end_);
     std::swap(p1->cap_, p2->cap_);
@@ -396,8 +724,10 @@ __libcpp_db::swap(void* c1, void* c2)
 void
 __libcpp_db::__insert_i(void* __i)
 {
-    WLock _(mut());
-    __insert_iterator(__i);
+    __db_table<__i_node>& __t = __s_->__i_table(__i);
+    __i_node* i = __new_i_node(__i);
+    WLock _(__t.__lock_);
+    __t.__link(i);
 }
 
 void
@@ -427,70 +757,6 @@ __c_node::__add(__i_node* i)
 
 // private api
 
-_LIBCPP_HIDDEN
-__i_node*
-__libcpp_db::__insert_iterator(void* __i)
-{
-    if (__isz_ + 1 > static_cast<size_t>(__iend_ - __ibeg_))
-    {
-        size_t nc = __next_prime(2*static_cast<size_t>(__iend_ - __ibeg_) + 1);
-        __i_node** ibeg = (__i_node**)calloc(nc, sizeof(void*));
-        if (ibeg == nullptr)
-#ifndef _LIBCPP_NO_EXCEPTIONS
-            throw bad_alloc();
-#else
-            abort();
-#endif
-        for (__i_node** p = __ibeg_; p != __iend_; ++p)
-        {
-            __i_node* q = *p;
-            while (q != nullptr)
-            {
-                size_t h = hash<void*>()(q->__i_) % nc;
-                __i_node* r = q->__next_;
-                q->__next_ = ibeg[h];
-                ibeg[h] = q;
-                q = r;
-            }
-        }
-        free(__ibeg_);
-        __ibeg_ = ibeg;
-        __iend_ = __ibeg_ + nc;
-    }
-    size_t hi = hash<void*>()(__i) % static_cast<size_t>(__iend_ - __ibeg_);
-    __i_node* p = __ibeg_[hi];
-    __i_node* r = __ibeg_[hi] = (__i_node*)malloc(sizeof(__i_node));
-    if (r == nullptr)
-#ifndef _LIBCPP_NO_EXCEPTIONS
-        throw bad_alloc();
-#else
-        abort();
-#endif
-    ::new(r) __i_node(__i, p, nullptr);
-    ++__isz_;
-    return r;
-}
-
-_LIBCPP_HIDDEN
-__i_node*
-__libcpp_db::__find_iterator(const void* __i) const
-{
-    __i_node* r = nullptr;
-    if (__ibeg_ != __iend_)
-    {
-        size_t h = hash<const void*>()(__i) % static_cast<size_t>(__iend_ - __ibeg_);
-        for (__i_node* nd = __ibeg_[h]; nd != nullptr; nd = nd->__next_)
-        {
-            if (nd->__i_ == __i)
-            {
-                r = nd;
-                break;
-            }
-        }
-    }
-    return r;
-}
-
 _LIBCPP_HIDDEN
 void
 __c_node::__remove(__i_node* p)
@@ -0,0 +1,24 @@
+//===------------------------ execution.cpp -------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define _LIBCPP_BUILDING_EXECUTION
+#include "execution"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace execution
+{
+
+const sequenced_policy            seq;
+const parallel_policy             par;
+const parallel_unsequenced_policy par_unseq;
+
+}  // execution
+
+_LIBCPP_END_NAMESPACE_STD
@@ -9,6 +9,7 @@
 
 #include "future"
 #include "string"
+#include "__thread_pool"
 
 _LIBCPP_BEGIN_NAMESPACE_STD
 
@@ -158,12 +159,83 @@ __assoc_sub_state::__sub_wait(unique_lock<mutex>& __lk)
             __lk.unlock();
             __execute();
         }
+        else if (__state_ & __pooled)
+        {
+            // Not picked up by the pool yet: run it right here rather than
+            // block, so waiting on it from a pool thread can't deadlock
+            __state_ &= ~__pooled;
+            __lk.unlock();
+            __execute();
+        }
         else
             while (!__is_ready())
                 __cv_.wait(__lk);
     }
 }
 
+// Runs on the pool when the queue gets to the task. The queue's pointer does
+// not own the state, so if the last future let go while the task was still
+// queued, dropping that pointer is what frees the state.
+void
+__assoc_sub_state::__execute_pooled()
+{
+    unique_lock<mutex> __lk(__mut_);
+    if (__state_ & __pooled)
+    {
+        __state_ &= ~__pooled;
+        __lk.unlock();
+        __execute();
+        __lk.lock();
+    }
+    __state_ &= ~__queued;
+    if (__state_ & __orphaned)
+    {
+        __lk.unlock();
+        __on_zero_shared();
+    }
+}
+
+// Called once the last reference is gone and the task has finished: true if
+// the queue still points at the state, which then outlives it until
+// __execute_pooled gets there.
+bool
+__assoc_sub_state::__keep_for_pool()
+{
+    lock_guard<mutex> __lk(__mut_);
+    if (!(__state_ & __queued))
+        return false;
+    __state_ |= __orphaned;
+    return true;
+}
+
+static void
+__run_pooled(void* __p)
+{
+    static_cast<__assoc_sub_state*>(__p)->__execute_pooled();
+}
+
+// The queue holds a plain pointer, not a reference, so the last future going
+// away still waits for the task (running it on the spot if no pool thread has
+// got to it yet, just as waiting does), and no waiter ever depends on a queued
+// task being picked up.
+void
+__submit_pooled(__assoc_sub_state* __s)
+{
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    try
+    {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+        __libcpp_thread_pool_submit(&__run_pooled, __s);
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    }
+    catch (...)
+    {
+        // Never queued: run it here instead
+        __s->__execute_pooled();
+    }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+}
+
 void
 __assoc_sub_state::__execute()
 {
@@ -63,4 +63,25 @@ ios_base::Init::~Init()
     wclog_ptr->flush();
 }
 
+// Unsynchronized standard streams buffer on their own and read and write
+// the file descriptors directly, so C stdio and the C++ streams must not be
+// mixed afterwards; input already buffered by stdin is not seen by cin.
+bool
+ios_base::sync_with_stdio(bool sync)
+{
+    static bool previous_state = true;
+    bool r = previous_state;
+    if (sync != previous_state)
+    {
+        reinterpret_cast<__stdinbuf <char>*>(__cin)->__set_buffered(!sync);
+        reinterpret_cast<__stdoutbuf<char>*>(__cout)->__set_buffered(!sync);
+        reinterpret_cast<__stdoutbuf<char>*>(__cerr)->__set_buffered(!sync);
+        reinterpret_cast<__stdinbuf <wchar_t>*>(__wcin)->__set_buffered(!sync);
+        reinterpret_cast<__stdoutbuf<wchar_t>*>(__wcout)->__set_buffered(!sync);
+        reinterpret_cast<__stdoutbuf<wchar_t>*>(__wcerr)->__set_buffered(!sync);
+    }
+    previous_state = sync;
+    return r;
+}
+
 _LIBCPP_END_NAMESPACE_STD
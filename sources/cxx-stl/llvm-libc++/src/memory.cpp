@@ -164,6 +164,36 @@ __get_sp_mut(const void* p)
     return muts[hash<const void*>()(p) & (__sp_mut_count-1)];
 }
 
+// Spin lock on the low bit of a shared_ptr's control block pointer.  Hold
+// times are a handful of instructions, so spin briefly before yielding.
+
+static const uintptr_t __sp_lock_bit = 1;
+
+__shared_weak_count*
+__sp_lock(__shared_weak_count** c) _NOEXCEPT
+{
+    uintptr_t* w = reinterpret_cast<uintptr_t*>(c);
+    unsigned count = 0;
+    while (true)
+    {
+        uintptr_t v = *static_cast<volatile uintptr_t*>(w) & ~__sp_lock_bit;
+        if (__sync_bool_compare_and_swap(w, v, v | __sp_lock_bit))
+            return reinterpret_cast<__shared_weak_count*>(v);
+        if (++count > 16)
+        {
+            this_thread::yield();
+            count = 0;
+        }
+    }
+}
+
+void
+__sp_unlock(__shared_weak_count** c, __shared_weak_count* v) _NOEXCEPT
+{
+    __sync_synchronize();
+    *static_cast<__shared_weak_count* volatile*>(c) = v;
+}
+
 #endif // __has_feature(cxx_atomic)
 
 void
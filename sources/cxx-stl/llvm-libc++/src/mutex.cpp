@@ -9,9 +9,18 @@
 
 #define _LIBCPP_BUILDING_MUTEX
 #include "mutex"
+#include "shared_mutex"
 #include "limits"
 #include "system_error"
 #include "cassert"
+#include <sched.h>
+#include <time.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 _LIBCPP_BEGIN_NAMESPACE_STD
 
@@ -209,42 +218,332 @@ recursive_timed_mutex::unlock() _NOEXCEPT
 // call into dispatch_once_f instead of here. Relevant radar this code needs to
 // keep in sync with:  7741191.
 
-static pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  cv  = PTHREAD_COND_INITIALIZER;
+// Waiting on a word until it no longer holds a given value, as with futexes.
+// __wait_word() may return early; callers check the word again. Without
+// futexes, every waiter parks on one condition variable.
+
+#if defined(__linux__)
+
+#ifndef FUTEX_PRIVATE_FLAG
+#define FUTEX_PRIVATE_FLAG 128
+#endif
+
+static bool
+__wait_word(volatile void* addr, unsigned val, const timespec* rel)
+{
+    return syscall(__NR_futex, addr, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, val, rel, 0, 0) == 0 ||
+           errno != ETIMEDOUT;
+}
+
+static void
+__wake_word(volatile void* addr, int n)
+{
+    syscall(__NR_futex, addr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, n, 0, 0, 0);
+}
+
+#else  // __linux__
+
+static pthread_mutex_t __park_mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __park_cv  = PTHREAD_COND_INITIALIZER;
+
+static bool
+__wait_word(volatile void* addr, unsigned val, const timespec* rel)
+{
+    int ec = 0;
+    pthread_mutex_lock(&__park_mut);
+    if (*static_cast<volatile unsigned*>(addr) == val)
+    {
+        if (rel == 0)
+            pthread_cond_wait(&__park_cv, &__park_mut);
+        else
+        {
+            chrono::nanoseconds d = chrono::system_clock::now().time_since_epoch() +
+                                    chrono::seconds(rel->tv_sec) + chrono::nanoseconds(rel->tv_nsec);
+            chrono::seconds s = chrono::duration_cast<chrono::seconds>(d);
+            timespec ts;
+            ts.tv_sec = static_cast<decltype(ts.tv_sec)>(s.count());
+            ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>((d - s).count());
+            ec = pthread_cond_timedwait(&__park_cv, &__park_mut, &ts);
+        }
+    }
+    pthread_mutex_unlock(&__park_mut);
+    return ec != ETIMEDOUT;
+}
+
+static void
+__wake_word(volatile void*, int)
+{
+    pthread_mutex_lock(&__park_mut);
+    pthread_cond_broadcast(&__park_cv);
+    pthread_mutex_unlock(&__park_mut);
+}
+
+#endif  // __linux__
+
+// Time left until t, false once it has passed
+static bool
+__time_left(const chrono::steady_clock::time_point& t, timespec& ts)
+{
+    using namespace chrono;
+    nanoseconds d = t - steady_clock::now();
+    if (d <= nanoseconds(0))
+        return false;
+    seconds s = duration_cast<seconds>(d);
+    typedef decltype(ts.tv_sec) ts_sec;
+    _LIBCPP_CONSTEXPR ts_sec ts_sec_max = numeric_limits<ts_sec>::max();
+    if (s.count() < ts_sec_max)
+    {
+        ts.tv_sec = static_cast<ts_sec>(s.count());
+        ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>((d - s).count());
+    }
+    else
+    {
+        ts.tv_sec = ts_sec_max;
+        ts.tv_nsec = giga::num - 1;
+    }
+    return true;
+}
+
+// The half of an unsigned long holding its low bits, for futex calls
+static volatile unsigned*
+__low_word(volatile unsigned long* p)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return reinterpret_cast<volatile unsigned*>(p) + (sizeof(unsigned long) / sizeof(unsigned) - 1);
+#else
+    return reinterpret_cast<volatile unsigned*>(p);
+#endif
+}
+
+// call_once flag states. Threads wait on the flag they need, and only
+// when the call is actually running elsewhere.
+
+static const unsigned long __once_running = 1;
+static const unsigned long __once_waited = 2;
+static const unsigned long __once_done = ~0ul;
+
+static void
+__once_set(volatile unsigned long& flag, unsigned long v)
+{
+    unsigned long old;
+    do
+    {
+        old = flag;
+    } while (!__sync_bool_compare_and_swap(&flag, old, v));
+    if (old == __once_waited)
+        __wake_word(__low_word(&flag), numeric_limits<int>::max());
+}
 
 void
 __call_once(volatile unsigned long& flag, void* arg, void(*func)(void*))
 {
-    pthread_mutex_lock(&mut);
-    while (flag == 1)
-        pthread_cond_wait(&cv, &mut);
-    if (flag == 0)
+    while (true)
     {
-#ifndef _LIBCPP_NO_EXCEPTIONS
-        try
+        unsigned long s = flag;
+        if (s == __once_done)
+        {
+            __sync_synchronize();
+            return;
+        }
+        if (s == 0)
         {
+            if (!__sync_bool_compare_and_swap(&flag, 0ul, __once_running))
+                continue;
+#ifndef _LIBCPP_NO_EXCEPTIONS
+            try
+            {
 #endif  // _LIBCPP_NO_EXCEPTIONS
-            flag = 1;
-            pthread_mutex_unlock(&mut);
-            func(arg);
-            pthread_mutex_lock(&mut);
-            flag = ~0ul;
-            pthread_mutex_unlock(&mut);
-            pthread_cond_broadcast(&cv);
+                func(arg);
 #ifndef _LIBCPP_NO_EXCEPTIONS
+            }
+            catch (...)
+            {
+                __once_set(flag, 0ul);
+                throw;
+            }
+#endif  // _LIBCPP_NO_EXCEPTIONS
+            __once_set(flag, __once_done);
+            return;
+        }
+        if (s == __once_running &&
+            !__sync_bool_compare_and_swap(&flag, __once_running, __once_waited))
+            continue;
+        __wait_word(__low_word(&flag), static_cast<unsigned>(__once_waited), 0);
+    }
+}
+
+// shared_timed_mutex
+//
+// __state_ holds the number of readers, the number of writers waiting, a
+// bit for a writer holding the lock and a bit for readers asleep on
+// __state_. Writers sleep on __writer_seq_, which is bumped to wake one of
+// them. Readers don't come in while writers wait, so writers are never
+// starved; readers get in once no writer is left.
+
+static const unsigned __rw_write = 1u << 31;
+static const unsigned __rw_readers_asleep = 1u << 30;
+static const unsigned __rw_writer_waits = 1u << 20;
+static const unsigned __rw_writers_mask = 0x3ffu << 20;
+static const unsigned __rw_readers_mask = __rw_writer_waits - 1;
+
+void
+shared_timed_mutex::__wake_writer()
+{
+    __sync_fetch_and_add(&__writer_seq_, 1u);
+    __wake_word(&__writer_seq_, 1);
+}
+
+void
+shared_timed_mutex::lock()
+{
+    __try_lock_until(chrono::steady_clock::time_point::max());
+}
+
+bool
+shared_timed_mutex::try_lock()
+{
+    unsigned s = __state_;
+    return (s & (__rw_write | __rw_readers_mask)) == 0 &&
+           __sync_bool_compare_and_swap(&__state_, s, s | __rw_write);
+}
+
+bool
+shared_timed_mutex::__try_lock_until(const chrono::steady_clock::time_point& t)
+{
+    volatile unsigned& state = __state_;
+    volatile unsigned& seq = __writer_seq_;
+    bool forever = t == chrono::steady_clock::time_point::max();
+    timespec ts;
+    unsigned s = state;
+    while (true)
+    {
+        if ((s & (__rw_write | __rw_readers_mask)) == 0)
+        {
+            if (__sync_bool_compare_and_swap(&state, s, s | __rw_write))
+                return true;
         }
-        catch (...)
+        else if ((s & __rw_writers_mask) == __rw_writers_mask)
         {
-            pthread_mutex_lock(&mut);
-            flag = 0ul;
-            pthread_mutex_unlock(&mut);
-            pthread_cond_broadcast(&cv);
-            throw;
+            if (!forever && !__time_left(t, ts))
+                return false;
+            sched_yield();
         }
-#endif  // _LIBCPP_NO_EXCEPTIONS
+        else if (__sync_bool_compare_and_swap(&state, s, s + __rw_writer_waits))
+            break;
+        s = state;
     }
-    else
-        pthread_mutex_unlock(&mut);
+    while (true)
+    {
+        unsigned n = seq;
+        __sync_synchronize();
+        s = state;
+        if ((s & (__rw_write | __rw_readers_mask)) == 0)
+        {
+            if (__sync_bool_compare_and_swap(&state, s, (s - __rw_writer_waits) | __rw_write))
+                return true;
+            continue;
+        }
+        if (!forever && !__time_left(t, ts))
+            break;
+        __wait_word(&seq, n, forever ? 0 : &ts);
+    }
+    // Timed out. A wakeup meant for this thread goes to the next writer;
+    // readers held back by this thread alone go ahead.
+    unsigned v;
+    do
+    {
+        s = state;
+        v = s - __rw_writer_waits;
+        if ((v & __rw_writers_mask) == 0)
+            v &= ~__rw_readers_asleep;
+    } while (!__sync_bool_compare_and_swap(&state, s, v));
+    if (v & __rw_writers_mask)
+        __wake_writer();
+    else if (s & __rw_readers_asleep)
+        __wake_word(&state, numeric_limits<int>::max());
+    return false;
+}
+
+void
+shared_timed_mutex::unlock()
+{
+    unsigned s, v;
+    do
+    {
+        s = __state_;
+        v = s & ~__rw_write;
+        if ((v & __rw_writers_mask) == 0)
+            v &= ~__rw_readers_asleep;
+    } while (!__sync_bool_compare_and_swap(&__state_, s, v));
+    if (s & __rw_writers_mask)
+        __wake_writer();
+    else if (s & __rw_readers_asleep)
+        __wake_word(&__state_, numeric_limits<int>::max());
+}
+
+void
+shared_timed_mutex::lock_shared()
+{
+    __try_lock_shared_until(chrono::steady_clock::time_point::max());
+}
+
+bool
+shared_timed_mutex::try_lock_shared()
+{
+    unsigned s = __state_;
+    while ((s & (__rw_write | __rw_writers_mask)) == 0 &&
+           (s & __rw_readers_mask) != __rw_readers_mask)
+    {
+        if (__sync_bool_compare_and_swap(&__state_, s, s + 1))
+            return true;
+        s = __state_;
+    }
+    return false;
+}
+
+bool
+shared_timed_mutex::__try_lock_shared_until(const chrono::steady_clock::time_point& t)
+{
+    volatile unsigned& state = __state_;
+    bool forever = t == chrono::steady_clock::time_point::max();
+    timespec ts;
+    while (true)
+    {
+        unsigned s = state;
+        if ((s & (__rw_write | __rw_writers_mask)) == 0 &&
+            (s & __rw_readers_mask) != __rw_readers_mask)
+        {
+            if (__sync_bool_compare_and_swap(&state, s, s + 1))
+                return true;
+            continue;
+        }
+        if (!(s & __rw_readers_asleep))
+        {
+            if (!__sync_bool_compare_and_swap(&state, s, s | __rw_readers_asleep))
+                continue;
+            s |= __rw_readers_asleep;
+        }
+        if (!forever && !__time_left(t, ts))
+            return false;
+        __wait_word(&state, s, forever ? 0 : &ts);
+    }
+}
+
+void
+shared_timed_mutex::unlock_shared()
+{
+    unsigned s, v;
+    do
+    {
+        s = __state_;
+        v = s - 1;
+        if ((v & __rw_writers_mask) == 0)
+            v &= ~__rw_readers_asleep;
+    } while (!__sync_bool_compare_and_swap(&__state_, s, v));
+    if ((v & __rw_readers_mask) == 0 && (v & __rw_writers_mask))
+        __wake_writer();
+    else if ((s & __rw_readers_asleep) && !(v & __rw_readers_asleep))
+        __wake_word(&__state_, numeric_limits<int>::max());
 }
 
 _LIBCPP_END_NAMESPACE_STD
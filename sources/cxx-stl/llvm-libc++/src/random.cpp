@@ -16,33 +16,202 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/random.h>
+#endif
 
 _LIBCPP_BEGIN_NAMESPACE_STD
 
+#ifdef __NR_getrandom
+
+// Fills [p, p + n) from the kernel pool; returns false if getrandom is not
+// available so the caller can fall back to the device file.
+static bool
+__getrandom(void* __p, size_t __n)
+{
+    char* __b = static_cast<char*>(__p);
+    while (__n > 0)
+    {
+        long __r = syscall(__NR_getrandom, __b, __n, 0);
+        if (__r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOSYS)
+                return false;
+            __throw_system_error(errno, "random_device getrandom failed");
+        }
+        __b += __r;
+        __n -= static_cast<size_t>(__r);
+    }
+    return true;
+}
+
+#endif  // __NR_getrandom
+
+static void
+__read_all(int __f, void* __p, size_t __n)
+{
+    char* __b = static_cast<char*>(__p);
+    while (__n > 0)
+    {
+        ssize_t __r = read(__f, __b, __n);
+        if (__r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            __throw_system_error(errno, "random_device read failed");
+        }
+        if (__r == 0)
+            __throw_system_error(EIO, "random_device got EOF");
+        __b += __r;
+        __n -= static_cast<size_t>(__r);
+    }
+}
+
+// The default source ("/dev/urandom") is shared by every random_device and
+// read a block at a time; the buffer is kept here rather than in the object.
+static const size_t __src_buf_size = 128;
+static pthread_mutex_t __src_mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t __src_once = PTHREAD_ONCE_INIT;
+static bool __src_getrandom = false;
+static int __src_fd = -1;
+static unsigned __src_buf[__src_buf_size];
+static size_t __src_pos = __src_buf_size;   // first unread entry of __src_buf
+
+namespace
+{
+
+struct __src_lock
+{
+    __src_lock() {pthread_mutex_lock(&__src_mut);}
+    ~__src_lock() {pthread_mutex_unlock(&__src_mut);}
+};
+
+}  // unnamed namespace
+
+// The buffer is locked across fork and dropped in the child, so buffered
+// bytes are never handed out by both processes.
+static void
+__src_prepare()
+{
+    pthread_mutex_lock(&__src_mut);
+}
+
+static void
+__src_parent()
+{
+    pthread_mutex_unlock(&__src_mut);
+}
+
+static void
+__src_child()
+{
+    __src_pos = __src_buf_size;
+    pthread_mutex_unlock(&__src_mut);
+}
+
+static void
+__src_setup()
+{
+    pthread_atfork(__src_prepare, __src_parent, __src_child);
+#ifdef __NR_getrandom
+    unsigned __probe;
+    __src_getrandom = __getrandom(&__probe, sizeof(__probe));
+#endif
+}
+
+static void
+__src_read(void* __p, size_t __n)
+{
+#ifdef __NR_getrandom
+    if (__src_getrandom)
+    {
+        __getrandom(__p, __n);
+        return;
+    }
+#endif
+    __read_all(__src_fd, __p, __n);
+}
+
 random_device::random_device(const string& __token)
-    : __f_(open(__token.c_str(), O_RDONLY))
+    : __f_(-1)
 {
-    if (__f_ <= 0)
-        __throw_system_error(errno, ("random_device failed to open " + __token).c_str());
+    if (__token == "/dev/urandom")
+    {
+        pthread_once(&__src_once, __src_setup);
+        __src_lock __lk;
+        if (__src_getrandom || __src_fd >= 0 ||
+            (__src_fd = open(__token.c_str(), O_RDONLY)) >= 0)
+            return;
+    }
+    else if ((__f_ = open(__token.c_str(), O_RDONLY)) >= 0)
+        return;
+    __throw_system_error(errno, ("random_device failed to open " + __token).c_str());
 }
 
 random_device::~random_device()
 {
-    close(__f_);
+    if (__f_ >= 0)
+        close(__f_);
+}
+
+void
+random_device::__fill(result_type* __p, size_t __n)
+{
+    if (__f_ >= 0)
+    {
+        __read_all(__f_, __p, __n * sizeof(result_type));
+        return;
+    }
+    __src_lock __lk;
+    size_t __k = _VSTD::min(__n, __src_buf_size - __src_pos);
+    _VSTD::copy(__src_buf + __src_pos, __src_buf + __src_pos + __k, __p);
+    __src_pos += __k;
+    __p += __k;
+    __n -= __k;
+    if (__n == 0)
+        return;
+    // Requests of a whole buffer or more go straight to the destination.
+    if (__n >= __src_buf_size)
+    {
+        __src_read(__p, __n * sizeof(result_type));
+        return;
+    }
+    __src_read(__src_buf, sizeof(__src_buf));
+    _VSTD::copy(__src_buf, __src_buf + __n, __p);
+    __src_pos = __n;
 }
 
 unsigned
 random_device::operator()()
 {
-    unsigned r;
-    read(__f_, &r, sizeof(r));
-    return r;
+    result_type __r;
+    __fill(&__r, 1);
+    return __r;
 }
 
 double
 random_device::entropy() const _NOEXCEPT
 {
+#if defined(__linux__)
+    int __f = __f_ >= 0 ? __f_ : __src_fd;
+    if (__f < 0)
+        return numeric_limits<result_type>::digits;
+    int __ent;
+    if (ioctl(__f, RNDGETENTCNT, &__ent) < 0)
+        return 0;
+    if (__ent < 0)
+        return 0;
+    if (__ent > numeric_limits<result_type>::digits)
+        return numeric_limits<result_type>::digits;
+    return __ent;
+#else
     return 0;
+#endif
 }
 
 _LIBCPP_END_NAMESPACE_STD
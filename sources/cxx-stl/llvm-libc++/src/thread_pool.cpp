@@ -0,0 +1,320 @@
+//===------------------------- thread_pool.cpp ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "__thread_pool"
+#include "condition_variable"
+#include "deque"
+#include "mutex"
+#include "thread"
+
+#include <pthread.h>
+#include <sched.h>
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+// Bounded work-stealing executor. Each worker owns a deque: it pushes and
+// pops tasks spawned by itself at the back, idle workers steal from the front
+// of the others. Tasks submitted by non-pool threads are dealt round-robin.
+
+namespace
+{
+
+struct __pool_task
+{
+    void (*__fn_)(void*);
+    void* __arg_;
+};
+
+class __thread_pool
+{
+    struct __worker
+    {
+        __thread_pool* __pool_;
+        unsigned __index_;
+        mutex __mut_;
+        deque<__pool_task> __tasks_;
+    };
+
+    unsigned __size_;
+    __worker* __workers_;
+    mutex __mut_;
+    condition_variable __cv_;
+    unsigned __pending_;
+    unsigned __next_;
+    pthread_key_t __self_;
+
+    __thread_pool(const __thread_pool&);
+    __thread_pool& operator=(const __thread_pool&);
+
+    static void* __run(void* __p);
+    void __loop(unsigned __i);
+public:
+    __thread_pool();
+
+    static __thread_pool& __get();
+
+    unsigned __size() const {return __size_;}
+    // Index of the calling worker, or __size_ for threads outside the pool.
+    unsigned __self() const;
+
+    void __submit(unsigned __i, __pool_task __t);
+    void __submit(__pool_task __t);
+    bool __take(unsigned __i, __pool_task& __t);
+    unsigned __retract(void* __arg);
+};
+
+__thread_pool::__thread_pool()
+    : __size_(thread::hardware_concurrency()),
+      __pending_(0),
+      __next_(0)
+{
+    if (__size_ == 0)
+        __size_ = 2;
+    __workers_ = new __worker[__size_];
+    pthread_key_create(&__self_, 0);
+    for (unsigned __i = 0; __i < __size_; ++__i)
+    {
+        __workers_[__i].__pool_ = this;
+        __workers_[__i].__index_ = __i;
+    }
+    for (unsigned __i = 0; __i < __size_; ++__i)
+    {
+        // Workers live as long as the process
+        pthread_t __t;
+        if (pthread_create(&__t, 0, &__thread_pool::__run, &__workers_[__i]) == 0)
+            pthread_detach(__t);
+    }
+}
+
+__thread_pool&
+__thread_pool::__get()
+{
+    // Never destroyed: detached workers may still be running at exit
+    static __thread_pool* __p = new __thread_pool;
+    return *__p;
+}
+
+void*
+__thread_pool::__run(void* __p)
+{
+    __worker* __w = static_cast<__worker*>(__p);
+    pthread_setspecific(__w->__pool_->__self_, __w);
+    __w->__pool_->__loop(__w->__index_);
+    return 0;
+}
+
+unsigned
+__thread_pool::__self() const
+{
+    __worker* __w = static_cast<__worker*>(pthread_getspecific(__self_));
+    return __w != 0 ? __w->__index_ : __size_;
+}
+
+// __i may be __size_ for a thread outside the pool, which only steals.
+bool
+__thread_pool::__take(unsigned __i, __pool_task& __t)
+{
+    bool __found = false;
+    if (__i < __size_)
+    {
+        __worker& __w = __workers_[__i];
+        lock_guard<mutex> __lk(__w.__mut_);
+        if (!__w.__tasks_.empty())
+        {
+            __t = __w.__tasks_.back();
+            __w.__tasks_.pop_back();
+            __found = true;
+        }
+    }
+    for (unsigned __k = 1; !__found && __k <= __size_; ++__k)
+    {
+        unsigned __j = (__i + __k) % (__size_ + 1);
+        if (__j == __size_)
+            continue;
+        __worker& __v = __workers_[__j];
+        lock_guard<mutex> __lk(__v.__mut_);
+        if (!__v.__tasks_.empty())
+        {
+            __t = __v.__tasks_.front();
+            __v.__tasks_.pop_front();
+            __found = true;
+        }
+    }
+    if (__found)
+    {
+        lock_guard<mutex> __lk(__mut_);
+        --__pending_;
+    }
+    return __found;
+}
+
+void
+__thread_pool::__loop(unsigned __i)
+{
+    for (;;)
+    {
+        __pool_task __t;
+        if (__take(__i, __t))
+        {
+            __t.__fn_(__t.__arg_);
+            continue;
+        }
+        unique_lock<mutex> __lk(__mut_);
+        while (__pending_ == 0)
+            __cv_.wait(__lk);
+    }
+}
+
+void
+__thread_pool::__submit(unsigned __i, __pool_task __t)
+{
+    {
+        lock_guard<mutex> __lk(__mut_);
+        ++__pending_;
+    }
+    {
+        __worker& __w = __workers_[__i];
+        lock_guard<mutex> __lk(__w.__mut_);
+        __w.__tasks_.push_back(__t);
+    }
+    __cv_.notify_one();
+}
+
+void
+__thread_pool::__submit(__pool_task __t)
+{
+    unsigned __i = __self();
+    if (__i == __size_)
+    {
+        lock_guard<mutex> __lk(__mut_);
+        __i = __next_++ % __size_;
+    }
+    __submit(__i, __t);
+}
+
+// Removes the queued tasks whose argument is __arg and returns their number.
+unsigned
+__thread_pool::__retract(void* __arg)
+{
+    unsigned __n = 0;
+    for (unsigned __i = 0; __i < __size_; ++__i)
+    {
+        __worker& __w = __workers_[__i];
+        lock_guard<mutex> __lk(__w.__mut_);
+        for (deque<__pool_task>::iterator __j = __w.__tasks_.begin();
+                __j != __w.__tasks_.end();)
+        {
+            if (__j->__arg_ == __arg)
+            {
+                __j = __w.__tasks_.erase(__j);
+                ++__n;
+            }
+            else
+                ++__j;
+        }
+    }
+    if (__n != 0)
+    {
+        lock_guard<mutex> __lk(__mut_);
+        __pending_ -= __n;
+    }
+    return __n;
+}
+
+volatile unsigned __parallelism_cap = 0;
+
+// One __libcpp_parallel_for call. Indices are claimed one at a time from
+// __next_ by the caller and by helper tasks queued on the pool; __helpers_
+// counts the helpers that were queued and have not finished or been
+// retracted, and the caller's frame stays alive until it drops to zero.
+struct __parallel_job
+{
+    void (*__fn_)(void*, size_t);
+    void* __ctx_;
+    size_t __n_;
+    volatile size_t __next_;
+    volatile unsigned __helpers_;
+
+    void __work()
+    {
+        for (;;)
+        {
+            size_t __i = __sync_fetch_and_add(&__next_, 1);
+            if (__i >= __n_)
+                break;
+            __fn_(__ctx_, __i);
+        }
+    }
+
+    static void __help(void* __p)
+    {
+        __parallel_job* __j = static_cast<__parallel_job*>(__p);
+        __j->__work();
+        __sync_fetch_and_sub(&__j->__helpers_, 1);
+    }
+};
+
+}  // unnamed namespace
+
+void
+__libcpp_thread_pool_submit(void (*__fn)(void*), void* __arg)
+{
+    __pool_task __t = {__fn, __arg};
+    __thread_pool::__get().__submit(__t);
+}
+
+unsigned
+__libcpp_parallelism() _NOEXCEPT
+{
+    unsigned __n = __thread_pool::__get().__size() + 1;
+    unsigned __cap = __parallelism_cap;
+    return __cap != 0 && __cap < __n ? __cap : __n;
+}
+
+void
+__libcpp_set_parallelism(unsigned __n) _NOEXCEPT
+{
+    __parallelism_cap = __n;
+}
+
+void
+__libcpp_parallel_for(size_t __n, void (*__fn)(void*, size_t), void* __ctx)
+{
+    if (__n == 0)
+        return;
+    size_t __h = __libcpp_parallelism() - 1;
+    if (__h > __n - 1)
+        __h = __n - 1;
+    if (__h == 0)
+    {
+        for (size_t __i = 0; __i < __n; ++__i)
+            __fn(__ctx, __i);
+        return;
+    }
+    __thread_pool& __pool = __thread_pool::__get();
+    __parallel_job __job = {__fn, __ctx, __n, 0, static_cast<unsigned>(__h)};
+    __pool_task __t = {&__parallel_job::__help, &__job};
+    // Helpers of a worker go on its own deque where idle workers steal
+    // them; an outside thread spreads them over the workers.
+    unsigned __self = __pool.__self();
+    for (size_t __k = 0; __k < __h; ++__k)
+        __pool.__submit(__self != __pool.__size() ? __self
+                                                  : (__self + __k) % __pool.__size(),
+                        __t);
+    __job.__work();
+    unsigned __r = __pool.__retract(&__job);
+    if (__r != 0)
+        __sync_fetch_and_sub(&__job.__helpers_, __r);
+    // The remaining helpers are running their last index. The barrier of
+    // the read makes their writes visible to the caller.
+    while (__sync_fetch_and_add(&__job.__helpers_, 0) != 0)
+        sched_yield();
+}
+
+_LIBCPP_END_NAMESPACE_STD
@@ -9,12 +9,318 @@
 
 #include "valarray"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#define _LIBCPP_VALARRAY_NEON
+#elif defined(__ANDROID__) && defined(__ARM_ARCH_7A__)
+// armeabi-v7a builds valarray_neon.cpp with NEON enabled, but only devices
+// reporting the feature may run it.
+#define _LIBCPP_VALARRAY_NEON
+#define _LIBCPP_VALARRAY_NEON_CHECK
+#include <cpu-features.h>
+#endif
+
 _LIBCPP_BEGIN_NAMESPACE_STD
 
 template valarray<size_t>::valarray(size_t);
 template valarray<size_t>::~valarray();
 template void valarray<size_t>::resize(size_t, size_t);
 
+#ifdef _LIBCPP_VALARRAY_NEON
+
+// Defined in valarray_neon.cpp. Doubles have NEON lanes on AArch64 only.
+_LIBCPP_HIDDEN void __valarray_neon_binary(__valarray_op, float*, const float*, bool,
+                                           const float*, bool, size_t);
+_LIBCPP_HIDDEN void __valarray_neon_binary(__valarray_op, int*, const int*, bool,
+                                           const int*, bool, size_t);
+_LIBCPP_HIDDEN bool __valarray_neon_reduce(int, const float*, size_t, float&);
+_LIBCPP_HIDDEN bool __valarray_neon_reduce(int, const int*, size_t, int&);
+#ifdef __aarch64__
+_LIBCPP_HIDDEN void __valarray_neon_binary(__valarray_op, double*, const double*, bool,
+                                           const double*, bool, size_t);
+_LIBCPP_HIDDEN bool __valarray_neon_reduce(int, const double*, size_t, double&);
+#endif
+
+#endif  // _LIBCPP_VALARRAY_NEON
+
+namespace
+{
+
+#include "valarray_simd.inc"
+
+// One lane; the kernels reduce to plain loops.
+template <class _Tp>
+struct __scalar_lanes
+{
+    typedef _Tp value_type;
+    typedef _Tp __vec;
+    static const size_t __width = 1;
+
+    static __vec __load(const _Tp* __p) {return *__p;}
+    static void __store(_Tp* __p, __vec __x) {*__p = __x;}
+    static __vec __splat(_Tp __x) {return __x;}
+    static void __lanes(_Tp* __p, __vec __x) {*__p = __x;}
+    static __vec __add(__vec __x, __vec __y) {return __x + __y;}
+    static __vec __sub(__vec __x, __vec __y) {return __x - __y;}
+    static __vec __mul(__vec __x, __vec __y) {return __x * __y;}
+    static __vec __div(__vec __x, __vec __y) {return __x / __y;}
+    static __vec __min(__vec __x, __vec __y) {return __y < __x ? __y : __x;}
+    static __vec __max(__vec __x, __vec __y) {return __x < __y ? __y : __x;}
+};
+
+#if defined(__SSE2__)
+
+struct __sse2_float
+{
+    typedef float value_type;
+    typedef __m128 __vec;
+    static const size_t __width = 4;
+
+    static __vec __load(const float* __p) {return _mm_loadu_ps(__p);}
+    static void __store(float* __p, __vec __x) {_mm_storeu_ps(__p, __x);}
+    static __vec __splat(float __x) {return _mm_set1_ps(__x);}
+    static void __lanes(float* __p, __vec __x) {_mm_storeu_ps(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return _mm_add_ps(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return _mm_sub_ps(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y) {return _mm_mul_ps(__x, __y);}
+    static __vec __div(__vec __x, __vec __y) {return _mm_div_ps(__x, __y);}
+    static __vec __min(__vec __x, __vec __y) {return _mm_min_ps(__x, __y);}
+    static __vec __max(__vec __x, __vec __y) {return _mm_max_ps(__x, __y);}
+};
+
+struct __sse2_double
+{
+    typedef double value_type;
+    typedef __m128d __vec;
+    static const size_t __width = 2;
+
+    static __vec __load(const double* __p) {return _mm_loadu_pd(__p);}
+    static void __store(double* __p, __vec __x) {_mm_storeu_pd(__p, __x);}
+    static __vec __splat(double __x) {return _mm_set1_pd(__x);}
+    static void __lanes(double* __p, __vec __x) {_mm_storeu_pd(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return _mm_add_pd(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return _mm_sub_pd(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y) {return _mm_mul_pd(__x, __y);}
+    static __vec __div(__vec __x, __vec __y) {return _mm_div_pd(__x, __y);}
+    static __vec __min(__vec __x, __vec __y) {return _mm_min_pd(__x, __y);}
+    static __vec __max(__vec __x, __vec __y) {return _mm_max_pd(__x, __y);}
+};
+
+// SSE2 has no 32-bit lane multiply, minimum or maximum: multiply the even
+// and the odd lanes as 64-bit products and keep their low halves, and blend
+// on a comparison. There is no integer division at all.
+struct __sse2_int
+{
+    typedef int value_type;
+    typedef __m128i __vec;
+    static const size_t __width = 4;
+
+    static __vec __load(const int* __p)
+        {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(__p));}
+    static void __store(int* __p, __vec __x)
+        {_mm_storeu_si128(reinterpret_cast<__m128i*>(__p), __x);}
+    static __vec __splat(int __x) {return _mm_set1_epi32(__x);}
+    static void __lanes(int* __p, __vec __x) {__store(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return _mm_add_epi32(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return _mm_sub_epi32(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y)
+    {
+        __m128i __even = _mm_mul_epu32(__x, __y);
+        __m128i __odd = _mm_mul_epu32(_mm_srli_epi64(__x, 32), _mm_srli_epi64(__y, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(__even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(__odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+    static __vec __div(__vec __x, __vec __y)
+    {
+        int __a[4];
+        int __b[4];
+        __store(__a, __x);
+        __store(__b, __y);
+        for (int __i = 0; __i < 4; ++__i)
+            __a[__i] /= __b[__i];
+        return __load(__a);
+    }
+    static __vec __min(__vec __x, __vec __y)
+    {
+        __m128i __gt = _mm_cmpgt_epi32(__x, __y);
+        return _mm_or_si128(_mm_and_si128(__gt, __y), _mm_andnot_si128(__gt, __x));
+    }
+    static __vec __max(__vec __x, __vec __y)
+    {
+        __m128i __gt = _mm_cmpgt_epi32(__y, __x);
+        return _mm_or_si128(_mm_and_si128(__gt, __y), _mm_andnot_si128(__gt, __x));
+    }
+};
+
+template <class _Tp> struct __native_lanes;
+template <> struct __native_lanes<float> {typedef __sse2_float type;};
+template <> struct __native_lanes<double> {typedef __sse2_double type;};
+template <> struct __native_lanes<int> {typedef __sse2_int type;};
+
+#else  // __SSE2__
+
+template <class _Tp> struct __native_lanes {typedef __scalar_lanes<_Tp> type;};
+
+#endif  // __SSE2__
+
+#ifdef _LIBCPP_VALARRAY_NEON
+
+inline bool
+__has_neon()
+{
+#ifdef _LIBCPP_VALARRAY_NEON_CHECK
+    static const bool __b = android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
+                            (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0;
+    return __b;
+#else
+    return true;
+#endif
+}
+
+#endif  // _LIBCPP_VALARRAY_NEON
+
+template <class _Tp>
+void
+__binary(__valarray_op __op, _Tp* __r, const _Tp* __a, bool __as, const _Tp* __b, bool __bs,
+         size_t __n)
+{
+    __simd_binary<typename __native_lanes<_Tp>::type>(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+template <class _Tp>
+bool
+__reduce(__valarray_reduce_kind __k, const _Tp* __p, size_t __n, _Tp& __r)
+{
+    return __simd_reduce<typename __native_lanes<_Tp>::type>(__k, __p, __n, __r);
+}
+
+#ifdef _LIBCPP_VALARRAY_NEON
+
+template <>
+void
+__binary(__valarray_op __op, float* __r, const float* __a, bool __as, const float* __b,
+         bool __bs, size_t __n)
+{
+    if (__has_neon())
+        __valarray_neon_binary(__op, __r, __a, __as, __b, __bs, __n);
+    else
+        __simd_binary<__scalar_lanes<float> >(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+template <>
+void
+__binary(__valarray_op __op, int* __r, const int* __a, bool __as, const int* __b,
+         bool __bs, size_t __n)
+{
+    if (__has_neon())
+        __valarray_neon_binary(__op, __r, __a, __as, __b, __bs, __n);
+    else
+        __simd_binary<__scalar_lanes<int> >(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+template <>
+bool
+__reduce(__valarray_reduce_kind __k, const float* __p, size_t __n, float& __r)
+{
+    if (__has_neon())
+        return __valarray_neon_reduce(__k, __p, __n, __r);
+    return __simd_reduce<__scalar_lanes<float> >(__k, __p, __n, __r);
+}
+
+template <>
+bool
+__reduce(__valarray_reduce_kind __k, const int* __p, size_t __n, int& __r)
+{
+    if (__has_neon())
+        return __valarray_neon_reduce(__k, __p, __n, __r);
+    return __simd_reduce<__scalar_lanes<int> >(__k, __p, __n, __r);
+}
+
+#ifdef __aarch64__
+
+template <>
+void
+__binary(__valarray_op __op, double* __r, const double* __a, bool __as, const double* __b,
+         bool __bs, size_t __n)
+{
+    __valarray_neon_binary(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+template <>
+bool
+__reduce(__valarray_reduce_kind __k, const double* __p, size_t __n, double& __r)
+{
+    return __valarray_neon_reduce(__k, __p, __n, __r);
+}
+
+#endif  // __aarch64__
+
+#endif  // _LIBCPP_VALARRAY_NEON
+
+template <class _Tp>
+_Tp
+__sum_of(const _Tp* __p, size_t __n)
+{
+    _Tp __r;
+    __reduce(__valarray_reduce_sum, __p, __n, __r);
+    return __r;
+}
+
+template <class _Tp>
+_Tp
+__min_of(const _Tp* __p, size_t __n)
+{
+    _Tp __r;
+    if (!__reduce(__valarray_reduce_min, __p, __n, __r))
+        __r = *_VSTD::min_element(__p, __p + __n);
+    return __r;
+}
+
+template <class _Tp>
+_Tp
+__max_of(const _Tp* __p, size_t __n)
+{
+    _Tp __r;
+    if (!__reduce(__valarray_reduce_max, __p, __n, __r))
+        __r = *_VSTD::max_element(__p, __p + __n);
+    return __r;
+}
+
+}  // unnamed namespace
+
+void
+__valarray_kernel(__valarray_op __op, float* __r, const float* __a, bool __as,
+                  const float* __b, bool __bs, size_t __n)
+{
+    __binary(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+void
+__valarray_kernel(__valarray_op __op, double* __r, const double* __a, bool __as,
+                  const double* __b, bool __bs, size_t __n)
+{
+    __binary(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+void
+__valarray_kernel(__valarray_op __op, int* __r, const int* __a, bool __as,
+                  const int* __b, bool __bs, size_t __n)
+{
+    __binary(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+float __valarray_sum(const float* __p, size_t __n) {return __sum_of(__p, __n);}
+double __valarray_sum(const double* __p, size_t __n) {return __sum_of(__p, __n);}
+int __valarray_sum(const int* __p, size_t __n) {return __sum_of(__p, __n);}
+float __valarray_min(const float* __p, size_t __n) {return __min_of(__p, __n);}
+double __valarray_min(const double* __p, size_t __n) {return __min_of(__p, __n);}
+int __valarray_min(const int* __p, size_t __n) {return __min_of(__p, __n);}
+float __valarray_max(const float* __p, size_t __n) {return __max_of(__p, __n);}
+double __valarray_max(const double* __p, size_t __n) {return __max_of(__p, __n);}
+int __valarray_max(const int* __p, size_t __n) {return __max_of(__p, __n);}
+
 void
 gslice::__init(size_t __start)
 {
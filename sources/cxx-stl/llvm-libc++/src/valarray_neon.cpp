@@ -0,0 +1,161 @@
+//===---------------------- valarray_neon.cpp -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// NEON valarray kernels. On armeabi-v7a this is the only file built with
+// NEON enabled, and valarray.cpp calls it after checking the CPU; elsewhere
+// it compiles to nothing.
+
+#include "valarray"
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+
+#include <arm_neon.h>
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace
+{
+
+#include "valarray_simd.inc"
+
+struct __neon_float
+{
+    typedef float value_type;
+    typedef float32x4_t __vec;
+    static const size_t __width = 4;
+
+    static __vec __load(const float* __p) {return vld1q_f32(__p);}
+    static void __store(float* __p, __vec __x) {vst1q_f32(__p, __x);}
+    static __vec __splat(float __x) {return vdupq_n_f32(__x);}
+    static void __lanes(float* __p, __vec __x) {vst1q_f32(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return vaddq_f32(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return vsubq_f32(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y) {return vmulq_f32(__x, __y);}
+    static __vec __div(__vec __x, __vec __y)
+    {
+#ifdef __aarch64__
+        return vdivq_f32(__x, __y);
+#else
+        // ARMv7 NEON only estimates reciprocals; divide exactly lane by lane.
+        float __a[4];
+        float __b[4];
+        vst1q_f32(__a, __x);
+        vst1q_f32(__b, __y);
+        for (int __i = 0; __i < 4; ++__i)
+            __a[__i] /= __b[__i];
+        return vld1q_f32(__a);
+#endif
+    }
+    static __vec __min(__vec __x, __vec __y) {return vminq_f32(__x, __y);}
+    static __vec __max(__vec __x, __vec __y) {return vmaxq_f32(__x, __y);}
+};
+
+struct __neon_int
+{
+    typedef int value_type;
+    typedef int32x4_t __vec;
+    static const size_t __width = 4;
+
+    static __vec __load(const int* __p) {return vld1q_s32(__p);}
+    static void __store(int* __p, __vec __x) {vst1q_s32(__p, __x);}
+    static __vec __splat(int __x) {return vdupq_n_s32(__x);}
+    static void __lanes(int* __p, __vec __x) {vst1q_s32(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return vaddq_s32(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return vsubq_s32(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y) {return vmulq_s32(__x, __y);}
+    static __vec __div(__vec __x, __vec __y)
+    {
+        int __a[4];
+        int __b[4];
+        vst1q_s32(__a, __x);
+        vst1q_s32(__b, __y);
+        for (int __i = 0; __i < 4; ++__i)
+            __a[__i] /= __b[__i];
+        return vld1q_s32(__a);
+    }
+    static __vec __min(__vec __x, __vec __y) {return vminq_s32(__x, __y);}
+    static __vec __max(__vec __x, __vec __y) {return vmaxq_s32(__x, __y);}
+};
+
+#ifdef __aarch64__
+
+struct __neon_double
+{
+    typedef double value_type;
+    typedef float64x2_t __vec;
+    static const size_t __width = 2;
+
+    static __vec __load(const double* __p) {return vld1q_f64(__p);}
+    static void __store(double* __p, __vec __x) {vst1q_f64(__p, __x);}
+    static __vec __splat(double __x) {return vdupq_n_f64(__x);}
+    static void __lanes(double* __p, __vec __x) {vst1q_f64(__p, __x);}
+    static __vec __add(__vec __x, __vec __y) {return vaddq_f64(__x, __y);}
+    static __vec __sub(__vec __x, __vec __y) {return vsubq_f64(__x, __y);}
+    static __vec __mul(__vec __x, __vec __y) {return vmulq_f64(__x, __y);}
+    static __vec __div(__vec __x, __vec __y) {return vdivq_f64(__x, __y);}
+    static __vec __min(__vec __x, __vec __y) {return vminq_f64(__x, __y);}
+    static __vec __max(__vec __x, __vec __y) {return vmaxq_f64(__x, __y);}
+};
+
+#endif  // __aarch64__
+
+}  // unnamed namespace
+
+_LIBCPP_HIDDEN
+void
+__valarray_neon_binary(__valarray_op __op, float* __r, const float* __a, bool __as,
+                       const float* __b, bool __bs, size_t __n)
+{
+    __simd_binary<__neon_float>(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+_LIBCPP_HIDDEN
+void
+__valarray_neon_binary(__valarray_op __op, int* __r, const int* __a, bool __as,
+                       const int* __b, bool __bs, size_t __n)
+{
+    __simd_binary<__neon_int>(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+_LIBCPP_HIDDEN
+bool
+__valarray_neon_reduce(int __k, const float* __p, size_t __n, float& __r)
+{
+    return __simd_reduce<__neon_float>(static_cast<__valarray_reduce_kind>(__k), __p, __n, __r);
+}
+
+_LIBCPP_HIDDEN
+bool
+__valarray_neon_reduce(int __k, const int* __p, size_t __n, int& __r)
+{
+    return __simd_reduce<__neon_int>(static_cast<__valarray_reduce_kind>(__k), __p, __n, __r);
+}
+
+#ifdef __aarch64__
+
+_LIBCPP_HIDDEN
+void
+__valarray_neon_binary(__valarray_op __op, double* __r, const double* __a, bool __as,
+                       const double* __b, bool __bs, size_t __n)
+{
+    __simd_binary<__neon_double>(__op, __r, __a, __as, __b, __bs, __n);
+}
+
+_LIBCPP_HIDDEN
+bool
+__valarray_neon_reduce(int __k, const double* __p, size_t __n, double& __r)
+{
+    return __simd_reduce<__neon_double>(static_cast<__valarray_reduce_kind>(__k), __p, __n, __r);
+}
+
+#endif  // __aarch64__
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif  // defined(__ARM_NEON__) || defined(__aarch64__)
@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <execution>
+
+// template <class ExecutionPolicy, class ForwardIterator, class Function>
+//   void for_each(ExecutionPolicy&& exec, ForwardIterator first, ForwardIterator last,
+//                 Function f);
+// template <class ExecutionPolicy, class ForwardIterator, class Size, class Function>
+//   ForwardIterator for_each_n(ExecutionPolicy&& exec, ForwardIterator first, Size n,
+//                              Function f);
+// template <class ExecutionPolicy, class ForwardIterator1, class ForwardIterator2,
+//           class UnaryOperation>
+//   ForwardIterator2 transform(ExecutionPolicy&& exec, ForwardIterator1 first,
+//                              ForwardIterator1 last, ForwardIterator2 result,
+//                              UnaryOperation op);
+// template <class ExecutionPolicy, class ForwardIterator1, class ForwardIterator2,
+//           class ForwardIterator, class BinaryOperation>
+//   ForwardIterator transform(ExecutionPolicy&& exec, ForwardIterator1 first1,
+//                             ForwardIterator1 last1, ForwardIterator2 first2,
+//                             ForwardIterator result, BinaryOperation binary_op);
+
+#include <execution>
+#include <functional>
+#include <list>
+#include <vector>
+#include <cassert>
+
+struct twice
+{
+    void operator()(int& x) const {x *= 2;}
+};
+
+int negate_int(int x) {return -x;}
+
+template <class Policy>
+void
+test(const Policy& policy, int n)
+{
+    std::vector<int> v(n);
+    for (int i = 0; i < n; ++i)
+        v[i] = i;
+    std::for_each(policy, v.begin(), v.end(), twice());
+    for (int i = 0; i < n; ++i)
+        assert(v[i] == 2 * i);
+    assert(std::for_each_n(policy, v.begin(), n / 2, twice()) == v.begin() + n / 2);
+    for (int i = 0; i < n; ++i)
+        assert(v[i] == (i < n / 2 ? 4 * i : 2 * i));
+
+    std::vector<int> w(n);
+    assert(std::transform(policy, v.begin(), v.end(), w.begin(), negate_int) == w.end());
+    for (int i = 0; i < n; ++i)
+        assert(w[i] == -v[i]);
+    assert(std::transform(policy, v.begin(), v.end(), w.begin(), w.begin(),
+                          std::plus<int>()) == w.end());
+    for (int i = 0; i < n; ++i)
+        assert(w[i] == 0);
+}
+
+int main()
+{
+    const int sizes[] = {0, 1, 1000, 100003, 1000000};
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+    {
+        test(std::execution::seq, sizes[i]);
+        test(std::execution::par, sizes[i]);
+        test(std::execution::par_unseq, sizes[i]);
+    }
+    {
+        // not random access: run sequentially
+        std::list<int> l(10, 1);
+        std::for_each(std::execution::par, l.begin(), l.end(), twice());
+        for (std::list<int>::iterator i = l.begin(); i != l.end(); ++i)
+            assert(*i == 2);
+    }
+}
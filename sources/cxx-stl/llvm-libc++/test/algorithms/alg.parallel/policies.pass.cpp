@@ -0,0 +1,35 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <execution>
+
+// class sequenced_policy;
+// class parallel_policy;
+// class parallel_unsequenced_policy;
+// template <class T> struct is_execution_policy;
+
+#include <execution>
+#include <type_traits>
+
+static_assert(std::is_execution_policy<std::execution::sequenced_policy>::value, "");
+static_assert(std::is_execution_policy<std::execution::parallel_policy>::value, "");
+static_assert(std::is_execution_policy<std::execution::parallel_unsequenced_policy>::value, "");
+static_assert(!std::is_execution_policy<int>::value, "");
+static_assert((std::is_same<decltype(std::execution::seq),
+                            const std::execution::sequenced_policy>::value), "");
+static_assert((std::is_same<decltype(std::execution::par),
+                            const std::execution::parallel_policy>::value), "");
+static_assert((std::is_same<decltype(std::execution::par_unseq),
+                            const std::execution::parallel_unsequenced_policy>::value), "");
+
+int main()
+{
+    std::execution::parallel_policy p = std::execution::par;
+    (void)p;
+}
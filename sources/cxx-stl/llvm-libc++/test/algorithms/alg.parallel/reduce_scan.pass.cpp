@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <execution>
+
+// template <class ExecutionPolicy, class ForwardIterator, class T, class BinaryOperation>
+//   T reduce(ExecutionPolicy&& exec, ForwardIterator first, ForwardIterator last, T init,
+//            BinaryOperation binary_op);
+// template <class ExecutionPolicy, class ForwardIterator1, class ForwardIterator2, class T>
+//   T transform_reduce(ExecutionPolicy&& exec, ForwardIterator1 first1,
+//                      ForwardIterator1 last1, ForwardIterator2 first2, T init);
+// template <class ExecutionPolicy, class ForwardIterator1, class ForwardIterator2>
+//   ForwardIterator2 inclusive_scan(ExecutionPolicy&& exec, ForwardIterator1 first,
+//                                   ForwardIterator1 last, ForwardIterator2 result);
+// template <class ExecutionPolicy, class ForwardIterator1, class ForwardIterator2, class T>
+//   ForwardIterator2 exclusive_scan(ExecutionPolicy&& exec, ForwardIterator1 first,
+//                                   ForwardIterator1 last, ForwardIterator2 result, T init);
+
+#include <execution>
+#include <functional>
+#include <list>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <cassert>
+
+long long square(long long x) {return x * x;}
+
+template <class Policy>
+void
+test(const Policy& policy, int n)
+{
+    std::vector<long long> v(n);
+    for (int i = 0; i < n; ++i)
+        v[i] = i % 1000 - 300;
+    long long sum = std::accumulate(v.begin(), v.end(), 0LL);
+    assert(std::reduce(policy, v.begin(), v.end()) == sum);
+    assert(std::reduce(policy, v.begin(), v.end(), 5LL) == sum + 5);
+    assert(std::reduce(policy, v.begin(), v.end(), 5LL, std::plus<long long>()) == sum + 5);
+    assert(std::transform_reduce(policy, v.begin(), v.end(), v.begin(), 1LL) ==
+           std::inner_product(v.begin(), v.end(), v.begin(), 1LL));
+    assert(std::transform_reduce(policy, v.begin(), v.end(), 0LL, std::plus<long long>(),
+                                 square) ==
+           std::inner_product(v.begin(), v.end(), v.begin(), 0LL));
+
+    std::vector<long long> s(n);
+    std::partial_sum(v.begin(), v.end(), s.begin());
+    std::vector<long long> w(n);
+    assert(std::inclusive_scan(policy, v.begin(), v.end(), w.begin()) == w.end());
+    assert(w == s);
+    std::inclusive_scan(policy, v.begin(), v.end(), w.begin(), std::plus<long long>(), 7LL);
+    for (int i = 0; i < n; ++i)
+        assert(w[i] == s[i] + 7);
+    assert(std::exclusive_scan(policy, v.begin(), v.end(), w.begin(), 7LL) == w.end());
+    for (int i = 0; i < n; ++i)
+        assert(w[i] == (i == 0 ? 7 : s[i - 1] + 7));
+    // in place
+    w = v;
+    std::inclusive_scan(policy, w.begin(), w.end(), w.begin());
+    assert(w == s);
+    w = v;
+    std::exclusive_scan(policy, w.begin(), w.end(), w.begin(), 0LL);
+    for (int i = 0; i < n; ++i)
+        assert(w[i] == (i == 0 ? 0 : s[i - 1]));
+}
+
+int main()
+{
+    const int sizes[] = {0, 1, 2, 1000, 4096, 100003, 1000000};
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+    {
+        test(std::execution::seq, sizes[i]);
+        test(std::execution::par, sizes[i]);
+        test(std::execution::par_unseq, sizes[i]);
+    }
+    {
+        // the partial results are combined in order
+        std::vector<std::string> v(20000, "a");
+        v[0] = "b";
+        v[19999] = "c";
+        std::string r = std::reduce(std::execution::par, v.begin(), v.end(), std::string("x"));
+        assert(r.size() == 20001);
+        assert(r[0] == 'x' && r[1] == 'b' && r[20000] == 'c');
+        std::vector<std::string> s(20000);
+        std::inclusive_scan(std::execution::par, v.begin(), v.end(), s.begin());
+        assert(s[19999] == r.substr(1));
+    }
+    {
+        std::list<int> l(10, 1);
+        assert(std::reduce(std::execution::par, l.begin(), l.end()) == 10);
+    }
+}
@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <execution>
+
+// template <class ExecutionPolicy, class RandomAccessIterator, class Compare>
+//   void sort(ExecutionPolicy&& exec, RandomAccessIterator first,
+//             RandomAccessIterator last, Compare comp);
+
+#include <execution>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cassert>
+
+template <class Policy>
+void
+test(const Policy& policy, unsigned n, unsigned range)
+{
+    std::vector<unsigned> v(n);
+    unsigned x = 12345;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        x = x * 1103515245 + 12345;
+        v[i] = (x >> 8) % range;
+    }
+    std::vector<unsigned> s(v);
+    std::sort(s.begin(), s.end());
+    std::vector<unsigned> w(v);
+    std::sort(policy, w.begin(), w.end());
+    assert(w == s);
+    std::sort(policy, v.begin(), v.end(), std::greater<unsigned>());
+    assert(std::equal(v.begin(), v.end(), s.rbegin()));
+}
+
+struct less_ptr
+{
+    bool operator()(const std::unique_ptr<int>& x, const std::unique_ptr<int>& y) const
+        {return *x < *y;}
+};
+
+int main()
+{
+    const unsigned sizes[] = {0, 1, 2, 1000, 40000, 100003, 1000000};
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+    {
+        test(std::execution::seq, sizes[i], 0xFFFFFF);
+        test(std::execution::par, sizes[i], 0xFFFFFF);
+        test(std::execution::par_unseq, sizes[i], 0xFFFFFF);
+        // many duplicates
+        test(std::execution::par, sizes[i], 3);
+    }
+    {
+        // move only elements
+        const int n = 100000;
+        std::vector<std::unique_ptr<int> > v;
+        for (int i = 0; i < n; ++i)
+            v.push_back(std::unique_ptr<int>(new int((i * 7919) % n)));
+        std::sort(std::execution::par, v.begin(), v.end(), less_ptr());
+        for (int i = 0; i < n; ++i)
+            assert(*v[i] == i);
+    }
+}
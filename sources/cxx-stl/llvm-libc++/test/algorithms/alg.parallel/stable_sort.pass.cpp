@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <execution>
+
+// template <class ExecutionPolicy, class RandomAccessIterator, class Compare>
+//   void stable_sort(ExecutionPolicy&& exec, RandomAccessIterator first,
+//                    RandomAccessIterator last, Compare comp);
+
+#include <execution>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cassert>
+
+typedef std::pair<unsigned, unsigned> P;
+
+struct first_less
+{
+    bool operator()(const P& x, const P& y) const {return x.first < y.first;}
+};
+
+template <class Policy>
+void
+test(const Policy& policy, unsigned n, unsigned range)
+{
+    std::vector<P> v(n);
+    unsigned x = 54321;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        x = x * 1103515245 + 12345;
+        v[i] = P((x >> 8) % range, i);
+    }
+    std::vector<P> s(v);
+    std::stable_sort(s.begin(), s.end(), first_less());
+    std::stable_sort(policy, v.begin(), v.end(), first_less());
+    assert(v == s);
+}
+
+struct less_ptr
+{
+    bool operator()(const std::unique_ptr<int>& x, const std::unique_ptr<int>& y) const
+        {return *x < *y;}
+};
+
+int main()
+{
+    const unsigned sizes[] = {0, 1, 2, 1000, 40000, 100003, 1000000};
+    for (unsigned i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+    {
+        test(std::execution::seq, sizes[i], 0xFFFFFF);
+        test(std::execution::par, sizes[i], 0xFFFFFF);
+        test(std::execution::par, sizes[i], 100);
+        test(std::execution::par_unseq, sizes[i], 2);
+    }
+    {
+        // move only elements
+        const int n = 100000;
+        std::vector<std::unique_ptr<int> > v;
+        for (int i = 0; i < n; ++i)
+            v.push_back(std::unique_ptr<int>(new int(n - 1 - i)));
+        std::stable_sort(std::execution::par, v.begin(), v.end(), less_ptr());
+        for (int i = 0; i < n; ++i)
+            assert(*v[i] == i);
+    }
+}
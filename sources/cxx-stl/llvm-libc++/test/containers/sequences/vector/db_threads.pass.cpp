@@ -0,0 +1,66 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <vector>
+
+// Debug mode iterator tracking from several threads at once: each thread
+// works on its own containers while all of them iterate a shared one.
+
+#define _LIBCPP_DEBUG2 1
+
+#include <vector>
+#include <list>
+#include <thread>
+#include <cassert>
+
+const std::vector<int>* shared;
+
+void
+work(int seed)
+{
+    for (int round = 0; round < 200; ++round)
+    {
+        std::vector<int> v(50, seed);
+        std::vector<int> w(20, seed + 1);
+        std::vector<int>::iterator i = v.begin() + 10;
+        std::vector<int>::iterator j = i;
+        assert(*j == seed);
+        v.pop_back();
+        assert(j == i && *(j + 5) == seed);
+        v.swap(w);
+        assert(*i == seed && i + 39 == w.end());
+        assert(v.size() == 20 && w.size() == 49);
+
+        std::list<int> a(10, seed);
+        std::list<int> b(5, seed + 2);
+        std::list<int>::iterator k = b.begin();
+        a.splice(a.end(), b);
+        assert(*k == seed + 2 && b.empty() && a.size() == 15);
+        a.swap(b);
+        assert(*k == seed + 2 && b.size() == 15);
+
+        long sum = 0;
+        for (std::vector<int>::const_iterator p = shared->begin(); p != shared->end(); ++p)
+            sum += *p;
+        assert(sum == 4950);
+    }
+}
+
+int main()
+{
+    std::vector<int> s;
+    for (int i = 0; i < 100; ++i)
+        s.push_back(i);
+    shared = &s;
+    std::thread t[4];
+    for (int i = 0; i < 4; ++i)
+        t[i] = std::thread(work, i * 10);
+    for (int i = 0; i < 4; ++i)
+        t[i].join();
+}
@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <ext/flat_hash_map>
+
+// Random inserts, lookups and erases checked against unordered_map, across
+// several rehashes and with many tombstones.
+
+#include <ext/flat_hash_map>
+#include <unordered_map>
+#include <string>
+#include <cassert>
+
+int main()
+{
+    {
+        __gnu_cxx::flat_hash_map<int, int> m;
+        std::unordered_map<int, int> r;
+        assert(m.empty());
+        assert(m.find(1) == m.end());
+        assert(m.begin() == m.end());
+        unsigned x = 12345;
+        for (int i = 0; i < 200000; ++i)
+        {
+            x = x * 1103515245 + 12345;
+            int k = (x >> 8) % 5000;
+            switch ((x >> 4) % 4)
+            {
+            case 0:
+            case 1:
+                assert(m.insert(std::make_pair(k, i)).second ==
+                       r.insert(std::make_pair(k, i)).second);
+                break;
+            case 2:
+                assert(m.erase(k) == r.erase(k));
+                break;
+            case 3:
+                {
+                    __gnu_cxx::flat_hash_map<int, int>::iterator j = m.find(k);
+                    std::unordered_map<int, int>::iterator l = r.find(k);
+                    assert((j == m.end()) == (l == r.end()));
+                    if (j != m.end())
+                        assert(j->first == k && j->second == l->second);
+                }
+                break;
+            }
+            assert(m.size() == r.size());
+        }
+        assert(m.load_factor() <= m.max_load_factor());
+        size_t n = 0;
+        for (__gnu_cxx::flat_hash_map<int, int>::const_iterator i = m.begin();
+                i != m.end(); ++i, ++n)
+            assert(r.at(i->first) == i->second);
+        assert(n == r.size());
+        m.clear();
+        assert(m.empty());
+        assert(m.begin() == m.end());
+        assert(m.count(1) == 0);
+    }
+    {
+        __gnu_cxx::flat_hash_map<std::string, int> m;
+        for (int i = 0; i < 1000; ++i)
+            m[std::to_string(i)] = i;
+        assert(m.size() == 1000);
+        for (int i = 0; i < 1000; ++i)
+            assert(m.at(std::to_string(i)) == i);
+        assert(m.try_emplace("7", 70).second == false);
+        assert(m["7"] == 7);
+        assert(m.emplace("1000", 1000).second);
+        __gnu_cxx::flat_hash_map<std::string, int> c(m);
+        assert(c == m);
+        c["1"] = 2;
+        assert(c != m);
+        __gnu_cxx::flat_hash_map<std::string, int> v(std::move(c));
+        assert(c.empty());
+        assert(v.size() == 1001);
+        try
+        {
+            m.at("x");
+            assert(false);
+        }
+        catch (const std::out_of_range&)
+        {
+        }
+        // Erasing while iterating visits every element once.
+        size_t n = 0;
+        for (__gnu_cxx::flat_hash_map<std::string, int>::iterator i = m.begin();
+                i != m.end();)
+        {
+            i = m.erase(i);
+            ++n;
+        }
+        assert(n == 1001);
+        assert(m.empty());
+    }
+    {
+        __gnu_cxx::flat_hash_map<int, int> m;
+        m.reserve(1000);
+        size_t c = m.capacity();
+        assert(c >= 1000);
+        for (int i = 0; i < 1000; ++i)
+            m[i] = i;
+        assert(m.capacity() == c);
+        m.clear();
+        m.rehash(0);
+        assert(m.capacity() == 0);
+    }
+}
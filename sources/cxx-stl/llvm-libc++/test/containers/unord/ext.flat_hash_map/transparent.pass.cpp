@@ -0,0 +1,49 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <ext/flat_hash_map>
+
+// Heterogeneous find, count, at and erase with a transparent hash and
+// key_equal.
+
+#include <ext/flat_hash_map>
+#include <string>
+#include <cstring>
+#include <cassert>
+
+struct StrHash
+{
+    typedef void is_transparent;
+    size_t operator()(const char* s) const
+        {return std::__do_string_hash(s, s + std::strlen(s));}
+    size_t operator()(const std::string& s) const {return (*this)(s.c_str());}
+};
+
+struct StrEq
+{
+    typedef void is_transparent;
+    bool operator()(const std::string& x, const char* y) const {return x == y;}
+    bool operator()(const std::string& x, const std::string& y) const {return x == y;}
+};
+
+int main()
+{
+    __gnu_cxx::flat_hash_map<std::string, int, StrHash, StrEq> m;
+    m["one"] = 1;
+    m["two"] = 2;
+    const char* k = "two";
+    assert(m.find(k) != m.end());
+    assert(m.find(k)->second == 2);
+    assert(m.count("three") == 0);
+    assert(m.at("one") == 1);
+    assert(m.erase("one") == 1);
+    assert(m.size() == 1);
+    const __gnu_cxx::flat_hash_map<std::string, int, StrHash, StrEq>& c = m;
+    assert(c.find("two") == c.begin());
+}
@@ -0,0 +1,54 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <ext/flat_hash_set>
+
+#include <ext/flat_hash_set>
+#include <unordered_set>
+#include <cassert>
+
+int main()
+{
+    {
+        __gnu_cxx::flat_hash_set<unsigned> s;
+        std::unordered_set<unsigned> r;
+        unsigned x = 1;
+        for (int i = 0; i < 100000; ++i)
+        {
+            x = x * 1664525 + 1013904223;
+            unsigned k = x % 3000;
+            if (x & 0x10000)
+                assert(s.insert(k).second == r.insert(k).second);
+            else
+                assert(s.erase(k) == r.erase(k));
+            assert(s.count(k) == r.count(k));
+        }
+        assert(s.size() == r.size());
+        for (__gnu_cxx::flat_hash_set<unsigned>::iterator i = s.begin(); i != s.end(); ++i)
+            assert(r.count(*i) == 1);
+        __gnu_cxx::flat_hash_set<unsigned> t(r.begin(), r.end());
+        assert(t == s);
+        s.erase(s.begin(), s.end());
+        assert(s.empty());
+        assert(t != s);
+    }
+    {
+        __gnu_cxx::flat_hash_set<int> s = {1, 2, 3, 2, 1};
+        assert(s.size() == 3);
+        assert(s.emplace(4).second);
+        assert(!s.emplace(4).second);
+        std::pair<__gnu_cxx::flat_hash_set<int>::iterator,
+                  __gnu_cxx::flat_hash_set<int>::iterator> p = s.equal_range(2);
+        assert(*p.first == 2);
+        assert(std::distance(p.first, p.second) == 1);
+        __gnu_cxx::flat_hash_set<int> t;
+        swap(s, t);
+        assert(s.empty() && t.size() == 4);
+    }
+}
@@ -0,0 +1,121 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <valarray>
+
+// template<class T> class valarray;
+
+// Arithmetic on whole valarrays and unit stride slices, checked against
+// element loops for every length up to a few vector widths.
+
+#include <valarray>
+#include <cassert>
+
+template <class T>
+T
+value(unsigned i, unsigned salt)
+{
+    return static_cast<T>((i * 7 + salt * 3) % 23 + 1);
+}
+
+template <class T>
+void
+test(unsigned n)
+{
+    std::valarray<T> a(n);
+    std::valarray<T> b(n);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        a[i] = value<T>(i, 1);
+        b[i] = value<T>(i, 2);
+    }
+    const T s = 3;
+    {
+        std::valarray<T> r = a + b;
+        std::valarray<T> q = a - s;
+        std::valarray<T> p = s * b;
+        std::valarray<T> d(n);
+        d = a / b;
+        assert(r.size() == n && q.size() == n && p.size() == n && d.size() == n);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            assert(r[i] == a[i] + b[i]);
+            assert(q[i] == a[i] - s);
+            assert(p[i] == s * b[i]);
+            assert(d[i] == a[i] / b[i]);
+        }
+    }
+    {
+        std::valarray<T> r(a);
+        r *= b;
+        r += s;
+        r -= a;
+        r /= b;
+        for (unsigned i = 0; i < n; ++i)
+            assert(r[i] == (a[i] * b[i] + s - a[i]) / b[i]);
+    }
+    {
+        std::valarray<T> r(a);
+        r = r * b;
+        for (unsigned i = 0; i < n; ++i)
+            assert(r[i] == a[i] * b[i]);
+    }
+    if (n > 2)
+    {
+        std::valarray<T> r(a);
+        std::valarray<T> w(b[std::slice(0, n - 2, 1)]);
+        r[std::slice(1, n - 2, 1)] += w;
+        r[std::slice(1, n - 2, 1)] *= w;
+        assert(r[0] == a[0] && r[n - 1] == a[n - 1]);
+        for (unsigned i = 1; i < n - 1; ++i)
+            assert(r[i] == (a[i] + b[i - 1]) * b[i - 1]);
+        // Operands overlapping the result keep the element by element order
+        std::valarray<T> c(a);
+        c[std::slice(1, n - 1, 1)] += c;
+        T e = a[0];
+        for (unsigned i = 1; i < n; ++i)
+        {
+            e = a[i] + e;
+            assert(c[i] == e);
+        }
+        std::valarray<T> m(a);
+        m += m[1];
+        assert(m[0] == a[0] + a[1] && m[1] == a[1] + a[1]);
+        for (unsigned i = 2; i < n; ++i)
+            assert(m[i] == a[i] + m[1]);
+    }
+    if (n > 0)
+    {
+        T sum = a[0];
+        T mn = a[0];
+        T mx = a[0];
+        for (unsigned i = 1; i < n; ++i)
+        {
+            sum += a[i];
+            if (a[i] < mn)
+                mn = a[i];
+            if (mx < a[i])
+                mx = a[i];
+        }
+        assert(a.sum() == sum);
+        assert(a.min() == mn);
+        assert(a.max() == mx);
+    }
+}
+
+int main()
+{
+    for (unsigned n = 0; n < 68; ++n)
+    {
+        test<float>(n);
+        test<double>(n);
+        test<int>(n);
+        test<long>(n);
+    }
+}
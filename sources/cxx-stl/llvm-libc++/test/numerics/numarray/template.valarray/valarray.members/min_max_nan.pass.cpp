@@ -0,0 +1,60 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <valarray>
+
+// template<class T> class valarray;
+
+// value_type min() const;
+// value_type max() const;
+
+// Unordered elements give the results of min_element and max_element.
+
+#include <valarray>
+#include <algorithm>
+#include <limits>
+#include <cassert>
+
+template <class T>
+bool
+same(T x, T y)
+{
+    return x == y || (x != x && y != y);
+}
+
+template <class T>
+void
+test()
+{
+    const T nan = std::numeric_limits<T>::quiet_NaN();
+    const T inf = std::numeric_limits<T>::infinity();
+    for (unsigned n = 1; n < 40; ++n)
+    {
+        for (unsigned k = 0; k < n; ++k)
+        {
+            std::valarray<T> v(n);
+            for (unsigned i = 0; i < n; ++i)
+                v[i] = static_cast<T>((i * 5) % 11) - 4;
+            v[k] = nan;
+            const T* b = &v[0];
+            assert(same(v.min(), *std::min_element(b, b + n)));
+            assert(same(v.max(), *std::max_element(b, b + n)));
+            v[k] = -inf;
+            assert(v.min() == -inf);
+            v[k] = inf;
+            assert(v.max() == inf);
+        }
+    }
+}
+
+int main()
+{
+    test<float>();
+    test<double>();
+}
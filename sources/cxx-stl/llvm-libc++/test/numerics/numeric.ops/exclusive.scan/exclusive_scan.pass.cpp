@@ -0,0 +1,59 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <numeric>
+
+// template <class InputIterator, class OutputIterator, class T>
+//   OutputIterator
+//   exclusive_scan(InputIterator first, InputIterator last, OutputIterator result, T init);
+// template <class InputIterator, class OutputIterator, class T, class BinaryOperation>
+//   OutputIterator
+//   exclusive_scan(InputIterator first, InputIterator last, OutputIterator result,
+//                  T init, BinaryOperation binary_op);
+
+#include <numeric>
+#include <functional>
+#include <cassert>
+
+#include "test_iterators.h"
+
+template <class InIter, class OutIter>
+void
+test()
+{
+    int ia[] = {1, 2, 3, 4, 5};
+    const unsigned s = sizeof(ia) / sizeof(ia[0]);
+    int ib[s] = {0};
+    int sum[] = {10, 11, 13, 16, 20};
+    int prod[] = {2, 2, 4, 12, 48};
+    OutIter r = std::exclusive_scan(InIter(ia), InIter(ia+s), OutIter(ib), 10);
+    assert(base(r) == ib + s);
+    for (unsigned i = 0; i < s; ++i)
+        assert(ib[i] == sum[i]);
+    r = std::exclusive_scan(InIter(ia), InIter(ia+s), OutIter(ib), 2, std::multiplies<int>());
+    assert(base(r) == ib + s);
+    for (unsigned i = 0; i < s; ++i)
+        assert(ib[i] == prod[i]);
+    r = std::exclusive_scan(InIter(ia), InIter(ia), OutIter(ib), 2);
+    assert(base(r) == ib);
+}
+
+int main()
+{
+    test<input_iterator<const int*>, output_iterator<int*> >();
+    test<forward_iterator<const int*>, forward_iterator<int*> >();
+    test<bidirectional_iterator<const int*>, bidirectional_iterator<int*> >();
+    test<random_access_iterator<const int*>, random_access_iterator<int*> >();
+    test<const int*, int*>();
+
+    // in place
+    int ia[] = {1, 2, 3, 4, 5};
+    std::exclusive_scan(ia, ia+5, ia, 0);
+    assert(ia[0] == 0 && ia[1] == 1 && ia[2] == 3 && ia[3] == 6 && ia[4] == 10);
+}
@@ -0,0 +1,67 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <numeric>
+
+// template <class InputIterator, class OutputIterator>
+//   OutputIterator
+//   inclusive_scan(InputIterator first, InputIterator last, OutputIterator result);
+// template <class InputIterator, class OutputIterator, class BinaryOperation>
+//   OutputIterator
+//   inclusive_scan(InputIterator first, InputIterator last, OutputIterator result,
+//                  BinaryOperation binary_op);
+// template <class InputIterator, class OutputIterator, class BinaryOperation, class T>
+//   OutputIterator
+//   inclusive_scan(InputIterator first, InputIterator last, OutputIterator result,
+//                  BinaryOperation binary_op, T init);
+
+#include <numeric>
+#include <functional>
+#include <cassert>
+
+#include "test_iterators.h"
+
+template <class InIter, class OutIter>
+void
+test()
+{
+    int ia[] = {1, 2, 3, 4, 5};
+    const unsigned s = sizeof(ia) / sizeof(ia[0]);
+    int ib[s] = {0};
+    int sum[] = {1, 3, 6, 10, 15};
+    int prod[] = {2, 4, 12, 48, 240};
+    OutIter r = std::inclusive_scan(InIter(ia), InIter(ia+s), OutIter(ib));
+    assert(base(r) == ib + s);
+    for (unsigned i = 0; i < s; ++i)
+        assert(ib[i] == sum[i]);
+    r = std::inclusive_scan(InIter(ia), InIter(ia+s), OutIter(ib), std::plus<int>());
+    assert(base(r) == ib + s);
+    for (unsigned i = 0; i < s; ++i)
+        assert(ib[i] == sum[i]);
+    r = std::inclusive_scan(InIter(ia), InIter(ia+s), OutIter(ib), std::multiplies<int>(), 2);
+    assert(base(r) == ib + s);
+    for (unsigned i = 0; i < s; ++i)
+        assert(ib[i] == prod[i]);
+    r = std::inclusive_scan(InIter(ia), InIter(ia), OutIter(ib), std::plus<int>(), 2);
+    assert(base(r) == ib);
+}
+
+int main()
+{
+    test<input_iterator<const int*>, output_iterator<int*> >();
+    test<forward_iterator<const int*>, forward_iterator<int*> >();
+    test<bidirectional_iterator<const int*>, bidirectional_iterator<int*> >();
+    test<random_access_iterator<const int*>, random_access_iterator<int*> >();
+    test<const int*, int*>();
+
+    // in place
+    int ia[] = {1, 2, 3, 4, 5};
+    std::inclusive_scan(ia, ia+5, ia);
+    assert(ia[0] == 1 && ia[1] == 3 && ia[2] == 6 && ia[3] == 10 && ia[4] == 15);
+}
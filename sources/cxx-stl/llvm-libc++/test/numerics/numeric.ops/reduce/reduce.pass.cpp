@@ -0,0 +1,48 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <numeric>
+
+// template <class InputIterator>
+//   typename iterator_traits<InputIterator>::value_type
+//   reduce(InputIterator first, InputIterator last);
+// template <class InputIterator, class T>
+//   T reduce(InputIterator first, InputIterator last, T init);
+// template <class InputIterator, class T, class BinaryOperation>
+//   T reduce(InputIterator first, InputIterator last, T init, BinaryOperation binary_op);
+
+#include <numeric>
+#include <functional>
+#include <cassert>
+
+#include "test_iterators.h"
+
+template <class Iter>
+void
+test()
+{
+    int ia[] = {1, 2, 3, 4, 5, 6};
+    unsigned sa = sizeof(ia) / sizeof(ia[0]);
+    assert(std::reduce(Iter(ia), Iter(ia)) == 0);
+    assert(std::reduce(Iter(ia), Iter(ia+sa)) == 21);
+    assert(std::reduce(Iter(ia), Iter(ia), 10) == 10);
+    assert(std::reduce(Iter(ia), Iter(ia+1), 10) == 11);
+    assert(std::reduce(Iter(ia), Iter(ia+sa), 10) == 31);
+    assert(std::reduce(Iter(ia), Iter(ia), 1, std::multiplies<int>()) == 1);
+    assert(std::reduce(Iter(ia), Iter(ia+sa), 2, std::multiplies<int>()) == 1440);
+}
+
+int main()
+{
+    test<input_iterator<const int*> >();
+    test<forward_iterator<const int*> >();
+    test<bidirectional_iterator<const int*> >();
+    test<random_access_iterator<const int*> >();
+    test<const int*>();
+}
@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <numeric>
+
+// template <class InputIterator1, class InputIterator2, class T>
+//   T transform_reduce(InputIterator1 first1, InputIterator1 last1,
+//                      InputIterator2 first2, T init);
+// template <class InputIterator1, class InputIterator2, class T,
+//           class BinaryOperation1, class BinaryOperation2>
+//   T transform_reduce(InputIterator1 first1, InputIterator1 last1,
+//                      InputIterator2 first2, T init,
+//                      BinaryOperation1 binary_op1, BinaryOperation2 binary_op2);
+// template <class InputIterator, class T, class BinaryOperation, class UnaryOperation>
+//   T transform_reduce(InputIterator first, InputIterator last, T init,
+//                      BinaryOperation binary_op, UnaryOperation unary_op);
+
+#include <numeric>
+#include <functional>
+#include <cassert>
+
+#include "test_iterators.h"
+
+int square(int x) {return x * x;}
+
+template <class Iter1, class Iter2>
+void
+test()
+{
+    int a[] = {1, 2, 3, 4, 5, 6};
+    unsigned b[] = {6, 5, 4, 3, 2, 1};
+    const unsigned s = sizeof(a) / sizeof(a[0]);
+    assert(std::transform_reduce(Iter1(a), Iter1(a), Iter2(b), 0) == 0);
+    assert(std::transform_reduce(Iter1(a), Iter1(a+s), Iter2(b), 10) == 66);
+    assert(std::transform_reduce(Iter1(a), Iter1(a+s), Iter2(b), 1,
+                                 std::multiplies<int>(), std::plus<int>()) == 117649);
+    assert(std::transform_reduce(Iter1(a), Iter1(a), 3, std::plus<int>(), square) == 3);
+    assert(std::transform_reduce(Iter1(a), Iter1(a+s), 3, std::plus<int>(), square) == 94);
+}
+
+int main()
+{
+    test<input_iterator<const int*>, input_iterator<const unsigned*> >();
+    test<forward_iterator<const int*>, bidirectional_iterator<const unsigned*> >();
+    test<random_access_iterator<const int*>, const unsigned*>();
+    test<const int*, const unsigned*>();
+}
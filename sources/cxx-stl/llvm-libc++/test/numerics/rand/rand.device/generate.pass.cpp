@@ -0,0 +1,66 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <random>
+
+// class random_device;
+
+// template<class ForwardIterator>
+//     void generate(ForwardIterator first, ForwardIterator last); // extension
+
+#include <random>
+#include <list>
+#include <vector>
+#include <cassert>
+#include <unistd.h>
+#include <sys/wait.h>
+
+int main()
+{
+    {
+        std::random_device r;
+        std::vector<unsigned> v(1000);
+        r.generate(v.begin(), v.end());
+        unsigned zeros = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+            zeros += v[i] == 0;
+        assert(zeros < 3);
+        assert(v[0] != v[1] || v[1] != v[2]);
+    }
+    {
+        std::random_device r("/dev/urandom");
+        std::list<unsigned> l(5, 0);
+        r.generate(l.begin(), l.end());
+        r.generate(l.begin(), l.begin());
+        assert(l.size() == 5);
+    }
+    {
+        // The child must not hand out the values buffered in the parent.
+        std::random_device r;
+        r();
+        int fd[2];
+        assert(pipe(fd) == 0);
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0)
+        {
+            unsigned c = r();
+            write(fd[1], &c, sizeof(c));
+            _exit(0);
+        }
+        unsigned p = r();
+        unsigned c = ~p;
+        assert(read(fd[0], &c, sizeof(c)) == sizeof(c));
+        int status;
+        waitpid(pid, &status, 0);
+        assert(p != c);
+        close(fd[0]);
+        close(fd[1]);
+    }
+}
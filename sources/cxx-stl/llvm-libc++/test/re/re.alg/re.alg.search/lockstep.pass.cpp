@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <regex>
+
+// template <class BidirectionalIterator, class Allocator, class charT, class traits>
+//     bool
+//     regex_search(BidirectionalIterator first, BidirectionalIterator last,
+//                  match_results<BidirectionalIterator, Allocator>& m,
+//                  const basic_regex<charT, traits>& e,
+//                  regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// Expressions without back references are matched in lock step; these would
+// take exponential time to backtrack through.
+
+#include <regex>
+#include <string>
+#include <cassert>
+
+int main()
+{
+    {
+        std::string p;
+        for (int i = 0; i < 30; ++i)
+            p += "a?";
+        p += std::string(30, 'a');
+        std::string s(30, 'a');
+        std::smatch m;
+        assert(std::regex_search(s, m, std::regex(p)));
+        assert(m.position(0) == 0);
+        assert(m.length(0) == 30);
+        assert(std::regex_match(s, std::regex(p, std::regex::extended)));
+    }
+    {
+        std::string s(5000, 'x');
+        std::smatch m;
+        assert(!std::regex_search(s, m, std::regex("(x+x+)+y")));
+        assert(m.size() == 0);
+        assert(!std::regex_search(s, std::regex("(x+x+)+y", std::regex::extended)));
+        s += 'y';
+        assert(std::regex_search(s, m, std::regex("(x+x+)+y")));
+        assert(m.position(0) == 0);
+        assert(m.length(0) == 5001);
+        assert(m[1].matched);
+    }
+    {
+        // a match starting earlier wins even when it ends later
+        std::cmatch m;
+        assert(std::regex_search("xabcd", m, std::regex("abcd|bc")));
+        assert(m.position(0) == 1);
+        assert(m.length(0) == 4);
+        assert(std::regex_search("xabcd", m, std::regex("abcd|bc", std::regex::extended)));
+        assert(m.position(0) == 1);
+        assert(m.length(0) == 4);
+    }
+    {
+        // ECMAScript takes the first alternative, POSIX the longest
+        std::cmatch m;
+        assert(std::regex_search("xabc", m, std::regex("(a|ab)(c?)")));
+        assert(m.position(0) == 1);
+        assert(m.length(0) == 1);
+        assert(m.length(1) == 1);
+        assert(std::regex_search("xabc", m, std::regex("(a|ab)(c?)", std::regex::extended)));
+        assert(m.position(0) == 1);
+        assert(m.length(0) == 3);
+        assert(m.length(1) == 2);
+    }
+    {
+        // counted repetitions keep their counts per candidate
+        std::cmatch m;
+        assert(std::regex_search("aaab aaaab", m, std::regex("a{4}b")));
+        assert(m.position(0) == 5);
+        assert(std::regex_search("ab aab", m, std::regex("(a|b){2,3}b")));
+        assert(m.position(0) == 3);
+        assert(m.length(0) == 3);
+    }
+}
@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <future>
+
+// Extension: async(launch::__pool, F&& f, Args&&... args);
+
+#include <future>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cassert>
+
+int f0()
+{
+    return 3;
+}
+
+void f1(int& i)
+{
+    ++i;
+}
+
+std::unique_ptr<int> f2(std::unique_ptr<int>&& p)
+{
+    return std::move(p);
+}
+
+// Fans out recursively and blocks on the children from pool threads; with
+// more nesting than there are workers this would deadlock if waiting did not
+// run queued tasks.
+long fib(int n)
+{
+    if (n < 2)
+        return n;
+    std::future<long> a = std::async(std::launch::__pool, fib, n - 1);
+    std::future<long> b = std::async(std::launch::__pool, fib, n - 2);
+    return a.get() + b.get();
+}
+
+bool done = false;
+
+void f3()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    done = true;
+}
+
+int main()
+{
+    {
+        std::future<int> f = std::async(std::launch::__pool, f0);
+        assert(f.get() == 3);
+    }
+    {
+        int i = 0;
+        std::future<void> f = std::async(std::launch::__pool, f1, std::ref(i));
+        f.get();
+        assert(i == 1);
+    }
+    {
+        std::future<std::unique_ptr<int>> f =
+            std::async(std::launch::__pool, f2, std::unique_ptr<int>(new int(3)));
+        assert(*f.get() == 3);
+    }
+    {
+        std::vector<std::future<int> > v;
+        for (int i = 0; i < 1000; ++i)
+            v.push_back(std::async(std::launch::__pool, f0));
+        for (int i = 0; i < 1000; ++i)
+            assert(v[i].get() == 3);
+    }
+    {
+        std::future<long> f = std::async(std::launch::__pool, fib, 16);
+        assert(f.get() == 987);
+    }
+    {
+        // Dropping the future without waiting still blocks until the task
+        // is done, whether a pool thread has picked it up or not
+        for (int i = 0; i < 4; ++i)
+        {
+            done = false;
+            {
+                std::future<void> f = std::async(std::launch::__pool, f3);
+            }
+            assert(done);
+        }
+        done = false;
+        std::async(std::launch::__pool, f3);
+        assert(done);
+    }
+}
@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <shared_mutex>
+
+// class shared_timed_mutex;
+
+// void lock_shared();
+// void unlock_shared();
+
+#include <shared_mutex>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+std::shared_timed_mutex m;
+int readers = 0;
+int value = 0;
+
+typedef std::chrono::milliseconds ms;
+
+void reader()
+{
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::shared_lock<std::shared_timed_mutex> lk(m);
+        assert(lk.owns_lock());
+        int v = value;
+        __sync_fetch_and_add(&readers, 1);
+        assert(value == v);
+        __sync_fetch_and_sub(&readers, 1);
+    }
+}
+
+void writer()
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::lock_guard<std::shared_timed_mutex> lk(m);
+        assert(readers == 0);
+        ++value;
+    }
+}
+
+int main()
+{
+    {
+        // Readers share the lock, a writer excludes them
+        m.lock_shared();
+        assert(m.try_lock_shared());
+        assert(!m.try_lock());
+        m.unlock_shared();
+        m.unlock_shared();
+        assert(m.try_lock());
+        assert(!m.try_lock_shared());
+        m.unlock();
+    }
+    {
+        // A waiting writer holds back new readers
+        m.lock_shared();
+        std::thread t([] { m.lock(); ++value; m.unlock(); });
+        while (m.try_lock_shared())
+        {
+            m.unlock_shared();
+            std::this_thread::sleep_for(ms(1));
+        }
+        m.unlock_shared();
+        t.join();
+        assert(value == 1);
+    }
+    {
+        value = 0;
+        std::vector<std::thread> v;
+        for (int i = 0; i < 4; ++i)
+            v.push_back(std::thread(reader));
+        for (int i = 0; i < 2; ++i)
+            v.push_back(std::thread(writer));
+        for (size_t i = 0; i < v.size(); ++i)
+            v[i].join();
+        assert(value == 2000);
+    }
+}
@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <shared_mutex>
+
+// class shared_timed_mutex;
+
+// template <class Rep, class Period>
+//     bool try_lock_for(const chrono::duration<Rep, Period>& rel_time);
+// template <class Rep, class Period>
+//     bool try_lock_shared_for(const chrono::duration<Rep, Period>& rel_time);
+
+#include <shared_mutex>
+#include <thread>
+#include <cassert>
+
+std::shared_timed_mutex m;
+
+typedef std::chrono::steady_clock Clock;
+typedef Clock::time_point time_point;
+typedef std::chrono::milliseconds ms;
+typedef std::chrono::nanoseconds ns;
+
+void f1()
+{
+    time_point t0 = Clock::now();
+    assert(m.try_lock_for(ms(300)) == true);
+    time_point t1 = Clock::now();
+    m.unlock();
+    ns d = t1 - t0 - ms(250);
+    assert(d < ns(50000000));  // within 50ms
+}
+
+void f2()
+{
+    time_point t0 = Clock::now();
+    assert(m.try_lock_for(ms(250)) == false);
+    time_point t1 = Clock::now();
+    ns d = t1 - t0 - ms(250);
+    assert(d >= ns(0) && d < ns(50000000));  // within 50ms
+}
+
+void f3()
+{
+    time_point t0 = Clock::now();
+    assert(m.try_lock_shared_for(ms(250)) == false);
+    time_point t1 = Clock::now();
+    ns d = t1 - t0 - ms(250);
+    assert(d >= ns(0) && d < ns(50000000));  // within 50ms
+}
+
+int main()
+{
+    {
+        m.lock_shared();
+        std::thread t(f1);
+        std::this_thread::sleep_for(ms(250));
+        m.unlock_shared();
+        t.join();
+    }
+    {
+        m.lock_shared();
+        std::thread t(f2);
+        std::this_thread::sleep_for(ms(300));
+        m.unlock_shared();
+        t.join();
+    }
+    {
+        m.lock();
+        std::thread t(f3);
+        std::this_thread::sleep_for(ms(300));
+        m.unlock();
+        t.join();
+    }
+    {
+        // A writer that gave up lets the readers it held back in
+        m.lock_shared();
+        std::thread t(f2);
+        std::this_thread::sleep_for(ms(50));
+        assert(!m.try_lock_shared());
+        t.join();
+        assert(m.try_lock_shared_for(ms(10)));
+        m.unlock_shared();
+        m.unlock_shared();
+    }
+    assert(m.try_lock_for(ms(0)));
+    assert(!m.try_lock_shared_until(Clock::now() + ms(10)));
+    m.unlock();
+}
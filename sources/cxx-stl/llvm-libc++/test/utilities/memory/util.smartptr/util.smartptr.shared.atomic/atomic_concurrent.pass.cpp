@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is dual licensed under the MIT and the University of Illinois Open
+// Source Licenses. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// <memory>
+
+// shared_ptr
+
+// Concurrent atomic_load, atomic_store and atomic_compare_exchange_strong
+// on one shared_ptr: every published object must be destroyed exactly once.
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+struct A
+{
+    static int count;
+    int value;
+
+    explicit A(int v) : value(v) {__sync_add_and_fetch(&count, 1);}
+    ~A() {__sync_sub_and_fetch(&count, 1);}
+};
+
+int A::count = 0;
+
+std::shared_ptr<A> p;
+
+void reader()
+{
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::shared_ptr<A> q = std::atomic_load(&p);
+        assert(q->value >= 0);
+    }
+}
+
+void writer(int id)
+{
+    for (int i = 0; i < 1000; ++i)
+        std::atomic_store(&p, std::shared_ptr<A>(new A(id * 1000 + i)));
+}
+
+void incrementer()
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::shared_ptr<A> v = std::atomic_load(&p);
+        while (!std::atomic_compare_exchange_strong(&p, &v,
+                    std::shared_ptr<A>(new A(v->value + 1))))
+            ;
+    }
+}
+
+int main()
+{
+#if __has_feature(cxx_atomic)
+    p = std::shared_ptr<A>(new A(0));
+    {
+        std::vector<std::thread> t;
+        for (int i = 0; i < 4; ++i)
+            t.push_back(std::thread(reader));
+        for (int i = 0; i < 2; ++i)
+            t.push_back(std::thread(writer, i));
+        for (unsigned i = 0; i < t.size(); ++i)
+            t[i].join();
+    }
+    assert(A::count == 1);
+    std::atomic_store(&p, std::shared_ptr<A>(new A(0)));
+    {
+        std::vector<std::thread> t;
+        for (int i = 0; i < 4; ++i)
+            t.push_back(std::thread(incrementer));
+        for (unsigned i = 0; i < t.size(); ++i)
+            t[i].join();
+    }
+    assert(std::atomic_load(&p)->value == 4000);
+    assert(A::count == 1);
+    p.reset();
+    assert(A::count == 0);
+#endif
+}
@@ -33,6 +33,10 @@
 #  include <cerrno>
 #endif
 
+#if defined (_STLP_NODE_ALLOC_PER_THREAD)
+#  include <sys/mman.h>
+#endif
+
 #include <stl/_threads.h>
 
 #include "lock_free_slist.h"
@@ -204,6 +208,15 @@ __oom_handler_type _STLP_CALL __malloc_alloc::set_malloc_handler(__oom_handler_t
 #  define _STLP_USE_LOCK_FREE_IMPLEMENTATION
 #endif
 
+/* The per thread node allocator relies on pthread keys and on gcc atomic
+ * builtins. */
+#if defined (_STLP_NODE_ALLOC_PER_THREAD) && \
+    (!defined (_STLP_PTHREADS) || defined (_STLP_NO_THREADS) || !defined (__GNUC__))
+#  undef _STLP_NODE_ALLOC_PER_THREAD
+#endif
+
+#if !defined (_STLP_NODE_ALLOC_PER_THREAD)
+
 #if !defined (_STLP_USE_LOCK_FREE_IMPLEMENTATION)
 #  if defined (_STLP_THREADS)
 
@@ -739,6 +752,345 @@ _Node_alloc_obj* __node_alloc_impl::_S_chunks  = 0;
 #  endif
 #endif
 
+#else /* _STLP_NODE_ALLOC_PER_THREAD */
+
+// *******************************************************
+// Per thread node allocator.
+// Every thread allocates nodes from its own heap, without locking.  For
+// each size class a heap owns spans: blocks of _S_span_size bytes, mapped
+// at an address aligned on their size and carved into nodes of the class.
+// The span of a node is found by masking the node address, so:
+// 1. A node freed by the thread owning its span goes back to the span
+//    free list.
+// 2. A node freed by any other thread is pushed on the span remote list
+//    with a compare and swap; the owner takes the whole list back once it
+//    runs out of free nodes of that class.
+// 3. A span with no node in use is unmapped, except the one its owner
+//    currently allocates from.
+// The heap of a terminated thread keeps the spans that still have nodes in
+// use and is handed over to the next thread needing a heap.
+
+struct _Node_alloc_obj {
+  _Node_alloc_obj * _M_next;
+};
+
+struct _Node_heap;
+
+struct _Node_span {
+  _Node_heap* _M_owner;
+  // Nodes freed by the owner
+  _Node_alloc_obj* _M_free;
+  // Nodes freed by other threads
+  _Node_alloc_obj* _STLP_VOLATILE _M_remote;
+  // Part of the span never handed out yet
+  char* _M_unused;
+  _Node_span* _M_prev;
+  _Node_span* _M_next;
+  size_t _M_node_size;
+  // Nodes handed out and not back on _M_free, remote ones included
+  size_t _M_in_use;
+  // Whether the span is on its heap's list of exhausted spans
+  bool _M_full;
+};
+
+struct _Node_heap {
+  _Node_heap() : _M_next(0) {
+    memset(_M_partial, 0, sizeof(_M_partial));
+    memset(_M_full, 0, sizeof(_M_full));
+    memset(__CONST_CAST(int*, _M_remote_frees), 0, sizeof(_M_remote_frees));
+  }
+
+  // Spans with nodes to hand out; the first one is allocated from
+  _Node_span* _M_partial[_STLP_NFREELISTS];
+  _Node_span* _M_full[_STLP_NFREELISTS];
+  // Set when a node of a size class is freed by another thread
+  _STLP_VOLATILE int _M_remote_frees[_STLP_NFREELISTS];
+  // Link in the list of heaps of terminated threads
+  _Node_heap* _M_next;
+};
+
+class __node_alloc_impl {
+  static inline size_t _STLP_CALL _S_round_up(size_t __bytes)
+  { return (((__bytes) + (size_t)_ALIGN-1) & ~((size_t)_ALIGN - 1)); }
+
+  typedef _Node_alloc_obj _Obj;
+
+  enum { _S_span_size = 16 * 1024 };
+
+  static size_t _S_header_size()
+  { return _S_round_up(sizeof(_Node_span)); }
+  static _Node_span* _S_span_of(void *__p)
+  { return __REINTERPRET_CAST(_Node_span*, __REINTERPRET_CAST(size_t, __p) & ~((size_t)_S_span_size - 1)); }
+
+  static void _S_link(_Node_span*& __head, _Node_span* __s, bool __first);
+  static void _S_unlink(_Node_span*& __head, _Node_span* __s);
+  // Takes the nodes freed by other threads back; false if there were none
+  static bool _S_collect(_Node_span* __s);
+  static _Node_span* _S_new_span(_Node_heap* __h, size_t __n);
+  static void _S_release_span(_Node_span* __s);
+  // Called when the first span of the size __n class has nothing left
+  static void* _S_refill(_Node_heap* __h, size_t __n);
+  static void _S_deallocate_remote(_Node_span* __s, _Obj* __pobj);
+
+  static pthread_key_t _S_key;
+  static pthread_once_t _S_key_once;
+  static _STLP_STATIC_MUTEX _S_heaps_lock;
+  static _Node_heap* _S_free_heaps;
+
+  static void _S_create_key();
+  static void _S_destructor(void* __h);
+  static _Node_heap* _S_get_heap();
+
+public:
+  /* __n must be > 0      */
+  static void* _M_allocate(size_t& __n);
+  /* __p may not be 0 */
+  static void _M_deallocate(void *__p, size_t __n);
+};
+
+pthread_key_t __node_alloc_impl::_S_key;
+pthread_once_t __node_alloc_impl::_S_key_once = PTHREAD_ONCE_INIT;
+_STLP_STATIC_MUTEX __node_alloc_impl::_S_heaps_lock _STLP_MUTEX_INITIALIZER;
+_Node_heap* __node_alloc_impl::_S_free_heaps = 0;
+
+void __node_alloc_impl::_S_create_key() {
+  if (pthread_key_create(&_S_key, _S_destructor) != 0) {
+    _STLP_ABORT();
+  }
+}
+
+_Node_heap* __node_alloc_impl::_S_get_heap() {
+  pthread_once(&_S_key_once, _S_create_key);
+  _Node_heap* __h = __STATIC_CAST(_Node_heap*, pthread_getspecific(_S_key));
+  if (__h != 0)
+    return __h;
+
+  _S_heaps_lock._M_acquire_lock();
+  __h = _S_free_heaps;
+  if (__h != 0)
+    _S_free_heaps = __h->_M_next;
+  _S_heaps_lock._M_release_lock();
+  if (__h == 0)
+    __h = new _Node_heap;
+  __h->_M_next = 0;
+  if (pthread_setspecific(_S_key, __h) != 0) {
+    _STLP_THROW_BAD_ALLOC;
+  }
+  return __h;
+}
+
+/* Runs on thread termination.  Empty spans are given back to the system,
+ * the heap keeps the others for the next thread taking it. */
+void __node_alloc_impl::_S_destructor(void* __p) {
+  _Node_heap* __h = __STATIC_CAST(_Node_heap*, __p);
+  for (size_t __i = 0; __i < _STLP_NFREELISTS; ++__i) {
+    __h->_M_remote_frees[__i] = 0;
+    _Node_span** __lists[2] = { &__h->_M_partial[__i], &__h->_M_full[__i] };
+    for (int __l = 0; __l < 2; ++__l) {
+      _Node_span* __s = *__lists[__l];
+      while (__s != 0) {
+        _Node_span* __next = __s->_M_next;
+        _S_collect(__s);
+        if (__s->_M_in_use == 0) {
+          _S_unlink(*__lists[__l], __s);
+          _S_release_span(__s);
+        }
+        __s = __next;
+      }
+    }
+  }
+  _S_heaps_lock._M_acquire_lock();
+  __h->_M_next = _S_free_heaps;
+  _S_free_heaps = __h;
+  _S_heaps_lock._M_release_lock();
+}
+
+void __node_alloc_impl::_S_link(_Node_span*& __head, _Node_span* __s, bool __first) {
+  if (__first || __head == 0) {
+    __s->_M_prev = 0;
+    __s->_M_next = __head;
+    if (__head != 0)
+      __head->_M_prev = __s;
+    __head = __s;
+  }
+  else {
+    // Right after the head, which stays the span allocated from
+    __s->_M_prev = __head;
+    __s->_M_next = __head->_M_next;
+    if (__head->_M_next != 0)
+      __head->_M_next->_M_prev = __s;
+    __head->_M_next = __s;
+  }
+}
+
+void __node_alloc_impl::_S_unlink(_Node_span*& __head, _Node_span* __s) {
+  if (__s->_M_prev != 0)
+    __s->_M_prev->_M_next = __s->_M_next;
+  else
+    __head = __s->_M_next;
+  if (__s->_M_next != 0)
+    __s->_M_next->_M_prev = __s->_M_prev;
+}
+
+bool __node_alloc_impl::_S_collect(_Node_span* __s) {
+  if (__s->_M_remote == 0)
+    return false;
+  // Only the owner takes nodes off the list, so there is no ABA problem
+  _Obj* __r = __sync_lock_test_and_set(&__s->_M_remote, (_Obj*)0);
+  _Obj* __last = __r;
+  size_t __count = 1;
+  for (; __last->_M_next != 0; __last = __last->_M_next)
+    ++__count;
+  __last->_M_next = __s->_M_free;
+  __s->_M_free = __r;
+  __s->_M_in_use -= __count;
+  return true;
+}
+
+_Node_span* __node_alloc_impl::_S_new_span(_Node_heap* __h, size_t __n) {
+  // Map twice the size and trim the excess to get an aligned span
+  char* __p = __STATIC_CAST(char*, mmap(0, 2 * _S_span_size, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (__p == MAP_FAILED) {
+    _STLP_THROW_BAD_ALLOC;
+  }
+  char* __start = __REINTERPRET_CAST(char*, _S_span_of(__p + _S_span_size - 1));
+  if (__start != __p)
+    munmap(__p, __start - __p);
+  munmap(__start + _S_span_size, __p + _S_span_size - __start);
+
+  _Node_span* __s = __REINTERPRET_CAST(_Node_span*, __start);
+  __s->_M_owner = __h;
+  __s->_M_free = 0;
+  __s->_M_remote = 0;
+  __s->_M_unused = __start + _S_header_size();
+  __s->_M_node_size = __n;
+  __s->_M_in_use = 0;
+  __s->_M_full = false;
+  _S_link(__h->_M_partial[_S_FREELIST_INDEX(__n)], __s, true);
+  return __s;
+}
+
+void __node_alloc_impl::_S_release_span(_Node_span* __s)
+{ munmap(__s, _S_span_size); }
+
+void* __node_alloc_impl::_S_refill(_Node_heap* __h, size_t __n) {
+  size_t __i = _S_FREELIST_INDEX(__n);
+  _Node_span*& __partial = __h->_M_partial[__i];
+  _Node_span*& __full = __h->_M_full[__i];
+
+  // Retire exhausted spans until one has nodes freed by other threads
+  _Node_span* __s;
+  while ((__s = __partial) != 0) {
+    if (_S_collect(__s))
+      break;
+    if (__s->_M_free != 0 || __s->_M_unused + __n <= __REINTERPRET_CAST(char*, __s) + _S_span_size)
+      break;
+    _S_unlink(__partial, __s);
+    __s->_M_full = true;
+    _S_link(__full, __s, true);
+  }
+
+  if (__s == 0 && __h->_M_remote_frees[__i] != 0 &&
+      __sync_fetch_and_and(&__h->_M_remote_frees[__i], 0) != 0) {
+    _Node_span* __next;
+    for (_Node_span* __f = __full; __f != 0; __f = __next) {
+      __next = __f->_M_next;
+      if (!_S_collect(__f))
+        continue;
+      _S_unlink(__full, __f);
+      __f->_M_full = false;
+      if (__f->_M_in_use == 0 && __partial != 0)
+        _S_release_span(__f);
+      else
+        _S_link(__partial, __f, false);
+    }
+    __s = __partial;
+  }
+
+  if (__s == 0)
+    __s = _S_new_span(__h, __n);
+
+  _Obj* __r = __s->_M_free;
+  if (__r != 0)
+    __s->_M_free = __r->_M_next;
+  else {
+    __r = __REINTERPRET_CAST(_Obj*, __s->_M_unused);
+    __s->_M_unused += __n;
+  }
+  ++__s->_M_in_use;
+  return __r;
+}
+
+void* __node_alloc_impl::_M_allocate(size_t& __n) {
+  __n = _S_round_up(__n);
+  _Node_heap* __h = _S_get_heap();
+  _Node_span* __s = __h->_M_partial[_S_FREELIST_INDEX(__n)];
+
+  if (__s != 0) {
+    _Obj* __r = __s->_M_free;
+    if (__r != 0) {
+      __s->_M_free = __r->_M_next;
+      ++__s->_M_in_use;
+      return __r;
+    }
+    if (__s->_M_unused + __n <= __REINTERPRET_CAST(char*, __s) + _S_span_size) {
+      __r = __REINTERPRET_CAST(_Obj*, __s->_M_unused);
+      __s->_M_unused += __n;
+      ++__s->_M_in_use;
+      return __r;
+    }
+  }
+  return _S_refill(__h, __n);
+}
+
+void __node_alloc_impl::_S_deallocate_remote(_Node_span* __s, _Obj* __pobj) {
+  // Once the node is pushed, the owner may collect the span and unmap it,
+  // so the span header is read before that. Heaps are never freed, so the
+  // flag itself stays valid.
+  _STLP_VOLATILE int* __flag = __s->_M_owner->_M_remote_frees + _S_FREELIST_INDEX(__s->_M_node_size);
+
+  _Obj* __head;
+  do {
+    __head = __s->_M_remote;
+    __pobj->_M_next = __head;
+  } while (!__sync_bool_compare_and_swap(&__s->_M_remote, __head, __pobj));
+
+  // The owner only looks at remote lists of exhausted spans when told to.
+  // Reading the flag after the push is enough: the owner clears it before
+  // looking at the lists.
+  if (*__flag == 0)
+    __sync_fetch_and_or(__flag, 1);
+}
+
+void __node_alloc_impl::_M_deallocate(void *__p, size_t /* __n */) {
+  _Node_span* __s = _S_span_of(__p);
+  _Obj* __pobj = __STATIC_CAST(_Obj*, __p);
+  _Node_heap* __h = __s->_M_owner;
+
+  if (__h != pthread_getspecific(_S_key)) {
+    _S_deallocate_remote(__s, __pobj);
+    return;
+  }
+
+  __pobj->_M_next = __s->_M_free;
+  __s->_M_free = __pobj;
+  --__s->_M_in_use;
+
+  size_t __i = _S_FREELIST_INDEX(__s->_M_node_size);
+  if (__s->_M_full) {
+    _S_unlink(__h->_M_full[__i], __s);
+    __s->_M_full = false;
+    _S_link(__h->_M_partial[__i], __s, false);
+  }
+  else if (__s->_M_in_use == 0 && __s != __h->_M_partial[__i]) {
+    _S_unlink(__h->_M_partial[__i], __s);
+    _S_release_span(__s);
+  }
+}
+
+#endif /* _STLP_NODE_ALLOC_PER_THREAD */
+
 void * _STLP_CALL __node_alloc::_M_allocate(size_t& __n)
 { return __node_alloc_impl::_M_allocate(__n); }
 
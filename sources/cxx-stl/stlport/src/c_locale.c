@@ -24,6 +24,8 @@
 #  include "c_locale_win32/c_locale_win32.c"
 #elif defined (_STLP_USE_GLIBC2_LOCALIZATION)
 #  include "c_locale_glibc/c_locale_glibc2.c" /* glibc 2.2 and newer */
+#elif defined (_STLP_USE_CRYSTAX_LOCALIZATION)
+#  include "c_locale_crystax/c_locale_crystax.c"
 #else
 #  include "c_locale_dummy/c_locale_dummy.c"
 #endif
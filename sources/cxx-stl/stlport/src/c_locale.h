@@ -43,6 +43,10 @@ struct _Locale_name_hint;
 #  define _STLP_USE_GLIBC2_LOCALIZATION
 #  include <nl_types.h>
 typedef nl_catd nl_catd_type;
+#elif defined (__ANDROID__) && defined (_STLP_REAL_LOCALE_IMPLEMENTED)
+/* Locale data of libcrystax */
+#  define _STLP_USE_CRYSTAX_LOCALIZATION
+typedef int nl_catd_type;
 #else
 typedef int nl_catd_type;
 #endif
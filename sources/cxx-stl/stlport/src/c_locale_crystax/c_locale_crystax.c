@@ -0,0 +1,813 @@
+/*
+ * Copyright (c) 1999
+ * Silicon Graphics Computer Systems, Inc.
+ *
+ * Copyright (c) 1999
+ * Boris Fomitchev
+ *
+ * This material is provided "as is", with absolutely no warranty expressed
+ * or implied. Any use is at your own risk.
+ *
+ * Permission to use or copy this software for any purpose is hereby granted
+ * without fee, provided the above notices are retained on all copies.
+ * Permission to modify the code and to distribute modified code is granted,
+ * provided the above notices are retained, and a notice that the code was
+ * modified is included with the above copyright notice.
+ *
+ */
+
+/* Implementation of the "c_locale.h" interface on top of the locale data
+   of libcrystax (see <crystax/locale.h>).  libcrystax loads each category
+   of a named locale once and keeps it for the life of the process; the
+   category objects built here from that data are kept the same way, so
+   a locale name costs the table building below only the first time it
+   is used.
+
+   There is no LC_TIME or LC_MESSAGES data, so the time and messages
+   categories of any locale known to libcrystax get the "C" values.
+*/
+
+#include <crystax/locale.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+static const char *_C_name = "C";
+static const char *_empty_str = "";
+
+/* Longest multibyte character of the encodings libcrystax converts */
+#define _Locale_MB_LEN_MAX 8
+
+/* Categories are kept by name in a single list, never freed. */
+enum {
+  _Locale_ctype_category,
+  _Locale_codecvt_category,
+  _Locale_numeric_category,
+  _Locale_time_category,
+  _Locale_collate_category,
+  _Locale_monetary_category,
+  _Locale_messages_category
+};
+
+struct _Locale_entry {
+  struct _Locale_entry *next;
+  int category;
+  char name[_Locale_MAX_SIMPLE_NAME];
+};
+
+struct _Locale_ctype {
+  struct _Locale_entry entry;
+  const struct crystax_locale_ctype *ct;
+  _Locale_mask_t table[256];
+  unsigned char upper[256];
+  unsigned char lower[256];
+};
+
+struct _Locale_codecvt {
+  struct _Locale_entry entry;
+  const struct crystax_locale_ctype *ct;
+};
+
+struct _Locale_numeric {
+  struct _Locale_entry entry;
+  const struct lconv *lc;
+  const struct crystax_locale_ctype *ct; /* to widen strings, may be NULL */
+};
+
+struct _Locale_time {
+  struct _Locale_entry entry;
+};
+
+struct _Locale_collate {
+  struct _Locale_entry entry;
+  const struct crystax_locale_collate *co;
+  const struct crystax_locale_ctype *ct; /* to narrow wide strings, may be NULL */
+};
+
+struct _Locale_monetary {
+  struct _Locale_entry entry;
+  const struct lconv *lc;
+  const struct crystax_locale_ctype *ct;
+};
+
+struct _Locale_messages {
+  struct _Locale_entry entry;
+};
+
+static pthread_mutex_t _Locale_entries_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct _Locale_entry *_Locale_entries = NULL;
+
+static void* _Locale_acquire(int category, const char *name, size_t size,
+                             int (*init)(struct _Locale_entry *), int *__err_code) {
+  struct _Locale_entry *e;
+  int err = 0;
+
+  if (strlen(name) >= _Locale_MAX_SIMPLE_NAME) {
+    *__err_code = _STLP_LOC_UNKNOWN_NAME;
+    return NULL;
+  }
+
+  pthread_mutex_lock(&_Locale_entries_lock);
+  for (e = _Locale_entries; e != NULL; e = e->next) {
+    if (e->category == category && strcmp(e->name, name) == 0)
+      break;
+  }
+  if (e == NULL) {
+    e = (struct _Locale_entry*)calloc(1, size);
+    if (e == NULL)
+      err = ENOMEM;
+    else {
+      e->category = category;
+      strcpy(e->name, name);
+      err = init(e);
+      if (err == 0) {
+        e->next = _Locale_entries;
+        _Locale_entries = e;
+      }
+      else {
+        free(e);
+        e = NULL;
+      }
+    }
+  }
+  pthread_mutex_unlock(&_Locale_entries_lock);
+
+  if (e == NULL) {
+    switch (err) {
+    case ENOMEM:
+      *__err_code = _STLP_LOC_NO_MEMORY;
+      break;
+    case ENOENT:
+    case EINVAL:
+      *__err_code = _STLP_LOC_UNKNOWN_NAME;
+      break;
+    default:
+      *__err_code = _STLP_LOC_UNSUPPORTED_FACET_CATEGORY;
+      break;
+    }
+  }
+  return e;
+}
+
+static _Locale_mask_t _Locale_mask(unsigned long cls) {
+  _Locale_mask_t ret = 0;
+  if (cls & CRYSTAX_LOCALE_ALPHA)  ret |= _Locale_ALPHA;
+  if (cls & CRYSTAX_LOCALE_CNTRL)  ret |= _Locale_CNTRL;
+  if (cls & CRYSTAX_LOCALE_DIGIT)  ret |= _Locale_DIGIT;
+  if (cls & CRYSTAX_LOCALE_PRINT)  ret |= _Locale_PRINT;
+  if (cls & CRYSTAX_LOCALE_PUNCT)  ret |= _Locale_PUNCT;
+  if (cls & CRYSTAX_LOCALE_SPACE)  ret |= _Locale_SPACE;
+  if (cls & CRYSTAX_LOCALE_XDIGIT) ret |= _Locale_XDIGIT;
+  if (cls & CRYSTAX_LOCALE_UPPER)  ret |= _Locale_UPPER;
+  if (cls & CRYSTAX_LOCALE_LOWER)  ret |= _Locale_LOWER;
+  return ret;
+}
+
+/* Single byte form of wc, or dflt if it takes more than one */
+static unsigned char _Locale_narrow(const struct crystax_locale_ctype *ct, wint_t wc,
+                                    unsigned char dflt) {
+  char buf[_Locale_MB_LEN_MAX];
+  mbstate_t st;
+  memset(&st, 0, sizeof(st));
+  if (crystax_locale_wcrtomb(ct, buf, (wchar_t)wc, &st) != 1)
+    return dflt;
+  return (unsigned char)buf[0];
+}
+
+#ifndef _STLP_NO_WCHAR_T
+/* Converts s to wide characters, bytes are simply widened without ct */
+static wchar_t* _Locale_widen(const struct crystax_locale_ctype *ct, const char *s,
+                              wchar_t *wbuf, size_t wbufSize) {
+  wchar_t *wcur = wbuf;
+  wchar_t *wend = wbuf + wbufSize - 1;
+  mbstate_t st;
+  size_t n = strlen(s);
+
+  memset(&st, 0, sizeof(st));
+  while (wcur != wend && n != 0) {
+    size_t r = 1;
+    if (ct == NULL)
+      *wcur = (unsigned char)*s;
+    else if ((r = crystax_locale_mbrtowc(ct, wcur, s, n, &st)) == 0 || r > n)
+      break;
+    s += r; n -= r; ++wcur;
+  }
+  *wcur = 0;
+  return wbuf;
+}
+#endif
+
+/* Framework functions */
+
+void _Locale_init(void)
+{}
+
+void _Locale_final(void)
+{}
+
+static int _Locale_ctype_init(struct _Locale_entry *e) {
+  struct _Locale_ctype *lctype = (struct _Locale_ctype*)e;
+  const struct crystax_locale_ctype *ct;
+  int c;
+
+  if ((ct = crystax_locale_ctype(e->name)) == NULL)
+    return errno;
+  lctype->ct = ct;
+
+  /* Bytes that are not a character by themselves (UTF-8 above 0x7f) have
+     no class and no case. */
+  for (c = 0; c < 256; ++c) {
+    char b = (char)c;
+    wchar_t wc;
+    mbstate_t st;
+
+    lctype->upper[c] = lctype->lower[c] = (unsigned char)c;
+    memset(&st, 0, sizeof(st));
+    if (crystax_locale_mbrtowc(ct, &wc, &b, 1, &st) > 1)
+      continue;
+    lctype->table[c] = _Locale_mask(crystax_locale_ctype_class(ct, wc));
+    lctype->upper[c] = _Locale_narrow(ct, crystax_locale_ctype_toupper(ct, wc), (unsigned char)c);
+    lctype->lower[c] = _Locale_narrow(ct, crystax_locale_ctype_tolower(ct, wc), (unsigned char)c);
+  }
+  return 0;
+}
+
+static int _Locale_codecvt_init(struct _Locale_entry *e) {
+  struct _Locale_codecvt *lcodecvt = (struct _Locale_codecvt*)e;
+  if ((lcodecvt->ct = crystax_locale_ctype(e->name)) == NULL)
+    return errno;
+  return 0;
+}
+
+static int _Locale_numeric_init(struct _Locale_entry *e) {
+  struct _Locale_numeric *lnum = (struct _Locale_numeric*)e;
+  if ((lnum->lc = crystax_locale_numeric(e->name)) == NULL)
+    return errno;
+  lnum->ct = crystax_locale_ctype(e->name);
+  return 0;
+}
+
+static int _Locale_monetary_init(struct _Locale_entry *e) {
+  struct _Locale_monetary *lmon = (struct _Locale_monetary*)e;
+  if ((lmon->lc = crystax_locale_monetary(e->name)) == NULL)
+    return errno;
+  lmon->ct = crystax_locale_ctype(e->name);
+  return 0;
+}
+
+static int _Locale_collate_init(struct _Locale_entry *e) {
+  struct _Locale_collate *lcol = (struct _Locale_collate*)e;
+  if ((lcol->co = crystax_locale_collate(e->name)) == NULL)
+    return errno;
+  lcol->ct = crystax_locale_ctype(e->name);
+  return 0;
+}
+
+/* No data of its own: any name libcrystax knows will do. */
+static int _Locale_known_init(struct _Locale_entry *e) {
+  if (crystax_locale_numeric(e->name) == NULL)
+    return errno;
+  return 0;
+}
+
+struct _Locale_ctype* _Locale_ctype_create(const char *name,
+                                           struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_ctype*)_Locale_acquire(_Locale_ctype_category, name, sizeof(struct _Locale_ctype),
+                                                 _Locale_ctype_init, __err_code); }
+
+struct _Locale_codecvt* _Locale_codecvt_create(const char *name,
+                                               struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_codecvt*)_Locale_acquire(_Locale_codecvt_category, name, sizeof(struct _Locale_codecvt),
+                                                   _Locale_codecvt_init, __err_code); }
+
+struct _Locale_numeric* _Locale_numeric_create(const char *name,
+                                               struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_numeric*)_Locale_acquire(_Locale_numeric_category, name, sizeof(struct _Locale_numeric),
+                                                   _Locale_numeric_init, __err_code); }
+
+struct _Locale_time* _Locale_time_create(const char *name,
+                                         struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_time*)_Locale_acquire(_Locale_time_category, name, sizeof(struct _Locale_time),
+                                                _Locale_known_init, __err_code); }
+
+struct _Locale_collate* _Locale_collate_create(const char *name,
+                                               struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_collate*)_Locale_acquire(_Locale_collate_category, name, sizeof(struct _Locale_collate),
+                                                   _Locale_collate_init, __err_code); }
+
+struct _Locale_monetary* _Locale_monetary_create(const char *name,
+                                                 struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_monetary*)_Locale_acquire(_Locale_monetary_category, name, sizeof(struct _Locale_monetary),
+                                                    _Locale_monetary_init, __err_code); }
+
+struct _Locale_messages* _Locale_messages_create(const char *name,
+                                                 struct _Locale_name_hint* hint, int *__err_code)
+{ return (struct _Locale_messages*)_Locale_acquire(_Locale_messages_category, name, sizeof(struct _Locale_messages),
+                                                    _Locale_known_init, __err_code); }
+
+/*
+  try to see locale category LC should be used from environment;
+  according POSIX, the order is
+  1. LC_ALL
+  2. category (LC_CTYPE, LC_NUMERIC, ... )
+  3. LANG
+  If set nothing, return "C" (this really implementation-specific).
+*/
+static const char *_Locale_aux_default(const char *LC, char *nm) {
+  char *name = getenv("LC_ALL");
+  if (name != NULL && *name != 0)
+    return name;
+  name = getenv(LC);
+  if (name != NULL && *name != 0)
+    return name;
+  name = getenv("LANG");
+  if (name != NULL && *name != 0)
+    return name;
+  return _C_name;
+}
+
+const char *_Locale_ctype_default(char* buf)    { return _Locale_aux_default("LC_CTYPE", buf); }
+const char *_Locale_numeric_default(char * buf) { return _Locale_aux_default("LC_NUMERIC", buf); }
+const char *_Locale_time_default(char* buf)     { return _Locale_aux_default("LC_TIME", buf); }
+const char *_Locale_collate_default(char* buf)  { return _Locale_aux_default("LC_COLLATE", buf); }
+const char *_Locale_monetary_default(char* buf) { return _Locale_aux_default("LC_MONETARY", buf); }
+const char *_Locale_messages_default(char* buf) { return _Locale_aux_default("LC_MESSAGES", buf); }
+
+char const* _Locale_ctype_name(const struct _Locale_ctype *lctype, char* buf)
+{ return lctype->entry.name; }
+
+char const* _Locale_codecvt_name(const struct _Locale_codecvt *lcodecvt, char* buf)
+{ return lcodecvt->entry.name; }
+
+char const* _Locale_numeric_name(const struct _Locale_numeric *lnum, char* buf)
+{ return lnum->entry.name; }
+
+char const* _Locale_time_name(const struct _Locale_time *ltime, char* buf)
+{ return ltime->entry.name; }
+
+char const* _Locale_collate_name(const struct _Locale_collate *lcol, char* buf)
+{ return lcol->entry.name; }
+
+char const* _Locale_monetary_name(const struct _Locale_monetary *lmon, char* buf)
+{ return lmon->entry.name; }
+
+char const* _Locale_messages_name(const struct _Locale_messages *lmes, char* buf)
+{ return lmes->entry.name; }
+
+/* Categories stay cached for the next locale of the same name. */
+void _Locale_ctype_destroy(struct _Locale_ctype *lctype)       {}
+void _Locale_codecvt_destroy(struct _Locale_codecvt *lcodecvt) {}
+void _Locale_numeric_destroy(struct _Locale_numeric *lnum)     {}
+void _Locale_time_destroy(struct _Locale_time *ltime)          {}
+void _Locale_collate_destroy(struct _Locale_collate *lcol)     {}
+void _Locale_monetary_destroy(struct _Locale_monetary *lmon)   {}
+void _Locale_messages_destroy(struct _Locale_messages *lmes)   {}
+
+/*
+ * locale loc expected either locale name indeed (platform-specific)
+ * or string like "LC_CTYPE=LocaleNameForCType;LC_NUMERIC=LocaleNameForNum;"
+ */
+static char const* _Locale_extract_name(const char *loc, const char *category, char *buf,
+                                        int *__err_code) {
+  const char *expr;
+  size_t len_name;
+
+  if (loc[0] == 'L' && loc[1] == 'C' && loc[2] == '_') {
+    expr = strstr(loc, category);
+    if (expr == NULL) {
+      *__err_code = _STLP_LOC_UNKNOWN_NAME;
+      return NULL; /* Category not found. */
+    }
+    expr += strlen(category);
+    len_name = strcspn(expr, ";");
+    len_name = len_name >= _Locale_MAX_SIMPLE_NAME ? _Locale_MAX_SIMPLE_NAME - 1 : len_name;
+    strncpy(buf, expr, len_name);
+    buf[len_name] = 0;
+    return buf;
+  }
+  return loc;
+}
+
+char const* _Locale_extract_ctype_name(const char *name, char *buf,
+                                       struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_CTYPE=", buf, __err_code); }
+
+char const* _Locale_extract_numeric_name(const char *name, char *buf,
+                                         struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_NUMERIC=", buf, __err_code); }
+
+char const* _Locale_extract_time_name(const char*name, char *buf,
+                                      struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_TIME=", buf, __err_code); }
+
+char const* _Locale_extract_collate_name(const char *name, char *buf,
+                                         struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_COLLATE=", buf, __err_code); }
+
+char const* _Locale_extract_monetary_name(const char *name, char *buf,
+                                          struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_MONETARY=", buf, __err_code); }
+
+char const* _Locale_extract_messages_name(const char *name, char *buf,
+                                          struct _Locale_name_hint* hint, int *__err_code)
+{ return _Locale_extract_name(name, "LC_MESSAGES=", buf, __err_code); }
+
+struct _Locale_name_hint* _Locale_get_ctype_hint(struct _Locale_ctype* ctype)
+{ return 0; }
+struct _Locale_name_hint* _Locale_get_numeric_hint(struct _Locale_numeric* numeric)
+{ return 0; }
+struct _Locale_name_hint* _Locale_get_time_hint(struct _Locale_time* time)
+{ return 0; }
+struct _Locale_name_hint* _Locale_get_collate_hint(struct _Locale_collate* collate)
+{ return 0; }
+struct _Locale_name_hint* _Locale_get_monetary_hint(struct _Locale_monetary* monetary)
+{ return 0; }
+struct _Locale_name_hint* _Locale_get_messages_hint(struct _Locale_messages* messages)
+{ return 0; }
+
+/* ctype */
+
+const _Locale_mask_t* _Locale_ctype_table(struct _Locale_ctype* lctype)
+{ return lctype->table; }
+
+/* c may come straight from a (signed) char */
+int _Locale_toupper(struct _Locale_ctype* lctype, int c)
+{ return lctype->upper[(unsigned char)c]; }
+
+int _Locale_tolower(struct _Locale_ctype* lctype, int c)
+{ return lctype->lower[(unsigned char)c]; }
+
+#ifndef _STLP_NO_WCHAR_T
+_Locale_mask_t _WLocale_ctype(struct _Locale_ctype *lctype, wint_t wc, _Locale_mask_t mask)
+{ return _Locale_mask(crystax_locale_ctype_class(lctype->ct, wc)) & mask; }
+
+wint_t _WLocale_tolower(struct _Locale_ctype *lctype, wint_t wc)
+{ return crystax_locale_ctype_tolower(lctype->ct, wc); }
+
+wint_t _WLocale_toupper(struct _Locale_ctype *lctype, wint_t wc)
+{ return crystax_locale_ctype_toupper(lctype->ct, wc); }
+
+int _WLocale_mb_cur_max(struct _Locale_codecvt *lcodecvt)
+{ return crystax_locale_ctype_mb_cur_max(lcodecvt->ct); }
+int _WLocale_mb_cur_min(struct _Locale_codecvt *lcodecvt) { return 1; }
+int _WLocale_is_stateless(struct _Locale_codecvt *lcodecvt) { return 1; }
+
+size_t _WLocale_mbtowc(struct _Locale_codecvt *lcodecvt,
+                       wchar_t *to,
+                       const char *from, size_t n,
+                       mbstate_t *st) {
+  /* Incomplete input is handed over again from the same place, so the
+     state only moves on once a whole character is there. */
+  mbstate_t tmp = *st;
+  size_t ret = crystax_locale_mbrtowc(lcodecvt->ct, to, from, n, &tmp);
+  if (ret == (size_t)-1 || ret == (size_t)-2)
+    return ret;
+  *st = tmp;
+  return ret == 0 ? 1 : ret;
+}
+
+size_t _WLocale_wctomb(struct _Locale_codecvt *lcodecvt,
+                       char *to, size_t n,
+                       const wchar_t c,
+                       mbstate_t *st) {
+  char buf[_Locale_MB_LEN_MAX];
+  mbstate_t tmp = *st;
+  size_t ret = crystax_locale_wcrtomb(lcodecvt->ct, buf, c, &tmp);
+  if (ret == (size_t)-1)
+    return ret;
+  if (ret > n)
+    return (size_t)-2;
+  memcpy(to, buf, ret);
+  *st = tmp;
+  return ret;
+}
+
+size_t _WLocale_unshift(struct _Locale_codecvt *lcodecvt,
+                        mbstate_t *st,
+                        char *buf, size_t n, char ** next)
+{ *next = buf; return 0; }
+#endif
+
+/* Collate */
+
+/* [s, s + n) as a C string: in buf if it fits, on the heap otherwise */
+static char* _Locale_cstr(const char *s, size_t n, char *buf, size_t bufSize) {
+  char *ret = n < bufSize ? buf : (char*)malloc(n + 1);
+  if (ret != NULL) {
+    memcpy(ret, s, n);
+    ret[n] = 0;
+  }
+  return ret;
+}
+
+static size_t _Locale_strnlen(const char *s, size_t n) {
+  const char *z = (const char*)memchr(s, 0, n);
+  return z != NULL ? (size_t)(z - s) : n;
+}
+
+/* Pieces between nulls compare in turn, shorter sequences first. */
+int _Locale_strcmp(struct _Locale_collate* lcol,
+                   const char* s1, size_t n1, const char* s2, size_t n2) {
+  char buf1[128], buf2[128];
+  for (;;) {
+    size_t l1 = _Locale_strnlen(s1, n1);
+    size_t l2 = _Locale_strnlen(s2, n2);
+    char *c1 = _Locale_cstr(s1, l1, buf1, sizeof(buf1));
+    char *c2 = _Locale_cstr(s2, l2, buf2, sizeof(buf2));
+    int ret;
+
+    if (c1 != NULL && c2 != NULL)
+      ret = crystax_locale_strcoll(lcol->co, c1, c2);
+    else if ((ret = memcmp(s1, s2, l1 < l2 ? l1 : l2)) == 0)
+      ret = l1 < l2 ? -1 : (l1 > l2 ? 1 : 0);
+    if (c1 != buf1) free(c1);
+    if (c2 != buf2) free(c2);
+    if (ret != 0)
+      return ret < 0 ? -1 : 1;
+
+    if (l1 == n1 || l2 == n2)
+      return l1 == n1 ? (l2 == n2 ? 0 : -1) : 1;
+    s1 += l1 + 1; n1 -= l1 + 1;
+    s2 += l2 + 1; n2 -= l2 + 1;
+  }
+}
+
+/* Keys of the pieces between nulls, separated by nulls. */
+size_t _Locale_strxfrm(struct _Locale_collate* lcol,
+                       char* dest, size_t dest_n,
+                       const char* src, size_t src_n) {
+  char buf[128];
+  size_t len = 0;
+  for (;;) {
+    size_t l = _Locale_strnlen(src, src_n);
+    size_t room = len < dest_n ? dest_n - len : 0;
+    char *c = _Locale_cstr(src, l, buf, sizeof(buf));
+
+    if (c == NULL)
+      return (size_t)-1;
+    len += crystax_locale_strxfrm(lcol->co, room != 0 ? dest + len : NULL, c, room);
+    if (c != buf) free(c);
+
+    if (l == src_n)
+      return len;
+    if (++len < dest_n)
+      dest[len - 1] = 0;
+    src += l + 1; src_n -= l + 1;
+  }
+}
+
+#ifndef _STLP_NO_WCHAR_T
+
+/*
+ * [s, s + n) in the multibyte encoding of the locale, nulls included.
+ * Byte order of the result is the order of the wide characters for all
+ * the encodings libcrystax converts.  NULL if a character can't be
+ * converted or on allocation failure.
+ */
+static char* _Locale_mbs(const struct crystax_locale_ctype *ct, const wchar_t *s, size_t n,
+                         char *buf, size_t bufSize, size_t *len) {
+  size_t max, cur = 0;
+  char *ret;
+  mbstate_t st;
+
+  if (ct == NULL)
+    return NULL;
+  max = (size_t)crystax_locale_ctype_mb_cur_max(ct);
+  ret = n * max < bufSize ? buf : (char*)malloc(n * max + 1);
+  if (ret == NULL)
+    return NULL;
+  memset(&st, 0, sizeof(st));
+  for (; n != 0; ++s, --n) {
+    size_t r = crystax_locale_wcrtomb(ct, ret + cur, *s, &st);
+    if (r == (size_t)-1) {
+      if (ret != buf) free(ret);
+      return NULL;
+    }
+    cur += r;
+  }
+  ret[cur] = 0;
+  *len = cur;
+  return ret;
+}
+
+static int _Locale_wcscmp(const wchar_t* s1, size_t n1, const wchar_t* s2, size_t n2) {
+  for (; n1 != 0 && n2 != 0; ++s1, ++s2, --n1, --n2) {
+    if (*s1 != *s2)
+      return *s1 < *s2 ? -1 : 1;
+  }
+  return n1 == n2 ? 0 : (n1 < n2 ? -1 : 1);
+}
+
+int _WLocale_strcmp(struct _Locale_collate* lcol,
+                    const wchar_t* s1, size_t n1, const wchar_t* s2, size_t n2) {
+  char buf1[256], buf2[256];
+  size_t l1, l2;
+  char *c1 = _Locale_mbs(lcol->ct, s1, n1, buf1, sizeof(buf1), &l1);
+  char *c2 = c1 != NULL ? _Locale_mbs(lcol->ct, s2, n2, buf2, sizeof(buf2), &l2) : NULL;
+  int ret;
+
+  if (c1 != NULL && c2 != NULL)
+    ret = _Locale_strcmp(lcol, c1, l1, c2, l2);
+  else
+    ret = _Locale_wcscmp(s1, n1, s2, n2);
+  if (c1 != buf1) free(c1);
+  if (c2 != buf2) free(c2);
+  return ret;
+}
+
+/* Each byte of the narrow key becomes a wide character. */
+size_t _WLocale_strxfrm(struct _Locale_collate* lcol,
+                        wchar_t* dest, size_t dest_n,
+                        const wchar_t* src, size_t src_n) {
+  char buf[256], kbuf[256];
+  size_t l, len, i;
+  char *c = _Locale_mbs(lcol->ct, src, src_n, buf, sizeof(buf), &l);
+  char *key;
+
+  if (c == NULL) {
+    if (dest != 0 && dest_n != 0) {
+      size_t n = src_n < dest_n ? src_n : dest_n - 1;
+      wmemcpy(dest, src, n);
+      dest[n] = 0;
+    }
+    return src_n;
+  }
+
+  len = _Locale_strxfrm(lcol, NULL, 0, c, l);
+  if (len == (size_t)-1)
+    key = NULL;
+  else
+    key = len < sizeof(kbuf) ? kbuf : (char*)malloc(len + 1);
+  if (key == NULL) {
+    if (c != buf) free(c);
+    return (size_t)-1;
+  }
+  _Locale_strxfrm(lcol, key, len + 1, c, l);
+  if (c != buf) free(c);
+
+  if (dest != 0 && dest_n != 0) {
+    for (i = 0; i < len && i < dest_n - 1; ++i)
+      dest[i] = (unsigned char)key[i];
+    dest[i] = 0;
+  }
+  if (key != kbuf) free(key);
+  return len;
+}
+
+#endif
+
+/* Numeric */
+
+char _Locale_decimal_point(struct _Locale_numeric* lnum)
+{ return lnum->lc->decimal_point[0]; }
+char _Locale_thousands_sep(struct _Locale_numeric* lnum)
+{ return lnum->lc->thousands_sep[0]; }
+const char* _Locale_grouping(struct _Locale_numeric * lnum)
+{ return lnum->lc->grouping; }
+const char * _Locale_true(struct _Locale_numeric * lnum)
+{ return "true"; }
+const char * _Locale_false(struct _Locale_numeric * lnum)
+{ return "false"; }
+
+#ifndef _STLP_NO_WCHAR_T
+wchar_t _WLocale_decimal_point(struct _Locale_numeric* lnum) {
+  wchar_t buf[2];
+  return _Locale_widen(lnum->ct, lnum->lc->decimal_point, buf, 2)[0];
+}
+wchar_t _WLocale_thousands_sep(struct _Locale_numeric* lnum) {
+  wchar_t buf[2];
+  return _Locale_widen(lnum->ct, lnum->lc->thousands_sep, buf, 2)[0];
+}
+const wchar_t * _WLocale_true(struct _Locale_numeric* lnum, wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, "true", buf, bufSize); }
+const wchar_t * _WLocale_false(struct _Locale_numeric* lnum, wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, "false", buf, bufSize); }
+#endif
+
+/* Monetary */
+
+const char* _Locale_int_curr_symbol(struct _Locale_monetary * lmon)
+{ return lmon->lc->int_curr_symbol; }
+const char* _Locale_currency_symbol(struct _Locale_monetary * lmon)
+{ return lmon->lc->currency_symbol; }
+char        _Locale_mon_decimal_point(struct _Locale_monetary * lmon)
+{ return lmon->lc->mon_decimal_point[0]; }
+char        _Locale_mon_thousands_sep(struct _Locale_monetary * lmon)
+{ return lmon->lc->mon_thousands_sep[0]; }
+const char* _Locale_mon_grouping(struct _Locale_monetary * lmon)
+{ return lmon->lc->mon_grouping; }
+const char* _Locale_positive_sign(struct _Locale_monetary * lmon)
+{ return lmon->lc->positive_sign; }
+const char* _Locale_negative_sign(struct _Locale_monetary * lmon)
+{ return lmon->lc->negative_sign; }
+char        _Locale_int_frac_digits(struct _Locale_monetary * lmon)
+{ return lmon->lc->int_frac_digits; }
+char        _Locale_frac_digits(struct _Locale_monetary * lmon)
+{ return lmon->lc->frac_digits; }
+int         _Locale_p_cs_precedes(struct _Locale_monetary * lmon)
+{ return lmon->lc->p_cs_precedes; }
+int         _Locale_p_sep_by_space(struct _Locale_monetary * lmon)
+{ return lmon->lc->p_sep_by_space; }
+int         _Locale_p_sign_posn(struct _Locale_monetary * lmon)
+{ return lmon->lc->p_sign_posn; }
+int         _Locale_n_cs_precedes(struct _Locale_monetary * lmon)
+{ return lmon->lc->n_cs_precedes; }
+int          _Locale_n_sep_by_space(struct _Locale_monetary * lmon)
+{ return lmon->lc->n_sep_by_space; }
+int          _Locale_n_sign_posn(struct _Locale_monetary * lmon)
+{ return lmon->lc->n_sign_posn; }
+
+#ifndef _STLP_NO_WCHAR_T
+const wchar_t* _WLocale_int_curr_symbol(struct _Locale_monetary * lmon,
+                                        wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(lmon->ct, lmon->lc->int_curr_symbol, buf, bufSize); }
+const wchar_t* _WLocale_currency_symbol(struct _Locale_monetary * lmon,
+                                        wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(lmon->ct, lmon->lc->currency_symbol, buf, bufSize); }
+wchar_t        _WLocale_mon_decimal_point(struct _Locale_monetary * lmon) {
+  wchar_t buf[2];
+  return _Locale_widen(lmon->ct, lmon->lc->mon_decimal_point, buf, 2)[0];
+}
+wchar_t        _WLocale_mon_thousands_sep(struct _Locale_monetary * lmon) {
+  wchar_t buf[2];
+  return _Locale_widen(lmon->ct, lmon->lc->mon_thousands_sep, buf, 2)[0];
+}
+const wchar_t* _WLocale_positive_sign(struct _Locale_monetary * lmon,
+                                      wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(lmon->ct, lmon->lc->positive_sign, buf, bufSize); }
+const wchar_t* _WLocale_negative_sign(struct _Locale_monetary * lmon,
+                                      wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(lmon->ct, lmon->lc->negative_sign, buf, bufSize); }
+#endif
+
+/* Time */
+static const char* full_monthname[] =
+{ "January", "February", "March", "April", "May", "June",
+  "July", "August", "September", "October", "November", "December" };
+const char * _Locale_full_monthname(struct _Locale_time * ltime, int n)
+{ return full_monthname[n]; }
+
+static const char* abbrev_monthname[] =
+{ "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+const char * _Locale_abbrev_monthname(struct _Locale_time * ltime, int n)
+{ return abbrev_monthname[n]; }
+
+static const char* full_dayname[] =
+{ "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+const char * _Locale_full_dayofweek(struct _Locale_time * ltime, int n)
+{ return full_dayname[n]; }
+
+static const char* abbrev_dayname[] =
+{ "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char * _Locale_abbrev_dayofweek(struct _Locale_time * ltime, int n)
+{ return abbrev_dayname[n]; }
+
+const char* _Locale_d_t_fmt(struct _Locale_time* ltime)
+{ return "%m/%d/%y"; }
+const char* _Locale_d_fmt(struct _Locale_time* ltime)
+{ return "%m/%d/%y"; }
+const char* _Locale_t_fmt(struct _Locale_time* ltime)
+{ return "%H:%M:%S"; }
+const char* _Locale_long_d_t_fmt(struct _Locale_time* ltime)
+{ return _empty_str; }
+const char* _Locale_long_d_fmt(struct _Locale_time* ltime)
+{ return _empty_str; }
+const char* _Locale_am_str(struct _Locale_time* ltime)
+{ return "AM"; }
+const char* _Locale_pm_str(struct _Locale_time* ltime)
+{ return "PM"; }
+
+#ifndef _STLP_NO_WCHAR_T
+const wchar_t * _WLocale_full_monthname(struct _Locale_time * ltime, int n,
+                                        wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, full_monthname[n], buf, bufSize); }
+const wchar_t * _WLocale_abbrev_monthname(struct _Locale_time * ltime, int n,
+                                          wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, abbrev_monthname[n], buf, bufSize); }
+const wchar_t * _WLocale_full_dayofweek(struct _Locale_time * ltime, int n,
+                                        wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, full_dayname[n], buf, bufSize); }
+const wchar_t * _WLocale_abbrev_dayofweek(struct _Locale_time * ltime, int n,
+                                          wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, abbrev_dayname[n], buf, bufSize); }
+const wchar_t* _WLocale_am_str(struct _Locale_time* ltime,
+                               wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, "AM", buf, bufSize); }
+const wchar_t* _WLocale_pm_str(struct _Locale_time* ltime,
+                               wchar_t* buf, size_t bufSize)
+{ return _Locale_widen(NULL, "PM", buf, bufSize); }
+#endif
+
+/* Messages */
+
+nl_catd_type _Locale_catopen(struct _Locale_messages* lmes, const char* name)
+{ return -1; }
+void _Locale_catclose(struct _Locale_messages* lmes, nl_catd_type cat) {}
+const char* _Locale_catgets(struct _Locale_messages* lmes, nl_catd_type cat,
+                            int setid, int msgid, const char *dfault)
+{ return dfault; }
@@ -20,6 +20,7 @@
 
 #include <locale>
 #include <stdexcept>
+#include <hash_map>
 
 #include "c_locale.h"
 #include "locale_impl.h"
@@ -134,6 +135,33 @@ locale::locale( _Locale_impl* impl ) :
   _M_impl( _get_Locale_impl( impl ) )
 {}
 
+#if defined (_STLP_USE_CRYSTAX_LOCALIZATION)
+// Locale data never changes once loaded, so the implementation built for a
+// name serves every later locale of that name. The cache holds a reference
+// to each of them for the life of the process. The system default ("") is
+// left out as it depends on the environment.
+typedef hash_map<string, _Locale_impl*, hash<string>, equal_to<string> > _Named_Locale_Map;
+static _Named_Locale_Map* _S_named_locales = 0;
+static _STLP_STATIC_MUTEX _Named_locales_lock _STLP_MUTEX_INITIALIZER;
+
+static _Locale_impl* _Stl_find_named_locale(const char* name) {
+  _STLP_auto_lock sentry(_Named_locales_lock);
+  if (_S_named_locales == 0)
+    return 0;
+  _Named_Locale_Map::iterator it = _S_named_locales->find(name);
+  return it != _S_named_locales->end() ? _get_Locale_impl((*it).second) : 0;
+}
+
+static void _Stl_remember_named_locale(const char* name, _Locale_impl* impl) {
+  _STLP_auto_lock sentry(_Named_locales_lock);
+  if (_S_named_locales == 0)
+    _S_named_locales = new _Named_Locale_Map();
+  _Named_Locale_Map::value_type __e(name, impl);
+  if (_S_named_locales->insert(__e).second)
+    _get_Locale_impl(impl);
+}
+#endif
+
 // Create a locale from a name.
 locale::locale(const char* name)
   : _M_impl(0) {
@@ -145,6 +173,11 @@ locale::locale(const char* name)
     return;
   }
 
+#if defined (_STLP_USE_CRYSTAX_LOCALIZATION)
+  if (name[0] != 0 && (_M_impl = _Stl_find_named_locale(name)) != 0)
+    return;
+#endif
+
   _Locale_impl* impl = 0;
   _STLP_TRY {
     impl = new _Locale_impl(locale::id::_S_max, name);
@@ -185,6 +218,15 @@ locale::locale(const char* name)
     _M_impl = _get_Locale_impl( impl );
   }
   _STLP_UNWIND(delete impl);
+
+#if defined (_STLP_USE_CRYSTAX_LOCALIZATION)
+  if (name[0] != 0) {
+    _STLP_TRY {
+      _Stl_remember_named_locale(name, _M_impl);
+    }
+    _STLP_CATCH_ALL {}
+  }
+#endif
 }
 
 static void _Stl_loc_combine_names_aux(_Locale_impl* L,
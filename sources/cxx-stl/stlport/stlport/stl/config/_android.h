@@ -21,8 +21,8 @@
 // C library is in the global namespace.
 #define _STLP_VENDOR_GLOBAL_CSTD 1
 
-// Don't have underlying local support.
-#undef _STLP_REAL_LOCALE_IMPLEMENTED
+// Named locales come from the locale data of libcrystax.
+#define _STLP_REAL_LOCALE_IMPLEMENTED 1
 
 // No pthread_spinlock_t in Android
 #define _STLP_DONT_USE_PTHREAD_SPINLOCK 1
@@ -43,8 +43,9 @@
 // No need to define our own namespace
 #define _STLP_NO_OWN_NAMESPACE 1
 
-// Use __new_alloc instead of __node_alloc, so we don't need static functions.
-#define _STLP_USE_SIMPLE_NODE_ALLOC 1
+// Serve __node_alloc from per thread pools, see src/allocators.cpp.
+// Only the library implementation changes, not the headers' interface.
+#define _STLP_NODE_ALLOC_PER_THREAD 1
 
 // Don't use extern versions of range errors, so we don't need to
 // compile as a library.
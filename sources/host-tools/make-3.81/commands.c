@@ -621,3 +621,16 @@ print_commands (struct commands *cmds)
       s = end;
     }
 }
+
+/* Write the commands in CMDS as the end of a rule line.  The text of
+   the lines after the first one starts with the tab read.  */
+
+void
+write_commands (FILE *fp, struct commands *cmds)
+{
+  unsigned int len = strlen (cmds->commands);
+
+  fprintf (fp, " ;%s", cmds->commands);
+  if (len == 0 || cmds->commands[len - 1] != '\n')
+    putc ('\n', fp);
+}
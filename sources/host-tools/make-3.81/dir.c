@@ -18,6 +18,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.  */
 
 #include "make.h"
 #include "hash.h"
+#include "filedef.h"
+
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif
 
 #ifdef	HAVE_DIRENT_H
 # include <dirent.h>
@@ -204,6 +209,151 @@ vmsstat_dir (char *name, struct stat *st)
 }
 #endif /* VMS */
 
+/* Cache of file status.
+
+   Make asks for the status of some names more than once: a makefile is
+   found by $(wildcard) and then checked as a goal, a directory is looked
+   up again under another spelling, and so on.  The answers are kept here,
+   keyed by the name in the string cache, until a command runs: make does
+   not expect anything else to change the files while it works.  */
+
+/* Reading a directory also reads the status of the files in it that make
+   knows about but has not checked yet, relative to the directory stream.  */
+
+#if defined (AT_FDCWD) && !defined (HAVE_CASE_INSENSITIVE_FS) \
+    && !defined (WINDOWS32) && !defined (VMS)
+# define PREFETCH_STATUSES
+#endif
+
+#ifndef	FILE_STATUS_BUCKETS
+#define FILE_STATUS_BUCKETS 1007
+#endif
+
+struct file_status
+  {
+    const char *name;		/* Name, in the string cache.  */
+    unsigned int epoch;		/* Value of `status_epoch' when read.  */
+    int error;			/* errno of a missing file, or zero.  */
+    struct stat st;		/* The status, if ERROR is zero.  */
+  };
+
+static struct hash_table file_statuses;
+
+/* Entries read before the last call to invalidate_file_stats have an
+   older epoch and are read again.  */
+static unsigned int status_epoch = 1;
+
+/* Number of status calls made, of those made while reading directories,
+   and of the calls the cache answered.  */
+static unsigned long status_calls;
+static unsigned long status_prefetched;
+static unsigned long status_saved;
+
+static unsigned long
+file_status_hash_1 (const void *key)
+{
+  return_STRING_HASH_1 (((struct file_status const *) key)->name);
+}
+
+static unsigned long
+file_status_hash_2 (const void *key)
+{
+  return_STRING_HASH_2 (((struct file_status const *) key)->name);
+}
+
+static int
+file_status_hash_cmp (const void *x, const void *y)
+{
+  return_STRING_COMPARE (((struct file_status const *) x)->name,
+			 ((struct file_status const *) y)->name);
+}
+
+/* Find the slot of NAME, which must be in the string cache.  */
+
+static struct file_status **
+file_status_slot (const char *name)
+{
+  struct file_status key;
+
+  key.name = name;
+  return (struct file_status **) hash_find_slot (&file_statuses, &key);
+}
+
+/* Store in SLOT the result of a status call on NAME.  Only successes and
+   missing files are kept: other errors are left to the caller.  */
+
+static void
+remember_file_status (struct file_status **slot, const char *name,
+		      int e, const struct stat *st)
+{
+  struct file_status *fs = *slot;
+
+  if (e != 0 && errno != ENOENT && errno != ENOTDIR)
+    return;
+
+  if (HASH_VACANT (fs))
+    {
+      fs = (struct file_status *) xmalloc (sizeof (struct file_status));
+      fs->name = name;
+      hash_insert_at (&file_statuses, fs, slot);
+    }
+  fs->epoch = status_epoch;
+  fs->error = e != 0 ? errno : 0;
+  if (e == 0)
+    fs->st = *st;
+}
+
+/* Like stat, but answer from the cache when NAME was read since the last
+   call to invalidate_file_stats.  */
+
+int
+stat_file (const char *name, struct stat *st)
+{
+  struct file_status **slot;
+  struct file_status *fs;
+  int e;
+
+  name = strcache_add (name);
+  slot = file_status_slot (name);
+  fs = *slot;
+  if (!HASH_VACANT (fs) && fs->epoch == status_epoch)
+    {
+      ++status_saved;
+      if (fs->error == 0)
+	{
+	  *st = fs->st;
+	  return 0;
+	}
+      errno = fs->error;
+      return -1;
+    }
+
+  ++status_calls;
+  EINTRLOOP (e, stat (name, st));
+  remember_file_status (slot, name, e, st);
+  return e;
+}
+
+/* Forget the status of all files: a command may have changed them.  */
+
+void
+invalidate_file_stats (void)
+{
+  ++status_epoch;
+}
+
+/* Print the number of status calls made and saved.  Without the cache,
+   each hit would have been a call, and nothing would have been read with
+   the directories.  */
+
+void
+print_file_stats (void)
+{
+  printf (_("%s: %lu stat calls (%lu while reading directories), %lu cache hits, %ld saved\n"),
+	  program, status_calls, status_prefetched, status_saved,
+	  (long) status_saved - (long) status_prefetched);
+}
+
 /* Hash table of directories.  */
 
 #ifndef	DIRECTORY_BUCKETS
@@ -238,6 +388,9 @@ struct directory_contents
 #endif /* WINDOWS32 */
     struct hash_table dirfiles;	/* Files in this directory.  */
     DIR *dirstream;		/* Stream reading this directory.  */
+#ifdef PREFETCH_STATUSES
+    const char *name;		/* Name the directory was first found by.  */
+#endif
   };
 
 static unsigned long
@@ -466,7 +619,7 @@ find_directory (char *name)
 #ifdef VMS
       r = vmsstat_dir (name, &st);
 #else
-      EINTRLOOP (r, stat (name, &st));
+      r = stat_file (name, &st);
 #endif
 
 #ifdef WINDOWS32
@@ -546,6 +699,9 @@ find_directory (char *name)
 	      dc->ino = st.st_ino;
 # endif
 #endif /* WINDOWS32 */
+#ifdef PREFETCH_STATUSES
+	      dc->name = dir->name;
+#endif
 	      hash_insert_at (&directory_contents, dc, dc_slot);
 	      ENULLLOOP (dc->dirstream, opendir (name));
 	      if (dc->dirstream == 0)
@@ -573,6 +729,66 @@ find_directory (char *name)
   return dir;
 }
 
+#ifdef PREFETCH_STATUSES
+/* DIR has been read in completely: read the status of each file in it
+   whose modtime make will want, through the open stream, while the
+   directory is still warm in the kernel caches.  */
+
+static void
+prefetch_file_stats (struct directory_contents *dir)
+{
+  struct dirfile **df = (struct dirfile **) dir->dirfiles.ht_vec;
+  struct dirfile **end = df + dir->dirfiles.ht_size;
+  unsigned int dlen = strlen (dir->name);
+  static char *buf;
+  static unsigned int bufsz;
+  int fd = dirfd (dir->dirstream);
+
+  /* Files in the current directory are named without a leading `./'.  */
+  if (dlen == 1 && dir->name[0] == '.')
+    dlen = 0;
+
+  for (; df < end; ++df)
+    {
+      struct file *f;
+      struct file_status **slot;
+      struct stat st;
+      const char *name;
+      unsigned int len;
+      int e;
+
+      if (HASH_VACANT (*df) || (*df)->impossible)
+	continue;
+
+      len = dlen + 1 + (*df)->length + 1;
+      if (len > bufsz)
+	{
+	  bufsz = len * 2;
+	  buf = xrealloc (buf, bufsz);
+	}
+      len = dlen;
+      memcpy (buf, dir->name, dlen);
+      if (dlen > 0 && buf[dlen - 1] != '/')
+	buf[len++] = '/';
+      memcpy (buf + len, (*df)->name, (*df)->length + 1);
+
+      f = lookup_file (buf);
+      if (f == 0 || f->last_mtime != UNKNOWN_MTIME)
+	continue;
+
+      name = strcache_add (buf);
+      slot = file_status_slot (name);
+      if (!HASH_VACANT (*slot) && (*slot)->epoch == status_epoch)
+	continue;
+
+      ++status_calls;
+      ++status_prefetched;
+      EINTRLOOP (e, fstatat (fd, (*df)->name, &st, 0));
+      remember_file_status (slot, name, e, &st);
+    }
+}
+#endif /* PREFETCH_STATUSES */
+
 /* Return 1 if the name FILENAME is entered in DIR's hash table.
    FILENAME must contain no slashes.  */
 
@@ -719,6 +935,9 @@ dir_contents_file_exists_p (struct directory_contents *dir, char *filename)
      close the stream and reset the pointer to nil.  */
   if (d == 0)
     {
+#ifdef PREFETCH_STATUSES
+      prefetch_file_stats (dir);
+#endif
       --open_directories;
       closedir (dir->dirstream);
       dir->dirstream = 0;
@@ -1174,25 +1393,13 @@ ansi_free (void *p)
     free(p);
 }
 
-/* On 64 bit ReliantUNIX (5.44 and above) in LFS mode, stat() is actually a
- * macro for stat64().  If stat is a macro, make a local wrapper function to
- * invoke it.
- */
-#ifndef stat
-# ifndef VMS
-extern int stat PARAMS ((const char *path, struct stat *sbuf));
-# endif
-# define local_stat stat
-#else
+/* Glob reads the status of files through the cache.  */
+
 static int
 local_stat (const char *path, struct stat *buf)
 {
-  int e;
-
-  EINTRLOOP (e, stat (path, buf));
-  return e;
+  return stat_file (path, buf);
 }
-#endif
 
 void
 dir_setup_glob (glob_t *gl)
@@ -1213,4 +1420,21 @@ hash_init_directories (void)
 	     directory_hash_1, directory_hash_2, directory_hash_cmp);
   hash_init (&directory_contents, DIRECTORY_BUCKETS,
 	     directory_contents_hash_1, directory_contents_hash_2, directory_contents_hash_cmp);
+  hash_init (&file_statuses, FILE_STATUS_BUCKETS,
+	     file_status_hash_1, file_status_hash_2, file_status_hash_cmp);
+}
+
+/* Call FN with the name of each directory looked at so far, and whether it
+   existed.  */
+
+void
+map_directories (void (*fn) (const char *name, int exists, void *arg),
+                 void *arg)
+{
+  struct directory **dirs = (struct directory **) directories.ht_vec;
+  struct directory **end = &dirs[directories.ht_size];
+
+  for (; dirs < end; ++dirs)
+    if (!HASH_VACANT (*dirs))
+      fn ((*dirs)->name, (*dirs)->contents != 0, arg);
 }
@@ -994,6 +994,217 @@ print_file_data_base (void)
   hash_print_stats (&files, stdout);
 }
 
+/* Return TEXT as it must be written in a rule to be read back, with `$'
+   doubled and `#' escaped, in a new string.  STOP lists the characters
+   TEXT may not contain besides newlines and `:', `;' and `='.  Return null
+   if TEXT cannot be written in a rule.  */
+
+static char *
+rule_text (const char *text, const char *stop)
+{
+  unsigned int len = strlen (text);
+  const char *p;
+  char *result;
+  char *o;
+
+  if (len == 0 || text[len - 1] == '\\' || strpbrk (text, stop) != 0
+      || strpbrk (text, "\n;=") != 0)
+    return 0;
+
+  for (p = strchr (text, ':'); p != 0; p = strchr (p + 1, ':'))
+    {
+#ifdef HAVE_DOS_PATHS
+      /* A drive letter.  */
+      if (p == text + 1 || (p > text + 1 && isblank ((unsigned char)p[-2])))
+        continue;
+#endif
+      return 0;
+    }
+
+  o = result = xmalloc (2 * len + 1);
+  for (p = text; *p != '\0'; ++p)
+    {
+      if (*p == '$')
+        *o++ = '$';
+      else if (*p == '#')
+        {
+          if (p != text && p[-1] == '\\')
+            {
+              free (result);
+              return 0;
+            }
+          *o++ = '\\';
+        }
+      *o++ = *p;
+    }
+  *o = '\0';
+  return result;
+}
+
+/* Return the name of a target as it must be written in a rule, in a new
+   string, or null if it cannot be.  `%' is only allowed when PATTERN is
+   nonzero.  */
+
+char *
+file_name_text (const char *name, int pattern)
+{
+  unsigned int len = strlen (name);
+
+  if (len != 0 && name[len - 1] == ')' && strchr (name, '(') != 0)
+    return 0;
+  return rule_text (name, pattern ? " \t|" : " \t|%");
+}
+
+/* Return a prerequisite line, as kept until snap_deps parses it, as it
+   must be written in a rule, in a new string, or null if it cannot be.  */
+
+char *
+dep_line_text (const struct dep *d)
+{
+  if (d->need_2nd_expansion)
+    return 0;
+  return rule_text (dep_name (d), "");
+}
+
+/* Write `NAME:' for F, or `NAME: PATTERN:' if F is the target of a static
+   pattern rule that matched STEM.  */
+
+static int
+write_target (FILE *fp, struct file *f, const char *name, const char *stem)
+{
+  fprintf (fp, "%s:%s", name, f->double_colon ? ":" : "");
+
+  if (stem != 0)
+    {
+      /* The pattern that matches F->NAME with STEM.  */
+      const char *p = f->name + strlen (f->name);
+      const char *q;
+      char *pattern;
+      char *text;
+
+      for (q = strstr (f->name, stem); q != 0 && *stem != '\0';
+           q = strstr (q + 1, stem))
+        p = q;
+      pattern = xmalloc (strlen (f->name) + 2);
+      sprintf (pattern, "%.*s%%%s", (int) (p - f->name), f->name,
+               p + strlen (stem));
+      text = file_name_text (pattern, 1);
+      free (pattern);
+      if (text == 0)
+        return 1;
+      fprintf (fp, " %s:", text);
+      free (text);
+    }
+
+  return 0;
+}
+
+/* Write the rules of F as makefile text, one for each prerequisite line,
+   and those of the double-colon entries after it.  Commands go with the
+   last line when it came with them, for $< to be the same.  */
+
+static int
+write_file (FILE *fp, struct file *f)
+{
+  char *name = file_name_text (f->name, 0);
+  int bad = 0;
+
+  if (name == 0)
+    return 1;
+
+  if (f->variables != 0)
+    bad = write_target_variables (fp, name, f->variables->set);
+
+  for (; f != 0 && !bad; f = f->prev)
+    {
+      int cmds = f->cmds != 0 && f->cmds->fileinfo.filenm != 0;
+      struct dep *d;
+
+      if (!f->is_target)
+        continue;
+
+      /* An empty .SUFFIXES rule clears the suffixes known by default.  */
+      if (streq (f->name, ".SUFFIXES"))
+        fputs (".SUFFIXES:\n", fp);
+
+      /* Default commands would change where lines read back go.  */
+      if (f->cmds != 0 && !cmds && f->deps != 0 && f->deps->next != 0)
+        {
+          bad = 1;
+          break;
+        }
+
+      for (d = f->deps; d != 0 && !bad; d = d->next)
+        {
+          int last = cmds && d->next == 0
+            && (f->double_colon || f->updating);
+          char *text = dep_line_text (d);
+
+          if (text == 0)
+            bad = 1;
+          else
+            bad = write_target (fp, f, name,
+                                d->staticpattern ? d->stem
+                                : last ? f->stem : 0);
+          if (bad)
+            {
+              if (text != 0)
+                free (text);
+              break;
+            }
+
+          fprintf (fp, " %s", text);
+          free (text);
+          if (last)
+            {
+              write_commands (fp, f->cmds);
+              cmds = 0;
+            }
+          else
+            putc ('\n', fp);
+        }
+
+      if (!bad && (cmds || f->deps == 0))
+        {
+          bad = write_target (fp, f, name, f->stem);
+          if (bad)
+            break;
+          if (cmds)
+            write_commands (fp, f->cmds);
+          else
+            putc ('\n', fp);
+        }
+    }
+
+  free (name);
+  return bad;
+}
+
+static int
+file_name_cmp (const void *x, const void *y)
+{
+  return strcmp ((*(struct file const **) x)->name,
+                 (*(struct file const **) y)->name);
+}
+
+/* Write the rules read so far for all the files as makefile text.  Only
+   valid before snap_deps.  Return nonzero if one of them cannot be written
+   that way.  */
+
+int
+write_file_data_base (FILE *fp)
+{
+  struct file **all = (struct file **) hash_dump (&files, 0, file_name_cmp);
+  struct file **f;
+  int bad = 0;
+
+  for (f = all; *f != 0 && !bad; ++f)
+    bad = write_file (fp, *f);
+  free (all);
+
+  return bad;
+}
+
 #define EXPANSION_INCREMENT(_l)  ((((_l) / 500) + 1) * 500)
 
 char *
@@ -111,6 +111,8 @@ extern void rehash_file PARAMS ((struct file *file, char *name));
 extern void set_command_state PARAMS ((struct file *file, enum cmd_state state));
 extern void notice_finished_file PARAMS ((struct file *file));
 extern void init_hash_files PARAMS ((void));
+extern char *file_name_text PARAMS ((const char *name, int pattern));
+extern char *dep_line_text PARAMS ((const struct dep *d));
 extern char *build_target_list PARAMS ((char *old_list));
 
 #if FILE_TIMESTAMP_HI_RES
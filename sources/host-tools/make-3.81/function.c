@@ -1417,7 +1417,7 @@ fold_newlines (char *buffer, unsigned int *length)
 
 
 
-int shell_function_pid = 0, shell_function_completed;
+int shell_function_pid = 0, shell_function_completed, shell_function_failed;
 
 
 #ifdef WINDOWS32
@@ -1574,8 +1574,101 @@ msdos_openpipe (int* pipedes, int *pidp, char *text)
 
 #else
 #ifndef _AMIGA
+
+/* Output of the $(shell) commands run so far whose program is listed in
+   .SHELL_MEMO.  Listing a program says that its output depends only on
+   its command line for the whole run, so each command is run once.  */
+
+struct shell_memo
+  {
+    char *command;
+    char *output;
+    unsigned int length;
+  };
+
+static struct hash_table shell_memos;
+
+static unsigned long
+shell_memo_hash_1 (const void *key)
+{
+  return_STRING_HASH_1 (((struct shell_memo const *) key)->command);
+}
+
+static unsigned long
+shell_memo_hash_2 (const void *key)
+{
+  return_STRING_HASH_2 (((struct shell_memo const *) key)->command);
+}
+
+static int
+shell_memo_hash_cmp (const void *x, const void *y)
+{
+  return_STRING_COMPARE (((struct shell_memo const *) x)->command,
+			 ((struct shell_memo const *) y)->command);
+}
+
+/* Return nonzero if the first word of COMMAND is listed in .SHELL_MEMO.  */
+
+static int
+shell_memoizable (char *command)
+{
+  char *list, *p, *w, *name;
+  unsigned int len, wlen;
+  int found = 0;
+
+  if (lookup_variable (".SHELL_MEMO", 11) == 0)
+    return 0;
+
+  p = command;
+  name = find_next_token (&p, &len);
+  if (name == 0)
+    return 0;
+
+  list = allocated_variable_expand ("$(.SHELL_MEMO)");
+  p = list;
+  while (!found && (w = find_next_token (&p, &wlen)) != 0)
+    found = wlen == len && strneq (w, name, len);
+  free (list);
+
+  return found;
+}
+
+/* Return the output remembered for COMMAND, or a null pointer.  */
+
+static struct shell_memo *
+find_shell_memo (char *command)
+{
+  struct shell_memo key;
+
+  if (shell_memos.ht_vec == 0)
+    return 0;
+
+  key.command = command;
+  return (struct shell_memo *) hash_find_item (&shell_memos, &key);
+}
+
+/* Remember OUTPUT, of LENGTH bytes, as the output of COMMAND.  */
+
+static void
+remember_shell_output (char *command, char *output, unsigned int length)
+{
+  struct shell_memo *m;
+
+  if (shell_memos.ht_vec == 0)
+    hash_init (&shell_memos, 31,
+	       shell_memo_hash_1, shell_memo_hash_2, shell_memo_hash_cmp);
+
+  m = (struct shell_memo *) xmalloc (sizeof (struct shell_memo));
+  m->command = xstrdup (command);
+  m->output = savestring (output, length);
+  m->length = length;
+  hash_insert (&shell_memos, m);
+}
+
+/* O is volatile since it is live across the vfork below.  */
+
 static char *
-func_shell (char *o, char **argv, const char *funcname UNUSED)
+func_shell (char *volatile o, char **argv, const char *funcname UNUSED)
 {
   char* batch_filename = NULL;
 
@@ -1587,6 +1680,18 @@ func_shell (char *o, char **argv, const char *funcname UNUSED)
   char **envp;
   int pipedes[2];
   int pid;
+  int memoizable = shell_memoizable (argv[0]);
+
+  if (memoizable)
+    {
+      struct shell_memo *m = find_shell_memo (argv[0]);
+
+      if (m != 0)
+	{
+	  DB (DB_VERBOSE, (_("Reusing the output of `%s'.\n"), argv[0]));
+	  return variable_buffer_output (o, m->output, m->length);
+	}
+    }
 
 #ifndef __MSDOS__
   /* Construct the argument list.  */
@@ -1597,6 +1702,10 @@ func_shell (char *o, char **argv, const char *funcname UNUSED)
     return o;
 #endif
 
+  /* The command may change any file.  Make waits for it, so forgetting
+     the status of files now is enough.  */
+  invalidate_file_stats ();
+
   /* Using a target environment for `shell' loses in cases like:
      export var = $(shell echo foobie)
      because target_environment hits a loop trying to expand $(var)
@@ -1659,6 +1768,16 @@ func_shell (char *o, char **argv, const char *funcname UNUSED)
 
 # else /* ! __EMX__ */
 
+#  ifdef USE_POSIX_SPAWN
+  {
+    int close_fds[2];
+
+    close_fds[0] = pipedes[0];
+    close_fds[1] = -1;
+    pid = child_spawn_job (0, pipedes[1], command_argv, envp, close_fds, 0);
+  }
+  if (pid < 0)
+#  endif
   pid = vfork ();
   if (pid < 0)
     perror_with_name (error_prefix, "fork");
@@ -1677,6 +1796,7 @@ func_shell (char *o, char **argv, const char *funcname UNUSED)
 
       /* Record the PID for reap_children.  */
       shell_function_pid = pid;
+      shell_function_failed = 0;
 #ifndef  __MSDOS__
       shell_function_completed = 0;
 
@@ -1746,6 +1866,10 @@ func_shell (char *o, char **argv, const char *funcname UNUSED)
 	     with spaces, and put that in the variable output buffer.  */
 	  fold_newlines (buffer, &i);
 	  o = variable_buffer_output (o, buffer, i);
+	  /* Output of a failing command may be incomplete or an error
+	     message; it is not worth reusing.  */
+	  if (memoizable && !shell_function_failed)
+	    remember_shell_output (argv[0], buffer, i);
 	}
 
       free (buffer);
@@ -2028,6 +2152,797 @@ func_abspath (char *o, char **argv, const char *funcname UNUSED)
  return o;
 }
 
+static char *func_call PARAMS ((char *o, char **argv, const char *funcname));
+
+/* Module graph functions for ndk-build.  They compute the same lists as the
+   -ndk-mod-get-closure and -ndk-mod-get-topo-list macros of
+   build/core/definitions-graph.mk, including their order, but in time
+   linear in the size of the graph.
+
+   $(ndk-closure LIST,DEPS) returns the nodes of LIST followed by all the
+   nodes they depend on, in breadth-first order.  $(call DEPS,NODE) must
+   expand to the direct dependencies of NODE.
+
+   $(ndk-toposort LIST,DEPS) returns the same nodes ordered so that each node
+   comes before its dependencies.  If no node of the closure is free of
+   incoming edges, the graph has a cycle and the closure is returned.  */
+
+struct graph_node
+  {
+    char *name;
+    struct graph_node **deps;	/* Direct dependencies, in DEPS order.  */
+    unsigned int ndeps;
+    unsigned int incoming;	/* Edges not yet removed by the sort.  */
+    int visited;
+  };
+
+struct graph
+  {
+    struct hash_table nodes;
+    char *deps_func;
+    struct graph_node **list;	/* Closure, in visit order.  */
+    unsigned int count;
+    unsigned int size;
+  };
+
+static unsigned long
+graph_node_hash_1 (const void *key)
+{
+  return_STRING_HASH_1 (((struct graph_node const *) key)->name);
+}
+
+static unsigned long
+graph_node_hash_2 (const void *key)
+{
+  return_STRING_HASH_2 (((struct graph_node const *) key)->name);
+}
+
+static int
+graph_node_hash_cmp (const void *x, const void *y)
+{
+  return_STRING_COMPARE (((struct graph_node const *) x)->name,
+                         ((struct graph_node const *) y)->name);
+}
+
+static void
+graph_node_free (const void *item)
+{
+  struct graph_node *n = (struct graph_node *) item;
+  free (n->name);
+  if (n->deps)
+    free (n->deps);
+  free (n);
+}
+
+static struct graph_node *
+graph_lookup (struct graph *g, const char *name, unsigned int len)
+{
+  struct graph_node key;
+  struct graph_node **slot;
+  struct graph_node *n;
+
+  key.name = savestring (name, len);
+  slot = (struct graph_node **) hash_find_slot (&g->nodes, &key);
+  if (!HASH_VACANT (*slot))
+    {
+      free (key.name);
+      return *slot;
+    }
+
+  n = (struct graph_node *) xmalloc (sizeof (struct graph_node));
+  n->name = key.name;
+  n->deps = 0;
+  n->ndeps = 0;
+  n->incoming = 0;
+  n->visited = 0;
+  hash_insert_at (&g->nodes, n, slot);
+  return n;
+}
+
+static void
+graph_append (struct graph *g, struct graph_node *n)
+{
+  if (g->count == g->size)
+    {
+      g->size = g->size ? g->size * 2 : 64;
+      g->list = (struct graph_node **)
+        xrealloc ((char *) g->list, g->size * sizeof (struct graph_node *));
+    }
+  g->list[g->count++] = n;
+  n->visited = 1;
+}
+
+/* Set the dependencies of N from $(call DEPS,NAME).  */
+
+static void
+graph_load_deps (struct graph *g, struct graph_node *n)
+{
+  char *argv[3];
+  char *obuf;
+  unsigned int olen;
+  char *p;
+  char *w;
+  unsigned int len;
+  unsigned int size = 0;
+
+  argv[0] = g->deps_func;
+  argv[1] = n->name;
+  argv[2] = 0;
+
+  /* The expansion goes to a buffer of its own, which restoring frees.  */
+  install_variable_buffer (&obuf, &olen);
+  func_call (variable_buffer, argv, "call");
+
+  p = variable_buffer;
+  while ((w = find_next_token (&p, &len)) != 0)
+    {
+      if (n->ndeps == size)
+        {
+          size = size ? size * 2 : 8;
+          n->deps = (struct graph_node **)
+            xrealloc ((char *) n->deps, size * sizeof (struct graph_node *));
+        }
+      n->deps[n->ndeps++] = graph_lookup (g, w, len);
+    }
+
+  restore_variable_buffer (obuf, olen);
+}
+
+/* Compute the closure of the nodes in LIST into G->list.  Like the macro,
+   every word of LIST is listed, even when it is repeated.  */
+
+static void
+graph_closure (struct graph *g, char *list, char *deps_func)
+{
+  char *p = list;
+  char *w;
+  unsigned int len;
+  unsigned int i;
+  unsigned int j;
+
+  hash_init (&g->nodes, 1024,
+             graph_node_hash_1, graph_node_hash_2, graph_node_hash_cmp);
+  g->deps_func = deps_func;
+  g->list = 0;
+  g->count = 0;
+  g->size = 0;
+
+  while ((w = find_next_token (&p, &len)) != 0)
+    graph_append (g, graph_lookup (g, w, len));
+
+  for (i = 0; i < g->count; ++i)
+    {
+      struct graph_node *n = g->list[i];
+
+      if (!n->deps)
+        graph_load_deps (g, n);
+      for (j = 0; j < n->ndeps; ++j)
+        if (!n->deps[j]->visited)
+          graph_append (g, n->deps[j]);
+    }
+}
+
+static void
+graph_free (struct graph *g)
+{
+  hash_map (&g->nodes, graph_node_free);
+  hash_free (&g->nodes, 0);
+  if (g->list)
+    free (g->list);
+}
+
+static char *
+graph_output (char *o, struct graph_node **list, unsigned int count)
+{
+  unsigned int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      if (i)
+        o = variable_buffer_output (o, " ", 1);
+      o = variable_buffer_output (o, list[i]->name, strlen (list[i]->name));
+    }
+  return o;
+}
+
+static char *
+func_ndk_closure (char *o, char **argv, const char *funcname UNUSED)
+{
+  struct graph g;
+
+  graph_closure (&g, argv[0], argv[1]);
+  o = graph_output (o, g.list, g.count);
+  graph_free (&g);
+  return o;
+}
+
+static char *
+func_ndk_toposort (char *o, char **argv, const char *funcname UNUSED)
+{
+  struct graph g;
+  struct graph_node **queue;
+  unsigned int head = 0;
+  unsigned int tail = 0;
+  unsigned int qsize;
+  unsigned int i;
+  unsigned int j;
+
+  graph_closure (&g, argv[0], argv[1]);
+
+  for (i = 0; i < g.count; ++i)
+    for (j = 0; j < g.list[i]->ndeps; ++j)
+      ++g.list[i]->deps[j]->incoming;
+
+  for (i = 0; i < g.count; ++i)
+    if (!g.list[i]->incoming)
+      break;
+
+  if (i == g.count)
+    {
+      o = graph_output (o, g.list, g.count);
+      graph_free (&g);
+      return o;
+    }
+
+  /* Kahn's algorithm from the first node without incoming edges.  Counts
+     stop at zero and a node is queued each time one of its edges is removed
+     at zero, as in -ndk-mod-topo-sort.  */
+  qsize = g.count;
+  queue = (struct graph_node **) xmalloc (qsize * sizeof (struct graph_node *));
+  queue[tail++] = g.list[i];
+  while (head < tail)
+    {
+      struct graph_node *n = queue[head++];
+
+      if (n->incoming)
+        --n->incoming;
+      for (j = 0; j < n->ndeps; ++j)
+        {
+          struct graph_node *d = n->deps[j];
+
+          if (d->incoming)
+            --d->incoming;
+          if (!d->incoming)
+            {
+              if (tail == qsize)
+                {
+                  qsize *= 2;
+                  queue = (struct graph_node **)
+                    xrealloc ((char *) queue,
+                              qsize * sizeof (struct graph_node *));
+                }
+              queue[tail++] = d;
+            }
+        }
+    }
+
+  o = graph_output (o, queue, tail);
+  free (queue);
+  graph_free (&g);
+  return o;
+}
+
+
+/* Persistent data base for ndk-build.
+
+   $(ndk-database-save FILE,KEY[,INPUTS]) writes the variables, rules and
+   `vpath' directives read so far to FILE as a makefile.  Comment lines at
+   its top record what they were computed from: KEY, the environment and
+   the command line, the makefiles read and the files in INPUTS, and the
+   directories searched.  It expands to nothing, and does not write FILE
+   when something read cannot be written back as makefile text.
+
+   $(ndk-database-check FILE,KEY) expands to `true' if FILE was saved with
+   KEY and none of the things it records has changed since.  Including FILE
+   then defines what reading the makefiles again would.  */
+
+extern int write_rule_data_base PARAMS ((FILE *fp));
+extern int write_file_data_base PARAMS ((FILE *fp));
+extern void write_vpath_data_base PARAMS ((FILE *fp));
+extern void map_directories PARAMS ((void (*fn) (const char *name, int exists, void *arg), void *arg));
+
+#define DATABASE_FORMAT "# ndk-database 1"
+
+/* 64-bit FNV-1a.  */
+#define DATABASE_HASH_INIT ((uintmax_t) 0xcbf29ce484222325ULL)
+#define DATABASE_HASH_PRIME ((uintmax_t) 0x100000001b3ULL)
+
+/* Environment variables that change without affecting the makefiles.  */
+static const char *const database_volatile_env[] =
+  {
+    "_", "OLDPWD", "SHLVL", "MAKELEVEL", "MAKEFLAGS", "MFLAGS", 0
+  };
+
+static uintmax_t
+database_hash (uintmax_t h, const char *p, unsigned int len)
+{
+  for (; len != 0; --len, ++p)
+    {
+      h ^= (unsigned char) *p;
+      h *= DATABASE_HASH_PRIME;
+    }
+  return h;
+}
+
+/* Hash S with its terminator, so that a list of strings hashes to a
+   different value than their concatenation.  */
+
+static uintmax_t
+database_hash_string (uintmax_t h, const char *s)
+{
+  return database_hash (h, s, strlen (s) + 1);
+}
+
+/* Write X in BUF as 16 hexadecimal digits, and return BUF.  */
+
+static char *
+database_hex (char *buf, uintmax_t x)
+{
+  int i;
+
+  for (i = 15; i >= 0; --i, x >>= 4)
+    buf[i] = "0123456789abcdef"[x & 15];
+  buf[16] = '\0';
+  return buf;
+}
+
+static int
+database_env_cmp (const void *x, const void *y)
+{
+  return strcmp (*(char *const *) x, *(char *const *) y);
+}
+
+/* Compute in BUF the hash of KEY and of what the makefiles may read
+   without it being tracked: the current directory, the names of the
+   environment variables, PATH, and the variables and switches of the
+   command line.  */
+
+static char *
+database_key (char *buf, const char *key)
+{
+  uintmax_t h = database_hash_string (DATABASE_HASH_INIT, key);
+  struct variable *v;
+  const char *path;
+  char **env;
+  unsigned int n;
+  unsigned int i;
+
+  h = database_hash_string (h, starting_directory ? starting_directory : "");
+
+  for (n = 0; environ[n] != 0; ++n)
+    ;
+  env = (char **) xmalloc ((n + 1) * sizeof (char *));
+  memcpy (env, environ, n * sizeof (char *));
+  qsort (env, n, sizeof (char *), database_env_cmp);
+  for (i = 0; i < n; ++i)
+    {
+      unsigned int len = strcspn (env[i], "=");
+      const char *const *p;
+
+      for (p = database_volatile_env; *p != 0; ++p)
+        if (strlen (*p) == len && strneq (env[i], *p, len))
+          break;
+      if (*p == 0)
+        h = database_hash (h, env[i], len + 1);
+    }
+  free (env);
+
+  path = getenv ("PATH");
+  h = database_hash_string (h, path ? path : "");
+
+  v = lookup_variable ("-*-command-variables-*-", 23);
+  h = database_hash_string (h, v ? v->value : "");
+  h = database_hash_string (h, env_overrides ? "-e" : "");
+  h = database_hash_string (h, no_builtin_rules_flag ? "-r" : "");
+  h = database_hash_string (h, no_builtin_variables_flag ? "-R" : "");
+
+  return database_hex (buf, h);
+}
+
+/* Set *H to the hash of the contents of NAME.  Return zero if it cannot
+   be read.  */
+
+static int
+database_file_hash (const char *name, uintmax_t *h)
+{
+  FILE *fp = fopen (name, "rb");
+  char buf[8192];
+  size_t n;
+
+  if (fp == 0)
+    return 0;
+  *h = DATABASE_HASH_INIT;
+  while ((n = fread (buf, 1, sizeof buf, fp)) > 0)
+    *h = database_hash (*h, buf, n);
+  n = ferror (fp);
+  fclose (fp);
+  return n == 0;
+}
+
+struct database_save
+  {
+    FILE *fp;
+    const char *dir;		/* Where the data base is.  */
+    time_t now;
+  };
+
+static void
+database_save_env (const char *name, void *arg)
+{
+  struct database_save *s = (struct database_save *) arg;
+  const char *value = getenv (name);
+  char hex[17];
+
+  fprintf (s->fp, "# env %s %s\n", name,
+           value ? database_hex (hex, database_hash_string (DATABASE_HASH_INIT,
+                                                            value))
+           : "-");
+}
+
+/* Record the size, modification time and contents of NAME.  A time within
+   a second of now could still be that of a later change, so the contents
+   are compared regardless.  */
+
+static void
+database_save_input (struct database_save *s, const char *name)
+{
+  struct stat st;
+  uintmax_t h;
+  char size[17];
+  char mtime[17];
+  char hash[17];
+
+  if (stat_file (name, &st) != 0 || !database_file_hash (name, &h))
+    {
+      fprintf (s->fp, "# input - - - %s\n", name);
+      return;
+    }
+
+  if (st.st_mtime >= s->now - 1)
+    strcpy (mtime, "-");
+  else
+    database_hex (mtime, FILE_TIMESTAMP_STAT_MODTIME (name, st));
+  fprintf (s->fp, "# input %s %s %s %s\n",
+           database_hex (size, (uintmax_t) st.st_size), mtime,
+           database_hex (hash, h), name);
+}
+
+/* Record whether directory NAME exists and its modification time, which
+   changes when entries are added to it or removed.  */
+
+static void
+database_save_dir (const char *name, int exists, void *arg)
+{
+  struct database_save *s = (struct database_save *) arg;
+  struct stat st;
+  char mtime[17];
+
+  if (streq (name, s->dir))
+    return;
+  if (exists && stat_file (name, &st) == 0)
+    fprintf (s->fp, "# dir %s %s\n",
+             database_hex (mtime, FILE_TIMESTAMP_STAT_MODTIME (name, st)), name);
+  else
+    fprintf (s->fp, "# dir - %s\n", name);
+}
+
+static void
+database_save_inputs (struct database_save *s, const char *list)
+{
+  char *p = (char *) list;
+  char *w;
+  unsigned int len;
+
+  while ((w = find_next_token (&p, &len)) != 0)
+    {
+      char *name = savestring (w, len);
+      database_save_input (s, name);
+      free (name);
+    }
+}
+
+/* Create the directories leading to NAME.  */
+
+static void
+database_make_dirs (char *name)
+{
+  char *p;
+
+  for (p = name + 1; *p != '\0'; ++p)
+    if (*p == '/'
+#ifdef HAVE_DOS_PATHS
+        || *p == '\\'
+#endif
+        )
+      {
+        char c = *p;
+
+        *p = '\0';
+#ifdef WINDOWS32
+        mkdir (name);
+#else
+        mkdir (name, 0777);
+#endif
+        *p = c;
+      }
+}
+
+static char *
+func_ndk_database_save (char *o, char **argv, const char *funcname UNUSED)
+{
+  struct database_save s;
+  struct variable *v;
+  char *p = argv[0];
+  unsigned int len;
+  char *file;
+  char *tmp;
+  char *w;
+  char key[17];
+  int bad;
+
+  w = find_next_token (&p, &len);
+  if (w == 0)
+    return o;
+  file = savestring (w, len);
+  tmp = xmalloc (len + 32);
+  sprintf (tmp, "%s.%lu", file, (unsigned long) getpid ());
+
+  s.dir = file;
+  database_make_dirs (file);
+  s.fp = fopen (tmp, "w");
+  if (s.fp == 0)
+    {
+      DB (DB_BASIC, (_("Cannot write data base `%s': %s\n"),
+                     tmp, strerror (errno)));
+      free (tmp);
+      free (file);
+      return o;
+    }
+  s.now = time ((time_t *) 0);
+
+  fprintf (s.fp, "%s\n# key %s\n", DATABASE_FORMAT,
+           database_key (key, argv[1]));
+  map_used_environment (database_save_env, &s);
+  v = lookup_variable ("MAKEFILE_LIST", 13);
+  if (v != 0)
+    database_save_inputs (&s, v->value);
+  if (argv[2] != 0)
+    database_save_inputs (&s, argv[2]);
+
+  /* The data base is replaced in its own directory, which is not tracked.  */
+  w = strrchr (file, '/');
+  if (w != 0)
+    {
+      *w = '\0';
+      map_directories (database_save_dir, &s);
+      *w = '/';
+    }
+  else
+    {
+      s.dir = ".";
+      map_directories (database_save_dir, &s);
+    }
+  fputs ("# end\n", s.fp);
+
+  bad = write_variable_data_base (s.fp);
+  if (!bad)
+    {
+      write_vpath_data_base (s.fp);
+      bad = write_rule_data_base (s.fp);
+    }
+  if (!bad)
+    bad = write_file_data_base (s.fp);
+
+  if (ferror (s.fp))
+    bad = 1;
+  if (fclose (s.fp) != 0)
+    bad = 1;
+
+#ifdef WINDOWS32
+  if (!bad)
+    remove (file);
+#endif
+  if (bad || rename (tmp, file) != 0)
+    {
+      DB (DB_BASIC, (_("Not saving data base `%s'\n"), file));
+      remove (tmp);
+    }
+
+  free (tmp);
+  free (file);
+  return o;
+}
+
+/* Split the next field off *P, which points into a line.  Return null if
+   there is none.  */
+
+static char *
+database_field (char **p)
+{
+  char *f = *p;
+  char *end;
+
+  if (f == 0 || *f == '\0')
+    return 0;
+  end = strchr (f, ' ');
+  if (end != 0)
+    {
+      *end = '\0';
+      *p = end + 1;
+    }
+  else
+    *p = f + strlen (f);
+  return f;
+}
+
+/* Return nonzero if what the header line LINE records is still the same.
+   The makefiles read so far, in *MAKEFILES, must be the first inputs
+   recorded; *MAKEFILES is advanced past those found.  LINE is modified.  */
+
+static int
+database_line_valid (char *line, char **makefiles)
+{
+  struct stat st;
+  char *p = line;
+  char *what;
+  char hex[17];
+
+  if (strncmp (p, "# ", 2) != 0)
+    return 0;
+  p += 2;
+  what = database_field (&p);
+  if (what == 0)
+    return 0;
+
+  if (streq (what, "env"))
+    {
+      char *name = database_field (&p);
+      const char *value;
+
+      if (name == 0)
+        return 0;
+      value = getenv (name);
+      if (value == 0)
+        return streq (p, "-");
+      return streq (p, database_hex (hex, database_hash_string
+                                     (DATABASE_HASH_INIT, value)));
+    }
+
+  if (streq (what, "input"))
+    {
+      char *size = database_field (&p);
+      char *mtime = database_field (&p);
+      char *hash = database_field (&p);
+      uintmax_t h;
+
+      if (hash == 0 || *p == '\0')
+        return 0;
+      if (*makefiles != 0)
+        {
+          unsigned int len;
+          char *w = find_next_token (makefiles, &len);
+
+          if (w != 0 && (strlen (p) != len || !strneq (p, w, len)))
+            return 0;
+        }
+      if (streq (size, "-"))
+        return stat_file (p, &st) != 0;
+      if (stat_file (p, &st) != 0
+          || !streq (size, database_hex (hex, (uintmax_t) st.st_size)))
+        return 0;
+      if (streq (mtime, database_hex (hex, FILE_TIMESTAMP_STAT_MODTIME (p, st))))
+        return 1;
+      return database_file_hash (p, &h)
+        && streq (hash, database_hex (hex, h));
+    }
+
+  if (streq (what, "dir"))
+    {
+      char *mtime = database_field (&p);
+
+      if (mtime == 0 || *p == '\0')
+        return 0;
+      if (streq (mtime, "-"))
+        return stat_file (p, &st) != 0;
+      return stat_file (p, &st) == 0
+        && streq (mtime, database_hex (hex, FILE_TIMESTAMP_STAT_MODTIME (p, st)));
+    }
+
+  return 0;
+}
+
+/* Read a line of FP into *BUF, of *SIZE bytes, without its newline.
+   Return null at the end of the file.  */
+
+static char *
+database_read_line (FILE *fp, char **buf, unsigned int *size)
+{
+  unsigned int len = 0;
+
+  while (fgets (*buf + len, *size - len, fp) != 0)
+    {
+      len += strlen (*buf + len);
+      if (len > 0 && (*buf)[len - 1] == '\n')
+        {
+          (*buf)[len - 1] = '\0';
+          return *buf;
+        }
+      if (len + 1 < *size)
+        break;
+      *size *= 2;
+      *buf = xrealloc (*buf, *size);
+    }
+  return len > 0 ? *buf : 0;
+}
+
+static char *
+func_ndk_database_check (char *o, char **argv, const char *funcname UNUSED)
+{
+  char *p = argv[0];
+  unsigned int len;
+  char *w;
+  char *file;
+  FILE *fp;
+  unsigned int size = 256;
+  char *buf;
+  char *line;
+  char *copy = 0;
+  char *makefiles = 0;
+  struct variable *v;
+  char key[17];
+  int valid = 0;
+
+  w = find_next_token (&p, &len);
+  if (w == 0)
+    return o;
+  file = savestring (w, len);
+  fp = fopen (file, "r");
+  if (fp == 0)
+    {
+      free (file);
+      return o;
+    }
+
+  v = lookup_variable ("MAKEFILE_LIST", 13);
+  if (v != 0)
+    makefiles = v->value;
+
+  buf = xmalloc (size);
+  line = database_read_line (fp, &buf, &size);
+  if (line != 0 && streq (line, DATABASE_FORMAT))
+    {
+      line = database_read_line (fp, &buf, &size);
+      if (line != 0 && strncmp (line, "# key ", 6) == 0
+          && streq (line + 6, database_key (key, argv[1])))
+        while ((line = database_read_line (fp, &buf, &size)) != 0)
+          {
+            if (streq (line, "# end"))
+              {
+                valid = makefiles == 0 || *next_token (makefiles) == '\0';
+                break;
+              }
+            if (ISDB (DB_BASIC))
+              strcpy (copy = xrealloc (copy, strlen (line) + 1), line);
+            if (!database_line_valid (line, &makefiles))
+              {
+                DB (DB_BASIC, (_("Data base `%s' is out of date: %s\n"),
+                               file, copy));
+                break;
+              }
+          }
+    }
+  fclose (fp);
+  free (buf);
+  if (copy != 0)
+    free (copy);
+  free (file);
+
+  if (valid)
+    o = variable_buffer_output (o, "true", 4);
+  return o;
+}
+
+
 /* Lookup table for builtin functions.
 
    This doesn't have to be sorted; we use a straight lookup.  We might gain
@@ -2040,9 +2955,6 @@ func_abspath (char *o, char **argv, const char *funcname UNUSED)
    EXPAND_ARGS means that all arguments should be expanded before invocation.
    Functions that do namespace tricks (foreach) don't automatically expand.  */
 
-static char *func_call PARAMS ((char *o, char **argv, const char *funcname));
-
-
 static struct function_table_entry function_table_init[] =
 {
  /* Name/size */                    /* MIN MAX EXP? Function */
@@ -2081,6 +2993,10 @@ static struct function_table_entry function_table_init[] =
   { STRING_SIZE_TUPLE("and"),           1,  0,  0,  func_and},
   { STRING_SIZE_TUPLE("value"),         0,  1,  1,  func_value},
   { STRING_SIZE_TUPLE("eval"),          0,  1,  1,  func_eval},
+  { STRING_SIZE_TUPLE("ndk-closure"),   2,  2,  1,  func_ndk_closure},
+  { STRING_SIZE_TUPLE("ndk-toposort"),  2,  2,  1,  func_ndk_toposort},
+  { STRING_SIZE_TUPLE("ndk-database-save"), 2, 3, 1, func_ndk_database_save},
+  { STRING_SIZE_TUPLE("ndk-database-check"), 2, 2, 1, func_ndk_database_check},
 #ifdef EXPERIMENTAL
   { STRING_SIZE_TUPLE("eq"),            2,  2,  1,  func_eq},
   { STRING_SIZE_TUPLE("not"),           0,  1,  1,  func_not},
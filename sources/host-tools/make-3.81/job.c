@@ -29,6 +29,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.  */
 
 #include <string.h>
 
+#ifdef USE_POSIX_SPAWN
+# include <spawn.h>
+#endif
+
 /* Default shell to use.  */
 #ifdef WINDOWS32
 #include <windows.h>
@@ -434,7 +438,7 @@ child_handler (int sig UNUSED)
   */
 }
 
-extern int shell_function_pid, shell_function_completed;
+extern int shell_function_pid, shell_function_completed, shell_function_failed;
 
 /* Reap all dead children, storing the returned status and the new command
    state (`cs_finished') in the `file' member of the `struct child' for the
@@ -678,6 +682,7 @@ reap_children (int block, int err)
 	    shell_function_completed = -1;
 	  else
 	    shell_function_completed = 1;
+	  shell_function_failed = exit_sig != 0 || exit_code != 0;
 	  break;
 	}
 
@@ -694,6 +699,9 @@ reap_children (int block, int err)
            Ignore it; it was inherited from our invoker.  */
         continue;
 
+      /* The child may have changed any file.  */
+      invalidate_file_stats ();
+
       DB (DB_JOBS, (child_failed
                     ? _("Reaping losing child %p PID %ld %s\n")
                     : _("Reaping winning child 0x%08lx PID %ld %s\n"),
@@ -1258,6 +1266,26 @@ start_job_command (struct child *child)
 
 #else  /* !__EMX__ */
 
+# ifdef USE_POSIX_SPAWN
+      {
+        /* The descriptors the child side closes below.  */
+        int close_fds[4];
+        int n = 0;
+
+        if (!(flags & COMMANDS_RECURSE) && job_fds[0] >= 0)
+          {
+            close_fds[n++] = job_fds[0];
+            close_fds[n++] = job_fds[1];
+          }
+        if (job_rfd >= 0)
+          close_fds[n++] = job_rfd;
+        close_fds[n] = -1;
+
+        child->pid = child_spawn_job (child->good_stdin ? 0 : bad_stdin, 1,
+                                      argv, child->environment, close_fds, 1);
+      }
+      if (child->pid < 0)
+# endif
       child->pid = vfork ();
       environ = parent_environ;	/* Restore value child may have clobbered.  */
       if (child->pid == 0)
@@ -1971,6 +1999,114 @@ child_execute_job (int stdin_fd, int stdout_fd, char **argv, char **envp)
   /* Run the command.  */
   exec_command (argv, envp);
 }
+
+# ifdef USE_POSIX_SPAWN
+/* Return the file execvp would run for the command NAME with environ set to
+   ENVP, in new storage, or a null pointer if there is none.  */
+
+static char *
+search_command_path (const char *name, char **envp)
+{
+  unsigned int len = strlen (name);
+  const char *p;
+  char **ep;
+  char *buf;
+
+  if (strchr (name, '/') != 0)
+    return xstrdup (name);
+
+  for (ep = envp; *ep != 0; ++ep)
+    if (strneq (*ep, "PATH=", 5))
+      break;
+  if (*ep == 0)
+    return 0;
+
+  p = *ep + 5;
+  buf = xmalloc (strlen (p) + 1 + len + 1);
+  while (1)
+    {
+      const char *end = strchr (p, PATH_SEPARATOR_CHAR);
+      unsigned int dlen = end != 0 ? (unsigned int) (end - p) : strlen (p);
+      struct stat st;
+
+      /* An empty element is the current directory.  */
+      if (dlen == 0)
+        memcpy (buf, name, len + 1);
+      else
+        {
+          memcpy (buf, p, dlen);
+          buf[dlen] = '/';
+          memcpy (buf + dlen + 1, name, len + 1);
+        }
+      if (stat (buf, &st) == 0 && S_ISREG (st.st_mode)
+          && access (buf, X_OK) == 0)
+        return buf;
+
+      if (end == 0)
+        break;
+      p = end + 1;
+    }
+
+  free (buf);
+  return 0;
+}
+
+/* Start a process running the command in ARGV with environment ENVP, as
+   child_execute_job would after a vfork, and return its ID.  STDIN_FD and
+   STDOUT_FD are its stdin and stdout, the descriptors in CLOSE_FDS, ended
+   by -1, are closed in it, and no signal is blocked in it if UNBLOCK is
+   nonzero.  Return -1 if the command cannot be started this way: the
+   caller then forks, so the child reports the error as it always did.  */
+
+int
+child_spawn_job (int stdin_fd, int stdout_fd, char **argv, char **envp,
+                 const int *close_fds, int unblock)
+{
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t empty;
+  char *program;
+  pid_t pid;
+  int r;
+
+  program = search_command_path (argv[0], envp);
+  if (program == 0)
+    return -1;
+
+  posix_spawn_file_actions_init (&actions);
+  for (; *close_fds >= 0; ++close_fds)
+    posix_spawn_file_actions_addclose (&actions, *close_fds);
+  if (stdin_fd != 0)
+    posix_spawn_file_actions_adddup2 (&actions, stdin_fd, 0);
+  if (stdout_fd != 1)
+    posix_spawn_file_actions_adddup2 (&actions, stdout_fd, 1);
+  if (stdin_fd != 0)
+    posix_spawn_file_actions_addclose (&actions, stdin_fd);
+  if (stdout_fd != 1)
+    posix_spawn_file_actions_addclose (&actions, stdout_fd);
+
+  posix_spawnattr_init (&attr);
+  if (unblock)
+    {
+      sigemptyset (&empty);
+      posix_spawnattr_setsigmask (&attr, &empty);
+      posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGMASK);
+    }
+
+  r = posix_spawn (&pid, program, &actions, &attr, argv, envp);
+
+  posix_spawnattr_destroy (&attr);
+  posix_spawn_file_actions_destroy (&actions);
+  free (program);
+
+  if (r != 0)
+    {
+      DB (DB_JOBS, (_("posix_spawn %s: %s\n"), argv[0], strerror (r)));
+      return -1;
+    }
+  return pid;
+}
+# endif /* USE_POSIX_SPAWN */
 #endif /* !AMIGA && !__MSDOS__ && !VMS */
 #endif /* !WINDOWS32 */
 
@@ -78,6 +78,17 @@ extern int child_execute_job PARAMS ((int stdin_fd, int stdout_fd, char **argv,
 #else
 extern void child_execute_job PARAMS ((int stdin_fd, int stdout_fd, char **argv, char **envp));
 #endif
+
+/* Start local children with posix_spawn when it can do all that the child
+   side of vfork would, which it cannot when make has privileges to give
+   up first.  */
+#if defined (HAVE_POSIX_SPAWN) && defined (HAVE_SPAWN_H) && defined (POSIX) \
+    && !defined (GETLOADAVG_PRIVILEGED) && !defined (WINDOWS32) \
+    && !defined (__EMX__) && !defined (__MSDOS__) && !defined (_AMIGA) \
+    && !defined (VMS)
+# define USE_POSIX_SPAWN
+extern int child_spawn_job PARAMS ((int stdin_fd, int stdout_fd, char **argv, char **envp, const int *close_fds, int unblock));
+#endif
 #ifdef _AMIGA
 extern void exec_command PARAMS ((char **argv));
 #elif defined(__EMX__)
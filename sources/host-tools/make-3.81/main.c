@@ -267,6 +267,10 @@ static int print_usage_flag = 0;
 
 int warn_undefined_variables_flag;
 
+/* If nonzero, print the number of stat calls made and saved on exit.  */
+
+int print_stat_statistics_flag;
+
 /* If nonzero, always build all targets, regardless of whether
    they appear out of date or not.  */
 
@@ -354,6 +358,8 @@ static const char *const usage[] =
                               Consider FILE to be infinitely new.\n"),
     N_("\
   --warn-undefined-variables  Warn when an undefined variable is referenced.\n"),
+    N_("\
+  --stat-statistics           Print how many stat calls were made and saved.\n"),
     NULL
   };
 
@@ -416,6 +422,8 @@ static const struct command_switch switches[] =
     { 'W', string, (char *) &new_files, 0, 0, 0, 0, 0, "what-if" },
     { CHAR_MAX+4, flag, (char *) &warn_undefined_variables_flag, 1, 1, 0, 0, 0,
       "warn-undefined-variables" },
+    { CHAR_MAX+5, flag, (char *) &print_stat_statistics_flag, 1, 1, 0, 0, 0,
+      "stat-statistics" },
     { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
   };
 
@@ -1123,6 +1131,12 @@ main (int argc, char **argv, char **envp)
   do_variable_definition (NILF, ".FEATURES", "check-symlink",
                           o_default, f_append, 0);
 #endif
+  /* $(ndk-closure) and $(ndk-toposort), used by ndk-build.  */
+  do_variable_definition (NILF, ".FEATURES", "ndk-graph",
+                          o_default, f_append, 0);
+  /* $(ndk-database-save) and $(ndk-database-check).  */
+  do_variable_definition (NILF, ".FEATURES", "ndk-database",
+                          o_default, f_append, 0);
 
   /* Read in variables from the environment.  It is important that this be
      done before $(MAKE) is figured out so its definitions will not be
@@ -3058,6 +3072,9 @@ die (int status)
       if (print_data_base_flag)
 	print_data_base ();
 
+      if (print_stat_statistics_flag)
+	print_file_stats ();
+
       clean_jobserver (status);
 
       /* Try to move back to the original directory.  This is essential on
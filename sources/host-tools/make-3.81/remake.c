@@ -1047,6 +1047,8 @@ touch_file (struct file *file)
   if (!silent_flag)
     message (0, "touch %s", file->name);
 
+  invalidate_file_stats ();
+
 #ifndef	NO_ARCHIVES
   if (ar_name (file->name))
     return ar_touch (file->name);
@@ -1358,7 +1360,7 @@ name_mtime (char *name)
   struct stat st;
   int e;
 
-  EINTRLOOP (e, stat (name, &st));
+  e = stat_file (name, &st);
   if (e == 0)
     mtime = FILE_TIMESTAMP_STAT_MODTIME (name, st);
   else if (errno == ENOENT || errno == ENOTDIR)
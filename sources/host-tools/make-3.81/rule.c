@@ -584,3 +584,48 @@ print_rule_data_base (void)
                num_pattern_rules, rules);
     }
 }
+
+/* Write the pattern rules read so far as makefile text.  Only valid
+   before snap_deps.  Return nonzero if one of them cannot be written that
+   way.  */
+
+int
+write_rule_data_base (FILE *fp)
+{
+  struct rule *r;
+
+  for (r = pattern_rules; r != 0; r = r->next)
+    {
+      unsigned int i;
+      struct dep *d;
+
+      for (i = 0; r->targets[i] != 0; ++i)
+        {
+          char *name = file_name_text (r->targets[i], 1);
+
+          if (name == 0)
+            return 1;
+          fprintf (fp, "%s ", name);
+          free (name);
+        }
+      fputs (r->terminal ? "::" : ":", fp);
+
+      for (d = r->deps; d != 0; d = d->next)
+        {
+          char *text = dep_line_text (d);
+
+          if (text == 0)
+            return 1;
+          fprintf (fp, " %s", text);
+          free (text);
+        }
+
+      /* Without commands, the rule cancels the ones it matches.  */
+      if (r->cmds != 0)
+        write_commands (fp, r->cmds);
+      else
+        putc ('\n', fp);
+    }
+
+  return 0;
+}
@@ -219,6 +219,7 @@ define_variable_in_set (const char *name, unsigned int length,
   v->recursive = recursive;
   v->special = 0;
   v->expanding = 0;
+  v->env_used = 0;
   v->exp_count = 0;
   v->per_target = 0;
   v->append = 0;
@@ -353,7 +354,11 @@ lookup_variable (const char *name, unsigned int length)
 
       v = (struct variable *) hash_find_item ((struct hash_table *) &set->table, &var_key);
       if (v)
-	return v->special ? handle_special_var (v) : v;
+        {
+          if (v->origin == o_env || v->origin == o_env_override)
+            v->env_used = 1;
+          return v->special ? handle_special_var (v) : v;
+        }
     }
 
 #ifdef VMS
@@ -1471,6 +1476,222 @@ print_variable_data_base (void)
 }
 
 
+/* Writing the data base back as a makefile.  */
+
+/* Return nonzero if a line of VALUE would start or end a `define'.  */
+
+static int
+define_breaks (const char *value)
+{
+  const char *line = value;
+
+  while (line != 0)
+    {
+      const char *p = next_token (line);
+
+      if (strncmp (p, "override", 8) == 0 && isblank ((unsigned char)p[8]))
+        p = next_token (p + 8);
+      if ((strncmp (p, "define", 6) == 0
+           && (p[6] == '\0' || isspace ((unsigned char)p[6])))
+          || (strncmp (p, "endef", 5) == 0
+              && (p[5] == '\0' || isspace ((unsigned char)p[5])
+                  || p[5] == '#')))
+        return 1;
+      line = strchr (line, '\n');
+      if (line != 0)
+        ++line;
+    }
+  return 0;
+}
+
+/* Return nonzero if VALUE reads back unchanged as the right-hand side of
+   a one-line assignment.  */
+
+static int
+one_line_value (const char *value)
+{
+  unsigned int len = strlen (value);
+
+  return !isblank ((unsigned char)*value)
+    && strchr (value, '\n') == 0
+    && strchr (value, '#') == 0
+    && (len == 0 || value[len - 1] != '\\');
+}
+
+static void
+write_value (FILE *fp, const char *value, int double_dollars)
+{
+  for (; *value != '\0'; ++value)
+    {
+      if (*value == '$' && double_dollars)
+        putc ('$', fp);
+      putc (*value, fp);
+    }
+}
+
+/* Return nonzero if NAME reads back as a variable name.  */
+
+static int
+plain_variable_name (const char *name)
+{
+  return *name != '\0' && strpbrk (name, " \t\n:=#$") == 0;
+}
+
+/* Write V, a global or pattern-specific variable, as a definition.
+   A simple variable whose value does not fit on one line is written as a
+   recursive one holding the escaped value, then simply expanded.  */
+
+static int
+write_variable (FILE *fp, const struct variable *v)
+{
+  const char *override = v->origin == o_override ? "override " : "";
+
+  if (!plain_variable_name (v->name))
+    return 1;
+
+  if (one_line_value (v->value))
+    {
+      fprintf (fp, "%s%s %s= ", override, v->name, v->recursive ? "" : ":");
+      write_value (fp, v->value, !v->recursive);
+      putc ('\n', fp);
+    }
+  else
+    {
+      if (define_breaks (v->value))
+        return 1;
+      fprintf (fp, "%sdefine %s\n", override, v->name);
+      write_value (fp, v->value, !v->recursive);
+      fputs ("\nendef\n", fp);
+      if (!v->recursive)
+        fprintf (fp, "%s%s := $(%s)\n", override, v->name, v->name);
+    }
+
+  if (v->export == v_export)
+    fprintf (fp, "export %s\n", v->name);
+  else if (v->export == v_noexport)
+    fprintf (fp, "unexport %s\n", v->name);
+  return 0;
+}
+
+/* Write V, a variable of TARGET, as a target-specific assignment.  Those
+   only take one line, with comments stripped.  In the value of a simple
+   variable, `$()' keeps blanks at the start and backslashes before `#' or
+   at the end.  */
+
+static int
+write_target_variable (FILE *fp, const char *target, const struct variable *v)
+{
+  const char *p;
+  unsigned int len = strlen (v->value);
+
+  if (!plain_variable_name (v->name) || strchr (v->value, '\n') != 0
+      || (v->append && !v->recursive) || v->export != v_default)
+    return 1;
+  if (v->recursive
+      && (isblank ((unsigned char)*v->value)
+          || (len != 0 && v->value[len - 1] == '\\')))
+    return 1;
+
+  fprintf (fp, "%s: %s%s %s= %s", target,
+           v->origin == o_override ? "override " : "", v->name,
+           v->append ? "+" : v->recursive ? "" : ":",
+           isblank ((unsigned char)*v->value) ? "$()" : "");
+  for (p = v->value; *p != '\0'; ++p)
+    {
+      if (*p == '#')
+        {
+          if (p != v->value && p[-1] == '\\')
+            {
+              if (v->recursive)
+                return 1;
+              fputs ("$()", fp);
+            }
+          putc ('\\', fp);
+        }
+      else if (*p == '$' && !v->recursive)
+        putc ('$', fp);
+      putc (*p, fp);
+    }
+  fputs (len != 0 && v->value[len - 1] == '\\' ? "$()\n" : "\n", fp);
+  return 0;
+}
+
+static int
+variable_name_cmp (const void *x, const void *y)
+{
+  return strcmp ((*(struct variable const **) x)->name,
+                 (*(struct variable const **) y)->name);
+}
+
+/* Write the variables that makefiles defined in the global set, then the
+   pattern-specific ones.  Return nonzero if one of them cannot be written
+   as makefile text.  */
+
+int
+write_variable_data_base (FILE *fp)
+{
+  struct variable **vars;
+  struct variable **vp;
+  struct pattern_var *p;
+  int bad = 0;
+
+  vars = (struct variable **) hash_dump (&global_variable_set.table, 0,
+                                         variable_name_cmp);
+  for (vp = vars; *vp != 0 && !bad; ++vp)
+    {
+      struct variable *v = *vp;
+
+      /* Make sets these again on each run.  */
+      if (v->special || streq (v->name, "MAKEFILE_LIST")
+          || streq (v->name, "CURDIR") || streq (v->name, "MAKEFLAGS"))
+        continue;
+
+      if (v->origin == o_file || v->origin == o_override)
+        bad = write_variable (fp, v);
+    }
+  free (vars);
+
+  if (export_all_variables)
+    fputs ("export\n", fp);
+
+  for (p = pattern_vars; p != 0 && !bad; p = p->next)
+    bad = write_target_variable (fp, p->target, &p->variable);
+
+  return bad;
+}
+
+/* Write the target-specific variables of SET, which belongs to TARGET.  */
+
+int
+write_target_variables (FILE *fp, const char *target, struct variable_set *set)
+{
+  struct variable **vars;
+  struct variable **vp;
+  int bad = 0;
+
+  vars = (struct variable **) hash_dump (&set->table, 0, variable_name_cmp);
+  for (vp = vars; *vp != 0 && !bad; ++vp)
+    bad = write_target_variable (fp, target, *vp);
+  free (vars);
+
+  return bad;
+}
+
+/* Call FN with the name of each global variable that was looked up while
+   its value came from the environment.  */
+
+void
+map_used_environment (void (*fn) (const char *name, void *arg), void *arg)
+{
+  struct variable **vp = (struct variable **) global_variable_set.table.ht_vec;
+  struct variable **end = &vp[global_variable_set.table.ht_size];
+
+  for (; vp < end; ++vp)
+    if (!HASH_VACANT (*vp) && (*vp)->env_used)
+      fn ((*vp)->name, arg);
+}
+
+
 /* Print all the local variables of FILE.  */
 
 void
@@ -63,6 +63,8 @@ struct variable
     unsigned int exportable:1;  /* Nonzero if the variable _could_ be
                                    exported.  */
     unsigned int expanding:1;	/* Nonzero if currently being expanded.  */
+    unsigned int env_used:1;	/* Nonzero if looked up while its value
+                                   came from the environment.  */
     unsigned int exp_count:EXP_COUNT_BITS;
                                 /* If >1, allow this many self-referential
                                    expansions.  */
@@ -143,6 +145,9 @@ extern void define_automatic_variables PARAMS ((void));
 extern void initialize_file_variables PARAMS ((struct file *file, int read));
 extern void print_file_variables PARAMS ((struct file *file));
 extern void print_variable_set PARAMS ((struct variable_set *set, char *prefix));
+extern int write_variable_data_base PARAMS ((FILE *fp));
+extern int write_target_variables PARAMS ((FILE *fp, const char *target, struct variable_set *set));
+extern void map_used_environment PARAMS ((void (*fn) (const char *name, void *arg), void *arg));
 extern void merge_variable_set_lists PARAMS ((struct variable_set_list **to_list, struct variable_set_list *from_list));
 extern struct variable *do_variable_definition PARAMS ((const struct floc *flocp, const char *name, char *value, enum variable_origin origin, enum variable_flavor flavor, int target_var));
 extern struct variable *parse_variable_definition PARAMS ((struct variable *v, char *line));
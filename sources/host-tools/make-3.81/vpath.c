@@ -526,7 +526,7 @@ selective_vpath_search (struct vpath *path, char **file,
 	    {
               int e;
 
-              EINTRLOOP (e, stat (name, &st)); /* Does it really exist?  */
+              e = stat_file (name, &st); /* Does it really exist?  */
               if (e != 0)
                 {
                   exists = 0;
@@ -603,3 +603,27 @@ print_vpath_data_base (void)
 		path[i + 1] == 0 ? '\n' : PATH_SEPARATOR_CHAR);
     }
 }
+
+/* Write the `vpath' directives read so far, which are kept in reverse
+   order until build_vpath_lists.  */
+
+static void
+write_vpath (FILE *fp, struct vpath *v)
+{
+  unsigned int i;
+
+  if (v == 0)
+    return;
+  write_vpath (fp, v->next);
+
+  fprintf (fp, "vpath %s ", v->pattern);
+  for (i = 0; v->searchpath[i] != 0; ++i)
+    fprintf (fp, "%s%c", v->searchpath[i],
+             v->searchpath[i + 1] == 0 ? '\n' : PATH_SEPARATOR_CHAR);
+}
+
+void
+write_vpath_data_base (FILE *fp)
+{
+  write_vpath (fp, vpaths);
+}
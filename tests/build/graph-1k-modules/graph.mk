@@ -0,0 +1,19 @@
+# Computes the closure and topological order of a synthetic module graph
+# with the ndk-build graph functions. GRAPH is a makefile that defines
+# ROOTS and <module>_depends for each module.
+
+BUILD_SYSTEM := $(NDK)/build/core
+include $(NDK)/build/gmsl/gmsl
+include $(BUILD_SYSTEM)/definitions-tests.mk
+include $(BUILD_SYSTEM)/definitions-utils.mk
+include $(BUILD_SYSTEM)/definitions-graph.mk
+include $(GRAPH)
+
+-graph-deps = $($1_depends)
+
+$(info closure: $(call -ndk-mod-get-closure,$(ROOTS),-graph-deps))
+$(info bfs: $(call -ndk-mod-get-bfs-list,$(firstword $(ROOTS)),-graph-deps))
+$(foreach _root,$(ROOTS),\
+  $(info topo $(_root): $(call -ndk-mod-get-topo-list,$(_root),-graph-deps)))
+
+all: ;
@@ -2,6 +2,12 @@ LOCAL_PATH := $(call my-dir)
 
 include $(CLEAR_VARS)
 LOCAL_MODULE := test-iostream
-LOCAL_SRC_FILES := main.cpp 
+LOCAL_SRC_FILES := main.cpp
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := test-iostream-bench
+LOCAL_SRC_FILES := bench.cpp
 
 include $(BUILD_EXECUTABLE)
@@ -0,0 +1,118 @@
+// Standard stream throughput against stdio, with the C++ streams synchronized
+// with stdio (the default) and after std::ios_base::sync_with_stdio(false).
+// Output goes to /dev/null, input comes from a scratch file; results are
+// printed to stderr.
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const int N = 200000;
+static const char *SCRATCH = "/data/local/tmp/test-iostream-bench.txt";
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void report(const char *name, bool sync, double t0)
+{
+    double ms = now() - t0;
+    fprintf(stderr, "%-14s %-6s %9.2f ms %8.2f Mops/s\n", name, sync ? "sync" : "unsync",
+            ms, N / (ms * 1e3));
+}
+
+static void write_ints(bool sync)
+{
+    std::ios_base::sync_with_stdio(sync);
+    double t0 = now();
+    for (int i = 0; i < N; ++i)
+        std::cout << i << '\n';
+    std::cout.flush();
+    report("cout << int", sync, t0);
+}
+
+static void write_lines(bool sync)
+{
+    std::ios_base::sync_with_stdio(sync);
+    std::string line(60, 'x');
+    double t0 = now();
+    for (int i = 0; i < N; ++i)
+        std::cout << line << '\n';
+    std::cout.flush();
+    report("cout << string", sync, t0);
+}
+
+static void read_ints(bool sync)
+{
+    std::ios_base::sync_with_stdio(sync);
+    rewind(stdin);
+    std::cin.clear();
+    long sum = 0;
+    int x;
+    double t0 = now();
+    while (std::cin >> x)
+        sum += x;
+    report("cin >> int", sync, t0);
+    if (sum != (long)N * (N - 1) / 2)
+        fprintf(stderr, "ERROR: read sum %ld\n", sum);
+}
+
+int main()
+{
+    FILE *f = fopen(SCRATCH, "w");
+    if (!f)
+    {
+        perror(SCRATCH);
+        return 1;
+    }
+    for (int i = 0; i < N; ++i)
+        fprintf(f, "%d\n", i);
+    fclose(f);
+
+    if (!freopen("/dev/null", "w", stdout) || !freopen(SCRATCH, "r", stdin))
+    {
+        perror("freopen");
+        return 1;
+    }
+
+    double t0 = now();
+    for (int i = 0; i < N; ++i)
+        printf("%d\n", i);
+    fflush(stdout);
+    report("printf", true, t0);
+
+    std::string line(60, 'x');
+    t0 = now();
+    for (int i = 0; i < N; ++i)
+    {
+        fputs(line.c_str(), stdout);
+        putchar('\n');
+    }
+    fflush(stdout);
+    report("fputs", true, t0);
+
+    write_ints(true);
+    write_ints(false);
+    write_lines(true);
+    write_lines(false);
+
+    rewind(stdin);
+    long sum = 0;
+    int x;
+    t0 = now();
+    while (scanf("%d", &x) == 1)
+        sum += x;
+    report("scanf", true, t0);
+
+    read_ints(true);
+    read_ints(false);
+
+    std::ios_base::sync_with_stdio(true);
+    remove(SCRATCH);
+    return 0;
+}
@@ -3,7 +3,7 @@
 
 LOCAL_PATH := $(call my-dir)
 
-TEST_LIBCRYSTAX_VFS := false
+TEST_LIBCRYSTAX_VFS := true
 
 include $(CLEAR_VARS)
 LOCAL_MODULE     := test-libcrystax
@@ -13,11 +13,14 @@ LOCAL_CPPFLAGS   := -std=gnu++0x
 LOCAL_SRC_FILES  := main.cpp \
 	list.cpp \
 	open-self.cpp \
+	jni-cache.cpp \
 
 ifeq ($(TEST_LIBCRYSTAX_VFS),true)
 
 LOCAL_STATIC_LIBRARIES += crystaxvfs_static
-LOCAL_CFLAGS += -DTEST_LIBCRYSTAXVFS=1
+LOCAL_CFLAGS += -DTEST_LIBCRYSTAX_VFS=1
+LOCAL_LDLIBS += -lz
+LOCAL_C_INCLUDES += $(NDK_ROOT)/sources/crystax/vfs
 
 LOCAL_SRC_FILES += \
     dirname.cpp \
@@ -29,6 +32,13 @@ LOCAL_SRC_FILES += \
     is_absolute.cpp \
     normalize.cpp \
     is_normalized.cpp \
+    poll.cpp \
+    pollset.cpp \
+    vfs-cache.cpp \
+    vfs-tmpfs.cpp \
+    vfs-zip.cpp \
+    vfs-aio.cpp \
+    vfs-trace.cpp \
 
 endif
 
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include <crystax.h>
 #include <crystax/common.hpp>
 
@@ -21,7 +22,23 @@ int test_relpath();
 int test_basename();
 int test_dirname();
 int test_path();
+int test_poll();
+int test_pollset();
+int test_vfs_cache();
+int test_vfs_tmpfs();
+int test_vfs_zip();
+int test_vfs_aio();
+int test_vfs_trace();
 int test_list();
 int test_open_self();
+int test_jni_cache();
+
+// Monotonic time in milliseconds, for timings printed by the tests
+static inline double now()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
 
 #endif /* TEST_LIBCRYSTAX_48f8fbd909ef410d9d798cfacbd1e580 */
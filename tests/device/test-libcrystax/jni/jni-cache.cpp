@@ -0,0 +1,180 @@
+#include "common.h"
+#include <crystax/jutils.hpp>
+
+// There is no JVM in standalone executable, so this test drives jutils
+// through mock JNIEnv which just counts JNI transitions. Java strings are
+// represented by plain ASCII C strings.
+
+namespace
+{
+
+unsigned transitions = 0;
+
+struct mock_class_t {const char *name;};
+mock_class_t mock_class = {"java/io/InputStream"};
+
+jclass mock_FindClass(JNIEnv *, const char *) {++transitions; return (jclass)&mock_class;}
+jobject mock_NewGlobalRef(JNIEnv *, jobject obj) {++transitions; return obj;}
+void mock_DeleteGlobalRef(JNIEnv *, jobject) {++transitions;}
+jobject mock_NewLocalRef(JNIEnv *, jobject obj) {++transitions; return obj;}
+void mock_DeleteLocalRef(JNIEnv *, jobject) {++transitions;}
+jboolean mock_ExceptionCheck(JNIEnv *) {++transitions; return JNI_FALSE;}
+
+jmethodID mock_GetMethodID(JNIEnv *, jclass, const char *name, const char *)
+{
+    ++transitions;
+    return (jmethodID)name;
+}
+
+jfieldID mock_GetFieldID(JNIEnv *, jclass, const char *name, const char *)
+{
+    ++transitions;
+    return (jfieldID)name;
+}
+
+jsize mock_GetStringLength(JNIEnv *, jstring s)
+{
+    ++transitions;
+    return (jsize)::strlen((const char *)s);
+}
+
+jsize mock_GetStringUTFLength(JNIEnv *, jstring s)
+{
+    ++transitions;
+    return (jsize)::strlen((const char *)s);
+}
+
+void mock_GetStringUTFRegion(JNIEnv *, jstring s, jsize start, jsize len, char *buf)
+{
+    ++transitions;
+    ::memcpy(buf, (const char *)s + start, len);
+}
+
+const char *mock_GetStringUTFChars(JNIEnv *, jstring s, jboolean *)
+{
+    ++transitions;
+    return ::strdup((const char *)s);
+}
+
+void mock_ReleaseStringUTFChars(JNIEnv *, jstring, const char *s)
+{
+    ++transitions;
+    ::free((void *)s);
+}
+
+} // anonymous namespace
+
+int test_jni_cache()
+{
+#ifdef TEST_JNI_CHECK
+#undef TEST_JNI_CHECK
+#endif
+#define TEST_JNI_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - jni-cache\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    static JNINativeInterface iface;
+    ::memset(&iface, 0, sizeof(iface));
+    iface.FindClass = &mock_FindClass;
+    iface.NewGlobalRef = &mock_NewGlobalRef;
+    iface.DeleteGlobalRef = &mock_DeleteGlobalRef;
+    iface.NewLocalRef = &mock_NewLocalRef;
+    iface.DeleteLocalRef = &mock_DeleteLocalRef;
+    iface.ExceptionCheck = &mock_ExceptionCheck;
+    iface.GetMethodID = &mock_GetMethodID;
+    iface.GetStaticMethodID = &mock_GetMethodID;
+    iface.GetFieldID = &mock_GetFieldID;
+    iface.GetStaticFieldID = &mock_GetFieldID;
+    iface.GetStringLength = &mock_GetStringLength;
+    iface.GetStringUTFLength = &mock_GetStringUTFLength;
+    iface.GetStringUTFRegion = &mock_GetStringUTFRegion;
+    iface.GetStringUTFChars = &mock_GetStringUTFChars;
+    iface.ReleaseStringUTFChars = &mock_ReleaseStringUTFChars;
+
+    static JNIEnv env;
+    env.functions = &iface;
+    crystax_save_jnienv(&env);
+
+    using namespace ::crystax::jni;
+
+    const unsigned N = 100000;
+
+    // Uncached: what every call used to cost
+    transitions = 0;
+    double t0 = now();
+    for (unsigned i = 0; i < N; ++i)
+    {
+        jclass cls = env.FindClass("java/io/InputStream");
+        env.GetMethodID(cls, "read", "([B)I");
+        env.DeleteLocalRef(cls);
+    }
+    double t1 = now();
+    unsigned uncached = transitions;
+
+    transitions = 0;
+    double t2 = now();
+    for (unsigned i = 0; i < N; ++i)
+        cached_method_id(&env, "java/io/InputStream", "read", "([B)I");
+    double t3 = now();
+    unsigned cached = transitions;
+
+    ::printf("method lookup x%u: uncached %u JNI calls (%.2f ms), cached %u JNI calls (%.2f ms)\n",
+        N, uncached, t1 - t0, cached, t3 - t2);
+    TEST_JNI_CHECK(uncached == 3 * N);
+    // FindClass, NewGlobalRef, DeleteLocalRef and GetMethodID, once
+    TEST_JNI_CHECK(cached <= 4);
+    TEST_JNI_CHECK(cached_method_id(&env, "java/io/InputStream", "read", "([B)I") == (jmethodID)"read");
+    TEST_JNI_CHECK(cached_method_id(&env, "java/io/InputStream", "skip", "(J)J") == (jmethodID)"skip");
+    TEST_JNI_CHECK(cached_field_id(&env, "java/io/InputStream", "read", "I") == (jfieldID)"read");
+
+    // String conversion
+    jstring str = (jstring)"/data/data/net.crystax.test/files/some/path";
+
+    transitions = 0;
+    t0 = now();
+    for (unsigned i = 0; i < N; ++i)
+    {
+        const char *s = env.GetStringUTFChars(str, JNI_FALSE);
+        char *dup = ::strdup(s);
+        env.ReleaseStringUTFChars(str, s);
+        ::free(dup);
+    }
+    t1 = now();
+    uncached = transitions;
+
+    transitions = 0;
+    t2 = now();
+    for (unsigned i = 0; i < N; ++i)
+    {
+        jstring_chars<> s(&env, str);
+        if (s.length() != ::strlen((const char *)str))
+            break;
+    }
+    t3 = now();
+    cached = transitions;
+
+    ::printf("string conversion x%u: strdup %u JNI calls (%.2f ms), jstring_chars %u JNI calls (%.2f ms)\n",
+        N, uncached, t1 - t0, cached, t3 - t2);
+
+    jstring_chars<> chars(&env, str);
+    TEST_JNI_CHECK(::strcmp(chars.c_str(), (const char *)str) == 0);
+
+    jstring_chars<8> longchars(&env, str);
+    TEST_JNI_CHECK(::strcmp(longchars.c_str(), (const char *)str) == 0);
+
+    char small[8];
+    TEST_JNI_CHECK(jstring_to_utf(&env, str, small, sizeof(small)) == ::strlen((const char *)str));
+    TEST_JNI_CHECK(::strlen(small) < sizeof(small));
+
+    clear_cache(&env);
+    crystax_save_jnienv(NULL);
+    return 0;
+}
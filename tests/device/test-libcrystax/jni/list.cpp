@@ -17,6 +17,25 @@ struct entry_t
 int test_list()
 {
 #ifdef TEST_LIST_CHECK
+    TEST_LIST_CHECK(list.push_front(new entry_t(1)) == true);
+    TEST_LIST_CHECK(list.push_front(new entry_t(0)) == true);
+    TEST_LIST_CHECK(list.size() == 2);
+    TEST_LIST_CHECK(list.head()->data == 0);
+    TEST_LIST_CHECK(list.tail()->data == 1);
+    TEST_LIST_CHECK(list.head()->prev == 0);
+    TEST_LIST_CHECK(list.head()->next == list.tail());
+    TEST_LIST_CHECK(list.tail()->prev == list.head());
+
+    TEST_LIST_CHECK(list.push(list.tail(), new entry_t(2)) == true);
+    TEST_LIST_CHECK(list.size() == 3);
+    TEST_LIST_CHECK(list.tail()->data == 2);
+    TEST_LIST_CHECK(list.tail()->next == 0);
+
+    e.reset(list.pop_back());
+    TEST_LIST_CHECK(e->data == 2);
+    TEST_LIST_CHECK(list.tail()->data == 1);
+    list.clear();
+
 #undef TEST_LIST_CHECK
 #endif
 #define TEST_LIST_CHECK(x) \
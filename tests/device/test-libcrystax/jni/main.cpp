@@ -17,9 +17,17 @@ int main()
     DO_TEST(basename);
     DO_TEST(dirname);
     DO_TEST(path);
+    DO_TEST(poll);
+    DO_TEST(pollset);
+    DO_TEST(vfs_cache);
+    DO_TEST(vfs_tmpfs);
+    DO_TEST(vfs_zip);
+    DO_TEST(vfs_aio);
+    DO_TEST(vfs_trace);
 #endif
     DO_TEST(list);
     DO_TEST(open_self);
+    DO_TEST(jni_cache);
 
 #undef DO_TEST
     return 0;
@@ -0,0 +1,153 @@
+#include "common.h"
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+// poll(), select() and epoll over VFS descriptors, followed by a scalability
+// run: up to 10000 sockets watched at once with only few of them ready.
+// poll() is expected to grow with number of watched sockets, epoll_wait()
+// with number of ready ones only.
+
+int test_poll()
+{
+#ifdef TEST_POLL_CHECK
+#undef TEST_POLL_CHECK
+#endif
+#define TEST_POLL_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - poll\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    // Pipe and socket in the same call; results must come back as the
+    // descriptors passed in
+    int p[2];
+    TEST_POLL_CHECK(::pipe(p) == 0);
+    int sv[2];
+    TEST_POLL_CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    struct pollfd fds[3];
+    fds[0].fd = p[0]; fds[0].events = POLLIN;
+    fds[1].fd = sv[0]; fds[1].events = POLLIN | POLLOUT;
+    fds[2].fd = -1; fds[2].events = POLLIN;
+    TEST_POLL_CHECK(::poll(fds, 3, 0) == 1);
+    TEST_POLL_CHECK(fds[0].revents == 0 && fds[1].revents == POLLOUT && fds[2].revents == 0);
+
+    TEST_POLL_CHECK(::write(p[1], "x", 1) == 1);
+    TEST_POLL_CHECK(::write(sv[1], "y", 1) == 1);
+    TEST_POLL_CHECK(::poll(fds, 3, 1000) == 2);
+    TEST_POLL_CHECK(fds[0].revents == POLLIN && fds[1].revents == (POLLIN | POLLOUT));
+
+    fd_set rfd, wfd;
+    FD_ZERO(&rfd);
+    FD_ZERO(&wfd);
+    FD_SET(p[0], &rfd);
+    FD_SET(sv[0], &rfd);
+    FD_SET(p[1], &wfd);
+    struct timeval tv = {0, 0};
+    int maxfd = p[0];
+    if (maxfd < p[1]) maxfd = p[1];
+    if (maxfd < sv[0]) maxfd = sv[0];
+    TEST_POLL_CHECK(::select(maxfd + 1, &rfd, &wfd, NULL, &tv) == 3);
+    TEST_POLL_CHECK(FD_ISSET(p[0], &rfd) && FD_ISSET(sv[0], &rfd) && FD_ISSET(p[1], &wfd));
+
+    int ep = ::epoll_create(16);
+    TEST_POLL_CHECK(ep >= 0);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = p[0];
+    TEST_POLL_CHECK(::epoll_ctl(ep, EPOLL_CTL_ADD, p[0], &ev) == 0);
+    ev.data.fd = sv[0];
+    TEST_POLL_CHECK(::epoll_ctl(ep, EPOLL_CTL_ADD, sv[0], &ev) == 0);
+    TEST_POLL_CHECK(::epoll_ctl(ep, EPOLL_CTL_ADD, sv[0], &ev) == -1 && errno == EEXIST);
+
+    struct epoll_event out[4];
+    TEST_POLL_CHECK(::epoll_wait(ep, out, 4, 0) == 2);
+    TEST_POLL_CHECK(out[0].data.fd != out[1].data.fd);
+    TEST_POLL_CHECK(out[0].data.fd == p[0] || out[0].data.fd == sv[0]);
+    TEST_POLL_CHECK(out[1].data.fd == p[0] || out[1].data.fd == sv[0]);
+
+    char c;
+    TEST_POLL_CHECK(::read(p[0], &c, 1) == 1);
+    TEST_POLL_CHECK(::read(sv[0], &c, 1) == 1);
+    TEST_POLL_CHECK(::epoll_wait(ep, out, 4, 10) == 0);
+
+    ::close(ep);
+    ::close(p[0]);
+    ::close(p[1]);
+    ::close(sv[0]);
+    ::close(sv[1]);
+
+    // Scalability
+    const int MAXSOCKS = 10000;
+    const int READY = 16;
+    const int ROUNDS = 200;
+
+    struct rlimit rl;
+    if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int *socks = (int *)::malloc(MAXSOCKS * sizeof(int));
+    struct pollfd *pfds = (struct pollfd *)::malloc(MAXSOCKS / 2 * sizeof(struct pollfd));
+    TEST_POLL_CHECK(socks && pfds);
+
+    // Stop at whatever limit comes first: rlimit or VFS descriptor table
+    int nsocks = 0;
+    while (nsocks + 2 <= MAXSOCKS && ::socketpair(AF_UNIX, SOCK_STREAM, 0, socks + nsocks) == 0)
+        nsocks += 2;
+    int npairs = nsocks / 2;
+    ::printf("%d sockets open (%d watched), %d ready\n", nsocks, npairs, READY);
+    TEST_POLL_CHECK(npairs > READY);
+
+    ep = ::epoll_create(npairs);
+    TEST_POLL_CHECK(ep >= 0);
+    for (int i = 0; i < npairs; ++i)
+    {
+        pfds[i].fd = socks[2 * i];
+        pfds[i].events = POLLIN;
+        ev.events = EPOLLIN;
+        ev.data.fd = socks[2 * i];
+        if (::epoll_ctl(ep, EPOLL_CTL_ADD, socks[2 * i], &ev) != 0)
+            break;
+    }
+    for (int i = 0; i < READY; ++i)
+        TEST_POLL_CHECK(::write(socks[2 * (i * npairs / READY) + 1], "z", 1) == 1);
+
+    double t0 = now();
+    int nready = 0;
+    for (int i = 0; i < ROUNDS; ++i)
+        nready = ::poll(pfds, npairs, 0);
+    double t1 = now();
+    TEST_POLL_CHECK(nready == READY);
+
+    struct epoll_event events[READY * 2];
+    double t2 = now();
+    for (int i = 0; i < ROUNDS; ++i)
+        nready = ::epoll_wait(ep, events, READY * 2, 0);
+    double t3 = now();
+    TEST_POLL_CHECK(nready == READY);
+
+    ::printf("poll: %.3f ms/call, epoll_wait: %.3f ms/call\n",
+        (t1 - t0) / ROUNDS, (t3 - t2) / ROUNDS);
+
+    ::close(ep);
+    for (int i = 0; i < nsocks; ++i)
+        ::close(socks[i]);
+    ::free(pfds);
+    ::free(socks);
+
+    return 0;
+}
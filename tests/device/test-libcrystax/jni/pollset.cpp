@@ -0,0 +1,289 @@
+#include "common.h"
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <crystax/jutils.hpp>
+#include "osfs/pollset.hpp"
+
+// Drives the persistent interest set behind libcore Posix.poll() the way
+// java.nio Selector does, through mock JNIEnv. StructPollfd and FileDescriptor
+// objects are plain structs here; every JNI call is counted.
+
+using ::crystax::fileio::osfs::pollset_t;
+using ::crystax::fileio::osfs::pollfd_fields_t;
+
+namespace
+{
+
+unsigned transitions = 0;
+
+// Once set, weak references read as cleared, as if Selector was collected
+bool collected = false;
+unsigned weak_deleted = 0;
+
+struct mock_fd_t {int descriptor;};
+struct mock_pollfd_t {mock_fd_t *fd; short events; short revents;};
+struct mock_array_t {size_t length; mock_pollfd_t **elems;};
+
+char fid_fd, fid_events, fid_revents, fid_descriptor;
+
+jsize mock_GetArrayLength(JNIEnv *, jarray a)
+{
+    ++transitions;
+    return ((mock_array_t *)a)->length;
+}
+
+jobject mock_GetObjectArrayElement(JNIEnv *, jobjectArray a, jsize i)
+{
+    ++transitions;
+    return (jobject)((mock_array_t *)a)->elems[i];
+}
+
+jobject mock_GetObjectField(JNIEnv *, jobject obj, jfieldID)
+{
+    ++transitions;
+    return (jobject)((mock_pollfd_t *)obj)->fd;
+}
+
+jint mock_GetIntField(JNIEnv *, jobject obj, jfieldID)
+{
+    ++transitions;
+    return ((mock_fd_t *)obj)->descriptor;
+}
+
+jshort mock_GetShortField(JNIEnv *, jobject obj, jfieldID fid)
+{
+    ++transitions;
+    mock_pollfd_t *p = (mock_pollfd_t *)obj;
+    return fid == (jfieldID)&fid_events ? p->events : p->revents;
+}
+
+void mock_SetShortField(JNIEnv *, jobject obj, jfieldID, jshort value)
+{
+    ++transitions;
+    ((mock_pollfd_t *)obj)->revents = value;
+}
+
+jboolean mock_IsSameObject(JNIEnv *, jobject a, jobject b) {++transitions; return a == b || (collected && !b);}
+jweak mock_NewWeakGlobalRef(JNIEnv *, jobject obj) {++transitions; return obj;}
+void mock_DeleteWeakGlobalRef(JNIEnv *, jweak) {++transitions; ++weak_deleted;}
+jobject mock_NewGlobalRef(JNIEnv *, jobject obj) {++transitions; return obj;}
+void mock_DeleteGlobalRef(JNIEnv *, jobject) {++transitions;}
+jobject mock_NewLocalRef(JNIEnv *, jobject obj) {++transitions; return obj;}
+void mock_DeleteLocalRef(JNIEnv *, jobject) {++transitions;}
+jint mock_PushLocalFrame(JNIEnv *, jint) {++transitions; return 0;}
+jobject mock_PopLocalFrame(JNIEnv *, jobject) {++transitions; return NULL;}
+
+pollfd_fields_t fields = {
+    (jfieldID)&fid_fd, (jfieldID)&fid_events, (jfieldID)&fid_revents, (jfieldID)&fid_descriptor
+};
+
+// What Posix_poll() does without persistent set
+int plain_poll(JNIEnv *env, jobjectArray javaStructs, int timeoutMs)
+{
+    using ::crystax::jni::jhobject;
+    size_t length = env->GetArrayLength(javaStructs);
+    struct pollfd *fds = (struct pollfd *)::calloc(length, sizeof(struct pollfd));
+    size_t count = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        jhobject javaStruct(env->GetObjectArrayElement(javaStructs, i));
+        if (!javaStruct)
+            break;
+        jhobject javaFd(env->GetObjectField(javaStruct.get(), fields.fd));
+        if (!javaFd)
+            break;
+        fds[count].fd = env->GetIntField(javaFd.get(), fields.descriptor);
+        fds[count].events = env->GetShortField(javaStruct.get(), fields.events);
+        ++count;
+    }
+    int rc = ::poll(fds, count, timeoutMs);
+    for (size_t i = 0; rc >= 0 && i < count; ++i)
+    {
+        jhobject javaStruct(env->GetObjectArrayElement(javaStructs, i));
+        env->SetShortField(javaStruct.get(), fields.revents, fds[i].revents);
+    }
+    ::free(fds);
+    return rc;
+}
+
+} // anonymous namespace
+
+int test_pollset()
+{
+#ifdef TEST_POLLSET_CHECK
+#undef TEST_POLLSET_CHECK
+#endif
+#define TEST_POLLSET_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - pollset\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    static JNINativeInterface iface;
+    ::memset(&iface, 0, sizeof(iface));
+    iface.GetArrayLength = &mock_GetArrayLength;
+    iface.GetObjectArrayElement = &mock_GetObjectArrayElement;
+    iface.GetObjectField = &mock_GetObjectField;
+    iface.GetIntField = &mock_GetIntField;
+    iface.GetShortField = &mock_GetShortField;
+    iface.SetShortField = &mock_SetShortField;
+    iface.IsSameObject = &mock_IsSameObject;
+    iface.NewWeakGlobalRef = &mock_NewWeakGlobalRef;
+    iface.DeleteWeakGlobalRef = &mock_DeleteWeakGlobalRef;
+    iface.NewGlobalRef = &mock_NewGlobalRef;
+    iface.DeleteGlobalRef = &mock_DeleteGlobalRef;
+    iface.NewLocalRef = &mock_NewLocalRef;
+    iface.DeleteLocalRef = &mock_DeleteLocalRef;
+    iface.PushLocalFrame = &mock_PushLocalFrame;
+    iface.PopLocalFrame = &mock_PopLocalFrame;
+
+    static JNIEnv env;
+    env.functions = &iface;
+    crystax_save_jnienv(&env);
+
+    // Slot 0 is the wakeup pipe, as in SelectorImpl; the rest are channels
+    const size_t N = 256;
+    int wakeup[2];
+    TEST_POLLSET_CHECK(::pipe(wakeup) == 0);
+    int socks[N][2];
+    mock_fd_t fdobjs[N + 1];
+    mock_pollfd_t structs[N + 1];
+    mock_pollfd_t *elems[N + 1];
+    for (size_t i = 0; i <= N; ++i)
+    {
+        if (i == 0)
+            fdobjs[i].descriptor = wakeup[0];
+        else
+        {
+            TEST_POLLSET_CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, socks[i - 1]) == 0);
+            fdobjs[i].descriptor = socks[i - 1][0];
+        }
+        structs[i].fd = &fdobjs[i];
+        structs[i].events = POLLIN;
+        structs[i].revents = 0;
+        elems[i] = &structs[i];
+    }
+    mock_array_t array = {N + 1, elems};
+    jobjectArray javaStructs = (jobjectArray)&array;
+
+    int rc = -1;
+    char c = 'x';
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 0);
+
+    TEST_POLLSET_CHECK(::write(socks[3][1], &c, 1) == 1);
+    TEST_POLLSET_CHECK(::write(socks[100][1], &c, 1) == 1);
+    TEST_POLLSET_CHECK(::write(wakeup[1], &c, 1) == 1);
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 1000, fields, &rc) && rc == 3);
+    TEST_POLLSET_CHECK(structs[0].revents == POLLIN && structs[4].revents == POLLIN && structs[101].revents == POLLIN);
+    TEST_POLLSET_CHECK(structs[1].revents == 0 && structs[5].revents == 0);
+
+    // Once drained, revents written last time must be reset
+    TEST_POLLSET_CHECK(::read(socks[3][0], &c, 1) == 1);
+    TEST_POLLSET_CHECK(::read(wakeup[0], &c, 1) == 1);
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 1);
+    TEST_POLLSET_CHECK(structs[0].revents == 0 && structs[4].revents == 0 && structs[101].revents == POLLIN);
+    TEST_POLLSET_CHECK(::read(socks[100][0], &c, 1) == 1);
+
+    // Changing interest: writability of one channel
+    structs[7].events = POLLIN | POLLOUT;
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 1);
+    TEST_POLLSET_CHECK(structs[7].revents == POLLOUT);
+    structs[7].events = POLLIN;
+
+    // Cancelled key: Selector shifts the rest of channels down
+    ::close(socks[9][0]);
+    ::close(socks[9][1]);
+    for (size_t i = 10; i < N; ++i)
+        elems[i] = elems[i + 1];
+    array.length = N;
+    TEST_POLLSET_CHECK(::write(socks[20][1], &c, 1) == 1);
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 1);
+    TEST_POLLSET_CHECK(structs[21].revents == POLLIN && elems[20] == &structs[21]);
+    TEST_POLLSET_CHECK(::read(socks[20][0], &c, 1) == 1);
+
+    // Descriptor number reused by another channel between two calls
+    int reused[2];
+    ::close(socks[30][0]);
+    TEST_POLLSET_CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, reused) == 0);
+    int reusedfd = reused[0] == fdobjs[31].descriptor ? reused[0] : ::dup2(reused[0], fdobjs[31].descriptor);
+    TEST_POLLSET_CHECK(reusedfd == fdobjs[31].descriptor);
+    mock_fd_t reusedobj = {reusedfd};
+    structs[31].fd = &reusedobj;
+    TEST_POLLSET_CHECK(::write(reused[1], &c, 1) == 1);
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 1);
+    TEST_POLLSET_CHECK(structs[31].revents == POLLIN);
+    TEST_POLLSET_CHECK(::read(reusedfd, &c, 1) == 1);
+
+    // Calls which go to plain poll()
+    mock_array_t small = {4, elems};
+    TEST_POLLSET_CHECK(!pollset_t::poll(&env, (jobjectArray)&small, 0, fields, &rc));
+    mock_fd_t *saved = structs[2].fd;
+    structs[2].fd = structs[1].fd;
+    TEST_POLLSET_CHECK(!pollset_t::poll(&env, javaStructs, 0, fields, &rc));
+    structs[2].fd = saved;
+
+    // revents left by plain poll() in between must be reset as well
+    structs[5].revents = POLLIN;
+    structs[200].revents = POLLIN;
+    TEST_POLLSET_CHECK(pollset_t::poll(&env, javaStructs, 0, fields, &rc) && rc == 0);
+    TEST_POLLSET_CHECK(structs[5].revents == 0 && structs[200].revents == 0);
+
+    // Steady state: few channels ready among many
+    const unsigned ROUNDS = 1000;
+    for (size_t i = 0; i < 4; ++i)
+        TEST_POLLSET_CHECK(::write(socks[40 + 50 * i][1], &c, 1) == 1);
+
+    transitions = 0;
+    double t0 = now();
+    for (unsigned i = 0; i < ROUNDS; ++i)
+        rc = plain_poll(&env, javaStructs, 0);
+    double t1 = now();
+    unsigned plain = transitions;
+    TEST_POLLSET_CHECK(rc == 4);
+
+    transitions = 0;
+    double t2 = now();
+    for (unsigned i = 0; i < ROUNDS; ++i)
+        pollset_t::poll(&env, javaStructs, 0, fields, &rc);
+    double t3 = now();
+    unsigned persistent = transitions;
+    TEST_POLLSET_CHECK(rc == 4);
+
+    ::printf("%u channels, 4 ready: plain %u JNI calls/select (%.3f ms), persistent %u JNI calls/select (%.3f ms)\n",
+        (unsigned)N - 1, plain / ROUNDS, (t1 - t0) / ROUNDS, persistent / ROUNDS, (t3 - t2) / ROUNDS);
+    TEST_POLLSET_CHECK(persistent < plain);
+
+    // Selector collected: its set goes away with all the references it holds
+    collected = true;
+    weak_deleted = 0;
+    mock_pollfd_t *first = elems[0];
+    elems[0] = elems[1];
+    pollset_t::poll(&env, javaStructs, 0, fields, &rc);
+    elems[0] = first;
+    TEST_POLLSET_CHECK(weak_deleted >= N - 2);
+    crystax_save_jnienv(NULL);
+
+    ::close(wakeup[0]);
+    ::close(wakeup[1]);
+    ::close(reused[0]);
+    ::close(reused[1]);
+    if (reusedfd != reused[0])
+        ::close(reusedfd);
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (i == 9)
+            continue;
+        if (i != 30)
+            ::close(socks[i][0]);
+        ::close(socks[i][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "common.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <crystax/vfs.h>
+
+// Asynchronous reads and writes on the system driver and on a tmpfs mount:
+// many requests in flight on one descriptor, completion through callbacks,
+// queues and polling, cancellation and unmount with requests pending.
+// Batched reads are timed against the same preads issued one by one.
+
+namespace
+{
+
+const char *dir = "/data/local/tmp/test-libcrystax-aio";
+
+enum
+{
+    FILE_SIZE = 256 * 1024,
+    CHUNK = 4096,
+    NREQ = FILE_SIZE / CHUNK
+};
+
+unsigned char pattern(size_t off)
+{
+    return (unsigned char)(off * 7 + off / 4096);
+}
+
+int callbacks = 0;
+
+void on_done(struct crystax_vfs_aiocb *)
+{
+    __sync_add_and_fetch(&callbacks, 1);
+}
+
+// Reads the whole file in NREQ requests completing to a queue and checks
+// the data; returns elapsed ms or -1
+double read_all(int fd, unsigned char *buf)
+{
+    struct crystax_vfs_aiocb cbs[NREQ];
+    struct crystax_vfs_aiocb *list[NREQ];
+    struct crystax_vfs_aio_queue *q = crystax_vfs_aio_queue_create();
+    if (!q)
+        return -1;
+
+    ::memset(cbs, 0, sizeof(cbs));
+    // Backwards, so nothing relies on submission order
+    for (int i = 0; i < NREQ; ++i)
+    {
+        int k = NREQ - 1 - i;
+        cbs[i].fd = fd;
+        cbs[i].opcode = CRYSTAX_VFS_AIO_READ;
+        cbs[i].buf = buf + k * CHUNK;
+        cbs[i].count = CHUNK;
+        cbs[i].offset = (long long)k * CHUNK;
+        cbs[i].queue = q;
+        list[i] = &cbs[i];
+    }
+
+    double t0 = now();
+    bool ok = crystax_vfs_aio_submit(list, NREQ) == NREQ;
+    int got = 0;
+    while (ok && got < NREQ)
+    {
+        struct crystax_vfs_aiocb *done[16];
+        int n = crystax_vfs_aio_queue_wait(q, done, 16, 5000);
+        if (n <= 0)
+            ok = false;
+        for (int j = 0; j < n; ++j)
+            if (crystax_vfs_aio_error(done[j]) != 0 || crystax_vfs_aio_return(done[j]) != CHUNK)
+                ok = false;
+        got += n > 0 ? n : 0;
+    }
+    double t = now() - t0;
+    crystax_vfs_aio_queue_destroy(q);
+
+    for (size_t off = 0; ok && off < FILE_SIZE; ++off)
+        ok = buf[off] == pattern(off);
+    return ok ? t : -1;
+}
+
+double read_sync(int fd, unsigned char *buf)
+{
+    double t0 = now();
+    for (int k = NREQ - 1; k >= 0; --k)
+        if (::pread(fd, buf + k * CHUNK, CHUNK, (off_t)k * CHUNK) != CHUNK)
+            return -1;
+    return now() - t0;
+}
+
+// Writes the pattern with callbacks and polls for completion
+bool write_all(int fd)
+{
+    static unsigned char data[FILE_SIZE];
+    for (size_t off = 0; off < FILE_SIZE; ++off)
+        data[off] = pattern(off);
+
+    struct crystax_vfs_aiocb cbs[NREQ];
+    struct crystax_vfs_aiocb *list[NREQ];
+    ::memset(cbs, 0, sizeof(cbs));
+    for (int k = 0; k < NREQ; ++k)
+    {
+        cbs[k].fd = fd;
+        cbs[k].opcode = CRYSTAX_VFS_AIO_WRITE;
+        cbs[k].buf = data + k * CHUNK;
+        cbs[k].count = CHUNK;
+        cbs[k].offset = (long long)k * CHUNK;
+        cbs[k].callback = &on_done;
+        list[k] = &cbs[k];
+    }
+
+    callbacks = 0;
+    if (crystax_vfs_aio_submit(list, NREQ) != NREQ)
+        return false;
+    for (int k = 0; k < NREQ; ++k)
+    {
+        while (crystax_vfs_aio_error(&cbs[k]) == EINPROGRESS)
+            ::usleep(100);
+        if (crystax_vfs_aio_return(&cbs[k]) != CHUNK)
+            return false;
+    }
+    // Callbacks run after the result is published
+    for (int i = 0; i < 1000 && callbacks < NREQ; ++i)
+        ::usleep(1000);
+    return callbacks == NREQ;
+}
+
+} // anonymous namespace
+
+int test_vfs_aio()
+{
+#ifdef TEST_AIO_CHECK
+#undef TEST_AIO_CHECK
+#endif
+#define TEST_AIO_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - vfs-aio\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    static unsigned char buf[FILE_SIZE];
+
+    TEST_AIO_CHECK(::mkdir(dir, 0755) == 0 || errno == EEXIST);
+
+    char path[256];
+    ::snprintf(path, sizeof(path), "%s/data", dir);
+
+    // System driver
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    TEST_AIO_CHECK(fd >= 0);
+    TEST_AIO_CHECK(write_all(fd));
+    ::memset(buf, 0, sizeof(buf));
+    double tasync = read_all(fd, buf);
+    TEST_AIO_CHECK(tasync >= 0);
+    double tsync = read_sync(fd, buf);
+    TEST_AIO_CHECK(tsync >= 0);
+    // File position is not touched
+    TEST_AIO_CHECK(::lseek(fd, 0, SEEK_CUR) == 0);
+    ::printf("system: %d x %d bytes, pread %.2f ms, aio %.2f ms\n", NREQ, CHUNK, tsync, tasync);
+
+    // Bad requests
+    struct crystax_vfs_aiocb cb;
+    struct crystax_vfs_aiocb *list[1] = {&cb};
+    ::memset(&cb, 0, sizeof(cb));
+    cb.fd = fd;
+    cb.opcode = 7;
+    cb.buf = buf;
+    cb.count = 1;
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(list, 1) == -1 && errno == EINVAL);
+    cb.opcode = CRYSTAX_VFS_AIO_READ;
+    cb.offset = -1;
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(list, 1) == -1 && errno == EINVAL);
+    TEST_AIO_CHECK(::close(fd) == 0);
+    cb.offset = 0;
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(list, 1) == -1 && errno == EBADF);
+
+    // Read past the end completes with 0
+    fd = ::open(path, O_RDONLY);
+    TEST_AIO_CHECK(fd >= 0);
+    cb.fd = fd;
+    cb.offset = FILE_SIZE;
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(list, 1) == 1);
+    while (crystax_vfs_aio_error(&cb) == EINPROGRESS)
+        ::usleep(100);
+    TEST_AIO_CHECK(crystax_vfs_aio_error(&cb) == 0 && crystax_vfs_aio_return(&cb) == 0);
+    TEST_AIO_CHECK(crystax_vfs_aio_cancel(&cb) == CRYSTAX_VFS_AIO_ALLDONE);
+    TEST_AIO_CHECK(::close(fd) == 0);
+    TEST_AIO_CHECK(::unlink(path) == 0);
+
+    // tmpfs, served by the driver's own workers
+    TEST_AIO_CHECK(::mount("tmpfs", dir, "tmpfs", 0, "size=1m") == 0);
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    TEST_AIO_CHECK(fd >= 0);
+    TEST_AIO_CHECK(write_all(fd));
+    ::memset(buf, 0, sizeof(buf));
+    tasync = read_all(fd, buf);
+    TEST_AIO_CHECK(tasync >= 0);
+    tsync = read_sync(fd, buf);
+    TEST_AIO_CHECK(tsync >= 0);
+    ::printf("tmpfs: %d x %d bytes, pread %.2f ms, aio %.2f ms\n", NREQ, CHUNK, tsync, tasync);
+
+    // Cancel the tail of a long batch; whatever wasn't canceled completes
+    struct crystax_vfs_aiocb cbs[NREQ];
+    struct crystax_vfs_aiocb *many[NREQ];
+    ::memset(cbs, 0, sizeof(cbs));
+    for (int k = 0; k < NREQ; ++k)
+    {
+        cbs[k].fd = fd;
+        cbs[k].opcode = CRYSTAX_VFS_AIO_READ;
+        cbs[k].buf = buf + k * CHUNK;
+        cbs[k].count = CHUNK;
+        cbs[k].offset = (long long)k * CHUNK;
+        many[k] = &cbs[k];
+    }
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(many, NREQ) == NREQ);
+    int canceled = 0;
+    for (int k = NREQ - 1; k >= 0; --k)
+        if (crystax_vfs_aio_cancel(&cbs[k]) == CRYSTAX_VFS_AIO_CANCELED)
+            ++canceled;
+    for (int k = 0; k < NREQ; ++k)
+        while (crystax_vfs_aio_error(&cbs[k]) == EINPROGRESS)
+            ::usleep(100);
+    int failed = 0;
+    for (int k = 0; k < NREQ; ++k)
+    {
+        int err = crystax_vfs_aio_error(&cbs[k]);
+        if (err == ECANCELED)
+            ++failed;
+        else
+            TEST_AIO_CHECK(err == 0 && crystax_vfs_aio_return(&cbs[k]) == CHUNK);
+    }
+    TEST_AIO_CHECK(failed == canceled);
+    ::printf("canceled %d of %d\n", canceled, (int)NREQ);
+
+    // Unmount waits for requests still queued; ones behind the close fail
+    TEST_AIO_CHECK(crystax_vfs_aio_submit(many, NREQ) == NREQ);
+    TEST_AIO_CHECK(::close(fd) == 0);
+    TEST_AIO_CHECK(::umount(dir) == 0);
+    for (int k = 0; k < NREQ; ++k)
+    {
+        int err = crystax_vfs_aio_error(&cbs[k]);
+        TEST_AIO_CHECK(err == 0 || err == EBADF);
+    }
+    TEST_AIO_CHECK(::rmdir(dir) == 0);
+
+#undef TEST_AIO_CHECK
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "common.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <crystax/vfs.h>
+
+// Block cache stacked over a plain directory: byte-at-a-time reads must turn
+// into few block sized reads of the underlying driver, writes through the
+// same mount must be seen by readers, and umount must take the cache away.
+
+namespace
+{
+
+const char *dir = "/data/local/tmp/test-libcrystax-cache";
+const char *file = "/data/local/tmp/test-libcrystax-cache/data";
+const size_t size = 1024 * 1024 + 17;
+
+char pattern(size_t i)
+{
+    return (char)(i * 7 + i / 251);
+}
+
+// Returns number of mismatching bytes, or -1 if the file can't be read
+long read_bytewise(double *ms)
+{
+    int fd = ::open(file, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    long bad = 0;
+    double t0 = now();
+    char c;
+    size_t i = 0;
+    for (; ::read(fd, &c, 1) == 1; ++i)
+        if (c != pattern(i))
+            ++bad;
+    *ms = now() - t0;
+    ::close(fd);
+    return i == size ? bad : -1;
+}
+
+} // anonymous namespace
+
+int test_vfs_cache()
+{
+#ifdef TEST_CACHE_CHECK
+#undef TEST_CACHE_CHECK
+#endif
+#define TEST_CACHE_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - vfs-cache\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    TEST_CACHE_CHECK(::mkdir(dir, 0755) == 0 || errno == EEXIST);
+    int fd = ::open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_CACHE_CHECK(fd >= 0);
+    char buf[4096];
+    for (size_t i = 0; i < size; i += sizeof(buf))
+    {
+        size_t n = size - i < sizeof(buf) ? size - i : sizeof(buf);
+        for (size_t j = 0; j < n; ++j)
+            buf[j] = pattern(i + j);
+        TEST_CACHE_CHECK(::write(fd, buf, n) == (ssize_t)n);
+    }
+    TEST_CACHE_CHECK(::close(fd) == 0);
+
+    double uncached;
+    TEST_CACHE_CHECK(read_bytewise(&uncached) == 0);
+
+    struct crystax_vfs_cache_stats st;
+    TEST_CACHE_CHECK(crystax_vfs_cache_stats(dir, &st) == -1 && errno == EINVAL);
+    TEST_CACHE_CHECK(::mount("cache", dir, "cache", 0, "size=256k,block=foo") == -1);
+    TEST_CACHE_CHECK(::mount("cache", dir, "cache", 0, "size=256k,block=16k,readahead=64k") == 0);
+
+    double cached;
+    TEST_CACHE_CHECK(read_bytewise(&cached) == 0);
+    TEST_CACHE_CHECK(crystax_vfs_cache_stats(dir, &st) == 0);
+    ::printf("byte reads of %lu bytes: direct %.2f ms, cached %.2f ms (%llu underlying reads, %llu hits, %llu misses, %llu read ahead)\n",
+        (unsigned long)size, uncached, cached, st.ext_reads, st.hits, st.misses, st.readahead);
+    TEST_CACHE_CHECK(st.capacity == 16 && st.block_size == 16 * 1024);
+    TEST_CACHE_CHECK(st.blocks == st.capacity);
+    TEST_CACHE_CHECK(st.ext_reads < size / st.block_size * 2);
+    TEST_CACHE_CHECK(st.readahead > 0);
+
+    // Random access
+    fd = ::open(file, O_RDONLY);
+    TEST_CACHE_CHECK(fd >= 0);
+    TEST_CACHE_CHECK(::lseek(fd, -5, SEEK_END) == (off_t)size - 5);
+    TEST_CACHE_CHECK(::read(fd, buf, sizeof(buf)) == 5);
+    TEST_CACHE_CHECK(buf[0] == pattern(size - 5) && buf[4] == pattern(size - 1));
+    TEST_CACHE_CHECK(::pread(fd, buf, 3, 100000) == 3);
+    TEST_CACHE_CHECK(buf[0] == pattern(100000) && buf[2] == pattern(100002));
+
+    // Writes invalidate what readers see
+    int wfd = ::open(file, O_WRONLY);
+    TEST_CACHE_CHECK(wfd >= 0);
+    TEST_CACHE_CHECK(::pwrite(wfd, "XYZ", 3, 100000) == 3);
+    // ... and so do appends: the size grows for them too
+    TEST_CACHE_CHECK(::pwrite(wfd, "END", 3, size) == 3);
+    TEST_CACHE_CHECK(::close(wfd) == 0);
+    TEST_CACHE_CHECK(::pread(fd, buf, 3, 100000) == 3);
+    TEST_CACHE_CHECK(::memcmp(buf, "XYZ", 3) == 0);
+    TEST_CACHE_CHECK(::pread(fd, buf, sizeof(buf), size - 2) == 5);
+    TEST_CACHE_CHECK(::memcmp(buf + 2, "END", 3) == 0);
+    TEST_CACHE_CHECK(::close(fd) == 0);
+
+    TEST_CACHE_CHECK(::umount(dir) == 0);
+    TEST_CACHE_CHECK(crystax_vfs_cache_stats(dir, &st) == -1);
+    TEST_CACHE_CHECK(::unlink(file) == 0);
+    TEST_CACHE_CHECK(::rmdir(dir) == 0);
+
+#undef TEST_CACHE_CHECK
+
+    return 0;
+}
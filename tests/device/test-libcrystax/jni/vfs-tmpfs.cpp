@@ -0,0 +1,141 @@
+#include "common.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+// In-memory file system mounted over a scratch directory: the usual file and
+// directory calls, size quota, and mmap staying coherent with read()/write().
+// Timing of small writes against the same workload on flash is printed.
+
+namespace
+{
+
+const char *dir = "/data/local/tmp/test-libcrystax-tmpfs";
+
+// Creates, writes and removes many small files; returns elapsed ms or -1
+double churn(unsigned count)
+{
+    char path[256];
+    char data[512];
+    ::memset(data, 'x', sizeof(data));
+
+    double t0 = now();
+    for (unsigned i = 0; i < count; ++i)
+    {
+        ::snprintf(path, sizeof(path), "%s/f%u", dir, i);
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return -1;
+        bool ok = ::write(fd, data, sizeof(data)) == (ssize_t)sizeof(data);
+        if (::close(fd) != 0 || !ok)
+            return -1;
+    }
+    for (unsigned i = 0; i < count; ++i)
+    {
+        ::snprintf(path, sizeof(path), "%s/f%u", dir, i);
+        if (::unlink(path) != 0)
+            return -1;
+    }
+    return now() - t0;
+}
+
+} // anonymous namespace
+
+int test_vfs_tmpfs()
+{
+#ifdef TEST_TMPFS_CHECK
+#undef TEST_TMPFS_CHECK
+#endif
+#define TEST_TMPFS_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - vfs-tmpfs\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    TEST_TMPFS_CHECK(::mkdir(dir, 0755) == 0 || errno == EEXIST);
+    double onflash = churn(500);
+    TEST_TMPFS_CHECK(onflash >= 0);
+
+    TEST_TMPFS_CHECK(::mount("tmpfs", dir, "tmpfs", 0, "size=1m,mode=bad") == -1);
+    TEST_TMPFS_CHECK(::mount("tmpfs", dir, "tmpfs", 0, "size=1m,mode=0700") == 0);
+
+    struct stat st;
+    TEST_TMPFS_CHECK(::stat(dir, &st) == 0);
+    TEST_TMPFS_CHECK(S_ISDIR(st.st_mode) && (st.st_mode & 07777) == 0700);
+
+    double inmem = churn(500);
+    TEST_TMPFS_CHECK(inmem >= 0);
+    ::printf("create/write/unlink of 500 files: flash %.2f ms, tmpfs %.2f ms\n", onflash, inmem);
+
+    // Files and directories
+    char path[256];
+    ::snprintf(path, sizeof(path), "%s/sub", dir);
+    TEST_TMPFS_CHECK(::mkdir(path, 0755) == 0);
+    ::snprintf(path, sizeof(path), "%s/sub/file", dir);
+    int fd = ::open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    TEST_TMPFS_CHECK(fd >= 0);
+    TEST_TMPFS_CHECK(::write(fd, "hello", 5) == 5);
+    TEST_TMPFS_CHECK(::pwrite(fd, "!", 1, 9) == 1);
+    char buf[4096];
+    TEST_TMPFS_CHECK(::pread(fd, buf, sizeof(buf), 0) == 10);
+    TEST_TMPFS_CHECK(::memcmp(buf, "hello\0\0\0\0!", 10) == 0);
+    TEST_TMPFS_CHECK(::fstat(fd, &st) == 0 && st.st_size == 10);
+
+    ::snprintf(buf, sizeof(buf), "%s/sub", dir);
+    DIR *d = ::opendir(buf);
+    TEST_TMPFS_CHECK(d != NULL);
+    int entries = 0;
+    bool found = false;
+    for (struct dirent *e; (e = ::readdir(d)) != NULL; ++entries)
+        found = found || ::strcmp(e->d_name, "file") == 0;
+    TEST_TMPFS_CHECK(::closedir(d) == 0);
+    TEST_TMPFS_CHECK(entries == 3 && found);
+
+    char other[256];
+    ::snprintf(other, sizeof(other), "%s/moved", dir);
+    TEST_TMPFS_CHECK(::rename(path, other) == 0);
+    TEST_TMPFS_CHECK(::stat(path, &st) == -1 && errno == ENOENT);
+    TEST_TMPFS_CHECK(::symlink("moved", path) == 0);
+    TEST_TMPFS_CHECK(::stat(path, &st) == 0 && S_ISREG(st.st_mode) && st.st_size == 10);
+
+    // Shared mapping sees write() and vice versa, also after the file grows
+    char *p = (char *)::mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    TEST_TMPFS_CHECK(p != MAP_FAILED);
+    TEST_TMPFS_CHECK(::memcmp(p, "hello", 5) == 0);
+    p[0] = 'H';
+    TEST_TMPFS_CHECK(::pread(fd, buf, 1, 0) == 1 && buf[0] == 'H');
+    ::memset(buf, 'g', sizeof(buf));
+    TEST_TMPFS_CHECK(::pwrite(fd, buf, sizeof(buf), 65536) == (ssize_t)sizeof(buf));
+    TEST_TMPFS_CHECK(::pwrite(fd, "E", 1, 1) == 1);
+    TEST_TMPFS_CHECK(p[1] == 'E');
+    TEST_TMPFS_CHECK(::munmap(p, 4096) == 0);
+
+    // Quota
+    int big = ::open(other, O_WRONLY | O_APPEND);
+    TEST_TMPFS_CHECK(big >= 0);
+    ssize_t n;
+    while ((n = ::write(big, buf, sizeof(buf))) > 0);
+    TEST_TMPFS_CHECK(n == -1 && errno == ENOSPC);
+    TEST_TMPFS_CHECK(::close(big) == 0);
+    TEST_TMPFS_CHECK(::ftruncate(fd, 0) == 0);
+    TEST_TMPFS_CHECK(::write(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    TEST_TMPFS_CHECK(::close(fd) == 0);
+
+    TEST_TMPFS_CHECK(::umount(dir) == 0);
+    TEST_TMPFS_CHECK(::stat(other, &st) == -1 && errno == ENOENT);
+    TEST_TMPFS_CHECK(::rmdir(dir) == 0);
+
+#undef TEST_TMPFS_CHECK
+
+    return 0;
+}
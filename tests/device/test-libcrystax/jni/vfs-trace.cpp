@@ -0,0 +1,110 @@
+#include "common.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <crystax/vfs.h>
+
+// Tracing of VFS calls on a tmpfs mount: counters, bytes, errors and
+// latency percentiles per operation, the report, and the cost of a traced
+// and untraced read() compared.
+
+namespace
+{
+
+const char *dir = "/data/local/tmp/test-libcrystax-trace";
+
+// ns per one-byte pread() from fd
+double cost(int fd, unsigned count)
+{
+    char c;
+    double t0 = now();
+    for (unsigned i = 0; i < count; ++i)
+        if (::pread(fd, &c, 1, i & 1023) != 1)
+            return -1;
+    return (now() - t0) * 1e6 / count;
+}
+
+} // anonymous namespace
+
+int test_vfs_trace()
+{
+#ifdef TEST_TRACE_CHECK
+#undef TEST_TRACE_CHECK
+#endif
+#define TEST_TRACE_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - vfs-trace\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    TEST_TRACE_CHECK(crystax_vfs_trace_enabled() == 0);
+    TEST_TRACE_CHECK(::strcmp(crystax_vfs_trace_op_name(CRYSTAX_VFS_OP_PREAD), "pread") == 0);
+    TEST_TRACE_CHECK(crystax_vfs_trace_op_name(CRYSTAX_VFS_OP_COUNT) == NULL);
+
+    TEST_TRACE_CHECK(::mkdir(dir, 0755) == 0 || errno == EEXIST);
+    TEST_TRACE_CHECK(::mount("tmpfs", dir, "tmpfs", 0, "size=1m") == 0);
+
+    char path[256];
+    ::snprintf(path, sizeof(path), "%s/data", dir);
+    char buf[1024];
+    ::memset(buf, 'x', sizeof(buf));
+
+    // Nothing is counted while disabled
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    TEST_TRACE_CHECK(fd >= 0);
+    TEST_TRACE_CHECK(::write(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    struct crystax_vfs_trace_stats st;
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_WRITE, &st) == 0 && st.calls == 0);
+    double off = cost(fd, 100000);
+    TEST_TRACE_CHECK(off > 0);
+
+    crystax_vfs_trace_enable(1);
+    TEST_TRACE_CHECK(crystax_vfs_trace_enabled() == 1);
+    double on = cost(fd, 100000);
+    TEST_TRACE_CHECK(on > 0);
+    ::printf("pread: %.1f ns untraced, %.1f ns traced\n", off, on);
+
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_PREAD, &st) == 0);
+    TEST_TRACE_CHECK(st.calls == 100000 && st.bytes == 100000 && st.errors == 0);
+    TEST_TRACE_CHECK(st.max_ns >= crystax_vfs_trace_percentile(&st, 0.99));
+    TEST_TRACE_CHECK(crystax_vfs_trace_percentile(&st, 0.99) >= crystax_vfs_trace_percentile(&st, 0.5));
+    unsigned long long sum = 0;
+    for (int i = 0; i < CRYSTAX_VFS_TRACE_BUCKETS; ++i)
+        sum += st.histogram[i];
+    TEST_TRACE_CHECK(sum == st.calls);
+    TEST_TRACE_CHECK(::close(fd) == 0);
+
+    // Failures are counted and paths remembered
+    char missing[256];
+    ::snprintf(missing, sizeof(missing), "%s/missing", dir);
+    struct stat sst;
+    TEST_TRACE_CHECK(::stat(missing, &sst) == -1 && errno == ENOENT);
+    TEST_TRACE_CHECK(::open(missing, O_RDONLY) == -1 && errno == ENOENT);
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_STAT, &st) == 0 && st.calls == 1 && st.errors == 1);
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_OPEN, &st) == 0 && st.calls == 1 && st.errors == 1);
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_CLOSE, &st) == 0 && st.calls == 1);
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, -1, &st) == -1 && errno == EINVAL);
+    TEST_TRACE_CHECK(crystax_vfs_trace_jni_calls(dir) == 0);
+
+    TEST_TRACE_CHECK(crystax_vfs_trace_dump(1) == 0);
+
+    crystax_vfs_trace_reset();
+    TEST_TRACE_CHECK(crystax_vfs_trace_stats(dir, CRYSTAX_VFS_OP_PREAD, &st) == 0 && st.calls == 0);
+    crystax_vfs_trace_enable(0);
+
+    TEST_TRACE_CHECK(::unlink(path) == 0);
+    TEST_TRACE_CHECK(::umount(dir) == 0);
+    TEST_TRACE_CHECK(::rmdir(dir) == 0);
+
+#undef TEST_TRACE_CHECK
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "common.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// Archive mount over a zip written here: one stored and one deflated entry
+// in an implicit directory. Checks reads through the index, and times random
+// reads of the deflated entry, which restart from inflate checkpoints.
+
+namespace
+{
+
+const char *archive = "/data/local/tmp/test-libcrystax.zip";
+const char *dir = "/data/local/tmp/test-libcrystax-zip";
+const size_t size = 4 * 1024 * 1024;
+
+unsigned char pattern(size_t i)
+{
+    // Compressible, but not trivially
+    return (unsigned char)((i * 2654435761u) >> ((i >> 12) % 24));
+}
+
+void put16(unsigned char *p, unsigned v) {p[0] = v; p[1] = v >> 8;}
+void put32(unsigned char *p, unsigned v) {put16(p, v); put16(p + 2, v >> 16);}
+
+struct entry_t
+{
+    const char *name;
+    unsigned method;
+    unsigned crc;
+    unsigned csize;
+    unsigned usize;
+    unsigned offset;
+};
+
+bool write_entry(FILE *fp, entry_t &e, const unsigned char *data, size_t len)
+{
+    unsigned char *out = (unsigned char *)data;
+    uLong olen = len;
+    if (e.method == 8)
+    {
+        z_stream z;
+        ::memset(&z, 0, sizeof(z));
+        if (::deflateInit2(&z, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        olen = ::deflateBound(&z, len);
+        out = (unsigned char *)::malloc(olen);
+        z.next_in = (Bytef *)data;
+        z.avail_in = len;
+        z.next_out = out;
+        z.avail_out = olen;
+        bool ok = ::deflate(&z, Z_FINISH) == Z_STREAM_END;
+        olen = z.total_out;
+        ::deflateEnd(&z);
+        if (!ok)
+            return false;
+    }
+
+    e.crc = ::crc32(0, data, len);
+    e.csize = olen;
+    e.usize = len;
+    e.offset = ::ftell(fp);
+
+    unsigned char h[30];
+    ::memset(h, 0, sizeof(h));
+    put32(h, 0x04034b50);
+    put16(h + 4, 20);
+    put16(h + 8, e.method);
+    put32(h + 14, e.crc);
+    put32(h + 18, e.csize);
+    put32(h + 22, e.usize);
+    put16(h + 26, ::strlen(e.name));
+    bool ok = ::fwrite(h, sizeof(h), 1, fp) == 1 &&
+        ::fwrite(e.name, ::strlen(e.name), 1, fp) == 1 &&
+        ::fwrite(out, olen, 1, fp) == 1;
+    if (out != data)
+        ::free(out);
+    return ok;
+}
+
+bool write_archive(const unsigned char *big)
+{
+    FILE *fp = ::fopen(archive, "wb");
+    if (!fp)
+        return false;
+
+    const char *text = "stored entry";
+    entry_t entries[] = {
+        {"readme.txt", 0, 0, 0, 0, 0},
+        {"levels/data.bin", 8, 0, 0, 0, 0},
+    };
+    bool ok = write_entry(fp, entries[0], (const unsigned char *)text, ::strlen(text)) &&
+        write_entry(fp, entries[1], big, size);
+
+    long cd = ::ftell(fp);
+    for (size_t i = 0; ok && i < sizeof(entries) / sizeof(entries[0]); ++i)
+    {
+        entry_t &e = entries[i];
+        unsigned char h[46];
+        ::memset(h, 0, sizeof(h));
+        put32(h, 0x02014b50);
+        put16(h + 4, 20);
+        put16(h + 6, 20);
+        put16(h + 10, e.method);
+        put32(h + 16, e.crc);
+        put32(h + 20, e.csize);
+        put32(h + 24, e.usize);
+        put16(h + 28, ::strlen(e.name));
+        put32(h + 42, e.offset);
+        ok = ::fwrite(h, sizeof(h), 1, fp) == 1 && ::fwrite(e.name, ::strlen(e.name), 1, fp) == 1;
+    }
+
+    unsigned char end[22];
+    ::memset(end, 0, sizeof(end));
+    put32(end, 0x06054b50);
+    put16(end + 8, 2);
+    put16(end + 10, 2);
+    put32(end + 12, ::ftell(fp) - cd);
+    put32(end + 16, cd);
+    ok = ok && ::fwrite(end, sizeof(end), 1, fp) == 1;
+    return ::fclose(fp) == 0 && ok;
+}
+
+} // anonymous namespace
+
+int test_vfs_zip()
+{
+#ifdef TEST_ZIP_CHECK
+#undef TEST_ZIP_CHECK
+#endif
+#define TEST_ZIP_CHECK(x) \
+    if (!(x)) \
+    { \
+        ::fprintf(stderr, \
+            "FAIL at %s:%d: assertion %s failed\n", \
+            __FILE__, __LINE__, #x); \
+        return 1; \
+    } \
+    ::printf("ok %d - vfs-zip\n", __LINE__ - start)
+
+    int start = __LINE__;
+
+    static unsigned char big[size];
+    for (size_t i = 0; i < size; ++i)
+        big[i] = pattern(i);
+
+    TEST_ZIP_CHECK(write_archive(big));
+    TEST_ZIP_CHECK(::mkdir(dir, 0755) == 0 || errno == EEXIST);
+    TEST_ZIP_CHECK(::mount(archive, dir, "zip", MS_RDONLY, "span=bad") == -1);
+    TEST_ZIP_CHECK(::mount(archive, dir, "zip", MS_RDONLY, "span=256k") == 0);
+
+    char path[256];
+    struct stat st;
+    ::snprintf(path, sizeof(path), "%s/levels", dir);
+    TEST_ZIP_CHECK(::stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+    ::snprintf(path, sizeof(path), "%s/levels/data.bin", dir);
+    TEST_ZIP_CHECK(::stat(path, &st) == 0 && st.st_size == (off_t)size);
+
+    DIR *d = ::opendir(dir);
+    TEST_ZIP_CHECK(d != NULL);
+    int entries = 0;
+    while (::readdir(d))
+        ++entries;
+    TEST_ZIP_CHECK(::closedir(d) == 0);
+    TEST_ZIP_CHECK(entries == 4);
+
+    // Stored entry
+    char buf[65536];
+    ::snprintf(path, sizeof(path), "%s/readme.txt", dir);
+    int fd = ::open(path, O_RDONLY);
+    TEST_ZIP_CHECK(fd >= 0);
+    TEST_ZIP_CHECK(::read(fd, buf, sizeof(buf)) == 12 && ::memcmp(buf, "stored entry", 12) == 0);
+    TEST_ZIP_CHECK(::pread(fd, buf, 5, 7) == 5 && ::memcmp(buf, "entry", 5) == 0);
+    TEST_ZIP_CHECK(::write(fd, "x", 1) == -1);
+    TEST_ZIP_CHECK(::close(fd) == 0);
+    TEST_ZIP_CHECK(::open(path, O_RDWR) == -1 && errno == EROFS);
+    ::snprintf(path, sizeof(path), "%s/new", dir);
+    TEST_ZIP_CHECK(::open(path, O_WRONLY | O_CREAT, 0644) == -1 && errno == EROFS);
+
+    // Deflated entry, sequentially then at random offsets
+    ::snprintf(path, sizeof(path), "%s/levels/data.bin", dir);
+    fd = ::open(path, O_RDONLY);
+    TEST_ZIP_CHECK(fd >= 0);
+    double t0 = now();
+    size_t total = 0;
+    bool same = true;
+    for (ssize_t n; (n = ::read(fd, buf, sizeof(buf))) > 0; total += n)
+        same = same && ::memcmp(buf, big + total, n) == 0;
+    double t1 = now();
+    TEST_ZIP_CHECK(total == size && same);
+
+    unsigned seed = 1;
+    for (int i = 0; i < 200 && same; ++i)
+    {
+        size_t off = ::rand_r(&seed) % (size - 4096);
+        same = ::pread(fd, buf, 4096, off) == 4096 && ::memcmp(buf, big + off, 4096) == 0;
+    }
+    double t2 = now();
+    TEST_ZIP_CHECK(same);
+    ::printf("inflate %lu bytes: sequential %.2f ms, 200 random 4k reads %.2f ms\n",
+        (unsigned long)size, t1 - t0, t2 - t1);
+
+    void *p = ::mmap(NULL, 8192, PROT_READ, MAP_PRIVATE, fd, 1024 * 1024);
+    TEST_ZIP_CHECK(p != MAP_FAILED);
+    TEST_ZIP_CHECK(::memcmp(p, big + 1024 * 1024, 8192) == 0);
+    TEST_ZIP_CHECK(::munmap(p, 8192) == 0);
+    TEST_ZIP_CHECK(::close(fd) == 0);
+
+    TEST_ZIP_CHECK(::umount(dir) == 0);
+    TEST_ZIP_CHECK(::stat(path, &st) == -1);
+    TEST_ZIP_CHECK(::rmdir(dir) == 0);
+    TEST_ZIP_CHECK(::unlink(archive) == 0);
+
+#undef TEST_ZIP_CHECK
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := stlport_bench_locale
+LOCAL_SRC_FILES := bench_locale.cpp
+include $(BUILD_EXECUTABLE)
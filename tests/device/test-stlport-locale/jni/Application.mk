@@ -0,0 +1,4 @@
+APP_ABI := all
+APP_STL := stlport_shared
+STLPORT_FORCE_REBUILD := true
+APP_PLATFORM := android-8
@@ -0,0 +1,71 @@
+// Construction of named locales and facet lookup with the crystax locale
+// backend. The first locale of a name loads its data and builds the
+// facets; later ones of the same name should only take a reference.
+
+#include <locale>
+#include <string>
+#include <stdio.h>
+#include <time.h>
+
+static const int N = 100000;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void report(const char* what, int n, double t0)
+{
+    double ms = now() - t0;
+    printf("%-32s %9.2f ms %10.3f us/op\n", what, ms, ms * 1e3 / n);
+}
+
+static bool check(const std::locale& loc)
+{
+    const std::ctype<wchar_t>& ct = std::use_facet<std::ctype<wchar_t> >(loc);
+    return ct.toupper(L'\x3b1') == L'\x391' && ct.is(std::ctype_base::lower, L'\x3b1');
+}
+
+int main()
+{
+    const char* name = "el_GR.UTF-8";
+
+    double t0 = now();
+    std::locale first(name);
+    report("first locale(name)", 1, t0);
+    if (!check(first))
+    {
+        fprintf(stderr, "ERROR: wrong ctype<wchar_t> for %s\n", name);
+        return 1;
+    }
+
+    t0 = now();
+    for (int i = 0; i < N; ++i)
+        std::locale loc(name);
+    report("locale(name)", N, t0);
+
+    t0 = now();
+    for (int i = 0; i < N; ++i)
+        std::locale loc(std::locale::classic(), name, std::locale::ctype);
+    report("locale(classic, name, ctype)", N, t0);
+
+    t0 = now();
+    int n = 0;
+    for (int i = 0; i < N; ++i)
+        n += std::use_facet<std::ctype<wchar_t> >(first).is(std::ctype_base::alpha, L'\x3b1');
+    report("use_facet<ctype<wchar_t> >", N, t0);
+
+    t0 = now();
+    for (int i = 0; i < N; ++i)
+        n += std::use_facet<std::collate<char> >(first).compare("a", "a" + 1, "b", "b" + 1) < 0;
+    report("use_facet<collate<char> >", N, t0);
+
+    t0 = now();
+    for (int i = 0; i < N; ++i)
+        n += std::has_facet<std::numpunct<char> >(std::locale(name));
+    report("has_facet(locale(name))", N, t0);
+
+    return n == 3 * N ? 0 : 1;
+}
@@ -0,0 +1,6 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := stlport_bench_node_alloc
+LOCAL_SRC_FILES := bench_node_alloc.cpp
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,168 @@
+// Container churn with std::allocator, served by the STLport node
+// allocator, against an allocator calling operator new for every node.
+// The threaded rows hand every container over to another thread, which
+// frees its nodes.
+
+#include <hash_map>
+#include <list>
+#include <map>
+#include <set>
+#include <new>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+template <class T>
+class NewAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U> struct rebind { typedef NewAllocator<U> other; };
+
+    NewAllocator() {}
+    template <class U> NewAllocator(const NewAllocator<U>&) {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(size_type n, const void* = 0) { return static_cast<pointer>(::operator new(n * sizeof(T))); }
+    void deallocate(pointer p, size_type) { ::operator delete(p); }
+    size_type max_size() const { return size_type(-1) / sizeof(T); }
+    void construct(pointer p, const T& v) { new (p) T(v); }
+    void destroy(pointer p) { p->~T(); }
+};
+
+template <class T, class U>
+bool operator==(const NewAllocator<T>&, const NewAllocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const NewAllocator<T>&, const NewAllocator<U>&) { return false; }
+
+static const int N = 20000;
+static const int ROUNDS = 20;
+static const int THREADS = 4;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+template <class Map>
+static void fill_map(Map& m)
+{
+    for (int i = 0; i < N; ++i)
+        m[(i * 7919) % N] = i;
+    for (int i = 0; i < N; i += 2)
+        m.erase(i);
+}
+
+template <class Set>
+static void fill_set(Set& s)
+{
+    for (int i = 0; i < N; ++i)
+        s.insert((i * 7919) % N);
+    for (int i = 0; i < N; i += 2)
+        s.erase(i);
+}
+
+template <class List>
+static void fill_list(List& l)
+{
+    for (int i = 0; i < N; ++i)
+    {
+        l.push_back(i);
+        if (i % 3 == 0)
+            l.pop_front();
+    }
+}
+
+template <class C>
+struct Churn
+{
+    typedef void (*fill_t)(C&);
+
+    static void single(const char* name, const char* alloc, fill_t fill)
+    {
+        double t0 = now();
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            C c;
+            fill(c);
+        }
+        printf("%-9s %-6s 1 thread   %9.2f ms\n", name, alloc, now() - t0);
+    }
+
+    struct Slot
+    {
+        fill_t fill;
+        C* c;
+    };
+
+    // Frees the containers built by the previous thread on this slot
+    static void* worker(void* p)
+    {
+        Slot* slot = static_cast<Slot*>(p);
+        delete slot->c;
+        slot->c = new C;
+        slot->fill(*slot->c);
+        return 0;
+    }
+
+    static void threaded(const char* name, const char* alloc, fill_t fill)
+    {
+        Slot slots[THREADS];
+        for (int i = 0; i < THREADS; ++i)
+        {
+            slots[i].fill = fill;
+            slots[i].c = 0;
+        }
+        double t0 = now();
+        for (int r = 0; r < ROUNDS / THREADS; ++r)
+        {
+            pthread_t t[THREADS];
+            for (int i = 0; i < THREADS; ++i)
+                pthread_create(&t[i], 0, worker, &slots[(i + r) % THREADS]);
+            for (int i = 0; i < THREADS; ++i)
+                pthread_join(t[i], 0);
+        }
+        for (int i = 0; i < THREADS; ++i)
+            delete slots[i].c;
+        printf("%-9s %-6s %d threads  %9.2f ms\n", name, alloc, THREADS, now() - t0);
+    }
+};
+
+template <class Node, class New>
+static void run(const char* name, void (*fill_node)(Node&), void (*fill_new)(New&))
+{
+    Churn<Node>::single(name, "node", fill_node);
+    Churn<New>::single(name, "new", fill_new);
+    Churn<Node>::threaded(name, "node", fill_node);
+    Churn<New>::threaded(name, "new", fill_new);
+}
+
+typedef std::map<int, int> NodeMap;
+typedef std::map<int, int, std::less<int>, NewAllocator<std::pair<const int, int> > > NewMap;
+typedef std::set<int> NodeSet;
+typedef std::set<int, std::less<int>, NewAllocator<int> > NewSet;
+typedef std::list<int> NodeList;
+typedef std::list<int, NewAllocator<int> > NewList;
+typedef std::hash_map<int, int> NodeHashMap;
+typedef std::hash_map<int, int, std::hash<int>, std::equal_to<int>,
+                      NewAllocator<std::pair<const int, int> > > NewHashMap;
+
+int main()
+{
+    run<NodeMap, NewMap>("map", fill_map<NodeMap>, fill_map<NewMap>);
+    run<NodeSet, NewSet>("set", fill_set<NodeSet>, fill_set<NewSet>);
+    run<NodeList, NewList>("list", fill_list<NodeList>, fill_list<NewList>);
+    run<NodeHashMap, NewHashMap>("hash_map", fill_map<NodeHashMap>, fill_map<NewHashMap>);
+    return 0;
+}
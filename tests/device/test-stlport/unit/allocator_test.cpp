@@ -21,6 +21,9 @@ class AllocatorTest : public CPPUNIT_NS::TestCase
 #endif
 #if defined (STLPORT) && defined (_STLP_THREADS) && defined (_STLP_USE_PERTHREAD_ALLOC)
   CPPUNIT_TEST(per_thread_alloc);
+#endif
+#if defined (STLPORT) && defined (_STLP_THREADS) && defined (_STLP_NODE_ALLOC_PER_THREAD)
+  CPPUNIT_TEST(node_alloc_threads);
 #endif
   CPPUNIT_TEST_SUITE_END();
 
@@ -28,6 +31,7 @@ protected:
   void zero_allocation();
   void bad_alloc_test();
   void per_thread_alloc();
+  void node_alloc_threads();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(AllocatorTest);
@@ -166,3 +170,64 @@ void AllocatorTest::per_thread_alloc()
   }
 }
 #endif
+
+#if defined (STLPORT) && defined (_STLP_THREADS) && defined (_STLP_NODE_ALLOC_PER_THREAD)
+#  include <list>
+#  include <map>
+#  include <pthread.h>
+
+struct NodeAllocData
+{
+  list<int>* l;
+  map<int, int>* m;
+};
+
+void* build_containers(void* pdata) {
+  NodeAllocData* pd = (NodeAllocData*)pdata;
+  //Frees nodes built by the previous round's threads, now terminated:
+  delete pd->l;
+  delete pd->m;
+  pd->l = new list<int>();
+  pd->m = new map<int, int>();
+  for (int i = 0; i < 10000; ++i) {
+    pd->l->push_back(i);
+    (*pd->m)[i] = i;
+    if (i % 3 == 0) {
+      pd->l->pop_front();
+    }
+  }
+  return 0;
+}
+
+void AllocatorTest::node_alloc_threads()
+{
+  const size_t nth = 4;
+  NodeAllocData datas[nth];
+  pthread_t t[nth];
+  size_t i;
+
+  for (i = 0; i < nth; ++i) {
+    datas[i].l = 0;
+    datas[i].m = 0;
+  }
+
+  for (int round = 0; round < 3; ++round) {
+    for (i = 0; i < nth; ++i) {
+      //Every thread gets the containers of another one:
+      pthread_create(&t[i], 0, build_containers, &datas[(i + round) % nth]);
+    }
+    for (i = 0; i < nth; ++i) {
+      pthread_join(t[i], 0);
+    }
+  }
+
+  for (i = 0; i < nth; ++i) {
+    CPPUNIT_ASSERT( datas[i].l->size() == 10000 - 3334 );
+    CPPUNIT_ASSERT( datas[i].m->size() == 10000 );
+    CPPUNIT_ASSERT( (*datas[i].m)[9999] == 9999 );
+    //Nodes of terminated threads are freed from this one:
+    delete datas[i].l;
+    delete datas[i].m;
+  }
+}
+#endif
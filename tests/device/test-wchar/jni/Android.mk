@@ -22,6 +22,7 @@ LOCAL_SRC_FILES := main.c   \
 	test-towctrans.c    \
 	test-wcrtomb.c      \
 	test-wcscasecmp.c   \
+	test-wcscoll.c      \
 	test-wcsnlen.c      \
 	test-wcsnrtombs.c   \
 	test-wcsrtombs.c    \
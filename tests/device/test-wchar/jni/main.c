@@ -13,6 +13,7 @@ extern int test_ms_wprintf(void);
 extern int test_towctrans(void);
 extern int test_wcrtomb(void);
 extern int test_wcscasecmp(void);
+extern int test_wcscoll(void);
 extern int test_wcsnlen(void);
 extern int test_wcsnrtombs(void);
 extern int test_wcsrtombs(void);
@@ -46,6 +47,7 @@ int main()
     DO_WCHAR_TEST(towctrans);
     DO_WCHAR_TEST(wcrtomb);
     DO_WCHAR_TEST(wcscasecmp);
+    DO_WCHAR_TEST(wcscoll);
     DO_WCHAR_TEST(wcsnlen);
     DO_WCHAR_TEST(wcsnrtombs);
     DO_WCHAR_TEST(wcsrtombs);
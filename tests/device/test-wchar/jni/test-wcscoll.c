@@ -0,0 +1,126 @@
+#include <common.h>
+
+static const char *words[] = {
+    "", "1", "9", "a", "A", "ab", "Ab", "abc", "ABC", "abd", "AC",
+    "b", "B", "ba", "z", "Z", "zz", "[", "~"
+};
+
+#define NWORDS (sizeof(words)/sizeof(words[0]))
+
+static int sign(int v)
+{
+    return v < 0 ? -1 : v > 0 ? 1 : 0;
+}
+
+static void widen(wchar_t *dst, const char *src)
+{
+    while ((*dst++ = (unsigned char)*src++) != L'\0')
+        ;
+}
+
+/*
+ * Sort keys must order exactly like strcoll()/wcscoll() on the originals,
+ * and the narrow and wide functions must agree with each other.
+ */
+static void check_xfrm(void)
+{
+    char k1[64], k2[64];
+    wchar_t w1[64], w2[64], wk1[64], wk2[64];
+    size_t i, j;
+    int r;
+
+    for (i = 0; i < NWORDS; ++i)
+        for (j = 0; j < NWORDS; ++j)
+        {
+            r = sign(strcoll(words[i], words[j]));
+            assert(strxfrm(k1, words[i], sizeof(k1)) < sizeof(k1));
+            assert(strxfrm(k2, words[j], sizeof(k2)) < sizeof(k2));
+            assert(sign(strcmp(k1, k2)) == r);
+
+            widen(w1, words[i]);
+            widen(w2, words[j]);
+            assert(sign(wcscoll(w1, w2)) == r);
+            assert(wcsxfrm(wk1, w1, 64) < 64);
+            assert(wcsxfrm(wk2, w2, 64) < 64);
+            assert(sign(wcscmp(wk1, wk2)) == r);
+        }
+}
+
+GLOBAL
+int test_wcscoll()
+{
+    wchar_t k1[64];
+    char *locale;
+
+    printf("1..6\n");
+
+    /*
+     * C/POSIX locale.
+     */
+
+    locale = setlocale(LC_COLLATE, "C");
+    assert(locale != NULL);
+    assert(strcmp(locale, "C") == 0);
+
+    assert(wcscoll(L"", L"") == 0);
+    assert(wcscoll(L"abc", L"abc") == 0);
+    assert(wcscoll(L"abc", L"abd") < 0);
+    assert(wcscoll(L"abd", L"abc") > 0);
+    assert(wcscoll(L"ab", L"abc") < 0);
+    assert(wcscoll(L"a", L"B") > 0);
+    printf("ok 1 - wcscoll\n");
+
+    assert(wcsxfrm(NULL, L"abc", 0) == 3);
+    assert(wcsxfrm(k1, L"", 64) == 0 && k1[0] == L'\0');
+    printf("ok 2 - wcsxfrm\n");
+
+    check_xfrm();
+    printf("ok 3 - wcsxfrm/wcscoll consistency\n");
+
+    /*
+     * Latin collation table: letters sort by primary weight with case only
+     * breaking ties, and punctuation outside the digits/letters block sorts
+     * after the letters.
+     */
+
+    locale = setlocale(LC_COLLATE, "la_LN.US-ASCII");
+    assert(locale != NULL);
+    assert(strcmp(locale, "la_LN.US-ASCII") == 0);
+
+    assert(strcoll("abc", "abc") == 0);
+    assert(wcscoll(L"abc", L"abc") == 0);
+    assert(strcoll("a", "B") < 0);
+    assert(wcscoll(L"a", L"B") < 0);
+    assert(strcoll("A", "a") < 0);
+    assert(wcscoll(L"A", L"a") < 0);
+    assert(strcoll("ab", "AC") < 0);
+    assert(wcscoll(L"ab", L"AC") < 0);
+    assert(strcoll("ab", "Ab") > 0);
+    assert(wcscoll(L"Ab", L"ab") < 0);
+    assert(strcoll("abc", "ABD") < 0);
+    assert(strcoll("abc", "ABC") > 0);
+    assert(strcoll("ab", "abc") < 0);
+    assert(strcoll("9", "a") < 0);
+    assert(strcoll("z", "[") < 0);
+    assert(wcscoll(L"z", L"[") < 0);
+    printf("ok 4 - strcoll/wcscoll\n");
+
+    check_xfrm();
+    printf("ok 5 - strxfrm/wcsxfrm consistency\n");
+
+    /*
+     * el_GR.UTF-8 borrows the same collation table.
+     */
+
+    locale = setlocale(LC_COLLATE, "el_GR.UTF-8");
+    assert(locale != NULL);
+    assert(strcoll("a", "B") < 0);
+    assert(strcoll("ab", "Ab") > 0);
+    check_xfrm();
+    printf("ok 6 - el_GR.UTF-8\n");
+
+    locale = setlocale(LC_COLLATE, "C");
+    assert(locale != NULL);
+
+    return (0);
+}